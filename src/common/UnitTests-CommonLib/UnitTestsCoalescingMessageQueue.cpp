@@ -0,0 +1,159 @@
+#include "pch.h"
+#include "coalescing_message_queue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std::chrono_literals;
+
+namespace UnitTestsCoalescingMessageQueue
+{
+    struct Measurement
+    {
+        size_t sent = 0;
+        std::wstring last_sent;
+        std::chrono::microseconds queue_time{};
+        // From queueing the last update to it being sent
+        std::chrono::microseconds last_update_latency{};
+    };
+
+    // Queues updates of one PowerToy as fast as the settings window can while a slider is dragged,
+    // to a sender which takes a fixed time for every message, like a pipe connection does
+    Measurement measure_rapid_updates(const bool coalesce, const int updates, const std::chrono::microseconds send_time)
+    {
+        using clock = std::chrono::steady_clock;
+        CoalescingMessageQueue queue;
+        Measurement result;
+        clock::time_point last_queued;
+        clock::time_point last_sent;
+        const std::wstring last_update = std::to_wstring(updates - 1);
+
+        std::thread sender([&] {
+            for (std::wstring message = queue.pop_message(); !message.empty(); message = queue.pop_message())
+            {
+                std::this_thread::sleep_for(send_time);
+                ++result.sent;
+                result.last_sent = message;
+                if (message == last_update)
+                {
+                    last_sent = clock::now();
+                    queue.interrupt();
+                }
+            }
+        });
+
+        const auto start = clock::now();
+        for (int i = 0; i < updates; ++i)
+        {
+            last_queued = clock::now();
+            queue.queue_message(std::to_wstring(i), coalesce ? L"powertoys/FancyZones" : L"");
+        }
+        result.queue_time = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+        sender.join();
+        result.last_update_latency = std::chrono::duration_cast<std::chrono::microseconds>(last_sent - last_queued);
+        return result;
+    }
+
+    void log_measurement(const wchar_t* name, const int updates, const Measurement& measurement)
+    {
+        const auto queue_rate = updates * 1000000.0 / std::max<long long>(1, measurement.queue_time.count());
+        Logger::WriteMessage((std::wstring(name) +
+                              L": " + std::to_wstring(updates) + L" updates queued at " + std::to_wstring(static_cast<long long>(queue_rate)) + L"/s, " +
+                              std::to_wstring(measurement.sent) + L" sent, last update sent after " +
+                              std::to_wstring(measurement.last_update_latency.count()) + L" us\n")
+                                 .c_str());
+    }
+
+    TEST_CLASS (CoalescingMessageQueueTests)
+    {
+    public:
+        TEST_METHOD (MessagesWithoutKeyAreAllSentInOrder)
+        {
+            CoalescingMessageQueue queue;
+            queue.queue_message(L"a");
+            queue.queue_message(L"a");
+            queue.queue_message(L"b");
+            Assert::AreEqual(std::wstring(L"a"), queue.pop_message());
+            Assert::AreEqual(std::wstring(L"a"), queue.pop_message());
+            Assert::AreEqual(std::wstring(L"b"), queue.pop_message());
+        }
+
+        TEST_METHOD (PendingMessageIsReplaced)
+        {
+            CoalescingMessageQueue queue;
+            queue.queue_message(L"first", L"general");
+            queue.queue_message(L"second", L"general");
+            queue.queue_message(L"third", L"general");
+            queue.queue_message(L"last");
+            Assert::AreEqual(std::wstring(L"third"), queue.pop_message());
+            Assert::AreEqual(std::wstring(L"last"), queue.pop_message());
+        }
+
+        TEST_METHOD (SentMessageIsNotReplaced)
+        {
+            CoalescingMessageQueue queue;
+            queue.queue_message(L"first", L"general");
+            Assert::AreEqual(std::wstring(L"first"), queue.pop_message());
+            queue.queue_message(L"second", L"general");
+            queue.queue_message(L"last");
+            Assert::AreEqual(std::wstring(L"second"), queue.pop_message());
+        }
+
+        TEST_METHOD (KeysAreReplacedIndependently)
+        {
+            CoalescingMessageQueue queue;
+            queue.queue_message(L"a1", L"powertoys/A");
+            queue.queue_message(L"b1", L"powertoys/B");
+            queue.queue_message(L"a2", L"powertoys/A");
+            queue.queue_message(L"b2", L"powertoys/B");
+            queue.queue_message(L"last");
+            Assert::AreEqual(std::wstring(L"a2"), queue.pop_message());
+            Assert::AreEqual(std::wstring(L"b2"), queue.pop_message());
+            Assert::AreEqual(std::wstring(L"last"), queue.pop_message());
+        }
+
+        TEST_METHOD (MessageWithoutKeyKeepsOrder)
+        {
+            // An action queued between two states must be sent after the first one and before the second one
+            CoalescingMessageQueue queue;
+            queue.queue_message(L"state1", L"powertoys/A");
+            queue.queue_message(L"action");
+            queue.queue_message(L"state2", L"powertoys/A");
+            queue.queue_message(L"state3", L"powertoys/A");
+            Assert::AreEqual(std::wstring(L"state1"), queue.pop_message());
+            Assert::AreEqual(std::wstring(L"action"), queue.pop_message());
+            Assert::AreEqual(std::wstring(L"state3"), queue.pop_message());
+        }
+
+        TEST_METHOD (InterruptWakesSender)
+        {
+            CoalescingMessageQueue queue;
+            std::wstring message = L"not popped";
+            std::thread sender([&] { message = queue.pop_message(); });
+            std::this_thread::sleep_for(10ms);
+            queue.interrupt();
+            sender.join();
+            Assert::IsTrue(message.empty());
+        }
+
+        TEST_METHOD (RapidUpdatesAreCoalesced)
+        {
+            const int updates = 200;
+            const auto send_time = 2ms;
+            const auto fifo = measure_rapid_updates(false, updates, send_time);
+            const auto coalesced = measure_rapid_updates(true, updates, send_time);
+            log_measurement(L"Without key", updates, fifo);
+            log_measurement(L"With key", updates, coalesced);
+
+            Assert::AreEqual<size_t>(updates, fifo.sent);
+            Assert::AreEqual(std::to_wstring(updates - 1), coalesced.last_sent);
+            Assert::IsTrue(coalesced.sent < fifo.sent);
+            // Every update waits for all the ones before it without a key, the last one only for the
+            // message being sent when it's queued
+            Assert::IsTrue(coalesced.last_update_latency < fifo.last_update_latency);
+        }
+    };
+}
@@ -0,0 +1,170 @@
+#include "pch.h"
+#include "d2d_window.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std::chrono_literals;
+
+namespace UnitTestsD2DWindow
+{
+    class TestWindow : public D2DWindow
+    {
+    public:
+        TestWindow(const std::chrono::milliseconds init_time = {}) :
+            init_time(init_time)
+        {
+        }
+
+        ~TestWindow()
+        {
+            wait_for_prewarm();
+        }
+
+        HWND window() const
+        {
+            return hwnd;
+        }
+
+        // False when there is no Direct3D device to render with, e.g. on a build agent
+        bool wait_for_init()
+        {
+            wait_for_prewarm();
+            return initialized;
+        }
+
+        int resize_count = 0;
+        UINT resized_width = 0;
+        UINT resized_height = 0;
+
+    protected:
+        // Stands for loading the scene, the devices are created by base_init() before
+        void init() override
+        {
+            std::this_thread::sleep_for(init_time);
+        }
+
+        void resize() override
+        {
+            ++resize_count;
+            resized_width = window_width;
+            resized_height = window_height;
+        }
+
+        void render(ID2D1DeviceContext5* d2d_dc) override
+        {
+            d2d_dc->Clear();
+        }
+
+        void on_show() override {}
+        void on_hide() override {}
+
+    private:
+        std::chrono::milliseconds init_time;
+    };
+
+    void pump_messages(HWND window)
+    {
+        MSG msg;
+        while (PeekMessage(&msg, window, 0, 0, PM_REMOVE))
+        {
+            DispatchMessage(&msg);
+        }
+    }
+
+    long long to_us(const std::chrono::high_resolution_clock::duration duration)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    }
+
+    // Every window is destroyed before the next one is made, so each startup creates the devices again
+    bool log_startup(const wchar_t* name, const bool prewarm, const std::chrono::milliseconds show_after)
+    {
+        TestWindow window;
+        window.initialize(prewarm);
+        std::this_thread::sleep_for(show_after);
+        window.show(0, 0, 64, 64);
+        window.hide();
+        if (!window.wait_for_init())
+        {
+            return false;
+        }
+
+        const auto stats = window.get_init_stats();
+        Logger::WriteMessage((std::wstring(name) +
+                              L": initialize() blocked " + std::to_wstring(to_us(stats.initialize_time)) + L" us, init took " +
+                              std::to_wstring(to_us(stats.init_time)) + L" us, first show waited " +
+                              std::to_wstring(to_us(stats.show_wait_time)) + L" us\n")
+                                 .c_str());
+        return true;
+    }
+
+    TEST_CLASS (D2DWindowTests)
+    {
+    public:
+        TEST_METHOD (ResizeDroppedDuringPrewarmIsReplayed)
+        {
+            TestWindow window(200ms);
+            window.initialize();
+            // Sent while init() still runs in the background, base_resize() can't create the swap chain yet
+            SetWindowPos(window.window(), nullptr, 0, 0, 120, 80, SWP_NOZORDER | SWP_NOACTIVATE);
+            if (!window.wait_for_init())
+            {
+                Logger::WriteMessage(L"No Direct3D device, skipped\n");
+                return;
+            }
+            Assert::AreEqual(0, window.resize_count);
+
+            pump_messages(window.window());
+            Assert::AreEqual(1, window.resize_count);
+            Assert::AreEqual(120u, window.resized_width);
+            Assert::AreEqual(80u, window.resized_height);
+        }
+
+        TEST_METHOD (ResizeAfterInitIsNotReplayed)
+        {
+            TestWindow window;
+            try
+            {
+                window.initialize(false);
+            }
+            catch (const winrt::hresult_error&)
+            {
+                Logger::WriteMessage(L"No Direct3D device, skipped\n");
+                return;
+            }
+            // The size the window got when it was made is replayed once
+            pump_messages(window.window());
+            const int resize_count = window.resize_count;
+
+            SetWindowPos(window.window(), nullptr, 0, 0, 120, 80, SWP_NOZORDER | SWP_NOACTIVATE);
+            Assert::AreEqual(resize_count + 1, window.resize_count);
+            pump_messages(window.window());
+            Assert::AreEqual(resize_count + 1, window.resize_count);
+        }
+
+        // Not a pass/fail test, logs the startup cost with and without the prewarm for comparison
+        TEST_METHOD (MeasureStartupWithAndWithoutPrewarm)
+        {
+            try
+            {
+                for (int i = 0; i < 3; ++i)
+                {
+                    if (!log_startup(L"Synchronous, shown at once", false, 0ms) ||
+                        !log_startup(L"Prewarmed, shown at once", true, 0ms) ||
+                        !log_startup(L"Prewarmed, shown after 500 ms", true, 500ms))
+                    {
+                        Logger::WriteMessage(L"No Direct3D device, skipped\n");
+                        return;
+                    }
+                }
+            }
+            catch (const winrt::hresult_error&)
+            {
+                // Thrown by the synchronous path
+                Logger::WriteMessage(L"No Direct3D device, skipped\n");
+            }
+        }
+    };
+}
@@ -0,0 +1,91 @@
+#include "pch.h"
+#include "animation.h"
+#include "frame_scheduler.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std::chrono_literals;
+
+namespace UnitTestsFrameScheduler
+{
+    TEST_CLASS (FrameSchedulerTests)
+    {
+    public:
+        TEST_METHOD (IdleWithoutAnimations)
+        {
+            FrameScheduler scheduler;
+            auto now = FrameScheduler::clock::now();
+
+            Assert::IsFalse(scheduler.animating(now));
+            Assert::IsFalse(scheduler.frame_rendered(now, now + 2ms));
+        }
+
+        TEST_METHOD (FramesFollowUntilAnimationEnds)
+        {
+            FrameScheduler scheduler;
+            auto now = FrameScheduler::clock::now();
+            scheduler.animate_until(now + 50ms);
+
+            Assert::IsTrue(scheduler.animating(now));
+            Assert::IsTrue(scheduler.frame_rendered(now, now + 16ms));
+            Assert::IsTrue(scheduler.frame_rendered(now + 32ms, now + 48ms));
+            // Started before the end, so the final state still needs a frame
+            Assert::IsTrue(scheduler.frame_rendered(now + 48ms, now + 64ms));
+            // Draws the final state, then the window is idle
+            Assert::IsFalse(scheduler.frame_rendered(now + 64ms, now + 80ms));
+            Assert::IsFalse(scheduler.animating(now + 80ms));
+        }
+
+        TEST_METHOD (LongestAnimationWins)
+        {
+            FrameScheduler scheduler;
+            auto now = FrameScheduler::clock::now();
+            scheduler.animate_until(now + 300ms);
+            scheduler.animate_until(now + 100ms);
+
+            Assert::IsTrue(scheduler.animating(now + 200ms));
+            Assert::IsFalse(scheduler.animating(now + 300ms));
+        }
+
+        TEST_METHOD (StopGoesIdle)
+        {
+            FrameScheduler scheduler;
+            auto now = FrameScheduler::clock::now();
+            scheduler.animate_until(now + 300ms);
+            scheduler.stop();
+
+            Assert::IsFalse(scheduler.animating(now));
+            Assert::IsFalse(scheduler.frame_rendered(now, now + 16ms));
+        }
+
+        TEST_METHOD (CountsFramesAndFrameTimes)
+        {
+            FrameScheduler scheduler;
+            auto now = FrameScheduler::clock::now();
+            scheduler.animate_until(now + 20ms);
+            scheduler.frame_rendered(now, now + 10ms);
+            scheduler.frame_rendered(now + 30ms, now + 34ms);
+
+            auto stats = scheduler.stats();
+            Assert::AreEqual<uint64_t>(2, stats.frames);
+            Assert::AreEqual<uint64_t>(1, stats.animated_frames);
+            Assert::IsTrue(stats.last_frame_time == 4ms);
+            Assert::IsTrue(stats.max_frame_time == 10ms);
+            Assert::IsTrue(stats.total_frame_time == 14ms);
+
+            scheduler.reset_stats();
+            Assert::AreEqual<uint64_t>(0, scheduler.stats().frames);
+        }
+
+        TEST_METHOD (AnimationEndTime)
+        {
+            Animation animation(0.25);
+            animation.reset();
+
+            FrameScheduler scheduler;
+            scheduler.animate_until(animation.end_time());
+            Assert::IsTrue(scheduler.animating(animation.end_time() - 1ms));
+            Assert::IsFalse(scheduler.animating(animation.end_time()));
+            Assert::IsTrue(animation.end_time() - FrameScheduler::clock::now() <= 250ms);
+        }
+    };
+}
@@ -0,0 +1,140 @@
+#include "pch.h"
+#include <json.h>
+
+#include <algorithm>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTestsJson
+{
+    // Configuration as the settings window sends it on save
+    const std::wstring savedConfig = LR"({
+        "name": "FancyZones",
+        "version": "1.0",
+        "properties": {
+            "fancyzones_shiftDrag": { "value": true },
+            "fancyzones_zoneHighlightOpacity": { "value": 90 },
+            "fancyzones_zoneColor": { "value": "#F5FCFF" },
+            "fancyzones_editor_hotkey": { "value": { "win": true, "ctrl": false, "alt": false, "shift": false, "code": 192, "key": "`" } },
+            "fancyzones_excluded_apps": { "value": [ "notepad.exe", "calc.exe" ] }
+        }
+    })";
+
+    json::JsonObject parse(const std::wstring& text)
+    {
+        return json::JsonObject::Parse(text);
+    }
+
+    json::JsonObject with_property(const std::wstring& name, const json::IJsonValue& value)
+    {
+        auto config = parse(savedConfig);
+        json::JsonObject property;
+        property.SetNamedValue(L"value", value);
+        config.GetNamedObject(L"properties").SetNamedValue(name, property);
+        return config;
+    }
+
+    TEST_CLASS (JsonEqualsTests)
+    {
+    public:
+        TEST_METHOD (NoOpSave)
+        {
+            Assert::IsTrue(json::equals(parse(savedConfig), parse(savedConfig)));
+        }
+
+        TEST_METHOD (NoOpSaveWithMembersReordered)
+        {
+            const auto reordered = parse(LR"({
+                "properties": {
+                    "fancyzones_excluded_apps": { "value": [ "notepad.exe", "calc.exe" ] },
+                    "fancyzones_editor_hotkey": { "value": { "key": "`", "code": 192, "shift": false, "alt": false, "ctrl": false, "win": true } },
+                    "fancyzones_zoneColor": { "value": "#F5FCFF" },
+                    "fancyzones_zoneHighlightOpacity": { "value": 90.0 },
+                    "fancyzones_shiftDrag": { "value": true }
+                },
+                "version": "1.0",
+                "name": "FancyZones"
+            })");
+            Assert::IsTrue(json::equals(parse(savedConfig), reordered));
+        }
+
+        TEST_METHOD (SingleBoolChanged)
+        {
+            Assert::IsFalse(json::equals(parse(savedConfig), with_property(L"fancyzones_shiftDrag", json::value(false))));
+        }
+
+        TEST_METHOD (SingleNumberChanged)
+        {
+            Assert::IsFalse(json::equals(parse(savedConfig), with_property(L"fancyzones_zoneHighlightOpacity", json::value(91))));
+        }
+
+        TEST_METHOD (SingleStringChanged)
+        {
+            Assert::IsFalse(json::equals(parse(savedConfig), with_property(L"fancyzones_zoneColor", json::value(L"#F5FCFE"))));
+        }
+
+        TEST_METHOD (NestedHotkeyChanged)
+        {
+            auto config = parse(savedConfig);
+            config.GetNamedObject(L"properties").GetNamedObject(L"fancyzones_editor_hotkey").GetNamedObject(L"value").SetNamedValue(L"ctrl", json::value(true));
+            Assert::IsFalse(json::equals(parse(savedConfig), config));
+        }
+
+        TEST_METHOD (ArrayOrderMatters)
+        {
+            const auto reordered = with_property(L"fancyzones_excluded_apps", json::JsonArray::Parse(LR"([ "calc.exe", "notepad.exe" ])"));
+            Assert::IsFalse(json::equals(parse(savedConfig), reordered));
+        }
+
+        TEST_METHOD (PropertyAdded)
+        {
+            Assert::IsFalse(json::equals(parse(savedConfig), with_property(L"fancyzones_mouseSwitch", json::value(true))));
+        }
+
+        TEST_METHOD (PropertyRemoved)
+        {
+            auto config = parse(savedConfig);
+            config.GetNamedObject(L"properties").Remove(L"fancyzones_zoneColor");
+            Assert::IsFalse(json::equals(parse(savedConfig), config));
+        }
+
+        TEST_METHOD (TypeChanged)
+        {
+            Assert::IsFalse(json::equals(parse(savedConfig), with_property(L"fancyzones_zoneHighlightOpacity", json::value(L"90"))));
+            Assert::IsFalse(json::equals(json::JsonValue::CreateNullValue(), json::value(false)));
+            Assert::IsTrue(json::equals(json::JsonValue::CreateNullValue(), json::JsonValue::CreateNullValue()));
+        }
+    };
+
+    TEST_CLASS (JsonChangedMembersTests)
+    {
+    public:
+        json::JsonObject properties(const json::JsonObject& config)
+        {
+            return config.GetNamedObject(L"properties");
+        }
+
+        TEST_METHOD (NoOpSave)
+        {
+            Assert::IsTrue(json::changed_members(properties(parse(savedConfig)), properties(parse(savedConfig))).empty());
+        }
+
+        TEST_METHOD (SingleFieldChanged)
+        {
+            const auto changed = json::changed_members(properties(parse(savedConfig)), properties(with_property(L"fancyzones_zoneColor", json::value(L"#F5FCFE"))));
+            Assert::AreEqual<size_t>(1, changed.size());
+            Assert::AreEqual(std::wstring(L"fancyzones_zoneColor"), changed[0]);
+        }
+
+        TEST_METHOD (AddedAndRemovedFields)
+        {
+            auto config = with_property(L"fancyzones_mouseSwitch", json::value(true));
+            properties(config).Remove(L"fancyzones_shiftDrag");
+            auto changed = json::changed_members(properties(parse(savedConfig)), properties(config));
+            std::sort(changed.begin(), changed.end());
+            Assert::AreEqual<size_t>(2, changed.size());
+            Assert::AreEqual(std::wstring(L"fancyzones_mouseSwitch"), changed[0]);
+            Assert::AreEqual(std::wstring(L"fancyzones_shiftDrag"), changed[1]);
+        }
+    };
+}
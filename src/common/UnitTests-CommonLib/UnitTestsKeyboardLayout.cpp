@@ -0,0 +1,80 @@
+#include "pch.h"
+#include "keyboard_layout.h"
+#include "shared_constants.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTestsKeyboardLayout
+{
+    TEST_CLASS (KeyboardLayoutTests)
+    {
+    public:
+        TEST_METHOD (SpecialKeysShouldHaveTheirNames)
+        {
+            LayoutMap layoutMap;
+
+            Assert::AreEqual(std::wstring(L"Enter"), layoutMap.GetKeyName(VK_RETURN));
+            Assert::AreEqual(std::wstring(L"Ctrl (Left)"), layoutMap.GetKeyName(VK_LCONTROL));
+            Assert::AreEqual(std::wstring(L"Win"), layoutMap.GetKeyName(CommonSharedConstants::VK_WIN_BOTH));
+            Assert::AreEqual(std::wstring(L"Undefined"), layoutMap.GetKeyName(0));
+            Assert::AreEqual(std::wstring(L"Undefined"), layoutMap.GetKeyName(0x1000));
+        }
+
+        TEST_METHOD (KeyNameListShouldMatchKeyNames)
+        {
+            LayoutMap layoutMap;
+            std::vector<DWORD> keyCodes = layoutMap.GetKeyCodeList(true);
+            std::vector<std::wstring> keyNames = layoutMap.GetKeyNameList(true);
+
+            Assert::AreEqual(keyCodes.size(), keyNames.size());
+            Assert::AreEqual(std::wstring(L"None"), keyNames[0]);
+            for (size_t i = 1; i < keyCodes.size(); i++)
+            {
+                Assert::AreEqual(layoutMap.GetKeyName(keyCodes[i]), keyNames[i]);
+            }
+
+            // Every key code appears once
+            std::vector<DWORD> sortedKeyCodes = keyCodes;
+            std::sort(sortedKeyCodes.begin(), sortedKeyCodes.end());
+            Assert::IsTrue(std::adjacent_find(sortedKeyCodes.begin(), sortedKeyCodes.end()) == sortedKeyCodes.end());
+        }
+
+        TEST_METHOD (ConcurrentLookupsShouldReturnTheSameNames)
+        {
+            LayoutMap layoutMap;
+            std::vector<std::wstring> expected;
+            for (DWORD key = 0; key < 256; key++)
+            {
+                expected.push_back(layoutMap.GetKeyName(key));
+            }
+
+            // Lookups don't take a lock, threads with the same layout share its table
+            std::vector<std::thread> threads;
+            std::atomic<int> mismatches = 0;
+            for (int t = 0; t < 4; t++)
+            {
+                threads.emplace_back([&]() {
+                    for (int round = 0; round < 100; round++)
+                    {
+                        for (DWORD key = 0; key < 256; key++)
+                        {
+                            if (layoutMap.GetKeyName(key) != expected[key])
+                            {
+                                mismatches++;
+                            }
+                        }
+                    }
+                });
+            }
+
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+            Assert::AreEqual(0, mismatches.load());
+        }
+    };
+}
@@ -0,0 +1,172 @@
+#include "pch.h"
+#include <settings_objects.h>
+#include <settings_schema.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace PowerToysSettings;
+
+namespace UnitTestsSettingsSchema
+{
+    struct TestSettings
+    {
+        bool enabled = true;
+        int size = 10;
+        std::wstring color = L"#FFFFFF";
+        json::JsonObject hotkey{ nullptr };
+    };
+
+    constexpr auto testSchema = make_schema(
+        field(L"bool_enabled", &TestSettings::enabled),
+        field(L"int_size", &TestSettings::size),
+        field(L"string_color", &TestSettings::color),
+        field(L"hotkey", &TestSettings::hotkey));
+
+    static_assert(testSchema.names().size() == 4);
+    static_assert(testSchema.names()[1] == L"int_size");
+
+    struct HotkeySettings
+    {
+        HotkeyObject hotkey = HotkeyObject::from_settings(true, false, false, false, 'A');
+    };
+
+    constexpr auto hotkeySchema = make_schema(field(L"hotkey", &HotkeySettings::hotkey));
+
+    TEST_CLASS (SettingsSchemaTests)
+    {
+    public:
+        TEST_METHOD (ParsesPowerToyValues)
+        {
+            PowerToyValues values(L"Test");
+            values.add_property(L"bool_enabled", false);
+            values.add_property(L"int_size", 42);
+            values.add_property(L"string_color", std::wstring(L"#000000"));
+            values.add_property(L"hotkey", json::JsonObject::Parse(LR"({"win":true,"code":65})"));
+
+            const auto settings = testSchema.parse(json::JsonObject::Parse(values.serialize()));
+            Assert::IsFalse(settings.enabled);
+            Assert::AreEqual(42, settings.size);
+            Assert::AreEqual(std::wstring(L"#000000"), settings.color);
+            Assert::IsTrue(settings.hotkey.GetNamedBoolean(L"win"));
+            Assert::AreEqual(65.0, settings.hotkey.GetNamedNumber(L"code"));
+        }
+
+        TEST_METHOD (SerializesForPowerToyValues)
+        {
+            TestSettings settings;
+            settings.enabled = false;
+            settings.size = 7;
+            settings.color = L"#123456";
+
+            auto values = PowerToyValues::from_json_string(testSchema.serialize(L"Test", settings).Stringify());
+            Assert::IsFalse(values.get_bool_value(L"bool_enabled").value());
+            Assert::AreEqual(7, values.get_int_value(L"int_size").value());
+            Assert::AreEqual(std::wstring(L"#123456"), values.get_string_value(L"string_color").value());
+            // Unset objects aren't written
+            Assert::IsFalse(values.get_json(L"hotkey").has_value());
+        }
+
+        TEST_METHOD (RoundTrip)
+        {
+            TestSettings settings;
+            settings.size = 3;
+            settings.hotkey = json::JsonObject::Parse(LR"({"alt":true,"code":32})");
+
+            const auto parsed = testSchema.parse(testSchema.serialize(L"Test", settings));
+            Assert::IsTrue(testSchema.diff(settings, parsed).none());
+        }
+
+        TEST_METHOD (MissingFieldsKeepDefaults)
+        {
+            const auto settings = testSchema.parse(json::JsonObject::Parse(LR"({"name":"Test","properties":{"int_size":{"value":5}}})"));
+            Assert::IsTrue(settings.enabled);
+            Assert::AreEqual(5, settings.size);
+            Assert::AreEqual(std::wstring(L"#FFFFFF"), settings.color);
+        }
+
+        TEST_METHOD (MissingPropertiesKeepValues)
+        {
+            TestSettings settings;
+            settings.size = 12;
+            testSchema.parse(json::JsonObject::Parse(LR"({"name":"Test"})"), settings);
+            Assert::AreEqual(12, settings.size);
+        }
+
+        TEST_METHOD (WrongTypesAreIgnored)
+        {
+            const auto settings = testSchema.parse(json::JsonObject::Parse(LR"({"properties":{
+                "bool_enabled":{"value":0},
+                "int_size":{"value":"20"},
+                "string_color":{"value":false},
+                "hotkey":"not an object"}})"));
+            Assert::IsTrue(settings.enabled);
+            Assert::AreEqual(10, settings.size);
+            Assert::AreEqual(std::wstring(L"#FFFFFF"), settings.color);
+        }
+
+        TEST_METHOD (UnknownPropertiesAreIgnored)
+        {
+            const auto settings = testSchema.parse(json::JsonObject::Parse(LR"({"properties":{
+                "bool_other":{"value":false},
+                "int_size_2":{"value":1},
+                "int_size":{"value":2}}})"));
+            Assert::IsTrue(settings.enabled);
+            Assert::AreEqual(2, settings.size);
+        }
+
+        TEST_METHOD (DiffReportsChangedFields)
+        {
+            TestSettings a;
+            TestSettings b;
+            Assert::IsTrue(testSchema.diff(a, b).none());
+
+            b.size = 11;
+            auto changes = testSchema.diff(a, b);
+            Assert::AreEqual<size_t>(1, changes.count());
+            Assert::IsTrue(changes[1]);
+
+            b.hotkey = json::JsonObject::Parse(LR"({"code":1})");
+            changes = testSchema.diff(a, b);
+            Assert::AreEqual<size_t>(2, changes.count());
+            Assert::IsTrue(changes[3]);
+        }
+
+        TEST_METHOD (DiffComparesObjectsByValue)
+        {
+            TestSettings a;
+            TestSettings b;
+            a.hotkey = json::JsonObject::Parse(LR"({"win":true,"code":65})");
+            b.hotkey = json::JsonObject::Parse(LR"({"code":65,"win":true})");
+            Assert::IsTrue(testSchema.diff(a, b).none());
+        }
+
+        TEST_METHOD (HotkeyRoundTrip)
+        {
+            HotkeySettings settings;
+            settings.hotkey = HotkeyObject::from_settings(false, true, false, true, 'B');
+
+            const auto parsed = hotkeySchema.parse(hotkeySchema.serialize(L"Test", settings));
+            Assert::IsTrue(hotkeySchema.diff(settings, parsed).none());
+            Assert::IsTrue(parsed.hotkey.ctrl_pressed());
+            Assert::AreEqual<UINT>('B', parsed.hotkey.get_code());
+            Assert::IsTrue(hotkeySchema.diff(settings, HotkeySettings{})[0]);
+        }
+
+        TEST_METHOD (IncompleteHotkeyIsIgnored)
+        {
+            const auto settings = hotkeySchema.parse(json::JsonObject::Parse(LR"({"properties":{"hotkey":{"value":{"code":66}}}})"));
+            Assert::IsTrue(hotkeySchema.diff(settings, HotkeySettings{}).none());
+        }
+
+        TEST_METHOD (ChangesFromNames)
+        {
+            const wchar_t* none[] = { nullptr };
+            Assert::IsTrue(testSchema.changes(none).none());
+
+            const wchar_t* names[] = { L"hotkey", L"unknown", L"bool_enabled", nullptr };
+            const auto changes = testSchema.changes(names);
+            Assert::AreEqual<size_t>(2, changes.count());
+            Assert::IsTrue(changes[0]);
+            Assert::IsTrue(changes[3]);
+        }
+    };
+}
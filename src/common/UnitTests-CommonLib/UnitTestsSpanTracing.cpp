@@ -0,0 +1,145 @@
+#include "pch.h"
+#include "span_tracing.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTestsSpanTracing
+{
+    // Every test records on threads of its own, so the spans of the other tests don't count
+    size_t count_spans(const std::string& trace, const std::string& name)
+    {
+        const std::string key = "\"name\":\"" + name + "\"";
+        size_t count = 0;
+        for (size_t pos = trace.find(key); pos != std::string::npos; pos = trace.find(key, pos + key.size()))
+        {
+            ++count;
+        }
+        return count;
+    }
+
+    TEST_CLASS (SpanTracingTests)
+    {
+    public:
+        TEST_METHOD (ExportsRecordedSpan)
+        {
+            const auto ticks_1500us = static_cast<span_tracing::ticks>(span_tracing::ticks_per_second() * 1500 / 1e6);
+            std::thread([ticks_1500us] {
+                const auto start = span_tracing::now();
+                span_tracing::record("export-test", start, start + ticks_1500us);
+            }).join();
+
+            const auto trace = span_tracing::export_chrome_trace();
+            Assert::AreEqual<size_t>(0, trace.find("{\"traceEvents\":["));
+            Assert::AreEqual<size_t>(1, count_spans(trace, "export-test"));
+            const auto span = trace.substr(trace.find("\"name\":\"export-test\""));
+            Assert::IsTrue(span.find("\"ph\":\"X\"") < span.find('}'));
+            const auto dur = span.find("\"dur\":");
+            Assert::IsTrue(dur < span.find('}'));
+            // The calibration is refined by the export, so allow for a little drift
+            Assert::AreEqual(1500.0, std::stod(span.substr(dur + 6)), 1.0);
+        }
+
+        TEST_METHOD (ScopedSpanRecordsOnExit)
+        {
+            std::thread([] {
+                span_tracing::ScopedSpan span("scoped-test");
+            }).join();
+
+            Assert::AreEqual<size_t>(1, count_spans(span_tracing::export_chrome_trace(), "scoped-test"));
+        }
+
+        TEST_METHOD (KeepsLastSpansOfThread)
+        {
+            std::thread([] {
+                const auto now = span_tracing::now();
+                for (size_t i = 0; i < 10; ++i)
+                {
+                    span_tracing::record("wrap-old", now, now);
+                }
+                for (size_t i = 0; i < span_tracing::SPANS_PER_THREAD; ++i)
+                {
+                    span_tracing::record("wrap-new", now, now);
+                }
+            }).join();
+
+            const auto trace = span_tracing::export_chrome_trace();
+            Assert::AreEqual<size_t>(0, count_spans(trace, "wrap-old"));
+            Assert::AreEqual<size_t>(span_tracing::SPANS_PER_THREAD, count_spans(trace, "wrap-new"));
+        }
+
+        TEST_METHOD (RecordsEveryThread)
+        {
+            std::vector<std::thread> threads;
+            for (int i = 0; i < 4; ++i)
+            {
+                threads.emplace_back([] {
+                    for (int j = 0; j < 100; ++j)
+                    {
+                        span_tracing::ScopedSpan span("thread-test");
+                    }
+                });
+            }
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+
+            Assert::AreEqual<size_t>(400, count_spans(span_tracing::export_chrome_trace(), "thread-test"));
+        }
+
+        TEST_METHOD (ExportWhileRecording)
+        {
+            std::atomic<bool> done = false;
+            std::thread writer([&] {
+                const auto now = span_tracing::now();
+                while (!done)
+                {
+                    span_tracing::record("busy-test", now, now);
+                }
+            });
+            for (int i = 0; i < 20; ++i)
+            {
+                const auto count = count_spans(span_tracing::export_chrome_trace(), "busy-test");
+                Assert::IsTrue(count <= span_tracing::SPANS_PER_THREAD);
+            }
+            done = true;
+            writer.join();
+        }
+
+        TEST_METHOD (EscapesNames)
+        {
+            std::thread([] {
+                const auto now = span_tracing::now();
+                span_tracing::record("quote\"back\\slash", now, now);
+            }).join();
+
+            Assert::AreEqual<size_t>(1, count_spans(span_tracing::export_chrome_trace(), "quote\\\"back\\\\slash"));
+        }
+
+        // Not a pass/fail test, logs what a span costs on the machine running the tests
+        TEST_METHOD (MeasureScopedSpanCost)
+        {
+            const int count = 1000000;
+            std::chrono::steady_clock::duration elapsed{};
+            std::thread([&] {
+                // Registers the thread, so it isn't measured
+                span_tracing::record("cost-warmup", span_tracing::now(), span_tracing::now());
+                const auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < count; ++i)
+                {
+                    span_tracing::ScopedSpan span("cost-test");
+                }
+                elapsed = std::chrono::steady_clock::now() - start;
+            }).join();
+
+            const auto ns = std::chrono::duration<double, std::nano>(elapsed).count() / count;
+            Logger::WriteMessage((L"ScopedSpan: " + std::to_wstring(ns) + L" ns per span\n").c_str());
+        }
+    };
+}
@@ -1,5 +1,10 @@
 // pch.cpp: source file corresponding to the pre-compiled header
 
 #include "pch.h"
+// Devices of the D2DWindow tests
+#pragma comment(lib, "dxgi")
+#pragma comment(lib, "d3d11")
+#pragma comment(lib, "d2d1")
+#pragma comment(lib, "dcomp")
 
 // When you are using pre-compiled headers, this source file is necessary for compilation to succeed.
@@ -49,3 +49,7 @@ bool Animation::done() const
 {
     return std::chrono::high_resolution_clock::now() - start >= std::chrono::duration<double>(duration);
 }
+std::chrono::high_resolution_clock::time_point Animation::end_time() const
+{
+    return start + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(std::chrono::duration<double>(duration));
+}
@@ -10,6 +10,8 @@
 
     When rendering, call value() to get value from 0 to 1 - depending on animation
     progress.
+
+    Windows rendering the animation need frames until end_time().
 */
 class Animation
 {
@@ -26,6 +28,8 @@ public:
     void reset(double duration, double start, double stop);
     double value(AnimFunctions apply_function) const;
     bool done() const;
+    // When the animation reaches its stop value
+    std::chrono::high_resolution_clock::time_point end_time() const;
 
 private:
     static double apply_animation_function(double t, AnimFunctions apply_function);
@@ -0,0 +1,73 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+
+// Queue of messages waiting to be sent, where a message given a key replaces the pending message
+// with the same key instead of being queued after it. Messages carrying a whole state, e.g. all the
+// settings of one PowerToy, are given a key so that only the latest state is sent when they arrive
+// faster than they can be sent. Messages without a key are always sent, in the order they were
+// queued, and a message queued after one of them never replaces a message queued before it.
+class CoalescingMessageQueue
+{
+public:
+    CoalescingMessageQueue() = default;
+    CoalescingMessageQueue(const CoalescingMessageQueue&) = delete;
+    CoalescingMessageQueue& operator=(const CoalescingMessageQueue&) = delete;
+
+    void queue_message(std::wstring message, std::wstring key = {})
+    {
+        {
+            std::unique_lock lock(queue_mutex);
+            if (!key.empty())
+            {
+                for (auto pending = message_queue.rbegin(); pending != message_queue.rend() && !pending->key.empty(); ++pending)
+                {
+                    if (pending->key == key)
+                    {
+                        pending->message = std::move(message);
+                        return;
+                    }
+                }
+            }
+            message_queue.push_back({ std::move(key), std::move(message) });
+        }
+        message_ready.notify_one();
+    }
+
+    // Waits for a message, returns an empty string once the queue is interrupted
+    std::wstring pop_message()
+    {
+        std::unique_lock lock(queue_mutex);
+        message_ready.wait(lock, [this] { return interrupted || !message_queue.empty(); });
+        if (interrupted)
+        {
+            return {};
+        }
+        std::wstring message = std::move(message_queue.front().message);
+        message_queue.pop_front();
+        return message;
+    }
+
+    void interrupt()
+    {
+        {
+            std::unique_lock lock(queue_mutex);
+            interrupted = true;
+        }
+        message_ready.notify_all();
+    }
+
+private:
+    struct PendingMessage
+    {
+        std::wstring key;
+        std::wstring message;
+    };
+
+    std::mutex queue_mutex;
+    std::deque<PendingMessage> message_queue;
+    std::condition_variable message_ready;
+    bool interrupted = false;
+};
@@ -0,0 +1,48 @@
+#include "pch.h"
+#include "d2d_device_pool.h"
+
+namespace
+{
+    std::mutex pool_mutex;
+    std::weak_ptr<const D2DDevices> pool_devices;
+
+    std::shared_ptr<const D2DDevices> create_devices()
+    {
+        auto devices = std::make_shared<D2DDevices>();
+#ifdef _DEBUG
+        D2D1_FACTORY_OPTIONS options = { D2D1_DEBUG_LEVEL_INFORMATION };
+#else
+        D2D1_FACTORY_OPTIONS options = {};
+#endif
+        winrt::check_hresult(D2D1CreateFactory(D2D1_FACTORY_TYPE_MULTI_THREADED,
+                                               __uuidof(devices->d2d_factory),
+                                               &options,
+                                               devices->d2d_factory.put_void()));
+        winrt::check_hresult(D3D11CreateDevice(nullptr,
+                                               D3D_DRIVER_TYPE_HARDWARE,
+                                               nullptr,
+                                               D3D11_CREATE_DEVICE_BGRA_SUPPORT,
+                                               nullptr,
+                                               0,
+                                               D3D11_SDK_VERSION,
+                                               devices->d3d_device.put(),
+                                               nullptr,
+                                               nullptr));
+        winrt::check_hresult(devices->d3d_device->QueryInterface(__uuidof(devices->dxgi_device), devices->dxgi_device.put_void()));
+        winrt::check_hresult(CreateDXGIFactory2(0, __uuidof(devices->dxgi_factory), devices->dxgi_factory.put_void()));
+        winrt::check_hresult(devices->d2d_factory->CreateDevice(devices->dxgi_device.get(), devices->d2d_device.put()));
+        return devices;
+    }
+}
+
+std::shared_ptr<const D2DDevices> D2DDevicePool::get()
+{
+    std::unique_lock lock(pool_mutex);
+    auto devices = pool_devices.lock();
+    if (!devices)
+    {
+        devices = create_devices();
+        pool_devices = devices;
+    }
+    return devices;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <winrt/base.h>
+#include <Windows.h>
+#include <dxgi1_3.h>
+#include <d3d11_2.h>
+#include <d2d1_3.h>
+#include <memory>
+
+// The Direct3D and Direct2D devices of the windows rendering with Direct2D
+struct D2DDevices
+{
+    winrt::com_ptr<ID2D1Factory6> d2d_factory;
+    winrt::com_ptr<ID3D11Device> d3d_device;
+    winrt::com_ptr<IDXGIDevice> dxgi_device;
+    winrt::com_ptr<IDXGIFactory2> dxgi_factory;
+    winrt::com_ptr<ID2D1Device5> d2d_device;
+};
+
+/*
+  Shares one set of devices between the D2DWindow instances of the process.
+
+  The devices are created by the first get() and released with the last
+  window using them. The factory is multithreaded, so device contexts
+  created from the shared device can be used from any thread.
+*/
+class D2DDevicePool
+{
+public:
+    // Returns the shared devices, creating them if needed. Can be called from any thread.
+    static std::shared_ptr<const D2DDevices> get();
+};
@@ -24,6 +24,33 @@ D2DSVG& D2DSVG::load(const std::wstring& filename, ID2D1DeviceContext5* d2d_dc)
     svg_width = (int)tmp;
     winrt::check_hresult(root->GetAttributeValue(L"height", &tmp));
     svg_height = (int)tmp;
+
+    fills.clear();
+    std::function<void(ID2D1SvgElement * element)> recurse = [&](ID2D1SvgElement* element) {
+        if (!element)
+            return;
+        if (element->IsAttributeSpecified(L"fill"))
+        {
+            winrt::com_ptr<ID2D1SvgPaint> paint;
+            if (element->GetAttributeValue(L"fill", paint.put()) == S_OK && paint)
+            {
+                Fill fill;
+                fill.element.copy_from(element);
+                paint->GetColor(&fill.color);
+                fills.push_back(std::move(fill));
+            }
+        }
+        winrt::com_ptr<ID2D1SvgElement> sub;
+        element->GetFirstChild(sub.put());
+        while (sub)
+        {
+            recurse(sub.get());
+            winrt::com_ptr<ID2D1SvgElement> next;
+            element->GetNextChild(sub.get(), next.put());
+            sub = next;
+        }
+    };
+    recurse(root.get());
     return *this;
 }
 
@@ -48,33 +75,14 @@ D2DSVG& D2DSVG::recolor(uint32_t oldcolor, uint32_t newcolor)
 {
     auto new_color = D2D1::ColorF(newcolor & 0xFFFFFF, 1);
     auto old_color = D2D1::ColorF(oldcolor & 0xFFFFFF, 1);
-    std::function<void(ID2D1SvgElement * element)> recurse = [&](ID2D1SvgElement* element) {
-        if (!element)
-            return;
-        if (element->IsAttributeSpecified(L"fill"))
-        {
-            D2D1_COLOR_F elem_fill;
-            winrt::com_ptr<ID2D1SvgPaint> paint;
-            element->GetAttributeValue(L"fill", paint.put());
-            paint->GetColor(&elem_fill);
-            if (elem_fill.r == old_color.r && elem_fill.g == old_color.g && elem_fill.b == old_color.b)
-            {
-                winrt::check_hresult(element->SetAttributeValue(L"fill", new_color));
-            }
-        }
-        winrt::com_ptr<ID2D1SvgElement> sub;
-        element->GetFirstChild(sub.put());
-        while (sub)
+    for (auto& fill : fills)
+    {
+        if (fill.color.r == old_color.r && fill.color.g == old_color.g && fill.color.b == old_color.b)
         {
-            recurse(sub.get());
-            winrt::com_ptr<ID2D1SvgElement> next;
-            element->GetNextChild(sub.get(), next.put());
-            sub = next;
+            winrt::check_hresult(fill.element->SetAttributeValue(L"fill", new_color));
+            fill.color = new_color;
         }
-    };
-    winrt::com_ptr<ID2D1SvgElement> root;
-    svg->GetRoot(root.put());
-    recurse(root.get());
+    }
     return *this;
 }
 
@@ -93,10 +101,15 @@ D2DSVG& D2DSVG::toggle_element(const wchar_t* id, bool visible)
     winrt::com_ptr<ID2D1SvgElement> element;
     if (svg->FindElementById(id, element.put()) != S_OK)
         return *this;
+    toggle_element(element.get(), visible);
+    return *this;
+}
+
+void D2DSVG::toggle_element(ID2D1SvgElement* element, bool visible)
+{
     if (!element)
-        return *this;
+        return;
     element->SetAttributeValue(L"display", visible ? D2D1_SVG_DISPLAY::D2D1_SVG_DISPLAY_INLINE : D2D1_SVG_DISPLAY::D2D1_SVG_DISPLAY_NONE);
-    return *this;
 }
 
 winrt::com_ptr<ID2D1SvgElement> D2DSVG::find_element(const std::wstring& id)
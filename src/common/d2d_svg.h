@@ -3,6 +3,7 @@
 #include <d2d1_3helper.h>
 #include <winrt/base.h>
 #include <string>
+#include <vector>
 
 class D2DSVG
 {
@@ -10,16 +11,27 @@ public:
     D2DSVG& load(const std::wstring& filename, ID2D1DeviceContext5* d2d_dc);
     D2DSVG& resize(int x, int y, int width, int height, float fill, float max_scale = -1.0f);
     D2DSVG& render(ID2D1DeviceContext5* d2d_dc);
+    // Changes the fill of the elements filled with oldcolor. Goes through the fills found by load(),
+    // without walking the document.
     D2DSVG& recolor(uint32_t oldcolor, uint32_t newcolor);
     float get_scale() const { return used_scale; }
     int width() const { return svg_width; }
     int height() const { return svg_height; }
     D2DSVG& toggle_element(const wchar_t* id, bool visible);
+    static void toggle_element(ID2D1SvgElement* element, bool visible);
     winrt::com_ptr<ID2D1SvgElement> find_element(const std::wstring& id);
     D2D1_RECT_F rescale(D2D1_RECT_F rect);
 
 protected:
+    struct Fill
+    {
+        winrt::com_ptr<ID2D1SvgElement> element;
+        D2D1_COLOR_F color;
+    };
+
     float used_scale = 1.0f;
+    // Every element with a fill attribute, found once when the document is loaded
+    std::vector<Fill> fills;
     winrt::com_ptr<ID2D1SvgDocument> svg;
     int svg_width = -1, svg_height = -1;
     D2D1::Matrix3x2F transform;
@@ -3,6 +3,12 @@
 
 extern "C" IMAGE_DOS_HEADER __ImageBase;
 
+namespace
+{
+    // Posted to the window when a resize was dropped while initialize() ran in the background
+    const UINT WM_REPLAY_RESIZE = WM_USER;
+}
+
 D2DWindow::D2DWindow()
 {
     static const WCHAR* class_name = L"PToyD2DPopup";
@@ -30,6 +36,13 @@ D2DWindow::D2DWindow()
 
 void D2DWindow::show(UINT x, UINT y, UINT width, UINT height)
 {
+    if (prewarm.valid())
+    {
+        auto wait_start = std::chrono::high_resolution_clock::now();
+        wait_for_prewarm();
+        std::unique_lock lock(mutex);
+        init_stats.show_wait_time = std::chrono::high_resolution_clock::now() - wait_start;
+    }
     if (!initialized)
     {
         base_init();
@@ -44,62 +57,98 @@ void D2DWindow::show(UINT x, UINT y, UINT width, UINT height)
 
 void D2DWindow::hide()
 {
+    scheduler.stop();
     ShowWindow(hwnd, SW_HIDE);
     on_hide();
 }
 
-void D2DWindow::initialize()
+void D2DWindow::initialize(bool prewarm)
+{
+    auto initialize_start = std::chrono::high_resolution_clock::now();
+    if (prewarm)
+    {
+        this->prewarm = std::async(std::launch::async, [this] { base_init(); });
+    }
+    else
+    {
+        base_init();
+    }
+    std::unique_lock lock(mutex);
+    init_stats.initialize_time = std::chrono::high_resolution_clock::now() - initialize_start;
+}
+
+void D2DWindow::wait_for_prewarm()
+{
+    if (!prewarm.valid())
+    {
+        return;
+    }
+    try
+    {
+        prewarm.get();
+    }
+    catch (...)
+    {
+        // show() tries again on the window thread
+    }
+}
+
+D2DWindow::InitStats D2DWindow::get_init_stats()
+{
+    std::unique_lock lock(mutex);
+    return init_stats;
+}
+
+void D2DWindow::invalidate()
 {
-    base_init();
+    InvalidateRect(hwnd, nullptr, FALSE);
+}
+
+FrameScheduler::Stats D2DWindow::get_render_stats() const
+{
+    return scheduler.stats();
+}
+
+void D2DWindow::track_animation(const Animation& animation)
+{
+    scheduler.animate_until(animation.end_time());
+    invalidate();
 }
 
 void D2DWindow::base_init()
 {
     std::unique_lock lock(mutex);
-    // D2D1Factory is independent from the device, no need to recreate it if we need to recreate the device.
-    if (!d2d_factory)
-    {
-#ifdef _DEBUG
-        D2D1_FACTORY_OPTIONS options = { D2D1_DEBUG_LEVEL_INFORMATION };
-#else
-        D2D1_FACTORY_OPTIONS options = {};
-#endif
-        winrt::check_hresult(D2D1CreateFactory(D2D1_FACTORY_TYPE_MULTI_THREADED,
-                                               __uuidof(d2d_factory),
-                                               &options,
-                                               d2d_factory.put_void()));
-    }
-    // For all other stuff - assign nullptr first to release the object, to reset the com_ptr.
+    auto init_start = std::chrono::high_resolution_clock::now();
+    // The devices are shared, only the device context belongs to the window.
+    // Assign nullptr first to release the object, to reset the com_ptr.
     d2d_dc = nullptr;
-    d2d_device = nullptr;
-    dxgi_factory = nullptr;
-    dxgi_device = nullptr;
-    d3d_device = nullptr;
-    winrt::check_hresult(D3D11CreateDevice(nullptr,
-                                           D3D_DRIVER_TYPE_HARDWARE,
-                                           nullptr,
-                                           D3D11_CREATE_DEVICE_BGRA_SUPPORT,
-                                           nullptr,
-                                           0,
-                                           D3D11_SDK_VERSION,
-                                           d3d_device.put(),
-                                           nullptr,
-                                           nullptr));
-    winrt::check_hresult(d3d_device->QueryInterface(__uuidof(dxgi_device), dxgi_device.put_void()));
-    winrt::check_hresult(CreateDXGIFactory2(0, __uuidof(dxgi_factory), dxgi_factory.put_void()));
-    winrt::check_hresult(d2d_factory->CreateDevice(dxgi_device.get(), d2d_device.put()));
-    winrt::check_hresult(d2d_device->CreateDeviceContext(D2D1_DEVICE_CONTEXT_OPTIONS_NONE, d2d_dc.put()));
+    devices = D2DDevicePool::get();
+    winrt::check_hresult(devices->d2d_device->CreateDeviceContext(D2D1_DEVICE_CONTEXT_OPTIONS_NONE, d2d_dc.put()));
     init();
     initialized = true;
+    init_stats.init_time = std::chrono::high_resolution_clock::now() - init_start;
+    // The swap chain is made on the window thread, with the size the window has by then
+    if (resize_dropped.exchange(false))
+    {
+        PostMessage(hwnd, WM_REPLAY_RESIZE, 0, 0);
+    }
 }
 
 void D2DWindow::base_resize(UINT width, UINT height)
 {
+    // Do not block the window thread while initialize() runs in the background. The flag is set
+    // before initialized is checked, so either this call or base_init() sees the other.
+    resize_dropped = true;
+    if (!initialized)
+    {
+        return;
+    }
     std::unique_lock lock(mutex);
     if (!initialized)
     {
         return;
     }
+    resize_dropped = false;
     window_width = width;
     window_height = height;
     if (window_width == 0 || window_height == 0)
@@ -116,12 +165,12 @@ void D2DWindow::base_resize(UINT width, UINT height)
     sc_description.Width = window_width;
     sc_description.Height = window_height;
     dxgi_swap_chain = nullptr;
-    winrt::check_hresult(dxgi_factory->CreateSwapChainForComposition(dxgi_device.get(),
-                                                                     &sc_description,
-                                                                     nullptr,
-                                                                     dxgi_swap_chain.put()));
+    winrt::check_hresult(devices->dxgi_factory->CreateSwapChainForComposition(devices->dxgi_device.get(),
+                                                                              &sc_description,
+                                                                              nullptr,
+                                                                              dxgi_swap_chain.put()));
     composition_device = nullptr;
-    winrt::check_hresult(DCompositionCreateDevice(dxgi_device.get(),
+    winrt::check_hresult(DCompositionCreateDevice(devices->dxgi_device.get(),
                                                   __uuidof(composition_device),
                                                   composition_device.put_void()));
 
@@ -150,14 +199,25 @@ void D2DWindow::base_resize(UINT width, UINT height)
 
 void D2DWindow::base_render()
 {
+    if (!initialized)
+    {
+        return;
+    }
     std::unique_lock lock(mutex);
     if (!initialized || !d2d_dc || !d2d_bitmap)
         return;
+    auto frame_start = FrameScheduler::clock::now();
     d2d_dc->BeginDraw();
     render(d2d_dc.get());
     winrt::check_hresult(d2d_dc->EndDraw());
     winrt::check_hresult(dxgi_swap_chain->Present(1, 0));
     winrt::check_hresult(composition_device->Commit());
+    // Present waits for the vertical blank, so asking for the next frame right away
+    // paces the animation to the display refresh rate.
+    if (scheduler.frame_rendered(frame_start, FrameScheduler::clock::now()))
+    {
+        invalidate();
+    }
 }
 
 void D2DWindow::render_empty()
@@ -174,6 +234,7 @@ void D2DWindow::render_empty()
 
 D2DWindow::~D2DWindow()
 {
+    wait_for_prewarm();
     ShowWindow(hwnd, SW_HIDE);
     DestroyWindow(hwnd);
 }
@@ -193,11 +254,22 @@ LRESULT __stdcall D2DWindow::d2d_window_proc(HWND window, UINT message, WPARAM w
         SetWindowLongPtr(window, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(create_struct->lpCreateParams));
         return TRUE;
     }
+    case WM_REPLAY_RESIZE:
+    {
+        RECT client_rect = {};
+        GetClientRect(window, &client_rect);
+        this_from_hwnd(window)->base_resize(client_rect.right, client_rect.bottom);
+        ValidateRect(window, nullptr);
+        this_from_hwnd(window)->base_render();
+        return 0;
+    }
     case WM_MOVE:
     case WM_SIZE:
         this_from_hwnd(window)->base_resize((unsigned)lparam & 0xFFFF, (unsigned)lparam >> 16);
         // Fall through to call 'base_render()'
     case WM_PAINT:
+        // Validate first, so invalidations made while rendering schedule the next frame
+        ValidateRect(window, nullptr);
         this_from_hwnd(window)->base_render();
         return 0;
     default:
@@ -9,7 +9,12 @@
 #include <dcomp.h>
 #include <dwmapi.h>
 #include <string>
+#include <atomic>
+#include <future>
 #include "d2d_svg.h"
+#include "d2d_device_pool.h"
+#include "animation.h"
+#include "frame_scheduler.h"
 
 class D2DWindow
 {
@@ -17,7 +22,25 @@ public:
     D2DWindow();
     void show(UINT x, UINT y, UINT width, UINT height);
     void hide();
-    void initialize();
+    // Gets the devices and calls init() on a background thread, so the scene is ready before the
+    // first show without delaying the caller. show() waits for it if it is not done yet.
+    // With prewarm set to false it is done on the calling thread.
+    void initialize(bool prewarm = true);
+    // Schedules a frame. The window only renders when invalidated or while an animation runs.
+    // Can be called from any thread.
+    void invalidate();
+    FrameScheduler::Stats get_render_stats() const;
+
+    struct InitStats
+    {
+        // How long initialize() blocked its caller
+        std::chrono::high_resolution_clock::duration initialize_time = {};
+        // How long getting the devices and init() took, on whichever thread did it
+        std::chrono::high_resolution_clock::duration init_time = {};
+        // How long the first show() waited for the initialization
+        std::chrono::high_resolution_clock::duration show_wait_time = {};
+    };
+    InitStats get_init_stats();
     virtual ~D2DWindow();
 
 protected:
@@ -28,7 +51,8 @@ protected:
     virtual void init() = 0;
     // resize - when called, window_width and window_height will have current window size
     virtual void resize() = 0;
-    // render - called on WM_PAIT, BeginPaint/EndPaint is handled by D2DWindow
+    // render - called on WM_PAIT, BeginPaint/EndPaint is handled by D2DWindow.
+    //   Call invalidate() when the scene changes and track_animation() when an animation starts.
     virtual void render(ID2D1DeviceContext5* d2d_dc) = 0;
     // on_show, on_hide - called when the window is about to be shown or about to be hidden
     virtual void on_show() = 0;
@@ -38,24 +62,32 @@ protected:
     static D2DWindow* this_from_hwnd(HWND window);
 
     void base_init();
+    // Waits for the initialization started by initialize(). Must be called by the destructors
+    // of the derived classes, before init() loses the members it fills.
+    void wait_for_prewarm();
     void base_resize(UINT width, UINT height);
     void base_render();
     void render_empty();
+    // Renders at the display refresh rate until the animation ends
+    void track_animation(const Animation& animation);
 
     std::recursive_mutex mutex;
-    bool initialized = false;
+    FrameScheduler scheduler;
+    std::future<void> prewarm;
+    InitStats init_stats;
+    std::atomic<bool> initialized = false;
+    // Set by a resize that came before the initialization was done, which is then done again
+    // with the current size once the initialization is
+    std::atomic<bool> resize_dropped = false;
     HWND hwnd;
     UINT window_width, window_height;
-    winrt::com_ptr<ID3D11Device> d3d_device;
-    winrt::com_ptr<IDXGIDevice> dxgi_device;
-    winrt::com_ptr<IDXGIFactory2> dxgi_factory;
+    // Shared with the other windows, see D2DDevicePool
+    std::shared_ptr<const D2DDevices> devices;
     winrt::com_ptr<IDXGISwapChain1> dxgi_swap_chain;
     winrt::com_ptr<IDCompositionDevice> composition_device;
     winrt::com_ptr<IDCompositionTarget> composition_target;
     winrt::com_ptr<IDCompositionVisual> composition_visual;
     winrt::com_ptr<IDXGISurface2> dxgi_surface;
     winrt::com_ptr<ID2D1Bitmap1> d2d_bitmap;
-    winrt::com_ptr<ID2D1Factory6> d2d_factory;
-    winrt::com_ptr<ID2D1Device5> d2d_device;
     winrt::com_ptr<ID2D1DeviceContext5> d2d_dc;
 };
@@ -0,0 +1,56 @@
+#include "pch.h"
+#include "frame_scheduler.h"
+
+void FrameScheduler::animate_until(clock::time_point end)
+{
+    std::unique_lock lock(mutex);
+    if (end > animation_end)
+    {
+        animation_end = end;
+    }
+}
+
+void FrameScheduler::stop()
+{
+    std::unique_lock lock(mutex);
+    animation_end = {};
+}
+
+bool FrameScheduler::animating(clock::time_point now) const
+{
+    std::unique_lock lock(mutex);
+    return now < animation_end;
+}
+
+bool FrameScheduler::frame_rendered(clock::time_point start, clock::time_point end)
+{
+    std::unique_lock lock(mutex);
+    auto frame_time = end - start;
+    ++counters.frames;
+    counters.last_frame_time = frame_time;
+    counters.total_frame_time += frame_time;
+    if (frame_time > counters.max_frame_time)
+    {
+        counters.max_frame_time = frame_time;
+    }
+    // The frame shows the animations as of its start. If they were still running then,
+    // the next frame is needed to get closer to, or to draw, their final state.
+    if (start < animation_end)
+    {
+        ++counters.animated_frames;
+        return true;
+    }
+    return false;
+}
+
+FrameScheduler::Stats FrameScheduler::stats() const
+{
+    std::unique_lock lock(mutex);
+    return counters;
+}
+
+void FrameScheduler::reset_stats()
+{
+    std::unique_lock lock(mutex);
+    counters = {};
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+/*
+  Decides when a window needs another frame.
+
+  Frames are requested explicitly by invalidating the window. While an
+  animation tracked with animate_until() is running, every rendered frame
+  asks for the next one, so the window renders at the display refresh rate.
+  Once the last animation has ended one more frame draws its final state
+  and the window goes idle until it is invalidated again.
+
+  Can be used from any thread.
+*/
+class FrameScheduler
+{
+public:
+    using clock = std::chrono::high_resolution_clock;
+
+    struct Stats
+    {
+        // Frames rendered since the stats were reset
+        uint64_t frames = 0;
+        // Frames rendered while an animation was running
+        uint64_t animated_frames = 0;
+        clock::duration last_frame_time = {};
+        clock::duration max_frame_time = {};
+        clock::duration total_frame_time = {};
+    };
+
+    // Keeps the frames coming until the given time
+    void animate_until(clock::time_point end);
+    // Drops the running animations, e.g. when the window is hidden
+    void stop();
+    bool animating(clock::time_point now) const;
+    // Records a frame that started rendering at start and was presented at end.
+    // Returns true if another frame should follow.
+    bool frame_rendered(clock::time_point start, clock::time_point end);
+
+    Stats stats() const;
+    void reset_stats();
+
+private:
+    mutable std::mutex mutex;
+    clock::time_point animation_end = {};
+    Stats counters;
+};
@@ -29,4 +29,78 @@ namespace json
         std::wstring obj_str{ obj.Stringify().c_str() };
         std::ofstream{ file_name.data(), std::ios::binary } << winrt::to_string(obj_str);
     }
+
+    bool equals(const IJsonValue& a, const IJsonValue& b)
+    {
+        if (a.ValueType() != b.ValueType())
+        {
+            return false;
+        }
+        switch (a.ValueType())
+        {
+        case JsonValueType::Null:
+            return true;
+        case JsonValueType::Boolean:
+            return a.GetBoolean() == b.GetBoolean();
+        case JsonValueType::Number:
+            return a.GetNumber() == b.GetNumber();
+        case JsonValueType::String:
+            return a.GetString() == b.GetString();
+        case JsonValueType::Array:
+        {
+            const auto left = a.GetArray();
+            const auto right = b.GetArray();
+            if (left.Size() != right.Size())
+            {
+                return false;
+            }
+            for (uint32_t i = 0; i < left.Size(); ++i)
+            {
+                if (!equals(left.GetAt(i), right.GetAt(i)))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case JsonValueType::Object:
+        {
+            const auto left = a.GetObjectW();
+            const auto right = b.GetObjectW();
+            if (left.Size() != right.Size())
+            {
+                return false;
+            }
+            for (const auto& member : left)
+            {
+                if (!right.HasKey(member.Key()) || !equals(member.Value(), right.GetNamedValue(member.Key())))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        }
+        return false;
+    }
+
+    std::vector<std::wstring> changed_members(const JsonObject& before, const JsonObject& after)
+    {
+        std::vector<std::wstring> changed;
+        for (const auto& member : after)
+        {
+            if (!before.HasKey(member.Key()) || !equals(member.Value(), before.GetNamedValue(member.Key())))
+            {
+                changed.emplace_back(member.Key().c_str());
+            }
+        }
+        for (const auto& member : before)
+        {
+            if (!after.HasKey(member.Key()))
+            {
+                changed.emplace_back(member.Key().c_str());
+            }
+        }
+        return changed;
+    }
 }
@@ -5,6 +5,8 @@
 #include <winrt/Windows.Data.Json.h>
 
 #include <optional>
+#include <string>
+#include <vector>
 
 namespace json
 {
@@ -14,6 +16,12 @@ namespace json
 
     void to_file(std::wstring_view file_name, const JsonObject& obj);
 
+    // Compares the values structurally: objects by their members in any order, numbers by value
+    bool equals(const IJsonValue& a, const IJsonValue& b);
+
+    // Names of the members which were added, removed or changed between the two objects
+    std::vector<std::wstring> changed_members(const JsonObject& before, const JsonObject& after);
+
     inline bool has(
         const json::JsonObject& o,
         std::wstring_view name,
@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "keyboard_layout_impl.h"
 #include "shared_constants.h"
+#include <algorithm>
 
 LayoutMap::LayoutMap() :
     impl(new LayoutMap::LayoutMapImpl())
@@ -32,38 +33,173 @@ std::vector<std::wstring> LayoutMap::GetKeyNameList(const bool isShortcut)
     return impl->GetKeyNameList(isShortcut);
 }
 
+namespace
+{
+    // Names of special keys like Shift, Ctrl etc because they don't have unicode mappings and key names like Enter, Space as they appear as "\r", " "
+    // To do: localization
+    const std::pair<DWORD, const wchar_t*> specialKeyNames[] = {
+        { VK_CANCEL, L"Break" },
+        { VK_BACK, L"Backspace" },
+        { VK_TAB, L"Tab" },
+        { VK_CLEAR, L"Clear" },
+        { VK_RETURN, L"Enter" },
+        { VK_SHIFT, L"Shift" },
+        { VK_CONTROL, L"Ctrl" },
+        { VK_MENU, L"Alt" },
+        { VK_PAUSE, L"Pause" },
+        { VK_CAPITAL, L"Caps Lock" },
+        { VK_ESCAPE, L"Esc" },
+        { VK_SPACE, L"Space" },
+        { VK_PRIOR, L"PgUp" },
+        { VK_NEXT, L"PgDn" },
+        { VK_END, L"End" },
+        { VK_HOME, L"Home" },
+        { VK_LEFT, L"Left" },
+        { VK_UP, L"Up" },
+        { VK_RIGHT, L"Right" },
+        { VK_DOWN, L"Down" },
+        { VK_SELECT, L"Select" },
+        { VK_PRINT, L"Print" },
+        { VK_EXECUTE, L"Execute" },
+        { VK_SNAPSHOT, L"Print Screen" },
+        { VK_INSERT, L"Insert" },
+        { VK_DELETE, L"Delete" },
+        { VK_HELP, L"Help" },
+        { VK_LWIN, L"Win (Left)" },
+        { VK_RWIN, L"Win (Right)" },
+        { VK_APPS, L"Menu" },
+        { VK_SLEEP, L"Sleep" },
+        { VK_NUMPAD0, L"NumPad 0" },
+        { VK_NUMPAD1, L"NumPad 1" },
+        { VK_NUMPAD2, L"NumPad 2" },
+        { VK_NUMPAD3, L"NumPad 3" },
+        { VK_NUMPAD4, L"NumPad 4" },
+        { VK_NUMPAD5, L"NumPad 5" },
+        { VK_NUMPAD6, L"NumPad 6" },
+        { VK_NUMPAD7, L"NumPad 7" },
+        { VK_NUMPAD8, L"NumPad 8" },
+        { VK_NUMPAD9, L"NumPad 9" },
+        { VK_SEPARATOR, L"Separator" },
+        { VK_F1, L"F1" },
+        { VK_F2, L"F2" },
+        { VK_F3, L"F3" },
+        { VK_F4, L"F4" },
+        { VK_F5, L"F5" },
+        { VK_F6, L"F6" },
+        { VK_F7, L"F7" },
+        { VK_F8, L"F8" },
+        { VK_F9, L"F9" },
+        { VK_F10, L"F10" },
+        { VK_F11, L"F11" },
+        { VK_F12, L"F12" },
+        { VK_F13, L"F13" },
+        { VK_F14, L"F14" },
+        { VK_F15, L"F15" },
+        { VK_F16, L"F16" },
+        { VK_F17, L"F17" },
+        { VK_F18, L"F18" },
+        { VK_F19, L"F19" },
+        { VK_F20, L"F20" },
+        { VK_F21, L"F21" },
+        { VK_F22, L"F22" },
+        { VK_F23, L"F23" },
+        { VK_F24, L"F24" },
+        { VK_NUMLOCK, L"Num Lock" },
+        { VK_SCROLL, L"Scroll Lock" },
+        { VK_LSHIFT, L"Shift (Left)" },
+        { VK_RSHIFT, L"Shift (Right)" },
+        { VK_LCONTROL, L"Ctrl (Left)" },
+        { VK_RCONTROL, L"Ctrl (Right)" },
+        { VK_LMENU, L"Alt (Left)" },
+        { VK_RMENU, L"Alt (Right)" },
+        { VK_BROWSER_BACK, L"Browser Back" },
+        { VK_BROWSER_FORWARD, L"Browser Forward" },
+        { VK_BROWSER_REFRESH, L"Browser Refresh" },
+        { VK_BROWSER_STOP, L"Browser Stop" },
+        { VK_BROWSER_SEARCH, L"Browser Search" },
+        { VK_BROWSER_FAVORITES, L"Browser Favorites" },
+        { VK_BROWSER_HOME, L"Browser Home" },
+        { VK_VOLUME_MUTE, L"Volume Mute" },
+        { VK_VOLUME_DOWN, L"Volume Down" },
+        { VK_VOLUME_UP, L"Volume Up" },
+        { VK_MEDIA_NEXT_TRACK, L"Next Track" },
+        { VK_MEDIA_PREV_TRACK, L"Previous Track" },
+        { VK_MEDIA_STOP, L"Stop Media" },
+        { VK_MEDIA_PLAY_PAUSE, L"Play/Pause Media" },
+        { VK_LAUNCH_MAIL, L"Start Mail" },
+        { VK_LAUNCH_MEDIA_SELECT, L"Select Media" },
+        { VK_LAUNCH_APP1, L"Start App 1" },
+        { VK_LAUNCH_APP2, L"Start App 2" },
+        { VK_PACKET, L"Packet" },
+        { VK_ATTN, L"Attn" },
+        { VK_CRSEL, L"CrSel" },
+        { VK_EXSEL, L"ExSel" },
+        { VK_EREOF, L"Erase EOF" },
+        { VK_PLAY, L"Play" },
+        { VK_ZOOM, L"Zoom" },
+        { VK_PA1, L"PA1" },
+        { VK_OEM_CLEAR, L"Clear" },
+        { 0xFF, L"Undefined" },
+    };
+
+    const std::wstring undefinedKeyName = L"Undefined";
+    const std::wstring winBothKeyName = L"Win";
+}
+
 // Function to return the unicode string name of the key
 std::wstring LayoutMap::LayoutMapImpl::GetKeyName(DWORD key)
 {
-    std::wstring result = L"Undefined";
-    std::lock_guard<std::mutex> lock(keyboardLayoutMap_mutex);
-    UpdateLayout();
+    return GetKeyName(GetCurrentTable(), key);
+}
 
-    auto it = keyboardLayoutMap.find(key);
-    if (it != keyboardLayoutMap.end())
+const std::wstring& LayoutMap::LayoutMapImpl::GetKeyName(const LayoutTable& table, DWORD key)
+{
+    if (key < table.keyNames.size())
+    {
+        return table.keyNames[key];
+    }
+    else if (key == CommonSharedConstants::VK_WIN_BOTH)
     {
-        result = it->second;
+        return winBothKeyName;
     }
-    return result;
+
+    return undefinedKeyName;
 }
 
 // Update Keyboard layout according to input locale identifier
 void LayoutMap::LayoutMapImpl::UpdateLayout()
+{
+    GetCurrentTable();
+}
+
+const LayoutMap::LayoutMapImpl::LayoutTable& LayoutMap::LayoutMapImpl::GetCurrentTable()
 {
     // Get keyboard layout for current thread
     HKL layout = GetKeyboardLayout(0);
-    if (layout == previousLayout)
+    const LayoutTable* table = currentTable.load(std::memory_order_acquire);
+    if (table && table->layout == layout)
     {
-        return;
+        return *table;
     }
-    previousLayout = layout;
-    if (!isKeyCodeListGenerated)
+
+    std::lock_guard<std::mutex> lock(keyboardLayoutMap_mutex);
+    auto& cachedTable = layoutTables[layout];
+    if (!cachedTable)
     {
-        unicodeKeys.clear();
-        unknownKeys.clear();
+        cachedTable = BuildLayoutTable(layout);
     }
 
-    BYTE* btKeys = new BYTE[256]{ 0 };
+    currentTable.store(cachedTable.get(), std::memory_order_release);
+    return *cachedTable;
+}
+
+std::unique_ptr<LayoutMap::LayoutMapImpl::LayoutTable> LayoutMap::LayoutMapImpl::BuildLayoutTable(HKL layout)
+{
+    auto table = std::make_unique<LayoutTable>();
+    table->layout = layout;
+    table->keyNames[0] = undefinedKeyName;
+
+    BYTE btKeys[256] = { 0 };
     // Only set the Caps Lock key to on for the key names in uppercase
     btKeys[VK_CAPITAL] = 1;
 
@@ -78,203 +214,85 @@ void LayoutMap::LayoutMapImpl::UpdateLayout()
         // If a representation is returned
         if (result > 0)
         {
-            keyboardLayoutMap[i] = szBuffer;
-            if (!isKeyCodeListGenerated)
-            {
-                unicodeKeys[i] = szBuffer;
-            }
+            table->keyNames[i] = szBuffer;
+            table->unicodeKeys[i] = true;
         }
         else
         {
             // Store the virtual key code as string
-            std::wstring vk = L"VK ";
-            vk += std::to_wstring(i);
-            keyboardLayoutMap[i] = vk;
-            if (!isKeyCodeListGenerated)
-            {
-                unknownKeys[i] = vk;
-            }
+            table->keyNames[i] = L"VK " + std::to_wstring(i);
         }
     }
 
-    delete[] btKeys;
-
-    // Override special key names like Shift, Ctrl etc because they don't have unicode mappings and key names like Enter, Space as they appear as "\r", " "
-    // To do: localization
-    keyboardLayoutMap[VK_CANCEL] = L"Break";
-    keyboardLayoutMap[VK_BACK] = L"Backspace";
-    keyboardLayoutMap[VK_TAB] = L"Tab";
-    keyboardLayoutMap[VK_CLEAR] = L"Clear";
-    keyboardLayoutMap[VK_RETURN] = L"Enter";
-    keyboardLayoutMap[VK_SHIFT] = L"Shift";
-    keyboardLayoutMap[VK_CONTROL] = L"Ctrl";
-    keyboardLayoutMap[VK_MENU] = L"Alt";
-    keyboardLayoutMap[VK_PAUSE] = L"Pause";
-    keyboardLayoutMap[VK_CAPITAL] = L"Caps Lock";
-    keyboardLayoutMap[VK_ESCAPE] = L"Esc";
-    keyboardLayoutMap[VK_SPACE] = L"Space";
-    keyboardLayoutMap[VK_PRIOR] = L"PgUp";
-    keyboardLayoutMap[VK_NEXT] = L"PgDn";
-    keyboardLayoutMap[VK_END] = L"End";
-    keyboardLayoutMap[VK_HOME] = L"Home";
-    keyboardLayoutMap[VK_LEFT] = L"Left";
-    keyboardLayoutMap[VK_UP] = L"Up";
-    keyboardLayoutMap[VK_RIGHT] = L"Right";
-    keyboardLayoutMap[VK_DOWN] = L"Down";
-    keyboardLayoutMap[VK_SELECT] = L"Select";
-    keyboardLayoutMap[VK_PRINT] = L"Print";
-    keyboardLayoutMap[VK_EXECUTE] = L"Execute";
-    keyboardLayoutMap[VK_SNAPSHOT] = L"Print Screen";
-    keyboardLayoutMap[VK_INSERT] = L"Insert";
-    keyboardLayoutMap[VK_DELETE] = L"Delete";
-    keyboardLayoutMap[VK_HELP] = L"Help";
-    keyboardLayoutMap[VK_LWIN] = L"Win (Left)";
-    keyboardLayoutMap[VK_RWIN] = L"Win (Right)";
-    keyboardLayoutMap[VK_APPS] = L"Menu";
-    keyboardLayoutMap[VK_SLEEP] = L"Sleep";
-    keyboardLayoutMap[VK_NUMPAD0] = L"NumPad 0";
-    keyboardLayoutMap[VK_NUMPAD1] = L"NumPad 1";
-    keyboardLayoutMap[VK_NUMPAD2] = L"NumPad 2";
-    keyboardLayoutMap[VK_NUMPAD3] = L"NumPad 3";
-    keyboardLayoutMap[VK_NUMPAD4] = L"NumPad 4";
-    keyboardLayoutMap[VK_NUMPAD5] = L"NumPad 5";
-    keyboardLayoutMap[VK_NUMPAD6] = L"NumPad 6";
-    keyboardLayoutMap[VK_NUMPAD7] = L"NumPad 7";
-    keyboardLayoutMap[VK_NUMPAD8] = L"NumPad 8";
-    keyboardLayoutMap[VK_NUMPAD9] = L"NumPad 9";
-    keyboardLayoutMap[VK_SEPARATOR] = L"Separator";
-    keyboardLayoutMap[VK_F1] = L"F1";
-    keyboardLayoutMap[VK_F2] = L"F2";
-    keyboardLayoutMap[VK_F3] = L"F3";
-    keyboardLayoutMap[VK_F4] = L"F4";
-    keyboardLayoutMap[VK_F5] = L"F5";
-    keyboardLayoutMap[VK_F6] = L"F6";
-    keyboardLayoutMap[VK_F7] = L"F7";
-    keyboardLayoutMap[VK_F8] = L"F8";
-    keyboardLayoutMap[VK_F9] = L"F9";
-    keyboardLayoutMap[VK_F10] = L"F10";
-    keyboardLayoutMap[VK_F11] = L"F11";
-    keyboardLayoutMap[VK_F12] = L"F12";
-    keyboardLayoutMap[VK_F13] = L"F13";
-    keyboardLayoutMap[VK_F14] = L"F14";
-    keyboardLayoutMap[VK_F15] = L"F15";
-    keyboardLayoutMap[VK_F16] = L"F16";
-    keyboardLayoutMap[VK_F17] = L"F17";
-    keyboardLayoutMap[VK_F18] = L"F18";
-    keyboardLayoutMap[VK_F19] = L"F19";
-    keyboardLayoutMap[VK_F20] = L"F20";
-    keyboardLayoutMap[VK_F21] = L"F21";
-    keyboardLayoutMap[VK_F22] = L"F22";
-    keyboardLayoutMap[VK_F23] = L"F23";
-    keyboardLayoutMap[VK_F24] = L"F24";
-    keyboardLayoutMap[VK_NUMLOCK] = L"Num Lock";
-    keyboardLayoutMap[VK_SCROLL] = L"Scroll Lock";
-    keyboardLayoutMap[VK_LSHIFT] = L"Shift (Left)";
-    keyboardLayoutMap[VK_RSHIFT] = L"Shift (Right)";
-    keyboardLayoutMap[VK_LCONTROL] = L"Ctrl (Left)";
-    keyboardLayoutMap[VK_RCONTROL] = L"Ctrl (Right)";
-    keyboardLayoutMap[VK_LMENU] = L"Alt (Left)";
-    keyboardLayoutMap[VK_RMENU] = L"Alt (Right)";
-    keyboardLayoutMap[VK_BROWSER_BACK] = L"Browser Back";
-    keyboardLayoutMap[VK_BROWSER_FORWARD] = L"Browser Forward";
-    keyboardLayoutMap[VK_BROWSER_REFRESH] = L"Browser Refresh";
-    keyboardLayoutMap[VK_BROWSER_STOP] = L"Browser Stop";
-    keyboardLayoutMap[VK_BROWSER_SEARCH] = L"Browser Search";
-    keyboardLayoutMap[VK_BROWSER_FAVORITES] = L"Browser Favorites";
-    keyboardLayoutMap[VK_BROWSER_HOME] = L"Browser Home";
-    keyboardLayoutMap[VK_VOLUME_MUTE] = L"Volume Mute";
-    keyboardLayoutMap[VK_VOLUME_DOWN] = L"Volume Down";
-    keyboardLayoutMap[VK_VOLUME_UP] = L"Volume Up";
-    keyboardLayoutMap[VK_MEDIA_NEXT_TRACK] = L"Next Track";
-    keyboardLayoutMap[VK_MEDIA_PREV_TRACK] = L"Previous Track";
-    keyboardLayoutMap[VK_MEDIA_STOP] = L"Stop Media";
-    keyboardLayoutMap[VK_MEDIA_PLAY_PAUSE] = L"Play/Pause Media";
-    keyboardLayoutMap[VK_LAUNCH_MAIL] = L"Start Mail";
-    keyboardLayoutMap[VK_LAUNCH_MEDIA_SELECT] = L"Select Media";
-    keyboardLayoutMap[VK_LAUNCH_APP1] = L"Start App 1";
-    keyboardLayoutMap[VK_LAUNCH_APP2] = L"Start App 2";
-    keyboardLayoutMap[VK_PACKET] = L"Packet";
-    keyboardLayoutMap[VK_ATTN] = L"Attn";
-    keyboardLayoutMap[VK_CRSEL] = L"CrSel";
-    keyboardLayoutMap[VK_EXSEL] = L"ExSel";
-    keyboardLayoutMap[VK_EREOF] = L"Erase EOF";
-    keyboardLayoutMap[VK_PLAY] = L"Play";
-    keyboardLayoutMap[VK_ZOOM] = L"Zoom";
-    keyboardLayoutMap[VK_PA1] = L"PA1";
-    keyboardLayoutMap[VK_OEM_CLEAR] = L"Clear";
-    keyboardLayoutMap[0xFF] = L"Undefined";
-    keyboardLayoutMap[CommonSharedConstants::VK_WIN_BOTH] = L"Win";
+    for (const auto& [key, name] : specialKeyNames)
+    {
+        if (table->keyNames[key] != name)
+        {
+            table->keyNames[key] = name;
+            table->renamedKeys[key] = true;
+        }
+    }
     // To do: Add IME key names
+
+    return table;
 }
 
 // Function to return the list of key codes in the order for the drop down. It creates it if it doesn't exist
 std::vector<DWORD> LayoutMap::LayoutMapImpl::GetKeyCodeList(const bool isShortcut)
 {
+    const LayoutTable& table = GetCurrentTable();
     std::lock_guard<std::mutex> lock(keyboardLayoutMap_mutex);
-    UpdateLayout();
     std::vector<DWORD> keyCodes;
     if (!isKeyCodeListGenerated)
     {
+        std::bitset<256> addedKeys;
+
         // Add character keys
-        for (auto& it : unicodeKeys)
+        for (int i = 1; i < 256; i++)
         {
             // If it was not renamed with a special name
-            if (it.second == keyboardLayoutMap[it.first])
+            if (table.unicodeKeys[i] && !table.renamedKeys[i])
             {
-                keyCodes.push_back(it.first);
+                keyCodes.push_back(i);
+                addedKeys[i] = true;
             }
         }
 
         // Add modifier keys in alphabetical order
-        keyCodes.push_back(VK_MENU);
-        keyCodes.push_back(VK_LMENU);
-        keyCodes.push_back(VK_RMENU);
-        keyCodes.push_back(VK_CONTROL);
-        keyCodes.push_back(VK_LCONTROL);
-        keyCodes.push_back(VK_RCONTROL);
-        keyCodes.push_back(VK_SHIFT);
-        keyCodes.push_back(VK_LSHIFT);
-        keyCodes.push_back(VK_RSHIFT);
+        for (DWORD modifier : { VK_MENU, VK_LMENU, VK_RMENU, VK_CONTROL, VK_LCONTROL, VK_RCONTROL, VK_SHIFT, VK_LSHIFT, VK_RSHIFT })
+        {
+            keyCodes.push_back(modifier);
+            addedKeys[modifier] = true;
+        }
         keyCodes.push_back(CommonSharedConstants::VK_WIN_BOTH);
         keyCodes.push_back(VK_LWIN);
         keyCodes.push_back(VK_RWIN);
+        addedKeys[VK_LWIN] = true;
+        addedKeys[VK_RWIN] = true;
 
-        // Add all other special keys
+        // Add all other special keys, i.e. the keys which are not named as VK #
         std::vector<DWORD> specialKeys;
         for (int i = 1; i < 256; i++)
         {
-            // If it is not already been added (i.e. it was either a modifier or had a unicode representation)
-            if (std::find(keyCodes.begin(), keyCodes.end(), i) == keyCodes.end())
+            if (!addedKeys[i] && table.renamedKeys[i])
             {
-                // If it is any other key but it is not named as VK #
-                auto it = unknownKeys.find(i);
-                if (it == unknownKeys.end())
-                {
-                    specialKeys.push_back(i);
-                }
-                else if (unknownKeys[i] != keyboardLayoutMap[i])
-                {
-                    specialKeys.push_back(i);
-                }
+                specialKeys.push_back(i);
             }
         }
 
         // Sort the special keys in alphabetical order
         std::sort(specialKeys.begin(), specialKeys.end(), [&](const DWORD& lhs, const DWORD& rhs) {
-            return keyboardLayoutMap[lhs] < keyboardLayoutMap[rhs];
+            return table.keyNames[lhs] < table.keyNames[rhs];
         });
-        for (int i = 0; i < specialKeys.size(); i++)
-        {
-            keyCodes.push_back(specialKeys[i]);
-        }
+        keyCodes.insert(keyCodes.end(), specialKeys.begin(), specialKeys.end());
 
         // Add unknown keys
-        for (auto& it : unknownKeys)
+        for (int i = 1; i < 256; i++)
         {
             // If it was not renamed with a special name
-            if (it.second == keyboardLayoutMap[it.first])
+            if (!table.unicodeKeys[i] && !table.renamedKeys[i])
             {
-                keyCodes.push_back(it.first);
+                keyCodes.push_back(i);
             }
         }
         keyCodeList = keyCodes;
@@ -298,21 +316,22 @@ std::vector<std::wstring> LayoutMap::LayoutMapImpl::GetKeyNameList(const bool is
 {
     std::vector<std::wstring> keyNames;
     std::vector<DWORD> keyCodes = GetKeyCodeList(isShortcut);
-    std::lock_guard<std::mutex> lock(keyboardLayoutMap_mutex);
+    const LayoutTable& table = GetCurrentTable();
+    keyNames.reserve(keyCodes.size());
     // If it is a key list for the shortcut control then we add a "None" key at the start
     if (isShortcut)
     {
         keyNames.push_back(L"None");
         for (int i = 1; i < keyCodes.size(); i++)
         {
-            keyNames.push_back(keyboardLayoutMap[keyCodes[i]]);
+            keyNames.push_back(GetKeyName(table, keyCodes[i]));
         }
     }
     else
     {
         for (int i = 0; i < keyCodes.size(); i++)
         {
-            keyNames.push_back(keyboardLayoutMap[keyCodes[i]]);
+            keyNames.push_back(GetKeyName(table, keyCodes[i]));
         }
     }
 
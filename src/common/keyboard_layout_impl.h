@@ -2,6 +2,9 @@
 #include "keyboard_layout.h"
 #include "..\modules\interface\lowlevel_keyboard_event_data.h"
 #include <string>
+#include <array>
+#include <atomic>
+#include <bitset>
 #include <map>
 #include <mutex>
 #include <winrt/Windows.UI.Core.h>
@@ -12,17 +15,36 @@ using namespace winrt;
 class LayoutMap::LayoutMapImpl
 {
 private:
-    // Stores mappings for all the virtual key codes to the name of the key
-    std::mutex keyboardLayoutMap_mutex;
+    // Names of all the virtual key codes for one keyboard layout. Never changed once built, so it
+    // can be read without a lock
+    struct LayoutTable
+    {
+        HKL layout = 0;
+        std::array<std::wstring, 256> keyNames;
+        // Keys which have a unicode representation in the layout
+        std::bitset<256> unicodeKeys;
+        // Keys given a special name instead of their unicode or VK # name
+        std::bitset<256> renamedKeys;
+    };
 
-    // Stores the previous layout
-    HKL previousLayout = 0;
+    // Builds the table of a layout by asking the layout for the name of every key
+    static std::unique_ptr<LayoutTable> BuildLayoutTable(HKL layout);
 
-    // Stores the keys which have a unicode representation
-    std::map<DWORD, std::wstring> unicodeKeys;
+    // Returns the name of the key in the table, including keys outside the table like VK_WIN_BOTH
+    static const std::wstring& GetKeyName(const LayoutTable& table, DWORD key);
 
-    // Stores the keys which do not have a name
-    std::map<DWORD, std::wstring> unknownKeys;
+    // Returns the table of the layout of the current thread, built on the first use of the layout
+    const LayoutTable& GetCurrentTable();
+
+    // Guards the table cache and the key code list
+    std::mutex keyboardLayoutMap_mutex;
+
+    // Tables of every layout seen so far. Users switching between input languages switch between
+    // these instead of rebuilding them. Tables are kept until the map is destroyed.
+    std::map<HKL, std::unique_ptr<LayoutTable>> layoutTables;
+
+    // Table of the last layout used, swapped when the layout changes
+    std::atomic<const LayoutTable*> currentTable = nullptr;
 
     // Stores true if the fixed ordering key code list has already been set
     bool isKeyCodeListGenerated = false;
@@ -31,8 +53,6 @@ private:
     std::vector<DWORD> keyCodeList;
 
 public:
-    std::map<DWORD, std::wstring> keyboardLayoutMap;
-
     // Update Keyboard layout according to input locale identifier
     void UpdateLayout();
 
@@ -49,4 +69,4 @@ public:
 
     // Function to return the list of key name in the order for the drop down based on the key codes
     std::vector<std::wstring> GetKeyNameList(const bool isShortcut);
-};
\ No newline at end of file
+};
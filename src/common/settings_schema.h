@@ -0,0 +1,308 @@
+#pragma once
+#include "json.h"
+#include "settings_helpers.h"
+#include "settings_objects.h"
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+// Typed access to settings stored the way PowerToyValues stores them:
+//   { "name": ..., "version": ..., "properties": { "<field>": { "value": ... }, ... } }
+//
+// A module declares its settings struct and the schema of its fields once:
+//
+//   struct MySettings
+//   {
+//       bool enabled = true;
+//       int size = 10;
+//   };
+//
+//   constexpr auto mySettingsSchema = PowerToysSettings::make_schema(
+//       PowerToysSettings::field(L"bool_enabled", &MySettings::enabled),
+//       PowerToysSettings::field(L"int_size", &MySettings::size));
+//
+// and then reads, writes and compares the whole struct at once. parse() walks the properties once,
+// matching each of them to a field by a hash of the name computed at compile time, instead of
+// looking up every field by name in the JSON. Fields missing from the JSON, or holding a value of
+// another type, keep the value they had, e.g. the default of the struct.
+// Supported field types are bool, int, std::wstring, json::JsonObject and HotkeyObject.
+namespace PowerToysSettings
+{
+    namespace schema_details
+    {
+        // FNV-1a
+        constexpr uint64_t hash(std::wstring_view name)
+        {
+            uint64_t result = 14695981039346656037ull;
+            for (const wchar_t c : name)
+            {
+                result = (result ^ static_cast<uint64_t>(c)) * 1099511628211ull;
+            }
+            return result;
+        }
+
+        inline void read(const json::IJsonValue& value, bool& out)
+        {
+            if (value.ValueType() == json::JsonValueType::Boolean)
+            {
+                out = value.GetBoolean();
+            }
+        }
+
+        inline void read(const json::IJsonValue& value, int& out)
+        {
+            if (value.ValueType() == json::JsonValueType::Number)
+            {
+                out = static_cast<int>(value.GetNumber());
+            }
+        }
+
+        inline void read(const json::IJsonValue& value, std::wstring& out)
+        {
+            if (value.ValueType() == json::JsonValueType::String)
+            {
+                out = value.GetString().c_str();
+            }
+        }
+
+        inline void read(const json::IJsonValue& value, json::JsonObject& out)
+        {
+            if (value.ValueType() == json::JsonValueType::Object)
+            {
+                out = value.GetObjectW();
+            }
+        }
+
+        inline void read(const json::IJsonValue& value, HotkeyObject& out)
+        {
+            if (value.ValueType() == json::JsonValueType::Object)
+            {
+                try
+                {
+                    out = HotkeyObject::from_json(value.GetObjectW());
+                }
+                catch (...)
+                {
+                    // Not a hotkey, e.g. a member is missing
+                }
+            }
+        }
+
+        template<typename T>
+        inline json::JsonValue write(const T& value)
+        {
+            return json::value(value);
+        }
+
+        inline json::JsonValue write(const HotkeyObject& value)
+        {
+            return json::value(value.get_json());
+        }
+
+        template<typename T>
+        inline bool equal(const T& a, const T& b)
+        {
+            return a == b;
+        }
+
+        inline bool equal(const json::JsonObject& a, const json::JsonObject& b)
+        {
+            if (!a || !b)
+            {
+                return !a && !b;
+            }
+            return json::equals(a, b);
+        }
+
+        inline bool equal(const HotkeyObject& a, const HotkeyObject& b)
+        {
+            return json::equals(a.get_json(), b.get_json());
+        }
+    }
+
+    template<typename Struct, typename T>
+    struct Field
+    {
+        std::wstring_view name;
+        T Struct::*member;
+        uint64_t hash;
+    };
+
+    template<typename Struct, typename T>
+    constexpr Field<Struct, T> field(std::wstring_view name, T Struct::*member)
+    {
+        return { name, member, schema_details::hash(name) };
+    }
+
+    template<typename Struct, typename... T>
+    class Schema
+    {
+    public:
+        // Bit i is set when the field i of the schema differs
+        using Changes = std::bitset<sizeof...(T)>;
+
+        constexpr explicit Schema(Field<Struct, T>... fields) :
+            fields(fields...)
+        {
+        }
+
+        // Reads the fields present in the settings into values
+        void parse(const json::JsonObject& settings, Struct& values) const
+        {
+            if (!json::has(settings, L"properties"))
+            {
+                return;
+            }
+            for (const auto& property : settings.GetNamedObject(L"properties"))
+            {
+                const auto property_value = property.Value();
+                if (property_value.ValueType() != json::JsonValueType::Object)
+                {
+                    continue;
+                }
+                const auto property_object = property_value.GetObjectW();
+                if (!property_object.HasKey(L"value"))
+                {
+                    continue;
+                }
+
+                const winrt::hstring key = property.Key();
+                const std::wstring_view name = key;
+                const uint64_t name_hash = schema_details::hash(name);
+                const auto value = property_object.GetNamedValue(L"value");
+                // Stops at the field with the name
+                const auto read_fields = [&](const auto&... field) {
+                    (read_field(field, name, name_hash, value, values) || ...);
+                };
+                std::apply(read_fields, fields);
+            }
+        }
+
+        // Default values of the struct, overwritten by the ones present in the settings
+        Struct parse(const json::JsonObject& settings) const
+        {
+            Struct values{};
+            parse(settings, values);
+            return values;
+        }
+
+        // Settings as PowerToyValues writes them
+        json::JsonObject serialize(std::wstring_view powertoy_name, const Struct& values) const
+        {
+            json::JsonObject properties;
+            const auto write_fields = [&](const auto&... field) {
+                (write_field(field, values, properties), ...);
+            };
+            std::apply(write_fields, fields);
+
+            json::JsonObject settings;
+            settings.SetNamedValue(L"name", json::value(powertoy_name));
+            settings.SetNamedValue(L"version", json::value(L"1.0"));
+            settings.SetNamedValue(L"properties", properties);
+            return settings;
+        }
+
+        Changes diff(const Struct& a, const Struct& b) const
+        {
+            Changes changes;
+            size_t index = 0;
+            const auto compare_fields = [&](const auto&... field) {
+                ((changes[index++] = !schema_details::equal(a.*field.member, b.*field.member)), ...);
+            };
+            std::apply(compare_fields, fields);
+            return changes;
+        }
+
+        // Bits of the fields with the given names, from a null-terminated table. Other names are ignored.
+        Changes changes(const wchar_t* const* changed_names) const
+        {
+            Changes changes;
+            const auto field_names = names();
+            for (; *changed_names; ++changed_names)
+            {
+                for (size_t i = 0; i < field_names.size(); ++i)
+                {
+                    if (field_names[i] == *changed_names)
+                    {
+                        changes.set(i);
+                    }
+                }
+            }
+            return changes;
+        }
+
+        constexpr std::array<std::wstring_view, sizeof...(T)> names() const
+        {
+            const auto field_names = [](const auto&... field) {
+                return std::array<std::wstring_view, sizeof...(T)>{ field.name... };
+            };
+            return std::apply(field_names, fields);
+        }
+
+        // Reads the settings file of the PowerToy, defaults for the fields which aren't in it
+        Struct load(std::wstring_view powertoy_name) const
+        {
+            return parse(PTSettingsHelper::load_module_settings(powertoy_name));
+        }
+
+        // Writes the fields into the settings file of the PowerToy. The properties of the file which
+        // aren't fields of the schema are kept, e.g. the ones of another version of the PowerToy.
+        void save(std::wstring_view powertoy_name, const Struct& values) const
+        {
+            auto settings = PTSettingsHelper::load_module_settings(powertoy_name);
+            if (!json::has(settings, L"properties"))
+            {
+                settings.SetNamedValue(L"properties", json::JsonObject{});
+            }
+            auto properties = settings.GetNamedObject(L"properties");
+            for (const auto& property : serialize(powertoy_name, values).GetNamedObject(L"properties"))
+            {
+                properties.SetNamedValue(property.Key(), property.Value());
+            }
+            settings.SetNamedValue(L"name", json::value(powertoy_name));
+            settings.SetNamedValue(L"version", json::value(L"1.0"));
+            PTSettingsHelper::save_module_settings(powertoy_name, settings);
+        }
+
+    private:
+        template<typename F>
+        static bool read_field(const F& field, std::wstring_view name, const uint64_t name_hash, const json::IJsonValue& value, Struct& values)
+        {
+            if (field.hash != name_hash || field.name != name)
+            {
+                return false;
+            }
+            schema_details::read(value, values.*field.member);
+            return true;
+        }
+
+        template<typename F>
+        static void write_field(const F& field, const Struct& values, json::JsonObject& properties)
+        {
+            const auto& value = values.*field.member;
+            if constexpr (std::is_same_v<std::decay_t<decltype(value)>, json::JsonObject>)
+            {
+                if (!value)
+                {
+                    return;
+                }
+            }
+            json::JsonObject property;
+            property.SetNamedValue(L"value", schema_details::write(value));
+            properties.SetNamedValue(field.name, property);
+        }
+
+        std::tuple<Field<Struct, T>...> fields;
+    };
+
+    template<typename Struct, typename... T>
+    constexpr Schema<Struct, T...> make_schema(Field<Struct, T>... fields)
+    {
+        return Schema<Struct, T...>(fields...);
+    }
+}
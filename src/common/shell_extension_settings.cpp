@@ -0,0 +1,317 @@
+#include "pch.h"
+#include "shell_extension_settings.h"
+#include "common.h"
+
+#include <sddl.h>
+#include <memory>
+#include <mutex>
+
+namespace shell_extension_settings
+{
+    namespace
+    {
+        const wchar_t SECTION_NAME[] = L"Local\\PowerToysShellExtensionSettings";
+        const uint32_t LAYOUT_VERSION = 2;
+        // Readers give up and fall back to the settings file if a writer holds the lock for this long.
+        const int MAX_READ_ATTEMPTS = 64;
+
+        struct SharedModuleState
+        {
+            volatile LONG published;
+            volatile LONG enabled;
+            volatile LONG flags;
+        };
+
+        struct SharedSnapshot
+        {
+            uint32_t layout_version;
+            uint32_t size;
+            volatile LONG64 generation;
+            // Process id of the runner which publishes into the section, 0 once it exited
+            volatile LONG owner_pid;
+            SharedModuleState modules[static_cast<size_t>(Module::Count)];
+        };
+
+        struct MappedSnapshot
+        {
+            HANDLE mapping = nullptr;
+            SharedSnapshot* snapshot = nullptr;
+
+            MappedSnapshot(DWORD access)
+            {
+                mapping = OpenFileMappingW(access, FALSE, SECTION_NAME);
+                if (mapping)
+                {
+                    snapshot = static_cast<SharedSnapshot*>(MapViewOfFile(mapping, access, 0, 0, sizeof(SharedSnapshot)));
+                }
+                if (snapshot && (snapshot->layout_version != LAYOUT_VERSION || snapshot->size != sizeof(SharedSnapshot)))
+                {
+                    UnmapViewOfFile(snapshot);
+                    snapshot = nullptr;
+                }
+            }
+
+            ~MappedSnapshot()
+            {
+                if (owner_process)
+                {
+                    CloseHandle(owner_process);
+                }
+                if (snapshot)
+                {
+                    UnmapViewOfFile(snapshot);
+                }
+                if (mapping)
+                {
+                    CloseHandle(mapping);
+                }
+            }
+
+            MappedSnapshot(const MappedSnapshot&) = delete;
+            MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+            // Remembers the runner owning the section, so that a reused view can tell when the
+            // runner exited, even if it crashed.
+            bool watch_owner()
+            {
+                owner_pid = ReadAcquire(&snapshot->owner_pid);
+                if (owner_pid != 0)
+                {
+                    owner_process = OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(owner_pid));
+                }
+                return owner_process != nullptr;
+            }
+
+            // True while the runner which owned the section when it was mapped still owns it
+            bool owner_alive() const
+            {
+                return owner_process &&
+                       ReadAcquire(&snapshot->owner_pid) == owner_pid &&
+                       WaitForSingleObject(owner_process, 0) == WAIT_TIMEOUT;
+            }
+
+            LONG owner_pid = 0;
+            HANDLE owner_process = nullptr;
+        };
+
+        // Takes the write side of the seqlock: moves the generation from even to odd
+        LONG64 begin_write(SharedSnapshot* snapshot)
+        {
+            LONG64 generation = ReadAcquire64(&snapshot->generation);
+            while ((generation & 1) || InterlockedCompareExchange64(&snapshot->generation, generation + 1, generation) != generation)
+            {
+                YieldProcessor();
+                generation = ReadAcquire64(&snapshot->generation);
+            }
+            return generation;
+        }
+
+        void end_write(SharedSnapshot* snapshot, const LONG64 generation)
+        {
+            // Full barrier, releases the lock and makes the new state visible.
+            InterlockedExchange64(&snapshot->generation, generation + 2);
+        }
+
+        // Explorer asks for the settings several times for every context menu, so the view is
+        // mapped once and reused until the runner which owns the section exits or is replaced.
+        // Readers keep the view they got alive while they read it.
+        std::shared_ptr<const MappedSnapshot> get_read_snapshot()
+        {
+            static std::mutex cache_mutex;
+            static std::shared_ptr<const MappedSnapshot> cached;
+
+            std::unique_lock lock(cache_mutex);
+            if (cached && cached->owner_alive())
+            {
+                return cached;
+            }
+            cached = nullptr;
+
+            auto mapped = std::make_shared<MappedSnapshot>(FILE_MAP_READ);
+            if (!mapped->snapshot)
+            {
+                return nullptr;
+            }
+            // A view whose owner can't be watched is only used for this read
+            if (mapped->watch_owner())
+            {
+                cached = mapped;
+            }
+            return mapped;
+        }
+
+        bool process_alive(const DWORD pid)
+        {
+            HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, pid);
+            if (!process)
+            {
+                // Any other error means the process exists but can't be opened
+                return GetLastError() != ERROR_INVALID_PARAMETER;
+            }
+            const bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+            CloseHandle(process);
+            return alive;
+        }
+
+        // Grant full access to the current user (both elevated and non-elevated tokens of the
+        // same user need to open the section) and SYSTEM.
+        std::wstring section_security_descriptor()
+        {
+            std::wstring result = L"D:P(A;;GA;;;SY)(A;;GA;;;BA)";
+
+            HANDLE token = nullptr;
+            if (OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, &token))
+            {
+                on_scope_exit close_token([&] { CloseHandle(token); });
+
+                DWORD size = 0;
+                GetTokenInformation(token, TokenUser, nullptr, 0, &size);
+                typed_storage<TOKEN_USER> user{ size };
+                wchar_t* sid = nullptr;
+                if (size && GetTokenInformation(token, TokenUser, user, size, &size) &&
+                    ConvertSidToStringSidW(static_cast<TOKEN_USER*>(user)->User.Sid, &sid))
+                {
+                    result += L"(A;;GA;;;";
+                    result += sid;
+                    result += L")";
+                    LocalFree(sid);
+                }
+            }
+            return result;
+        }
+    }
+
+    Publisher::Publisher()
+    {
+        PSECURITY_DESCRIPTOR descriptor = nullptr;
+        if (!ConvertStringSecurityDescriptorToSecurityDescriptorW(section_security_descriptor().c_str(), SDDL_REVISION_1, &descriptor, nullptr))
+        {
+            return;
+        }
+        on_scope_exit free_descriptor([&] { LocalFree(descriptor); });
+
+        SECURITY_ATTRIBUTES attributes{ sizeof(attributes), descriptor, FALSE };
+        mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, &attributes, PAGE_READWRITE, 0, sizeof(SharedSnapshot), SECTION_NAME);
+        if (!mapping)
+        {
+            return;
+        }
+        const bool existed = GetLastError() == ERROR_ALREADY_EXISTS;
+
+        // A new section is zero-initialized, so every module starts unpublished.
+        auto snapshot = static_cast<SharedSnapshot*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedSnapshot)));
+        if (!snapshot)
+        {
+            CloseHandle(mapping);
+            mapping = nullptr;
+            return;
+        }
+        if (existed)
+        {
+            // Shell extensions keep the section of a runner which exited open, it's taken over
+            // unless that runner is still alive.
+            const LONG owner_pid = ReadAcquire(&snapshot->owner_pid);
+            const bool layout_matches = ReadAcquire(reinterpret_cast<volatile LONG*>(&snapshot->layout_version)) == LAYOUT_VERSION &&
+                                        snapshot->size == sizeof(SharedSnapshot);
+            if (!layout_matches || (owner_pid != 0 && process_alive(static_cast<DWORD>(owner_pid))))
+            {
+                UnmapViewOfFile(snapshot);
+                CloseHandle(mapping);
+                mapping = nullptr;
+                return;
+            }
+
+            const LONG64 generation = begin_write(snapshot);
+            for (auto& module : snapshot->modules)
+            {
+                WriteNoFence(&module.published, 0);
+            }
+            WriteNoFence(&snapshot->owner_pid, static_cast<LONG>(GetCurrentProcessId()));
+            end_write(snapshot, generation);
+        }
+        else
+        {
+            snapshot->size = sizeof(SharedSnapshot);
+            snapshot->owner_pid = static_cast<LONG>(GetCurrentProcessId());
+            // Publish the layout version last, readers ignore the section until then.
+            InterlockedExchange(reinterpret_cast<volatile LONG*>(&snapshot->layout_version), LAYOUT_VERSION);
+        }
+        view = snapshot;
+    }
+
+    Publisher::~Publisher()
+    {
+        if (view)
+        {
+            // Shell extensions holding on to the section drop it at their next read
+            InterlockedExchange(&static_cast<SharedSnapshot*>(view)->owner_pid, 0);
+            UnmapViewOfFile(view);
+        }
+        if (mapping)
+        {
+            CloseHandle(mapping);
+        }
+    }
+
+    bool publish(Module module, const ModuleState& state)
+    {
+        if (module >= Module::Count)
+        {
+            return false;
+        }
+
+        MappedSnapshot mapped{ FILE_MAP_READ | FILE_MAP_WRITE };
+        if (!mapped.snapshot)
+        {
+            return false;
+        }
+
+        auto snapshot = mapped.snapshot;
+
+        const LONG64 generation = begin_write(snapshot);
+
+        auto& shared = snapshot->modules[static_cast<size_t>(module)];
+        WriteNoFence(&shared.enabled, state.enabled ? 1 : 0);
+        WriteNoFence(&shared.flags, static_cast<LONG>(state.flags));
+        WriteNoFence(&shared.published, 1);
+        end_write(snapshot, generation);
+        return true;
+    }
+
+    std::optional<ModuleState> read(Module module)
+    {
+        if (module >= Module::Count)
+        {
+            return std::nullopt;
+        }
+
+        const auto mapped = get_read_snapshot();
+        if (!mapped)
+        {
+            return std::nullopt;
+        }
+
+        const auto& shared = mapped->snapshot->modules[static_cast<size_t>(module)];
+        for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt)
+        {
+            const LONG64 before = ReadAcquire64(&mapped->snapshot->generation);
+            if (before & 1)
+            {
+                YieldProcessor();
+                continue;
+            }
+
+            const LONG published = ReadNoFence(&shared.published);
+            ModuleState state;
+            state.enabled = ReadNoFence(&shared.enabled) != 0;
+            state.flags = static_cast<uint32_t>(ReadNoFence(&shared.flags));
+
+            MemoryBarrier();
+            if (ReadNoFence64(&mapped->snapshot->generation) == before)
+            {
+                return published ? std::optional<ModuleState>{ state } : std::nullopt;
+            }
+        }
+        return std::nullopt;
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <Windows.h>
+#include <cstdint>
+#include <optional>
+
+// Read-only snapshot of the settings the shell extensions need on every right-click.
+// The runner owns a named shared memory section for the lifetime of the process and
+// modules loaded into the runner publish their state into it. Shell extensions running
+// inside Explorer read it without touching the disk and fall back to their JSON settings
+// file only when no runner is present (or the module hasn't published yet).
+//
+// Writers and readers are synchronized with a seqlock: the generation counter is odd
+// while a write is in progress and readers retry when it changed under them. Readers map
+// the section once per process and keep the view until the runner which owns it exits.
+namespace shell_extension_settings
+{
+    enum class Module : uint32_t
+    {
+        ImageResizer = 0,
+        PowerRename,
+        Count
+    };
+
+    // Module specific flags stored in ModuleState::flags
+    namespace flags
+    {
+        const uint32_t POWER_RENAME_SHOW_ICON_ON_MENU = 1 << 0;
+        const uint32_t POWER_RENAME_EXTENDED_CONTEXT_MENU_ONLY = 1 << 1;
+    }
+
+    struct ModuleState
+    {
+        bool enabled = true;
+        uint32_t flags = 0;
+    };
+
+    // Owned by the runner, keeps the shared section alive until destroyed.
+    class Publisher
+    {
+    public:
+        Publisher();
+        ~Publisher();
+        Publisher(const Publisher&) = delete;
+        Publisher& operator=(const Publisher&) = delete;
+
+        bool valid() const { return view != nullptr; }
+
+    private:
+        HANDLE mapping = nullptr;
+        void* view = nullptr;
+    };
+
+    // Publishes the state of a module. Does nothing if the runner isn't running.
+    bool publish(Module module, const ModuleState& state);
+
+    // Returns the published state of a module, or an empty optional if there's no runner
+    // or the module hasn't published its state yet.
+    std::optional<ModuleState> read(Module module);
+}
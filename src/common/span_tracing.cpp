@@ -0,0 +1,222 @@
+#include "pch.h"
+#include "span_tracing.h"
+#include "settings_helpers.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace span_tracing
+{
+    namespace detail
+    {
+        thread_local ThreadBuffer* thread_buffer = nullptr;
+    }
+
+    namespace
+    {
+        using detail::ThreadBuffer;
+
+        const double MIN_CALIBRATION_SECONDS = 0.1;
+
+        int64_t query_performance_counter()
+        {
+            LARGE_INTEGER counter;
+            QueryPerformanceCounter(&counter);
+            return counter.QuadPart;
+        }
+
+        int64_t query_performance_frequency()
+        {
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+            return frequency.QuadPart;
+        }
+
+        // Both counters read together when the first span is recorded, the ticks are measured from there
+        struct Origin
+        {
+            ticks tsc = now();
+            int64_t qpc = query_performance_counter();
+            int64_t qpc_frequency = query_performance_frequency();
+        };
+
+        const Origin& get_origin()
+        {
+            static const Origin origin;
+            return origin;
+        }
+
+        struct Registry
+        {
+            std::mutex mutex;
+            // Kept after their threads exit, so their spans are still exported
+            std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+        };
+
+        Registry& get_registry()
+        {
+            static Registry registry;
+            return registry;
+        }
+
+        struct CopiedSpan
+        {
+            const char* name;
+            ticks start;
+            ticks end;
+        };
+
+        std::vector<CopiedSpan> copy_spans(const ThreadBuffer& buffer)
+        {
+            const uint64_t published = buffer.published.load(std::memory_order_acquire);
+            const uint64_t first = published > SPANS_PER_THREAD ? published - SPANS_PER_THREAD : 0;
+            std::vector<CopiedSpan> copied;
+            copied.reserve(published - first);
+            for (uint64_t i = first; i < published; ++i)
+            {
+                const auto& span = buffer.spans[i % SPANS_PER_THREAD];
+                copied.push_back({ span.name.load(std::memory_order_relaxed),
+                                   span.start.load(std::memory_order_relaxed),
+                                   span.end.load(std::memory_order_relaxed) });
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            // Slot i is overwritten by the span numbered i + SPANS_PER_THREAD, which claims i + SPANS_PER_THREAD + 1
+            const uint64_t claimed = buffer.claimed.load(std::memory_order_relaxed);
+            const uint64_t overwritten = claimed > SPANS_PER_THREAD ? claimed - SPANS_PER_THREAD : 0;
+            if (overwritten > first)
+            {
+                copied.erase(copied.begin(), copied.begin() + std::min<uint64_t>(overwritten - first, copied.size()));
+            }
+            return copied;
+        }
+
+        void append_escaped(std::string& out, const char* text)
+        {
+            for (; *text; ++text)
+            {
+                const char c = *text;
+                if (c == '"' || c == '\\')
+                {
+                    out += '\\';
+                    out += c;
+                }
+                else if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    out += ' ';
+                }
+                else
+                {
+                    out += c;
+                }
+            }
+        }
+    }
+
+    namespace detail
+    {
+        ThreadBuffer* register_thread() noexcept
+        {
+            try
+            {
+                get_origin();
+                auto buffer = std::make_unique<ThreadBuffer>();
+                buffer->thread_id = GetCurrentThreadId();
+                auto& registry = get_registry();
+                std::unique_lock lock(registry.mutex);
+                registry.buffers.push_back(std::move(buffer));
+                thread_buffer = registry.buffers.back().get();
+                return thread_buffer;
+            }
+            catch (...)
+            {
+                return nullptr;
+            }
+        }
+    }
+
+    double ticks_per_second()
+    {
+        const auto& origin = get_origin();
+        const double frequency = static_cast<double>(origin.qpc_frequency);
+        const double elapsed = (query_performance_counter() - origin.qpc) / frequency;
+        if (elapsed < MIN_CALIBRATION_SECONDS)
+        {
+            Sleep(static_cast<DWORD>((MIN_CALIBRATION_SECONDS - elapsed) * 1000) + 1);
+        }
+
+        // Read close together, so the ratio doesn't include a preemption between them
+        const ticks tsc = now();
+        const int64_t qpc = query_performance_counter();
+        return (tsc - origin.tsc) * frequency / (qpc - origin.qpc);
+    }
+
+    std::string export_chrome_trace()
+    {
+        const auto& origin = get_origin();
+        const double ticks_per_microsecond = ticks_per_second() / 1e6;
+        const double origin_microseconds = origin.qpc * 1e6 / origin.qpc_frequency;
+        // The counter ticks of the spans on the QueryPerformanceCounter() timeline
+        const auto to_microseconds = [&](const ticks tsc) {
+            return origin_microseconds + static_cast<int64_t>(tsc - origin.tsc) / ticks_per_microsecond;
+        };
+
+        std::vector<std::pair<DWORD, std::vector<CopiedSpan>>> threads;
+        {
+            auto& registry = get_registry();
+            std::unique_lock lock(registry.mutex);
+            for (const auto& buffer : registry.buffers)
+            {
+                threads.emplace_back(buffer->thread_id, copy_spans(*buffer));
+            }
+        }
+
+        // The clock is shared by all the processes, so the files of several binaries line up
+        const auto process_id = std::to_string(GetCurrentProcessId());
+        std::string result = "{\"traceEvents\":[";
+        bool first = true;
+        for (const auto& [thread_id, spans] : threads)
+        {
+            for (const auto& span : spans)
+            {
+                result += first ? "\n" : ",\n";
+                first = false;
+                result += "{\"name\":\"";
+                append_escaped(result, span.name);
+                result += "\",\"cat\":\"powertoys\",\"ph\":\"X\",\"ts\":";
+                result += std::to_string(to_microseconds(span.start));
+                result += ",\"dur\":";
+                result += std::to_string((span.end - span.start) / ticks_per_microsecond);
+                result += ",\"pid\":";
+                result += process_id;
+                result += ",\"tid\":";
+                result += std::to_string(thread_id);
+                result += "}";
+            }
+        }
+        result += "\n],\"displayTimeUnit\":\"ms\"}\n";
+        return result;
+    }
+
+    void write_chrome_trace(std::wstring_view name)
+    {
+        try
+        {
+            std::filesystem::path folder = PTSettingsHelper::get_root_save_folder_location();
+            folder /= L"Traces";
+            std::filesystem::create_directories(folder);
+            std::wstring file_name{ name };
+            file_name += L"-" + std::to_wstring(GetCurrentProcessId()) + L".json";
+            std::ofstream file(folder / file_name, std::ios::binary | std::ios::trunc);
+            file << export_chrome_trace();
+        }
+        catch (...)
+        {
+        }
+    }
+}
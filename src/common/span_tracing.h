@@ -0,0 +1,122 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <intrin.h>
+#include <string>
+#include <string_view>
+
+// Scoped timing spans, exported as Chrome trace-event JSON for chrome://tracing or ui.perfetto.dev.
+// The PERF_SPAN macros only record when POWERTOYS_SPAN_TRACING is defined, which the build does with
+// /p:PowerToysSpanTracing=true. Otherwise they expand to nothing.
+//
+// Every thread records into a ring buffer of its own, keeping its last SPANS_PER_THREAD spans. The
+// thread is the only writer of its buffer, so recording takes no lock; the export copies the buffers
+// while they are written and drops the spans overwritten meanwhile.
+// Every binary linking common has its own buffers, so the runner and each module export their own file.
+namespace span_tracing
+{
+    // Time stamp counter ticks. The counter is invariant and synchronized between the cores on the
+    // x64 machines PowerToys runs on, and reading it takes a few nanoseconds, where each
+    // QueryPerformanceCounter() call behind std::chrono::steady_clock can take tens in a virtual
+    // machine. The export converts the ticks to the QueryPerformanceCounter() timeline.
+    using ticks = uint64_t;
+
+    inline ticks now() noexcept
+    {
+        return __rdtsc();
+    }
+
+    // Ticks per second, measured against QueryPerformanceCounter() since the first span was recorded.
+    // Waits for the measurement to cover 100 ms if called earlier.
+    double ticks_per_second();
+
+    const size_t SPANS_PER_THREAD = 4096;
+
+    namespace detail
+    {
+        struct Span
+        {
+            std::atomic<const char*> name = nullptr;
+            std::atomic<ticks> start = 0;
+            std::atomic<ticks> end = 0;
+        };
+
+        // Written by its thread only. claimed is bumped before a slot is overwritten and published
+        // after, so the export can tell which of the slots it copied were overwritten meanwhile.
+        struct ThreadBuffer
+        {
+            uint32_t thread_id = 0;
+            std::atomic<uint64_t> claimed = 0;
+            std::atomic<uint64_t> published = 0;
+            Span spans[SPANS_PER_THREAD];
+        };
+
+        // Constant initialized, so reading it is a load from the static TLS block of the thread,
+        // without a call or an initialization check
+        extern thread_local ThreadBuffer* thread_buffer;
+
+        // Creates the buffer of the calling thread and sets thread_buffer, returns nullptr if that fails
+        ThreadBuffer* register_thread() noexcept;
+    }
+
+    // The name isn't copied, it has to outlive the export, e.g. a string literal.
+    // Inline, so a span costs the two counter reads and a few stores.
+    inline void record(const char* name, const ticks start, const ticks end) noexcept
+    {
+        auto buffer = detail::thread_buffer;
+        if (!buffer)
+        {
+            buffer = detail::register_thread();
+            if (!buffer)
+            {
+                return;
+            }
+        }
+
+        const uint64_t index = buffer->published.load(std::memory_order_relaxed);
+        buffer->claimed.store(index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        auto& span = buffer->spans[index % SPANS_PER_THREAD];
+        span.name.store(name, std::memory_order_relaxed);
+        span.start.store(start, std::memory_order_relaxed);
+        span.end.store(end, std::memory_order_relaxed);
+        buffer->published.store(index + 1, std::memory_order_release);
+    }
+
+    class ScopedSpan
+    {
+    public:
+        explicit ScopedSpan(const char* name) noexcept :
+            name(name), start(now())
+        {
+        }
+
+        ~ScopedSpan()
+        {
+            record(name, start, now());
+        }
+
+        ScopedSpan(const ScopedSpan&) = delete;
+        ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+    private:
+        const char* name;
+        ticks start;
+    };
+
+    // Spans recorded so far by every thread of this binary, as Chrome trace-event JSON
+    std::string export_chrome_trace();
+
+    // Writes the export to Traces\<name>-<process id>.json in the PowerToys settings folder
+    void write_chrome_trace(std::wstring_view name);
+}
+
+#ifdef POWERTOYS_SPAN_TRACING
+#define PERF_SPAN_CONCAT_IMPL(a, b) a##b
+#define PERF_SPAN_CONCAT(a, b) PERF_SPAN_CONCAT_IMPL(a, b)
+#define PERF_SPAN(name) span_tracing::ScopedSpan PERF_SPAN_CONCAT(perf_span_, __LINE__)(name)
+#define PERF_SPAN_WRITE_TRACE(name) span_tracing::write_chrome_trace(name)
+#else
+#define PERF_SPAN(name)
+#define PERF_SPAN_WRITE_TRACE(name)
+#endif
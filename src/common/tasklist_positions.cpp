@@ -1,6 +1,200 @@
 #include "pch.h"
 #include "tasklist_positions.h"
 
+namespace
+{
+    // A button of the taskbar as found by the walk, before the keynums are assigned
+    struct TrackedButton
+    {
+        std::vector<int> runtime_id;
+        TasklistButton button;
+    };
+
+    bool read_rect(const VARIANT& var_rect, TasklistButton& button)
+    {
+        if (var_rect.vt != (VT_R8 | VT_ARRAY))
+        {
+            return false;
+        }
+        LONG pos;
+        double value;
+        pos = 0;
+        SafeArrayGetElement(var_rect.parray, &pos, &value);
+        button.x = (long)value;
+        pos = 1;
+        SafeArrayGetElement(var_rect.parray, &pos, &value);
+        button.y = (long)value;
+        pos = 2;
+        SafeArrayGetElement(var_rect.parray, &pos, &value);
+        button.width = (long)value;
+        pos = 3;
+        SafeArrayGetElement(var_rect.parray, &pos, &value);
+        button.height = (long)value;
+        return true;
+    }
+
+    std::vector<int> read_runtime_id(SAFEARRAY* array)
+    {
+        std::vector<int> runtime_id;
+        LONG lower = 0, upper = -1;
+        if (array && SafeArrayGetLBound(array, 1, &lower) >= 0 && SafeArrayGetUBound(array, 1, &upper) >= 0)
+        {
+            for (LONG pos = lower; pos <= upper; ++pos)
+            {
+                int value = 0;
+                SafeArrayGetElement(array, &pos, &value);
+                runtime_id.push_back(value);
+            }
+        }
+        return runtime_id;
+    }
+
+    // Numbers the buttons of the first row the way Win+number does
+    void assign_keynums(const std::vector<TrackedButton>& found_buttons, std::vector<TasklistButton>& buttons)
+    {
+        buttons.clear();
+        for (auto& found : found_buttons)
+        {
+            TasklistButton button = found.button;
+            if (buttons.empty())
+            {
+                button.keynum = 1;
+                buttons.push_back(std::move(button));
+            }
+            else
+            {
+                if (button.x < buttons.back().x || button.y < buttons.back().y) // skip 2nd row
+                    break;
+                if (button.name == buttons.back().name)
+                    continue; // skip buttons from the same app
+                button.keynum = buttons.back().keynum + 1;
+                buttons.push_back(std::move(button));
+                if (buttons.back().keynum == 10)
+                    break; // no more than 10 buttons
+            }
+        }
+    }
+}
+
+struct Tasklist::State
+{
+    std::mutex mutex;
+    // Buttons in taskbar order, as of the last walk and the moves seen since
+    std::vector<TrackedButton> tracked_buttons;
+    std::vector<TasklistButton> buttons;
+    // Set when buttons were added, removed or reordered, or moved during a walk
+    bool stale = true;
+    bool walking = false;
+    std::function<void()> changed_callback;
+
+    // Called with the mutex held
+    void notify_changed()
+    {
+        if (changed_callback)
+        {
+            changed_callback();
+        }
+    }
+};
+
+class Tasklist::EventHandler : public IUIAutomationStructureChangedEventHandler, public IUIAutomationPropertyChangedEventHandler
+{
+public:
+    EventHandler(std::shared_ptr<State> state) :
+        state(std::move(state))
+    {
+    }
+
+    IFACEMETHODIMP QueryInterface(REFIID riid, void** ppv) override
+    {
+        if (riid == __uuidof(IUnknown) || riid == __uuidof(IUIAutomationStructureChangedEventHandler))
+        {
+            *ppv = static_cast<IUIAutomationStructureChangedEventHandler*>(this);
+        }
+        else if (riid == __uuidof(IUIAutomationPropertyChangedEventHandler))
+        {
+            *ppv = static_cast<IUIAutomationPropertyChangedEventHandler*>(this);
+        }
+        else
+        {
+            *ppv = nullptr;
+            return E_NOINTERFACE;
+        }
+        AddRef();
+        return S_OK;
+    }
+
+    IFACEMETHODIMP_(ULONG) AddRef() override
+    {
+        return InterlockedIncrement(&ref_count);
+    }
+
+    IFACEMETHODIMP_(ULONG) Release() override
+    {
+        auto count = InterlockedDecrement(&ref_count);
+        if (count == 0)
+        {
+            delete this;
+        }
+        return count;
+    }
+
+    // Buttons added, removed or reordered, the next update walks the taskbar again
+    IFACEMETHODIMP HandleStructureChangedEvent(IUIAutomationElement*, StructureChangeType, SAFEARRAY*) override
+    {
+        std::unique_lock lock(state->mutex);
+        state->stale = true;
+        state->notify_changed();
+        return S_OK;
+    }
+
+    // A button moved, its new position comes with the event
+    IFACEMETHODIMP HandlePropertyChangedEvent(IUIAutomationElement* sender, PROPERTYID property_id, VARIANT new_value) override
+    {
+        if (property_id != UIA_BoundingRectanglePropertyId || !sender)
+        {
+            return S_OK;
+        }
+        std::vector<int> runtime_id;
+        if (SAFEARRAY* array = nullptr; sender->GetRuntimeId(&array) >= 0)
+        {
+            runtime_id = read_runtime_id(array);
+            SafeArrayDestroy(array);
+        }
+
+        std::unique_lock lock(state->mutex);
+        auto tracked = std::find_if(state->tracked_buttons.begin(), state->tracked_buttons.end(), [&](const TrackedButton& button) {
+            return !runtime_id.empty() && button.runtime_id == runtime_id;
+        });
+        if (state->walking || tracked == state->tracked_buttons.end() || !read_rect(new_value, tracked->button))
+        {
+            state->stale = true;
+        }
+        else
+        {
+            assign_keynums(state->tracked_buttons, state->buttons);
+        }
+        state->notify_changed();
+        return S_OK;
+    }
+
+private:
+    ULONG ref_count = 1;
+    std::shared_ptr<State> state;
+};
+
+Tasklist::Tasklist() :
+    state(std::make_shared<State>())
+{
+}
+
+Tasklist::~Tasklist()
+{
+    release();
+    std::unique_lock lock(state->mutex);
+    state->changed_callback = nullptr;
+}
+
 void Tasklist::update()
 {
     // Get HWND of the tasklist
@@ -16,6 +210,11 @@ void Tasklist::update()
     tasklist_hwnd = FindWindowExA(tasklist_hwnd, 0, "MSTaskListWClass", nullptr);
     if (!tasklist_hwnd)
         return;
+    if (element && tasklist_hwnd == this->tasklist_hwnd)
+    {
+        // Still the same taskbar, the events keep the buttons up to date
+        return;
+    }
     if (!automation)
     {
         winrt::check_hresult(CoCreateInstance(CLSID_CUIAutomation,
@@ -24,9 +223,52 @@ void Tasklist::update()
                                               IID_IUIAutomation,
                                               automation.put_void()));
         winrt::check_hresult(automation->CreateTrueCondition(true_condition.put()));
+        winrt::check_hresult(automation->CreateCacheRequest(cache_request.put()));
+        winrt::check_hresult(cache_request->AddProperty(UIA_BoundingRectanglePropertyId));
+        winrt::check_hresult(cache_request->AddProperty(UIA_AutomationIdPropertyId));
+        winrt::check_hresult(cache_request->AddProperty(UIA_RuntimeIdPropertyId));
+        winrt::check_hresult(cache_request->put_AutomationElementMode(AutomationElementMode_None));
     }
-    element = nullptr;
+    stop_tracking();
     winrt::check_hresult(automation->ElementFromHandle(tasklist_hwnd, element.put()));
+    this->tasklist_hwnd = tasklist_hwnd;
+    {
+        std::unique_lock lock(state->mutex);
+        state->stale = true;
+    }
+
+    auto handler = new EventHandler(state);
+    structure_handler.attach(handler);
+    property_handler.copy_from(handler);
+    // Without the events the buttons are walked on every update, as if they always changed
+    PROPERTYID rect_property = UIA_BoundingRectanglePropertyId;
+    if (automation->AddStructureChangedEventHandler(element.get(), TreeScope_Element | TreeScope_Children, nullptr, structure_handler.get()) < 0 ||
+        automation->AddPropertyChangedEventHandlerNativeArray(element.get(), TreeScope_Children, nullptr, property_handler.get(), &rect_property, 1) < 0)
+    {
+        automation->RemoveAllEventHandlers();
+        structure_handler = nullptr;
+        property_handler = nullptr;
+    }
+}
+
+void Tasklist::stop_tracking()
+{
+    if (automation && structure_handler)
+    {
+        automation->RemoveAllEventHandlers();
+    }
+    structure_handler = nullptr;
+    property_handler = nullptr;
+    element = nullptr;
+    tasklist_hwnd = nullptr;
+}
+
+void Tasklist::release()
+{
+    stop_tracking();
+    cache_request = nullptr;
+    true_condition = nullptr;
+    automation = nullptr;
 }
 
 bool Tasklist::update_buttons(std::vector<TasklistButton>& buttons)
@@ -35,76 +277,69 @@ bool Tasklist::update_buttons(std::vector<TasklistButton>& buttons)
     {
         return false;
     }
+    {
+        std::unique_lock lock(state->mutex);
+        if (!state->stale && structure_handler)
+        {
+            buttons = state->buttons;
+            return true;
+        }
+        // Changes arriving during the walk mark the buttons stale again
+        state->stale = false;
+        state->walking = true;
+    }
+
+    // One cross-process call returns the buttons with their properties
+    std::vector<TrackedButton> found_buttons;
+    bool walked = false;
     winrt::com_ptr<IUIAutomationElementArray> elements;
-    if (element->FindAll(TreeScope_Children, true_condition.get(), elements.put()) < 0)
-        return false;
-    if (!elements)
-        return false;
-    int count;
-    if (elements->get_Length(&count) < 0)
-        return false;
-    winrt::com_ptr<IUIAutomationElement> child;
-    std::vector<TasklistButton> found_buttons;
-    found_buttons.reserve(count);
-    for (int i = 0; i < count; ++i)
+    int count = 0;
+    if (element->FindAllBuildCache(TreeScope_Children, true_condition.get(), cache_request.get(), elements.put()) >= 0 &&
+        elements && elements->get_Length(&count) >= 0)
     {
-        child = nullptr;
-        if (elements->GetElement(i, child.put()) < 0)
-            return false;
-        TasklistButton button;
-        if (VARIANT var_rect; child->GetCurrentPropertyValue(UIA_BoundingRectanglePropertyId, &var_rect) >= 0)
+        walked = true;
+        found_buttons.reserve(count);
+        winrt::com_ptr<IUIAutomationElement> child;
+        for (int i = 0; i < count; ++i)
         {
-            if (var_rect.vt == (VT_R8 | VT_ARRAY))
+            child = nullptr;
+            TrackedButton found;
+            VARIANT var_rect;
+            if (elements->GetElement(i, child.put()) < 0 ||
+                child->GetCachedPropertyValue(UIA_BoundingRectanglePropertyId, &var_rect) < 0)
             {
-                LONG pos;
-                double value;
-                pos = 0;
-                SafeArrayGetElement(var_rect.parray, &pos, &value);
-                button.x = (long)value;
-                pos = 1;
-                SafeArrayGetElement(var_rect.parray, &pos, &value);
-                button.y = (long)value;
-                pos = 2;
-                SafeArrayGetElement(var_rect.parray, &pos, &value);
-                button.width = (long)value;
-                pos = 3;
-                SafeArrayGetElement(var_rect.parray, &pos, &value);
-                button.height = (long)value;
+                walked = false;
+                break;
             }
+            read_rect(var_rect, found.button);
             VariantClear(&var_rect);
+            if (BSTR automation_id; child->get_CachedAutomationId(&automation_id) >= 0)
+            {
+                found.button.name = automation_id;
+                SysFreeString(automation_id);
+            }
+            if (VARIANT var_id; child->GetCachedPropertyValue(UIA_RuntimeIdPropertyId, &var_id) >= 0)
+            {
+                if (var_id.vt == (VT_I4 | VT_ARRAY))
+                {
+                    found.runtime_id = read_runtime_id(var_id.parray);
+                }
+                VariantClear(&var_id);
+            }
+            found_buttons.push_back(std::move(found));
         }
-        else
-        {
-            return false;
-        }
-        if (BSTR automation_id; child->get_CurrentAutomationId(&automation_id) >= 0)
-        {
-            button.name = automation_id;
-            SysFreeString(automation_id);
-        }
-        found_buttons.push_back(button);
     }
-    // assign keynums
-    buttons.clear();
-    for (auto& button : found_buttons)
+
+    std::unique_lock lock(state->mutex);
+    state->walking = false;
+    if (!walked)
     {
-        if (buttons.empty())
-        {
-            button.keynum = 1;
-            buttons.push_back(std::move(button));
-        }
-        else
-        {
-            if (button.x < buttons.back().x || button.y < buttons.back().y) // skip 2nd row
-                break;
-            if (button.name == buttons.back().name)
-                continue; // skip buttons from the same app
-            button.keynum = buttons.back().keynum + 1;
-            buttons.push_back(std::move(button));
-            if (buttons.back().keynum == 10)
-                break; // no more than 10 buttons
-        }
+        state->stale = true;
+        return false;
     }
+    state->tracked_buttons = std::move(found_buttons);
+    assign_keynums(state->tracked_buttons, state->buttons);
+    buttons = state->buttons;
     return true;
 }
 
@@ -113,4 +348,16 @@ std::vector<TasklistButton> Tasklist::get_buttons()
     std::vector<TasklistButton> buttons;
     update_buttons(buttons);
     return buttons;
-}
\ No newline at end of file
+}
+
+std::vector<TasklistButton> Tasklist::get_cached_buttons()
+{
+    std::unique_lock lock(state->mutex);
+    return state->buttons;
+}
+
+void Tasklist::set_changed_callback(std::function<void()> callback)
+{
+    std::unique_lock lock(state->mutex);
+    state->changed_callback = std::move(callback);
+}
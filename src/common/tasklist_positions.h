@@ -2,6 +2,8 @@
 #include <vector>
 #include <unordered_set>
 #include <string>
+#include <functional>
+#include <memory>
 #include <Windows.h>
 #include <UIAutomationClient.h>
 
@@ -11,15 +13,44 @@ struct TasklistButton
     long x, y, width, height, keynum;
 };
 
+// Tracks the taskbar buttons through UI Automation events. The button tree is only walked again
+// after buttons were added, removed or reordered; moved buttons are updated from the events alone.
+// Events are only delivered to handlers registered from a multithreaded apartment, so update()
+// should be called from one.
 class Tasklist
 {
 public:
+    Tasklist();
+    ~Tasklist();
+
+    // Finds the taskbar and starts tracking it. Does nothing while the taskbar found last time
+    // still exists, e.g. until Explorer restarts.
     void update();
+    // Stops tracking, call it from the thread that called update()
+    void stop_tracking();
+    // Stops tracking and releases the UI Automation objects. They belong to the apartment of the
+    // thread that called update(), so call it from that thread before it uninitializes COM.
+    void release();
     std::vector<TasklistButton> get_buttons();
+    // Returns the tracked buttons, walking the taskbar only if its buttons changed since the last walk
     bool update_buttons(std::vector<TasklistButton>& buttons);
+    // Buttons of the last walk with the changes seen since, without touching the taskbar
+    std::vector<TasklistButton> get_cached_buttons();
+    // Called on a UI Automation thread whenever the buttons changed
+    void set_changed_callback(std::function<void()> callback);
 
 private:
+    struct State;
+    class EventHandler;
+
     winrt::com_ptr<IUIAutomation> automation;
     winrt::com_ptr<IUIAutomationElement> element;
     winrt::com_ptr<IUIAutomationCondition> true_condition;
+    // Fetches the properties of all the buttons in the same call that finds them
+    winrt::com_ptr<IUIAutomationCacheRequest> cache_request;
+    winrt::com_ptr<IUIAutomationStructureChangedEventHandler> structure_handler;
+    winrt::com_ptr<IUIAutomationPropertyChangedEventHandler> property_handler;
+    HWND tasklist_hwnd = nullptr;
+    // Shared with the event handler, which can outlive the tasklist on a UI Automation thread
+    std::shared_ptr<State> state;
 };
@@ -19,9 +19,9 @@ TwoWayPipeMessageIPC::~TwoWayPipeMessageIPC()
     delete impl;
 }
 
-void TwoWayPipeMessageIPC::send(std::wstring msg)
+void TwoWayPipeMessageIPC::send(std::wstring msg, std::wstring coalescing_key)
 {
-    impl->send(msg);
+    impl->send(std::move(msg), std::move(coalescing_key));
 }
 
 void TwoWayPipeMessageIPC::start(HANDLE _restricted_pipe_token)
@@ -45,9 +45,9 @@ TwoWayPipeMessageIPC::TwoWayPipeMessageIPCImpl::TwoWayPipeMessageIPCImpl(
     dispatch_inc_message_function = p_func;
 }
 
-void TwoWayPipeMessageIPC::TwoWayPipeMessageIPCImpl::send(std::wstring msg)
+void TwoWayPipeMessageIPC::TwoWayPipeMessageIPCImpl::send(std::wstring msg, std::wstring coalescing_key)
 {
-    output_queue.queue_message(msg);
+    output_queue.queue_message(std::move(msg), std::move(coalescing_key));
 }
 
 void TwoWayPipeMessageIPC::TwoWayPipeMessageIPCImpl::start(HANDLE _restricted_pipe_token)
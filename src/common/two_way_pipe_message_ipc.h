@@ -8,7 +8,9 @@ public:
         std::wstring _output_pipe_name, 
         callback_function p_func);
     ~TwoWayPipeMessageIPC();
-    void send(std::wstring msg);
+    // Queues the message, a message sent with a coalescing key replaces the message with the same
+    // key that wasn't sent yet.
+    void send(std::wstring msg, std::wstring coalescing_key = L"");
     void start(HANDLE _restricted_pipe_token);
     void end();
 
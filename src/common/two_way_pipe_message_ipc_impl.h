@@ -1,6 +1,7 @@
 #pragma once
 #include <Windows.h>
 #include "async_message_queue.h"
+#include "coalescing_message_queue.h"
 #include <WinSafer.h>
 #include <accctrl.h>
 #include <aclapi.h>
@@ -10,14 +11,14 @@
 class TwoWayPipeMessageIPC::TwoWayPipeMessageIPCImpl
 {
 public:
-    void send(std::wstring msg);
+    void send(std::wstring msg, std::wstring coalescing_key);
     TwoWayPipeMessageIPCImpl(std::wstring _input_pipe_name, std::wstring _output_pipe_name, callback_function p_func);
     void start(HANDLE _restricted_pipe_token);
     void end();
 
 private:
     AsyncMessageQueue input_queue;
-    AsyncMessageQueue output_queue;
+    CoalescingMessageQueue output_queue;
     std::wstring output_pipe_name;
     std::wstring input_pipe_name;
     std::thread input_queue_thread;
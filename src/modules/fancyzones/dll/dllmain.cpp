@@ -1,6 +1,7 @@
 #include "pch.h"
 #include <common/settings_objects.h>
 #include <common/common.h>
+#include <common/span_tracing.h>
 #include <interface/powertoy_module_interface.h>
 #include <interface/lowlevel_keyboard_event_data.h>
 #include <interface/win_hook_event_data.h>
@@ -138,6 +139,7 @@ public:
     virtual void destroy() override
     {
         Disable(false);
+        PERF_SPAN_WRITE_TRACE(L"FancyZones");
         delete this;
     }
 
@@ -10,6 +10,8 @@
 #include "lib/JsonHelpers.h"
 #include "lib/ZoneSet.h"
 #include "lib/WindowMoveHandler.h"
+#include "lib/WindowMoveBatch.h"
+#include "lib/MoveSizeCoalescer.h"
 #include "lib/FancyZonesWinHookEventIDs.h"
 #include "lib/util.h"
 #include "trace.h"
@@ -50,7 +52,10 @@ public:
         std::unique_lock writeLock(m_lock);
         m_windowMoveHandler.OnMouseDown();
 
-        PostMessageW(m_window, WM_PRIV_LOCATIONCHANGE, NULL, NULL);
+        if (m_locationChanges.Receive())
+        {
+            PostMessageW(m_window, WM_PRIV_LOCATIONCHANGE, NULL, NULL);
+        }
     }
 
     void MoveSizeStart(HWND window, HMONITOR monitor, POINT const& ptScreen) noexcept
@@ -86,7 +91,11 @@ public:
             PostMessageW(m_window, WM_PRIV_MOVESIZEEND, wparam, lparam);
             break;
         case EVENT_OBJECT_LOCATIONCHANGE:
-            PostMessageW(m_window, WM_PRIV_LOCATIONCHANGE, wparam, lparam);
+            // Only one update is queued at a time, it handles the events which arrive meanwhile.
+            if (m_locationChanges.Receive())
+            {
+                PostMessageW(m_window, WM_PRIV_LOCATIONCHANGE, wparam, lparam);
+            }
             break;
         case EVENT_OBJECT_NAMECHANGE:
             PostMessageW(m_window, WM_PRIV_NAMECHANGE, wparam, lparam);
@@ -173,6 +182,7 @@ public:
 
     LRESULT WndProc(HWND, UINT, WPARAM, LPARAM) noexcept;
     void OnDisplayChange(DisplayChangeType changeType) noexcept;
+    void OnLocationChange() noexcept;
     void AddZoneWindow(HMONITOR monitor, PCWSTR deviceId) noexcept;
 
 protected:
@@ -235,6 +245,8 @@ private:
     OnThreadExecutor m_dpiUnawareThread;
     OnThreadExecutor m_virtualDesktopTrackerThread;
 
+    MoveSizeCoalescer m_locationChanges;
+
     static UINT WM_PRIV_VD_INIT; // Scheduled when FancyZones is initialized
     static UINT WM_PRIV_VD_SWITCH; // Scheduled when virtual desktop switch occurs
     static UINT WM_PRIV_VD_UPDATE; // Scheduled on virtual desktops update (creation/deletion)
@@ -609,6 +621,7 @@ LRESULT FancyZones::WndProc(HWND window, UINT message, WPARAM wparam, LPARAM lpa
             auto hwnd = reinterpret_cast<HWND>(wparam);
             if (auto monitor = MonitorFromPoint(ptScreen, MONITOR_DEFAULTTONULL))
             {
+                m_locationChanges.StartDrag(MoveSizeCoalescer::clock::now());
                 MoveSizeStart(hwnd, monitor, ptScreen);
             }
         }
@@ -616,13 +629,13 @@ LRESULT FancyZones::WndProc(HWND window, UINT message, WPARAM wparam, LPARAM lpa
         {
             auto hwnd = reinterpret_cast<HWND>(wparam);
             MoveSizeEnd(hwnd, ptScreen);
+
+            const auto stats = m_locationChanges.GetDragStats(MoveSizeCoalescer::clock::now());
+            Trace::FancyZones::MoveSizeUpdates(stats.receivedCount, stats.processedCount, std::chrono::duration_cast<std::chrono::milliseconds>(stats.duration));
         }
-        else if (message == WM_PRIV_LOCATIONCHANGE && InMoveSize())
+        else if (message == WM_PRIV_LOCATIONCHANGE)
         {
-            if (auto monitor = MonitorFromPoint(ptScreen, MONITOR_DEFAULTTONULL))
-            {
-                MoveSizeUpdate(monitor, ptScreen);
-            }
+            OnLocationChange();
         }
         else if (message == WM_PRIV_WINDOWCREATED)
         {
@@ -639,6 +652,20 @@ LRESULT FancyZones::WndProc(HWND window, UINT message, WPARAM wparam, LPARAM lpa
     return 0;
 }
 
+void FancyZones::OnLocationChange() noexcept
+{
+    m_locationChanges.Processed();
+    if (InMoveSize())
+    {
+        POINT ptScreen;
+        GetPhysicalCursorPos(&ptScreen);
+        if (auto monitor = MonitorFromPoint(ptScreen, MONITOR_DEFAULTTONULL))
+        {
+            MoveSizeUpdate(monitor, ptScreen);
+        }
+    }
+}
+
 void FancyZones::OnDisplayChange(DisplayChangeType changeType) noexcept
 {
     if (changeType == DisplayChangeType::VirtualDesktop ||
@@ -761,12 +788,28 @@ void FancyZones::UpdateZoneWindows() noexcept
 
 void FancyZones::UpdateWindowsPositions() noexcept
 {
+    const auto collectStart = std::chrono::steady_clock::now();
+
+    // Gather stamped windows first, so the lock isn't held while enumerating every top-level window.
+    std::vector<std::pair<HWND, size_t>> stampedWindows;
     auto callback = [](HWND window, LPARAM data) -> BOOL {
         size_t bitmask = reinterpret_cast<size_t>(::GetProp(window, MULTI_ZONE_STAMP));
-
         if (bitmask != 0)
         {
-            std::vector<int> indexSet;
+            reinterpret_cast<std::vector<std::pair<HWND, size_t>>*>(data)->emplace_back(window, bitmask);
+        }
+        return TRUE;
+    };
+    EnumWindows(callback, reinterpret_cast<LPARAM>(&stampedWindows));
+
+    std::vector<WindowMoveBatch::MoveRequest> requests;
+    requests.reserve(stampedWindows.size());
+    {
+        std::unique_lock writeLock(m_lock);
+        std::vector<int> indexSet;
+        for (const auto& [window, bitmask] : stampedWindows)
+        {
+            indexSet.clear();
             for (int i = 0; i < std::numeric_limits<size_t>::digits; i++)
             {
                 if ((1ull << i) & bitmask)
@@ -775,17 +818,22 @@ void FancyZones::UpdateWindowsPositions() noexcept
                 }
             }
 
-            auto strongThis = reinterpret_cast<FancyZones*>(data);
-            std::unique_lock writeLock(strongThis->m_lock);
-            auto zoneWindow = strongThis->m_workAreaHandler.GetWorkArea(window);
-            if (zoneWindow)
+            auto zoneWindow = m_workAreaHandler.GetWorkArea(window);
+            RECT rect;
+            if (zoneWindow && m_windowMoveHandler.AssignWindowToZoneIndexSet(window, indexSet, zoneWindow, rect))
             {
-                strongThis->m_windowMoveHandler.MoveWindowIntoZoneByIndexSet(window, indexSet, zoneWindow);
+                requests.push_back(WindowMoveBatch::MoveRequest{ window, zoneWindow->Monitor(), rect });
             }
         }
-        return TRUE;
-    };
-    EnumWindows(callback, reinterpret_cast<LPARAM>(this));
+    }
+
+    const auto batches = WindowMoveBatch::GroupByMonitor(requests);
+    const auto collectTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - collectStart);
+
+    auto backend = WindowMoveBatch::MakeWin32Backend();
+    auto stats = WindowMoveBatch::Apply(batches, *backend);
+    stats.collectTime = collectTime;
+    Trace::FancyZones::WindowsRepositioned(stats);
 }
 
 void FancyZones::CycleActiveZoneSet(DWORD vkCode) noexcept
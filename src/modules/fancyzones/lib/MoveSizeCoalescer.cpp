@@ -0,0 +1,32 @@
+#include "pch.h"
+
+#include "MoveSizeCoalescer.h"
+
+bool MoveSizeCoalescer::Receive() noexcept
+{
+    m_receivedCount++;
+    return !m_pending.exchange(true);
+}
+
+void MoveSizeCoalescer::Processed() noexcept
+{
+    m_processedCount++;
+    // Cleared before the update reads the cursor, so a move during the update queues another one.
+    m_pending = false;
+}
+
+void MoveSizeCoalescer::StartDrag(clock::time_point now) noexcept
+{
+    m_dragStart = now;
+    m_dragReceivedCount = m_receivedCount;
+    m_dragProcessedCount = m_processedCount;
+}
+
+MoveSizeCoalescer::Stats MoveSizeCoalescer::GetDragStats(clock::time_point now) const noexcept
+{
+    Stats stats;
+    stats.receivedCount = m_receivedCount - m_dragReceivedCount;
+    stats.processedCount = m_processedCount - m_dragProcessedCount;
+    stats.duration = now - m_dragStart;
+    return stats;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+/**
+ * Coalesces the location change events of a dragged window. High rate mice report a thousand
+ * moves per second or more, but the zones only need the latest cursor position. At most one update
+ * is queued at a time. It runs as soon as the window dequeues it and reads the cursor then, so the
+ * events arriving meanwhile cost nothing and the latest position is the one processed. The updates
+ * follow the cursor as fast as the window thread runs them, no timer holds them back: WM_TIMER has
+ * a resolution of 10 to 16 ms, below the refresh rate of most displays.
+ *
+ * Receive() can be called from any thread, the other methods from the thread running the updates.
+ */
+class MoveSizeCoalescer
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    struct Stats
+    {
+        size_t receivedCount{}; // Location change events received.
+        size_t processedCount{}; // Updates run, one per batch of events.
+        clock::duration duration{}; // Time since the drag started.
+    };
+
+    MoveSizeCoalescer() = default;
+
+    /**
+     * Count a location change event.
+     * @returns Boolean indicating whether an update must be queued, false if one is queued already.
+     */
+    bool Receive() noexcept;
+
+    /**
+     * Mark the queued update as run, before it reads the cursor. Events received from now on queue
+     * a new update.
+     */
+    void Processed() noexcept;
+
+    /**
+     * Start counting the events and updates of a new drag.
+     */
+    void StartDrag(clock::time_point now) noexcept;
+
+    /**
+     * @returns The events and updates counted since the drag started.
+     */
+    Stats GetDragStats(clock::time_point now) const noexcept;
+
+private:
+    std::atomic<bool> m_pending = false;
+    std::atomic<size_t> m_receivedCount = 0;
+    size_t m_processedCount = 0;
+
+    clock::time_point m_dragStart{};
+    size_t m_dragReceivedCount = 0;
+    size_t m_dragProcessedCount = 0;
+};
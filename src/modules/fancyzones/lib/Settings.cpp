@@ -1,9 +1,49 @@
 #include "pch.h"
 #include <common/settings_objects.h>
+#include <common/settings_schema.h>
 #include "lib/Settings.h"
 #include "lib/FancyZones.h"
 #include "trace.h"
 
+namespace
+{
+    constexpr std::wstring_view ShiftDragName = L"fancyzones_shiftDrag";
+    constexpr std::wstring_view MouseSwitchName = L"fancyzones_mouseSwitch";
+    constexpr std::wstring_view OverrideSnapHotkeysName = L"fancyzones_overrideSnapHotkeys";
+    constexpr std::wstring_view MoveWindowAcrossMonitorsName = L"fancyzones_moveWindowAcrossMonitors";
+    constexpr std::wstring_view DisplayChangeMoveWindowsName = L"fancyzones_displayChange_moveWindows";
+    constexpr std::wstring_view ZoneSetChangeMoveWindowsName = L"fancyzones_zoneSetChange_moveWindows";
+    constexpr std::wstring_view AppLastZoneMoveWindowsName = L"fancyzones_appLastZone_moveWindows";
+    constexpr std::wstring_view UseCursorposEditorStartupscreenName = L"use_cursorpos_editor_startupscreen";
+    constexpr std::wstring_view ShowOnAllMonitorsName = L"fancyzones_show_on_all_monitors";
+    constexpr std::wstring_view MakeDraggedWindowTransparentName = L"fancyzones_makeDraggedWindowTransparent";
+    constexpr std::wstring_view ZoneColorName = L"fancyzones_zoneColor";
+    constexpr std::wstring_view ZoneBorderColorName = L"fancyzones_zoneBorderColor";
+    constexpr std::wstring_view ZoneHighlightName = L"fancyzones_zoneHighlightColor";
+    constexpr std::wstring_view EditorHotkeyName = L"fancyzones_editor_hotkey";
+    constexpr std::wstring_view ExcludedAppsName = L"fancyzones_excluded_apps";
+    constexpr std::wstring_view ZoneHighlightOpacityName = L"fancyzones_highlight_opacity";
+
+    // "Turning FLASHING_ZONE option off", fancyzones_zoneSetChange_flashZones isn't read or written
+    constexpr auto settingsSchema = PowerToysSettings::make_schema(
+        PowerToysSettings::field(ShiftDragName, &Settings::shiftDrag),
+        PowerToysSettings::field(MouseSwitchName, &Settings::mouseSwitch),
+        PowerToysSettings::field(OverrideSnapHotkeysName, &Settings::overrideSnapHotkeys),
+        PowerToysSettings::field(MoveWindowAcrossMonitorsName, &Settings::moveWindowAcrossMonitors),
+        PowerToysSettings::field(DisplayChangeMoveWindowsName, &Settings::displayChange_moveWindows),
+        PowerToysSettings::field(ZoneSetChangeMoveWindowsName, &Settings::zoneSetChange_moveWindows),
+        PowerToysSettings::field(AppLastZoneMoveWindowsName, &Settings::appLastZone_moveWindows),
+        PowerToysSettings::field(UseCursorposEditorStartupscreenName, &Settings::use_cursorpos_editor_startupscreen),
+        PowerToysSettings::field(ShowOnAllMonitorsName, &Settings::showZonesOnAllMonitors),
+        PowerToysSettings::field(MakeDraggedWindowTransparentName, &Settings::makeDraggedWindowTransparent),
+        PowerToysSettings::field(ZoneColorName, &Settings::zoneColor),
+        PowerToysSettings::field(ZoneBorderColorName, &Settings::zoneBorderColor),
+        PowerToysSettings::field(ZoneHighlightName, &Settings::zoneHighlightColor),
+        PowerToysSettings::field(ZoneHighlightOpacityName, &Settings::zoneHighlightOpacity),
+        PowerToysSettings::field(EditorHotkeyName, &Settings::editorHotkey),
+        PowerToysSettings::field(ExcludedAppsName, &Settings::excludedApps));
+}
+
 struct FancyZonesSettings : winrt::implements<FancyZonesSettings, IFancyZonesSettings>
 {
 public:
@@ -24,6 +64,7 @@ public:
 private:
     void LoadSettings(PCWSTR config, bool fromFile) noexcept;
     void SaveSettings() noexcept;
+    void UpdateExcludedAppsArray();
 
     IFancyZonesCallback* m_callback{};
     const HINSTANCE m_hinstance;
@@ -33,30 +74,23 @@ private:
 
     struct
     {
-        PCWSTR name;
+        std::wstring_view name;
         bool* value;
         int resourceId;
     } m_configBools[10 /* 11 */] = { // "Turning FLASHING_ZONE option off"
-        { L"fancyzones_shiftDrag", &m_settings.shiftDrag, IDS_SETTING_DESCRIPTION_SHIFTDRAG },
-        { L"fancyzones_mouseSwitch", &m_settings.mouseSwitch, IDS_SETTING_DESCRIPTION_MOUSESWITCH },
-        { L"fancyzones_overrideSnapHotkeys", &m_settings.overrideSnapHotkeys, IDS_SETTING_DESCRIPTION_OVERRIDE_SNAP_HOTKEYS },
-        { L"fancyzones_moveWindowAcrossMonitors", &m_settings.moveWindowAcrossMonitors, IDS_SETTING_DESCRIPTION_MOVE_WINDOW_ACROSS_MONITORS },
+        { ShiftDragName, &m_settings.shiftDrag, IDS_SETTING_DESCRIPTION_SHIFTDRAG },
+        { MouseSwitchName, &m_settings.mouseSwitch, IDS_SETTING_DESCRIPTION_MOUSESWITCH },
+        { OverrideSnapHotkeysName, &m_settings.overrideSnapHotkeys, IDS_SETTING_DESCRIPTION_OVERRIDE_SNAP_HOTKEYS },
+        { MoveWindowAcrossMonitorsName, &m_settings.moveWindowAcrossMonitors, IDS_SETTING_DESCRIPTION_MOVE_WINDOW_ACROSS_MONITORS },
         // "Turning FLASHING_ZONE option off"
         //{ L"fancyzones_zoneSetChange_flashZones", &m_settings.zoneSetChange_flashZones, IDS_SETTING_DESCRIPTION_ZONESETCHANGE_FLASHZONES },
-        { L"fancyzones_displayChange_moveWindows", &m_settings.displayChange_moveWindows, IDS_SETTING_DESCRIPTION_DISPLAYCHANGE_MOVEWINDOWS },
-        { L"fancyzones_zoneSetChange_moveWindows", &m_settings.zoneSetChange_moveWindows, IDS_SETTING_DESCRIPTION_ZONESETCHANGE_MOVEWINDOWS },
-        { L"fancyzones_appLastZone_moveWindows", &m_settings.appLastZone_moveWindows, IDS_SETTING_DESCRIPTION_APPLASTZONE_MOVEWINDOWS },
-        { L"use_cursorpos_editor_startupscreen", &m_settings.use_cursorpos_editor_startupscreen, IDS_SETTING_DESCRIPTION_USE_CURSORPOS_EDITOR_STARTUPSCREEN },
-        { L"fancyzones_show_on_all_monitors", &m_settings.showZonesOnAllMonitors, IDS_SETTING_DESCRIPTION_SHOW_FANCY_ZONES_ON_ALL_MONITORS},
-        { L"fancyzones_makeDraggedWindowTransparent", &m_settings.makeDraggedWindowTransparent, IDS_SETTING_DESCRIPTION_MAKE_DRAGGED_WINDOW_TRANSPARENT},
+        { DisplayChangeMoveWindowsName, &m_settings.displayChange_moveWindows, IDS_SETTING_DESCRIPTION_DISPLAYCHANGE_MOVEWINDOWS },
+        { ZoneSetChangeMoveWindowsName, &m_settings.zoneSetChange_moveWindows, IDS_SETTING_DESCRIPTION_ZONESETCHANGE_MOVEWINDOWS },
+        { AppLastZoneMoveWindowsName, &m_settings.appLastZone_moveWindows, IDS_SETTING_DESCRIPTION_APPLASTZONE_MOVEWINDOWS },
+        { UseCursorposEditorStartupscreenName, &m_settings.use_cursorpos_editor_startupscreen, IDS_SETTING_DESCRIPTION_USE_CURSORPOS_EDITOR_STARTUPSCREEN },
+        { ShowOnAllMonitorsName, &m_settings.showZonesOnAllMonitors, IDS_SETTING_DESCRIPTION_SHOW_FANCY_ZONES_ON_ALL_MONITORS},
+        { MakeDraggedWindowTransparentName, &m_settings.makeDraggedWindowTransparent, IDS_SETTING_DESCRIPTION_MAKE_DRAGGED_WINDOW_TRANSPARENT},
     };
-
-    const std::wstring m_zoneColorName = L"fancyzones_zoneColor";
-    const std::wstring m_zoneBorderColorName = L"fancyzones_zoneBorderColor";
-    const std::wstring m_zoneHighlightName = L"fancyzones_zoneHighlightColor";
-    const std::wstring m_editorHotkeyName = L"fancyzones_editor_hotkey";
-    const std::wstring m_excludedAppsName = L"fancyzones_excluded_apps";
-    const std::wstring m_zoneHighlightOpacity = L"fancyzones_highlight_opacity";
 };
 
 IFACEMETHODIMP_(bool) FancyZonesSettings::GetConfig(_Out_ PWSTR buffer, _Out_ int *buffer_size) noexcept
@@ -77,20 +111,20 @@ IFACEMETHODIMP_(bool) FancyZonesSettings::GetConfig(_Out_ PWSTR buffer, _Out_ in
         IDS_SETTING_LAUNCH_EDITOR_BUTTON,
         IDS_SETTING_LAUNCH_EDITOR_DESCRIPTION
     );
-    settings.add_hotkey(m_editorHotkeyName, IDS_SETTING_LAUNCH_EDITOR_HOTKEY_LABEL, m_settings.editorHotkey);
+    settings.add_hotkey(EditorHotkeyName, IDS_SETTING_LAUNCH_EDITOR_HOTKEY_LABEL, m_settings.editorHotkey);
 
     for (auto const& setting : m_configBools)
     {
         settings.add_bool_toggle(setting.name, setting.resourceId, *setting.value);
     }
 
-    settings.add_color_picker(m_zoneHighlightName, IDS_SETTING_DESCRIPTION_ZONEHIGHLIGHTCOLOR, m_settings.zoneHighlightColor);
-    settings.add_color_picker(m_zoneColorName, IDS_SETTING_DESCRIPTION_ZONECOLOR, m_settings.zoneColor);
-    settings.add_color_picker(m_zoneBorderColorName, IDS_SETTING_DESCRIPTION_ZONE_BORDER_COLOR, m_settings.zoneBorderColor);
+    settings.add_color_picker(ZoneHighlightName, IDS_SETTING_DESCRIPTION_ZONEHIGHLIGHTCOLOR, m_settings.zoneHighlightColor);
+    settings.add_color_picker(ZoneColorName, IDS_SETTING_DESCRIPTION_ZONECOLOR, m_settings.zoneColor);
+    settings.add_color_picker(ZoneBorderColorName, IDS_SETTING_DESCRIPTION_ZONE_BORDER_COLOR, m_settings.zoneBorderColor);
     
-    settings.add_int_spinner(m_zoneHighlightOpacity, IDS_SETTINGS_HIGHLIGHT_OPACITY, m_settings.zoneHighlightOpacity, 0, 100, 1);
+    settings.add_int_spinner(ZoneHighlightOpacityName, IDS_SETTINGS_HIGHLIGHT_OPACITY, m_settings.zoneHighlightOpacity, 0, 100, 1);
     
-    settings.add_multiline_string(m_excludedAppsName, IDS_SETTING_EXCLUDED_APPS_DESCRIPTION, m_settings.excludedApps);
+    settings.add_multiline_string(ExcludedAppsName, IDS_SETTING_EXCLUDED_APPS_DESCRIPTION, m_settings.excludedApps);
 
     return settings.serialize_to_buffer(buffer, buffer_size);
 }
@@ -122,87 +156,45 @@ CATCH_LOG();
 
 void FancyZonesSettings::LoadSettings(PCWSTR config, bool fromFile) noexcept try
 {
-    PowerToysSettings::PowerToyValues values = fromFile ?
-        PowerToysSettings::PowerToyValues::load_from_settings_file(m_moduleName) :
-        PowerToysSettings::PowerToyValues::from_json_string(config);
-
-    for (auto const& setting : m_configBools)
-    {
-        if (const auto val = values.get_bool_value(setting.name))
-        {
-            *setting.value = *val;
-        }
-    }
-
-    if (auto val = values.get_string_value(m_zoneColorName))
+    if (fromFile)
     {
-        m_settings.zoneColor = std::move(*val);
+        m_settings = settingsSchema.load(m_moduleName);
     }
-
-    if (auto val = values.get_string_value(m_zoneBorderColorName))
+    else
     {
-        m_settings.zoneBorderColor = std::move(*val);
+        settingsSchema.parse(json::JsonObject::Parse(config), m_settings);
     }
+    UpdateExcludedAppsArray();
+}
+CATCH_LOG();
 
-    if (auto val = values.get_string_value(m_zoneHighlightName))
-    {
-        m_settings.zoneHighlightColor = std::move(*val);
-    }
+void FancyZonesSettings::SaveSettings() noexcept try
+{
+    settingsSchema.save(m_moduleName, m_settings);
+}
+CATCH_LOG();
 
-    if (const auto val = values.get_json(m_editorHotkeyName))
+void FancyZonesSettings::UpdateExcludedAppsArray()
+{
+    m_settings.excludedAppsArray.clear();
+    auto excludedUppercase = m_settings.excludedApps;
+    CharUpperBuffW(excludedUppercase.data(), (DWORD)excludedUppercase.length());
+    std::wstring_view view(excludedUppercase);
+    while (view.starts_with('\n') || view.starts_with('\r'))
     {
-        m_settings.editorHotkey = PowerToysSettings::HotkeyObject::from_json(*val);
+        view.remove_prefix(1);
     }
-
-    if (auto val = values.get_string_value(m_excludedAppsName))
+    while (!view.empty())
     {
-        m_settings.excludedApps = std::move(*val);
-        m_settings.excludedAppsArray.clear();
-        auto excludedUppercase = m_settings.excludedApps;
-        CharUpperBuffW(excludedUppercase.data(), (DWORD)excludedUppercase.length());
-        std::wstring_view view(excludedUppercase);
+        auto pos = (std::min)(view.find_first_of(L"\r\n"), view.length());
+        m_settings.excludedAppsArray.emplace_back(view.substr(0, pos));
+        view.remove_prefix(pos);
         while (view.starts_with('\n') || view.starts_with('\r'))
         {
             view.remove_prefix(1);
         }
-        while (!view.empty())
-        {
-            auto pos = (std::min)(view.find_first_of(L"\r\n"), view.length());
-            m_settings.excludedAppsArray.emplace_back(view.substr(0, pos));
-            view.remove_prefix(pos);
-            while (view.starts_with('\n') || view.starts_with('\r'))
-            {
-                view.remove_prefix(1);
-            }
-        }
-    }
-
-    if (auto val = values.get_int_value(m_zoneHighlightOpacity))
-    {
-        m_settings.zoneHighlightOpacity = *val;
     }
 }
-CATCH_LOG();
-
-void FancyZonesSettings::SaveSettings() noexcept try
-{
-    PowerToysSettings::PowerToyValues values(m_moduleName);
-
-    for (auto const& setting : m_configBools)
-    {
-        values.add_property(setting.name, *setting.value);
-    }
-
-    values.add_property(m_zoneColorName, m_settings.zoneColor);
-    values.add_property(m_zoneBorderColorName, m_settings.zoneBorderColor);
-    values.add_property(m_zoneHighlightName, m_settings.zoneHighlightColor);
-    values.add_property(m_zoneHighlightOpacity, m_settings.zoneHighlightOpacity);
-    values.add_property(m_editorHotkeyName, m_settings.editorHotkey.get_json());
-    values.add_property(m_excludedAppsName, m_settings.excludedApps);
-
-    values.save_to_settings_file();
-}
-CATCH_LOG();
 
 winrt::com_ptr<IFancyZonesSettings> MakeFancyZonesSettings(HINSTANCE hinstance, PCWSTR name) noexcept
 {
@@ -0,0 +1,200 @@
+#include "pch.h"
+
+#include "WindowMoveBatch.h"
+#include "util.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace WindowMoveBatch
+{
+    namespace
+    {
+        class Win32Backend : public IWindowPositionBackend
+        {
+        public:
+            ~Win32Backend()
+            {
+                if (m_hdwp)
+                {
+                    // Abandoned batch, nothing was applied.
+                    EndDeferWindowPos(m_hdwp);
+                }
+            }
+
+            bool CanDefer(HWND window, HMONITOR monitor) override
+            {
+                if (IsIconic(window) || IsZoomed(window))
+                {
+                    return false;
+                }
+
+                // Crossing monitors may change the window DPI, which SizeWindowToRect takes care of.
+                return MonitorFromWindow(window, MONITOR_DEFAULTTONULL) == monitor;
+            }
+
+            bool BeginBatch(int count) override
+            {
+                m_hdwp = BeginDeferWindowPos(count);
+                return m_hdwp != nullptr;
+            }
+
+            bool DeferMove(HWND window, HMONITOR monitor, const RECT& rect) override
+            {
+                if (!m_hdwp)
+                {
+                    return false;
+                }
+
+                // Rectangles are in workspace coordinates, DeferWindowPos expects screen coordinates.
+                RECT screenRect = rect;
+                MONITORINFO mi{ sizeof(mi) };
+                if (GetMonitorInfoW(monitor, &mi))
+                {
+                    OffsetRect(&screenRect, mi.rcWork.left - mi.rcMonitor.left, mi.rcWork.top - mi.rcMonitor.top);
+                }
+
+                // On failure the whole HDWP is freed by the system.
+                m_hdwp = DeferWindowPos(m_hdwp,
+                                        window,
+                                        nullptr,
+                                        screenRect.left,
+                                        screenRect.top,
+                                        screenRect.right - screenRect.left,
+                                        screenRect.bottom - screenRect.top,
+                                        SWP_NOZORDER | SWP_NOACTIVATE | SWP_NOOWNERZORDER);
+                return m_hdwp != nullptr;
+            }
+
+            bool EndBatch() override
+            {
+                if (!m_hdwp)
+                {
+                    return false;
+                }
+
+                const bool result = EndDeferWindowPos(m_hdwp);
+                m_hdwp = nullptr;
+                return result;
+            }
+
+            void MoveSingle(HWND window, const RECT& rect) override
+            {
+                SizeWindowToRect(window, rect);
+            }
+
+        private:
+            HDWP m_hdwp{};
+        };
+    }
+
+    std::vector<MonitorBatch> GroupByMonitor(const std::vector<MoveRequest>& requests) noexcept
+    {
+        std::vector<MonitorBatch> batches;
+        std::unordered_map<HMONITOR, size_t> monitorIndex;
+        std::unordered_map<HWND, std::pair<size_t, size_t>> windowIndex; // batch, position inside batch
+
+        for (const auto& request : requests)
+        {
+            if (auto it = windowIndex.find(request.window); it != windowIndex.end())
+            {
+                auto& [batch, position] = it->second;
+                if (batches[batch].monitor == request.monitor)
+                {
+                    batches[batch].moves[position] = request;
+                    continue;
+                }
+
+                // Window moved to another monitor within the same plan, drop the old request.
+                auto& moves = batches[batch].moves;
+                moves.erase(moves.begin() + position);
+                for (auto& [otherWindow, otherIndex] : windowIndex)
+                {
+                    if (otherIndex.first == batch && otherIndex.second > position)
+                    {
+                        otherIndex.second--;
+                    }
+                }
+                windowIndex.erase(it);
+            }
+
+            auto [it, inserted] = monitorIndex.try_emplace(request.monitor, batches.size());
+            if (inserted)
+            {
+                batches.push_back(MonitorBatch{ request.monitor, {} });
+            }
+
+            auto& batch = batches[it->second];
+            windowIndex[request.window] = { it->second, batch.moves.size() };
+            batch.moves.push_back(request);
+        }
+
+        batches.erase(std::remove_if(batches.begin(), batches.end(), [](const MonitorBatch& batch) {
+                          return batch.moves.empty();
+                      }),
+                      batches.end());
+        return batches;
+    }
+
+    Stats Apply(const std::vector<MonitorBatch>& batches, IWindowPositionBackend& backend) noexcept
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        Stats stats{};
+        stats.monitorCount = batches.size();
+
+        for (const auto& batch : batches)
+        {
+            stats.windowCount += batch.moves.size();
+
+            std::vector<const MoveRequest*> deferred;
+            deferred.reserve(batch.moves.size());
+            for (const auto& move : batch.moves)
+            {
+                if (backend.CanDefer(move.window, batch.monitor))
+                {
+                    deferred.push_back(&move);
+                }
+                else
+                {
+                    backend.MoveSingle(move.window, move.rect);
+                    stats.singleCount++;
+                }
+            }
+
+            if (deferred.empty())
+            {
+                continue;
+            }
+
+            bool succeeded = backend.BeginBatch(static_cast<int>(deferred.size()));
+            for (size_t i = 0; succeeded && i < deferred.size(); i++)
+            {
+                succeeded = backend.DeferMove(deferred[i]->window, batch.monitor, deferred[i]->rect);
+            }
+            succeeded = succeeded && backend.EndBatch();
+
+            if (succeeded)
+            {
+                stats.deferredCount += deferred.size();
+            }
+            else
+            {
+                stats.failedBatchCount++;
+                for (const auto* move : deferred)
+                {
+                    backend.MoveSingle(move->window, move->rect);
+                    stats.singleCount++;
+                }
+            }
+        }
+
+        stats.applyTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        return stats;
+    }
+
+    std::unique_ptr<IWindowPositionBackend> MakeWin32Backend() noexcept
+    {
+        return std::make_unique<Win32Backend>();
+    }
+}
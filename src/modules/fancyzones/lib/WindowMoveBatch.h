@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+
+/**
+ * Repositioning of many zoned windows at once (e.g. after switching zone layout). Target
+ * rectangles are collected up front, grouped per monitor and applied through
+ * BeginDeferWindowPos / DeferWindowPos so each monitor is updated in a single pass instead
+ * of rippling window by window.
+ */
+namespace WindowMoveBatch
+{
+    struct MoveRequest
+    {
+        HWND window{};
+        HMONITOR monitor{};
+        RECT rect{}; // Workspace coordinates, same as WINDOWPLACEMENT::rcNormalPosition.
+    };
+
+    struct MonitorBatch
+    {
+        HMONITOR monitor{};
+        std::vector<MoveRequest> moves;
+    };
+
+    struct Stats
+    {
+        size_t windowCount{};
+        size_t monitorCount{};
+        size_t deferredCount{}; // Windows moved as part of a DeferWindowPos batch.
+        size_t singleCount{}; // Windows moved one by one (minimized, maximized or failed batches).
+        size_t failedBatchCount{};
+        std::chrono::microseconds collectTime{};
+        std::chrono::microseconds applyTime{};
+    };
+
+    /**
+     * Abstraction over the window manager, so batch planning and application can be tested
+     * without real windows.
+     */
+    class IWindowPositionBackend
+    {
+    public:
+        virtual ~IWindowPositionBackend() = default;
+
+        /**
+         * @returns Boolean indicating whether the window can be moved with DeferWindowPos. Minimized
+         *          and maximized windows need their placement restored and are moved one by one.
+         */
+        virtual bool CanDefer(HWND window, HMONITOR monitor) = 0;
+        virtual bool BeginBatch(int count) = 0;
+        virtual bool DeferMove(HWND window, HMONITOR monitor, const RECT& rect) = 0;
+        virtual bool EndBatch() = 0;
+        virtual void MoveSingle(HWND window, const RECT& rect) = 0;
+    };
+
+    /**
+     * Group move requests per monitor. Monitors keep the order of their first request and windows
+     * keep their order within a monitor. If a window is requested more than once, the last request wins.
+     */
+    std::vector<MonitorBatch> GroupByMonitor(const std::vector<MoveRequest>& requests) noexcept;
+
+    /**
+     * Apply grouped move requests through the backend. A monitor whose batch fails is retried
+     * window by window so no window is left behind.
+     */
+    Stats Apply(const std::vector<MonitorBatch>& batches, IWindowPositionBackend& backend) noexcept;
+
+    std::unique_ptr<IWindowPositionBackend> MakeWin32Backend() noexcept;
+}
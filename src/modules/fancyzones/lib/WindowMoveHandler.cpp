@@ -4,6 +4,7 @@
 #include <common/notifications.h>
 #include <common/notifications/fancyzones_notifications.h>
 #include <common/window_helpers.h>
+#include <common/span_tracing.h>
 
 #include "lib/Settings.h"
 #include "lib/ZoneWindow.h"
@@ -67,6 +68,7 @@ public:
     void MoveSizeEnd(HWND window, POINT const& ptScreen, const std::unordered_map<HMONITOR, winrt::com_ptr<IZoneWindow>>& zoneWindowMap) noexcept;
 
     void MoveWindowIntoZoneByIndexSet(HWND window, const std::vector<int>& indexSet, winrt::com_ptr<IZoneWindow> zoneWindow) noexcept;
+    bool AssignWindowToZoneIndexSet(HWND window, const std::vector<int>& indexSet, winrt::com_ptr<IZoneWindow> zoneWindow, RECT& rect) noexcept;
     bool MoveWindowIntoZoneByDirection(HWND window, DWORD vkCode, bool cycle, winrt::com_ptr<IZoneWindow> zoneWindow);
 
 private:
@@ -126,6 +128,11 @@ void WindowMoveHandler::MoveWindowIntoZoneByIndexSet(HWND window, const std::vec
     pimpl->MoveWindowIntoZoneByIndexSet(window, indexSet, zoneWindow);
 }
 
+bool WindowMoveHandler::AssignWindowToZoneIndexSet(HWND window, const std::vector<int>& indexSet, winrt::com_ptr<IZoneWindow> zoneWindow, RECT& rect) noexcept
+{
+    return pimpl->AssignWindowToZoneIndexSet(window, indexSet, zoneWindow, rect);
+}
+
 bool WindowMoveHandler::MoveWindowIntoZoneByDirection(HWND window, DWORD vkCode, bool cycle, winrt::com_ptr<IZoneWindow> zoneWindow)
 {
     return pimpl->MoveWindowIntoZoneByDirection(window, vkCode, cycle, zoneWindow);
@@ -195,6 +202,7 @@ void WindowMoveHandlerPrivate::MoveSizeStart(HWND window, HMONITOR monitor, POIN
 
 void WindowMoveHandlerPrivate::MoveSizeUpdate(HMONITOR monitor, POINT const& ptScreen, const std::unordered_map<HMONITOR, winrt::com_ptr<IZoneWindow>>& zoneWindowMap) noexcept
 {
+    PERF_SPAN("MoveSizeUpdate");
     if (!m_inMoveSize)
     {
         return;
@@ -314,6 +322,11 @@ void WindowMoveHandlerPrivate::MoveWindowIntoZoneByIndexSet(HWND window, const s
     }
 }
 
+bool WindowMoveHandlerPrivate::AssignWindowToZoneIndexSet(HWND window, const std::vector<int>& indexSet, winrt::com_ptr<IZoneWindow> zoneWindow, RECT& rect) noexcept
+{
+    return window != m_windowMoveSize && zoneWindow && zoneWindow->AssignWindowToZoneIndexSet(window, indexSet, rect);
+}
+
 bool WindowMoveHandlerPrivate::MoveWindowIntoZoneByDirection(HWND window, DWORD vkCode, bool cycle, winrt::com_ptr<IZoneWindow> zoneWindow)
 {
     return zoneWindow && zoneWindow->MoveWindowIntoZoneByDirection(window, vkCode, cycle);
@@ -5,6 +5,7 @@
 #include "Settings.h"
 
 #include <common/dpi_aware.h>
+#include <common/span_tracing.h>
 
 namespace
 {
@@ -133,6 +134,8 @@ public:
     IFACEMETHODIMP_(void)
     MoveWindowIntoZoneByIndexSet(HWND window, HWND windowZone, const std::vector<int>& indexSet) noexcept;
     IFACEMETHODIMP_(bool)
+    AssignWindowToZoneIndexSet(HWND window, HWND windowZone, const std::vector<int>& indexSet, RECT& rect) noexcept;
+    IFACEMETHODIMP_(bool)
     MoveWindowIntoZoneByDirection(HWND window, HWND zoneWindow, DWORD vkCode, bool cycle) noexcept;
     IFACEMETHODIMP_(void)
     MoveWindowIntoZoneByPoint(HWND window, HWND zoneWindow, POINT ptClient) noexcept;
@@ -261,10 +264,20 @@ ZoneSet::MoveWindowIntoZoneByIndex(HWND window, HWND windowZone, int index) noex
 
 IFACEMETHODIMP_(void)
 ZoneSet::MoveWindowIntoZoneByIndexSet(HWND window, HWND windowZone, const std::vector<int>& indexSet) noexcept
+{
+    RECT size;
+    if (AssignWindowToZoneIndexSet(window, windowZone, indexSet, size))
+    {
+        SizeWindowToRect(window, size);
+    }
+}
+
+IFACEMETHODIMP_(bool)
+ZoneSet::AssignWindowToZoneIndexSet(HWND window, HWND windowZone, const std::vector<int>& indexSet, RECT& rect) noexcept
 {
     if (m_zones.empty())
     {
-        return;
+        return false;
     }
 
     RECT size;
@@ -301,11 +314,14 @@ ZoneSet::MoveWindowIntoZoneByIndexSet(HWND window, HWND windowZone, const std::v
         }
     }
 
-    if (!sizeEmpty)
+    if (sizeEmpty)
     {
-        SizeWindowToRect(window, size);
-        StampWindow(window, bitmask);
+        return false;
     }
+
+    StampWindow(window, bitmask);
+    rect = size;
+    return true;
 }
 
 IFACEMETHODIMP_(bool)
@@ -365,6 +381,7 @@ ZoneSet::MoveWindowIntoZoneByPoint(HWND window, HWND zoneWindow, POINT ptClient)
 IFACEMETHODIMP_(bool)
 ZoneSet::CalculateZones(MONITORINFO monitorInfo, int zoneCount, int spacing) noexcept
 {
+    PERF_SPAN("CalculateZones");
     Rect const workArea(monitorInfo.rcWork);
     //invalid work area
     if (workArea.width() == 0 || workArea.height() == 0)
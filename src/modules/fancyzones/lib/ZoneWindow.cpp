@@ -1,6 +1,7 @@
 #include "pch.h"
 
 #include <common/common.h>
+#include <common/animation.h>
 
 #include "ZoneWindow.h"
 #include "trace.h"
@@ -216,6 +217,8 @@ public:
     IFACEMETHODIMP_(void)
     MoveWindowIntoZoneByIndexSet(HWND window, const std::vector<int>& indexSet) noexcept;
     IFACEMETHODIMP_(bool)
+    AssignWindowToZoneIndexSet(HWND window, const std::vector<int>& indexSet, RECT& rect) noexcept;
+    IFACEMETHODIMP_(bool)
     MoveWindowIntoZoneByDirection(HWND window, DWORD vkCode, bool cycle) noexcept;
     IFACEMETHODIMP_(void)
     CycleActiveZoneSet(DWORD vkCode) noexcept;
@@ -227,6 +230,8 @@ public:
     SaveWindowProcessToZoneIndex(HWND window) noexcept;
     IFACEMETHODIMP_(IZoneSet*)
     ActiveZoneSet() noexcept { return m_activeZoneSet.get(); }
+    IFACEMETHODIMP_(HMONITOR)
+    Monitor() noexcept { return m_monitor; }
     IFACEMETHODIMP_(void)
     ShowZoneWindow() noexcept;
     IFACEMETHODIMP_(void)
@@ -247,6 +252,9 @@ private:
     std::vector<int> ZonesFromPoint(POINT pt) noexcept;
     void CycleActiveZoneSetInternal(DWORD wparam, Trace::ZoneWindow::InputMode mode) noexcept;
     void FlashZones() noexcept;
+    void StartShowAnimation() noexcept;
+    void OnShowAnimationTick() noexcept;
+    void CancelShowAnimation() noexcept;
 
     winrt::com_ptr<IZoneWindowHost> m_host;
     HMONITOR m_monitor{};
@@ -263,6 +271,12 @@ private:
     size_t m_keyCycle{};
     static const UINT m_showAnimationDuration = 200; // ms
     static const UINT m_flashDuration = 700; // ms
+    static const UINT_PTR m_showAnimationTimerId = 1;
+    // ms, about one frame at 60 Hz. WM_TIMER isn't synchronized with the display, so the alpha of each tick
+    // comes from the time elapsed since the fade started rather than from the number of ticks.
+    static const UINT m_showAnimationFrameInterval = 16;
+    Animation m_showAnimation{ m_showAnimationDuration / 1000.0 };
+    bool m_showAnimationActive{};
 
     HWND draggedWindow = nullptr;
     long draggedWindowExstyle = 0;
@@ -442,6 +456,12 @@ ZoneWindow::MoveWindowIntoZoneByIndexSet(HWND window, const std::vector<int>& in
     }
 }
 
+IFACEMETHODIMP_(bool)
+ZoneWindow::AssignWindowToZoneIndexSet(HWND window, const std::vector<int>& indexSet, RECT& rect) noexcept
+{
+    return m_activeZoneSet && m_activeZoneSet->AssignWindowToZoneIndexSet(window, m_window.get(), indexSet, rect);
+}
+
 IFACEMETHODIMP_(bool)
 ZoneWindow::MoveWindowIntoZoneByDirection(HWND window, DWORD vkCode, bool cycle) noexcept
 {
@@ -511,14 +531,9 @@ ZoneWindow::ShowZoneWindow() noexcept
 
     SetWindowPos(window, windowInsertAfter, 0, 0, 0, 0, flags);
 
-    std::thread{ [=]() {
-        AnimateWindow(window, m_showAnimationDuration, AW_BLEND);
-        InvalidateRect(window, nullptr, true);
-        if (!m_host->InMoveSize())
-        {
-            HideZoneWindow();
-        }
-    } }.detach();
+    // Fade in from the window's own message loop instead of AnimateWindow, which would block
+    // this thread (and with it all MoveSizeUpdate processing) for the whole animation duration.
+    StartShowAnimation();
 }
 
 IFACEMETHODIMP_(void)
@@ -526,6 +541,7 @@ ZoneWindow::HideZoneWindow() noexcept
 {
     if (m_window)
     {
+        CancelShowAnimation();
         ShowWindow(m_window.get(), SW_HIDE);
         m_keyLast = 0;
         m_windowMoveSize = nullptr;
@@ -623,6 +639,15 @@ LRESULT ZoneWindow::WndProc(UINT message, WPARAM wparam, LPARAM lparam) noexcept
     case WM_ERASEBKGND:
         return 1;
 
+    case WM_TIMER:
+    {
+        if (wparam == m_showAnimationTimerId)
+        {
+            OnShowAnimationTick();
+        }
+    }
+    break;
+
     case WM_PRINTCLIENT:
     case WM_PAINT:
     {
@@ -764,6 +789,67 @@ void ZoneWindow::FlashZones() noexcept
         AnimateWindow(window, m_flashDuration, AW_HIDE | AW_BLEND);
     }).detach();
 }
+
+void ZoneWindow::StartShowAnimation() noexcept
+{
+    auto window = m_window.get();
+
+    // Restart cleanly if a previous fade is still running.
+    CancelShowAnimation();
+
+    SetWindowLong(window, GWL_EXSTYLE, GetWindowLong(window, GWL_EXSTYLE) | WS_EX_LAYERED);
+    SetLayeredWindowAttributes(window, 0, 0, LWA_ALPHA);
+    ShowWindow(window, SW_SHOWNA);
+    InvalidateRect(window, nullptr, true);
+
+    m_showAnimation.reset();
+    m_showAnimationActive = SetTimer(window, m_showAnimationTimerId, m_showAnimationFrameInterval, nullptr) != 0;
+    if (!m_showAnimationActive)
+    {
+        // No timer available, show the zones immediately rather than leaving the window invisible.
+        CancelShowAnimation();
+    }
+}
+
+void ZoneWindow::OnShowAnimationTick() noexcept
+{
+    if (!m_showAnimationActive)
+    {
+        KillTimer(m_window.get(), m_showAnimationTimerId);
+        return;
+    }
+
+    if (m_showAnimation.done())
+    {
+        CancelShowAnimation();
+        if (m_host && !m_host->InMoveSize())
+        {
+            HideZoneWindow();
+        }
+        return;
+    }
+
+    const auto alpha = static_cast<BYTE>(m_showAnimation.value(Animation::AnimFunctions::LINEAR) * 255);
+    SetLayeredWindowAttributes(m_window.get(), 0, alpha, LWA_ALPHA);
+}
+
+void ZoneWindow::CancelShowAnimation() noexcept
+{
+    auto window = m_window.get();
+    if (m_showAnimationActive)
+    {
+        KillTimer(window, m_showAnimationTimerId);
+        m_showAnimationActive = false;
+    }
+
+    // Drop the layered style so the window goes back to DWM blur-behind per-pixel alpha.
+    const auto exStyle = GetWindowLong(window, GWL_EXSTYLE);
+    if (exStyle & WS_EX_LAYERED)
+    {
+        SetWindowLong(window, GWL_EXSTYLE, exStyle & ~WS_EX_LAYERED);
+        InvalidateRect(window, nullptr, true);
+    }
+}
 #pragma endregion
 
 LRESULT CALLBACK ZoneWindow::s_WndProc(HWND window, UINT message, WPARAM wparam, LPARAM lparam) noexcept
@@ -56,6 +56,16 @@ interface __declspec(uuid("{7F017528-8110-4FB3-BE41-F472969C2560}")) IZoneWindow
      * @param   indexSet The set of zone indices within zone layout.
      */
     IFACEMETHOD_(void, MoveWindowIntoZoneByIndexSet)(HWND window, const std::vector<int>& indexSet) = 0;
+    /**
+     * Assign window to the zones based on the set of zone indices inside zone layout, without moving it.
+     *
+     * @param   window   Handle of window which should be assigned to zone.
+     * @param   indexSet The set of zone indices within zone layout.
+     * @param   rect     Receives the window rectangle (in workspace coordinates) matching the zones.
+     *
+     * @returns Boolean indicating whether the window was assigned and rect is valid.
+     */
+    IFACEMETHOD_(bool, AssignWindowToZoneIndexSet)(HWND window, const std::vector<int>& indexSet, RECT& rect) = 0;
     /**
      * Assign window to the zone based on direction (using WIN + LEFT/RIGHT arrow).
      *
@@ -96,6 +106,10 @@ interface __declspec(uuid("{7F017528-8110-4FB3-BE41-F472969C2560}")) IZoneWindow
      * @returns Active zone layout for this work area.
      */
     IFACEMETHOD_(IZoneSet*, ActiveZoneSet)() = 0;
+    /**
+     * @returns Monitor on which this work area is located.
+     */
+    IFACEMETHOD_(HMONITOR, Monitor)() = 0;
     IFACEMETHOD_(void, ShowZoneWindow)() = 0;
     IFACEMETHOD_(void, HideZoneWindow)() = 0;
     /**
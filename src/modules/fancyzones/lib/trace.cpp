@@ -3,6 +3,7 @@
 #include "lib/ZoneSet.h"
 #include "lib/Settings.h"
 #include "lib/JsonHelpers.h"
+#include "lib/WindowMoveBatch.h"
 
 TRACELOGGING_DEFINE_PROVIDER(
     g_hProvider,
@@ -161,6 +162,34 @@ void Trace::FancyZones::EditorLaunched(int value) noexcept
         TraceLoggingInt32(value, "Value"));
 }
 
+void Trace::FancyZones::WindowsRepositioned(const WindowMoveBatch::Stats& stats) noexcept
+{
+    TraceLoggingWrite(
+        g_hProvider,
+        "FancyZones_WindowsRepositioned",
+        ProjectTelemetryPrivacyDataTag(ProjectTelemetryTag_ProductAndServicePerformance),
+        TraceLoggingKeyword(PROJECT_KEYWORD_MEASURE),
+        TraceLoggingValue(static_cast<UINT32>(stats.windowCount), "WindowCount"),
+        TraceLoggingValue(static_cast<UINT32>(stats.monitorCount), "MonitorCount"),
+        TraceLoggingValue(static_cast<UINT32>(stats.deferredCount), "DeferredCount"),
+        TraceLoggingValue(static_cast<UINT32>(stats.singleCount), "SingleCount"),
+        TraceLoggingValue(static_cast<UINT32>(stats.failedBatchCount), "FailedBatchCount"),
+        TraceLoggingValue(static_cast<INT64>(stats.collectTime.count()), "CollectTimeMicroseconds"),
+        TraceLoggingValue(static_cast<INT64>(stats.applyTime.count()), "ApplyTimeMicroseconds"));
+}
+
+void Trace::FancyZones::MoveSizeUpdates(size_t receivedCount, size_t processedCount, std::chrono::milliseconds duration) noexcept
+{
+    TraceLoggingWrite(
+        g_hProvider,
+        "FancyZones_MoveSizeUpdates",
+        ProjectTelemetryPrivacyDataTag(ProjectTelemetryTag_ProductAndServicePerformance),
+        TraceLoggingKeyword(PROJECT_KEYWORD_MEASURE),
+        TraceLoggingValue(static_cast<UINT32>(receivedCount), "ReceivedCount"),
+        TraceLoggingValue(static_cast<UINT32>(processedCount), "ProcessedCount"),
+        TraceLoggingValue(static_cast<INT64>(duration.count()), "DurationMilliseconds"));
+}
+
 void Trace::SettingsChanged(const Settings& settings) noexcept
 {
     const auto& editorHotkey = settings.editorHotkey;
@@ -1,8 +1,15 @@
 #pragma once
 
+#include <chrono>
+
 struct Settings;
 interface IZoneSet;
 
+namespace WindowMoveBatch
+{
+    struct Stats;
+}
+
 class Trace
 {
 public:
@@ -16,6 +23,8 @@ public:
         static void OnKeyDown(DWORD vkCode, bool win, bool control, bool inMoveSize) noexcept;
         static void DataChanged() noexcept;
         static void EditorLaunched(int value) noexcept;
+        static void WindowsRepositioned(const WindowMoveBatch::Stats& stats) noexcept;
+        static void MoveSizeUpdates(size_t receivedCount, size_t processedCount, std::chrono::milliseconds duration) noexcept;
     };
 
     static void SettingsChanged(const Settings& settings) noexcept;
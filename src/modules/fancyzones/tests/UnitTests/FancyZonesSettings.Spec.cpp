@@ -714,5 +714,20 @@ namespace FancyZonesUnitTests
 
                     Assert::IsTrue(std::filesystem::exists(settingsFile));
                 }
+
+                TEST_METHOD (SetConfigKeepsUnknownProperties)
+                {
+                    auto values = PowerToysSettings::PowerToyValues::load_from_settings_file(m_moduleName);
+                    values.add_property(L"fancyzones_unknown", 42);
+                    values.save_to_settings_file();
+
+                    Settings expected;
+                    expected.zoneColor = L"#FAFAFA";
+                    m_settings->SetConfig(serializedPowerToySettings(expected).c_str());
+
+                    auto saved = PowerToysSettings::PowerToyValues::load_from_settings_file(m_moduleName);
+                    Assert::AreEqual(42, saved.get_int_value(L"fancyzones_unknown").value());
+                    Assert::AreEqual(std::wstring(L"#FAFAFA"), saved.get_string_value(L"fancyzones_zoneColor").value());
+                }
     };
 }
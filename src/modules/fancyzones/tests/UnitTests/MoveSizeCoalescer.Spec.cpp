@@ -0,0 +1,174 @@
+#include "pch.h"
+#include "lib\MoveSizeCoalescer.h"
+
+#include <optional>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std::chrono_literals;
+
+namespace FancyZonesUnitTests
+{
+    using clock = MoveSizeCoalescer::clock;
+
+    struct ReplayResult
+    {
+        MoveSizeCoalescer::Stats stats;
+        std::vector<clock::time_point> updates;
+    };
+
+    // Replays a drag trace the way the FancyZones window handles it: a queued update runs once the
+    // window thread gets to its message and is done with the previous update, which keeps the thread
+    // busy for updateCost.
+    ReplayResult Replay(MoveSizeCoalescer& coalescer, const std::vector<clock::time_point>& events, clock::duration updateCost = 200us, clock::duration messageLatency = 50us)
+    {
+        ReplayResult result;
+        std::optional<clock::time_point> queued;
+        clock::time_point busyUntil{};
+        auto nextRun = [&] { return std::max(*queued, busyUntil); };
+        auto run = [&](clock::time_point now) {
+            coalescer.Processed();
+            result.updates.push_back(now);
+            busyUntil = now + updateCost;
+            queued.reset();
+        };
+
+        coalescer.StartDrag(events.front());
+        for (auto event : events)
+        {
+            while (queued && nextRun() <= event)
+            {
+                run(nextRun());
+            }
+            if (coalescer.Receive())
+            {
+                queued = event + messageLatency;
+            }
+        }
+        while (queued)
+        {
+            run(nextRun());
+        }
+
+        result.stats = coalescer.GetDragStats(result.updates.back());
+        return result;
+    }
+
+    // Events at a fixed rate, like a mouse reporting at its polling rate
+    std::vector<clock::time_point> SteadyTrace(clock::time_point start, clock::duration interval, clock::duration length)
+    {
+        std::vector<clock::time_point> events;
+        for (auto time = start; time < start + length; time += interval)
+        {
+            events.push_back(time);
+        }
+        return events;
+    }
+
+    TEST_CLASS(MoveSizeCoalescerUnitTests)
+    {
+        clock::time_point m_start = clock::now();
+
+        // No update waits longer than the given time after the previous one while the cursor moves
+        void AssertMaxGap(const ReplayResult& result, clock::duration maxGap)
+        {
+            for (size_t i = 1; i < result.updates.size(); i++)
+            {
+                Assert::IsTrue(result.updates[i] - result.updates[i - 1] <= maxGap);
+            }
+        }
+
+        TEST_METHOD(OneUpdatePendingAtATime)
+        {
+            MoveSizeCoalescer coalescer;
+            coalescer.StartDrag(m_start);
+            Assert::IsTrue(coalescer.Receive());
+            Assert::IsFalse(coalescer.Receive());
+            Assert::IsFalse(coalescer.Receive());
+
+            coalescer.Processed();
+            Assert::IsTrue(coalescer.Receive());
+
+            auto stats = coalescer.GetDragStats(m_start + 10ms);
+            Assert::AreEqual(size_t{ 4 }, stats.receivedCount);
+            Assert::AreEqual(size_t{ 1 }, stats.processedCount);
+            Assert::IsTrue(stats.duration == 10ms);
+        }
+
+        TEST_METHOD(DragStatsCountFromDragStart)
+        {
+            MoveSizeCoalescer coalescer;
+            coalescer.Receive();
+            coalescer.Processed();
+
+            coalescer.StartDrag(m_start);
+            auto stats = coalescer.GetDragStats(m_start);
+            Assert::AreEqual(size_t{ 0 }, stats.receivedCount);
+            Assert::AreEqual(size_t{ 0 }, stats.processedCount);
+        }
+
+        TEST_METHOD(Replay1000HzDrag)
+        {
+            MoveSizeCoalescer coalescer;
+            const auto events = SteadyTrace(m_start, 1ms, 2s);
+            const auto result = Replay(coalescer, events);
+
+            // The window keeps up, every event gets its update without queuing more than one
+            Assert::AreEqual(events.size(), result.stats.receivedCount);
+            Assert::AreEqual(events.size(), result.stats.processedCount);
+            Assert::AreEqual(result.updates.size(), result.stats.processedCount);
+            AssertMaxGap(result, 1ms);
+            // The last position is not lost
+            Assert::IsTrue(result.updates.back() >= events.back());
+        }
+
+        TEST_METHOD(Replay8000HzDragWithSlowUpdates)
+        {
+            // Updates taking 2 ms, the events arriving meanwhile are folded into the next update
+            MoveSizeCoalescer coalescer;
+            const auto events = SteadyTrace(m_start, 125us, 1s);
+            const auto result = Replay(coalescer, events, 2ms);
+
+            Assert::AreEqual(size_t{ 8000 }, result.stats.receivedCount);
+            Assert::IsTrue(result.stats.processedCount <= 501);
+            Assert::IsTrue(result.stats.processedCount >= 450);
+            // Faster than a 240 Hz display refreshes
+            AssertMaxGap(result, 2ms + 125us + 50us);
+            Assert::IsTrue(result.updates.back() >= events.back());
+        }
+
+        TEST_METHOD(ReplayDragWithPauses)
+        {
+            // 100 ms of movement at 1000 Hz, then the cursor rests for 200 ms, five times over
+            MoveSizeCoalescer coalescer;
+            std::vector<clock::time_point> events;
+            std::vector<clock::time_point> burstEnds;
+            for (int burst = 0; burst < 5; burst++)
+            {
+                auto burstEvents = SteadyTrace(m_start + burst * 300ms, 1ms, 100ms);
+                events.insert(events.end(), burstEvents.begin(), burstEvents.end());
+                burstEnds.push_back(burstEvents.back());
+            }
+            const auto result = Replay(coalescer, events, 3ms);
+
+            Assert::AreEqual(size_t{ 500 }, result.stats.receivedCount);
+            // Every burst ends with an update at its final position, before the next burst starts
+            for (size_t burst = 0; burst < burstEnds.size(); burst++)
+            {
+                auto nextBurst = m_start + (burst + 1) * 300ms;
+                bool found = std::any_of(result.updates.begin(), result.updates.end(), [&](auto update) {
+                    return update >= burstEnds[burst] && update < nextBurst;
+                });
+                Assert::IsTrue(found);
+            }
+        }
+
+        TEST_METHOD(ReplaySingleMoveRunsAtOnce)
+        {
+            MoveSizeCoalescer coalescer;
+            const auto result = Replay(coalescer, { m_start }, 200us, 50us);
+
+            Assert::AreEqual(size_t{ 1 }, result.updates.size());
+            Assert::IsTrue(result.updates[0] == m_start + 50us);
+        }
+    };
+}
@@ -0,0 +1,193 @@
+#include "pch.h"
+#include "lib\WindowMoveBatch.h"
+
+#include "Util.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    struct FakeWindowPositionBackend : public WindowMoveBatch::IWindowPositionBackend
+    {
+        std::unordered_set<HWND> notDeferrable;
+        bool failBegin = false;
+        HWND failDeferFor = nullptr;
+
+        int batchCount = 0;
+        std::vector<std::pair<HWND, RECT>> deferredMoves;
+        std::vector<std::pair<HWND, RECT>> singleMoves;
+
+        bool CanDefer(HWND window, HMONITOR) override
+        {
+            return !notDeferrable.contains(window);
+        }
+
+        bool BeginBatch(int) override
+        {
+            m_pending.clear();
+            return !failBegin;
+        }
+
+        bool DeferMove(HWND window, HMONITOR, const RECT& rect) override
+        {
+            if (window == failDeferFor)
+            {
+                m_pending.clear();
+                return false;
+            }
+            m_pending.emplace_back(window, rect);
+            return true;
+        }
+
+        bool EndBatch() override
+        {
+            batchCount++;
+            deferredMoves.insert(deferredMoves.end(), m_pending.begin(), m_pending.end());
+            m_pending.clear();
+            return true;
+        }
+
+        void MoveSingle(HWND window, const RECT& rect) override
+        {
+            singleMoves.emplace_back(window, rect);
+        }
+
+    private:
+        std::vector<std::pair<HWND, RECT>> m_pending;
+    };
+
+    TEST_CLASS(WindowMoveBatchUnitTests)
+    {
+        HMONITOR m_monitor1 = Mocks::Monitor();
+        HMONITOR m_monitor2 = Mocks::Monitor();
+
+        TEST_METHOD(GroupByMonitorEmpty)
+        {
+            auto batches = WindowMoveBatch::GroupByMonitor({});
+            Assert::IsTrue(batches.empty());
+        }
+
+        TEST_METHOD(GroupByMonitorKeepsOrder)
+        {
+            HWND w1 = Mocks::Window(), w2 = Mocks::Window(), w3 = Mocks::Window();
+            auto batches = WindowMoveBatch::GroupByMonitor({
+                { w1, m_monitor2, { 0, 0, 10, 10 } },
+                { w2, m_monitor1, { 10, 0, 20, 10 } },
+                { w3, m_monitor2, { 20, 0, 30, 10 } },
+            });
+
+            Assert::AreEqual(size_t{ 2 }, batches.size());
+            Assert::IsTrue(batches[0].monitor == m_monitor2);
+            Assert::AreEqual(size_t{ 2 }, batches[0].moves.size());
+            Assert::IsTrue(batches[0].moves[0].window == w1);
+            Assert::IsTrue(batches[0].moves[1].window == w3);
+            Assert::IsTrue(batches[1].monitor == m_monitor1);
+            Assert::AreEqual(size_t{ 1 }, batches[1].moves.size());
+            Assert::IsTrue(batches[1].moves[0].window == w2);
+        }
+
+        TEST_METHOD(GroupByMonitorLastRequestWins)
+        {
+            HWND w1 = Mocks::Window(), w2 = Mocks::Window();
+            RECT last{ 5, 5, 50, 50 };
+            auto batches = WindowMoveBatch::GroupByMonitor({
+                { w1, m_monitor1, { 0, 0, 10, 10 } },
+                { w2, m_monitor1, { 10, 0, 20, 10 } },
+                { w1, m_monitor1, last },
+            });
+
+            Assert::AreEqual(size_t{ 1 }, batches.size());
+            Assert::AreEqual(size_t{ 2 }, batches[0].moves.size());
+            Assert::IsTrue(batches[0].moves[0].window == w1);
+            CustomAssert::AreEqual(last, batches[0].moves[0].rect);
+        }
+
+        TEST_METHOD(GroupByMonitorWindowChangesMonitor)
+        {
+            HWND w1 = Mocks::Window();
+            auto batches = WindowMoveBatch::GroupByMonitor({
+                { w1, m_monitor1, { 0, 0, 10, 10 } },
+                { w1, m_monitor2, { 10, 0, 20, 10 } },
+            });
+
+            Assert::AreEqual(size_t{ 1 }, batches.size());
+            Assert::IsTrue(batches[0].monitor == m_monitor2);
+            Assert::AreEqual(size_t{ 1 }, batches[0].moves.size());
+        }
+
+        TEST_METHOD(ApplyOneBatchPerMonitor)
+        {
+            std::vector<WindowMoveBatch::MoveRequest> requests;
+            for (int i = 0; i < 60; i++)
+            {
+                requests.push_back({ Mocks::Window(), i % 2 ? m_monitor1 : m_monitor2, { i, i, i + 100, i + 100 } });
+            }
+
+            FakeWindowPositionBackend backend;
+            auto stats = WindowMoveBatch::Apply(WindowMoveBatch::GroupByMonitor(requests), backend);
+
+            Assert::AreEqual(2, backend.batchCount);
+            Assert::AreEqual(size_t{ 60 }, backend.deferredMoves.size());
+            Assert::IsTrue(backend.singleMoves.empty());
+            Assert::AreEqual(size_t{ 60 }, stats.windowCount);
+            Assert::AreEqual(size_t{ 2 }, stats.monitorCount);
+            Assert::AreEqual(size_t{ 60 }, stats.deferredCount);
+            Assert::AreEqual(size_t{ 0 }, stats.singleCount);
+        }
+
+        TEST_METHOD(ApplyNotDeferrableMovedSingly)
+        {
+            HWND minimized = Mocks::Window(), normal = Mocks::Window();
+            FakeWindowPositionBackend backend;
+            backend.notDeferrable.insert(minimized);
+
+            auto stats = WindowMoveBatch::Apply(WindowMoveBatch::GroupByMonitor({
+                                                    { minimized, m_monitor1, { 0, 0, 10, 10 } },
+                                                    { normal, m_monitor1, { 10, 0, 20, 10 } },
+                                                }),
+                                                backend);
+
+            Assert::AreEqual(size_t{ 1 }, backend.singleMoves.size());
+            Assert::IsTrue(backend.singleMoves[0].first == minimized);
+            Assert::AreEqual(size_t{ 1 }, backend.deferredMoves.size());
+            Assert::IsTrue(backend.deferredMoves[0].first == normal);
+            Assert::AreEqual(size_t{ 1 }, stats.singleCount);
+            Assert::AreEqual(size_t{ 1 }, stats.deferredCount);
+        }
+
+        TEST_METHOD(ApplyFailedBatchFallsBack)
+        {
+            HWND w1 = Mocks::Window(), w2 = Mocks::Window(), w3 = Mocks::Window();
+            FakeWindowPositionBackend backend;
+            backend.failDeferFor = w2;
+
+            auto stats = WindowMoveBatch::Apply(WindowMoveBatch::GroupByMonitor({
+                                                    { w1, m_monitor1, { 0, 0, 10, 10 } },
+                                                    { w2, m_monitor1, { 10, 0, 20, 10 } },
+                                                    { w3, m_monitor1, { 20, 0, 30, 10 } },
+                                                }),
+                                                backend);
+
+            Assert::IsTrue(backend.deferredMoves.empty());
+            Assert::AreEqual(size_t{ 3 }, backend.singleMoves.size());
+            Assert::AreEqual(size_t{ 1 }, stats.failedBatchCount);
+            Assert::AreEqual(size_t{ 3 }, stats.singleCount);
+        }
+
+        TEST_METHOD(ApplyFailedBeginFallsBack)
+        {
+            FakeWindowPositionBackend backend;
+            backend.failBegin = true;
+
+            auto stats = WindowMoveBatch::Apply(WindowMoveBatch::GroupByMonitor({
+                                                    { Mocks::Window(), m_monitor1, { 0, 0, 10, 10 } },
+                                                    { Mocks::Window(), m_monitor2, { 10, 0, 20, 10 } },
+                                                }),
+                                                backend);
+
+            Assert::AreEqual(0, backend.batchCount);
+            Assert::AreEqual(size_t{ 2 }, backend.singleMoves.size());
+            Assert::AreEqual(size_t{ 2 }, stats.failedBatchCount);
+        }
+    };
+}
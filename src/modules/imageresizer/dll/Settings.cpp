@@ -73,6 +73,13 @@ void CSettings::Load()
     }
 }
 
+void CSettings::PublishSnapshot()
+{
+    shell_extension_settings::ModuleState state;
+    state.enabled = settings.enabled;
+    shell_extension_settings::publish(shell_extension_settings::Module::ImageResizer, state);
+}
+
 void CSettings::Reload()
 {
     // Load json settings from data file if it is modified in the meantime.
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <common/shell_extension_settings.h>
+
 class CSettings
 {
 public:
@@ -7,6 +9,11 @@ public:
 
     inline bool GetEnabled()
     {
+        // Prefer the snapshot published by the runner, it doesn't touch the disk.
+        if (auto snapshot = shell_extension_settings::read(shell_extension_settings::Module::ImageResizer))
+        {
+            return snapshot->enabled;
+        }
         Reload();
         return settings.enabled;
     }
@@ -19,6 +26,7 @@ public:
 
     void Save();
     void Load();
+    void PublishSnapshot();
 
 private:
     struct Settings
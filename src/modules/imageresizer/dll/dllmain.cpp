@@ -38,6 +38,7 @@ public:
     ImageResizerModule()
     {
         m_enabled = CSettingsInstance().GetEnabled();
+        CSettingsInstance().PublishSnapshot();
         app_name = GET_RESOURCE_STRING(IDS_IMAGERESIZER);
     };
 
@@ -76,6 +77,12 @@ public:
         return settings.serialize_to_buffer(buffer, buffer_size);
     }
 
+    // The configuration only holds resource strings, it never changes
+    virtual unsigned long long get_config_generation() override
+    {
+        return 1;
+    }
+
     // Signal from the Settings editor to call a custom action.
     // This can be used to spawn more complex editors.
     virtual void call_custom_action(const wchar_t* action) override {}
@@ -88,6 +95,7 @@ public:
     {
         m_enabled = true;
         CSettingsInstance().SetEnabled(m_enabled);
+        CSettingsInstance().PublishSnapshot();
         Trace::EnableImageResizer(m_enabled);
     }
 
@@ -96,6 +104,7 @@ public:
     {
         m_enabled = false;
         CSettingsInstance().SetEnabled(m_enabled);
+        CSettingsInstance().PublishSnapshot();
         Trace::EnableImageResizer(m_enabled);
     }
 
@@ -118,4 +127,10 @@ public:
 extern "C" __declspec(dllexport) PowertoyModuleIface* __cdecl powertoy_create()
 {
     return new ImageResizerModule();
+}
+
+// Only reads the settings, so the runner can create it on a worker thread
+extern "C" __declspec(dllexport) unsigned __cdecl powertoy_startup_flags()
+{
+    return POWERTOY_STARTUP_CONCURRENT_CREATE;
 }
\ No newline at end of file
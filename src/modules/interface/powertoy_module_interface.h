@@ -9,6 +9,8 @@
   The PowerToys runner will, for each PowerToy DLL:
     - load the DLL,
     - call powertoy_create() to create the PowerToy.
+  PowerToys which were disabled the last time they were created are only loaded
+  when the runner first needs them, e.g. when they are enabled.
 
   On the received object, the runner will call:
     - get_name() to get the name of the PowerToy,
@@ -19,7 +21,8 @@
   and destroy():
     - disable()/enable()/is_enabled() to change or get the PowerToy's enabled state,
     - get_config() to get the available configuration settings,
-    - set_config() to set various settings,
+    - get_config_generation() to check if the configuration changed since get_config(),
+    - set_config() or set_changed_config() to set various settings,
     - call_custom_action() when the user selects clicks a custom action in settings,
     - signal_event() to send an event the PowerToy registered to.
 
@@ -30,6 +33,15 @@
 
 class PowertoySystemMenuIface;
 
+/* Configuration passed to set_changed_config(). */
+struct PowertoyConfigChanges {
+  /* The whole configuration, as passed to set_config(). */
+  const wchar_t* config;
+  /* Null-terminated table of the names of the properties which changed since the configuration
+     last applied, or nullptr if the runner doesn't know, e.g. on the first save after loading. */
+  const wchar_t* const* changed_properties;
+};
+
 class PowertoyModuleIface {
 public:
   /* Returns the name of the PowerToy, this will be cached by the runner. */
@@ -49,8 +61,22 @@ public:
    * Returns true if successful.
    */
   virtual bool get_config(wchar_t* buffer, int *buffer_size) = 0;
+  /* Returns a number which changes whenever the configuration returned by get_config()
+   * changes, so the runner can reuse the configuration it got before.
+   * PowerToys returning 0 are asked for their configuration every time.
+   */
+  virtual unsigned long long get_config_generation() { return 0; }
   /* Sets the configuration values. */
   virtual void set_config(const wchar_t* config) = 0;
+  /* Sets the configuration values, only the changed properties need to be applied.
+   * Returns false if the configuration couldn't be applied, the runner sends it again
+   * on the next save then.
+   * PowerToys which don't override it apply the whole configuration with set_config().
+   */
+  virtual bool set_changed_config(const PowertoyConfigChanges& changes) {
+    set_config(changes.config);
+    return true;
+  }
   /* Call custom action from settings screen. */
   virtual void call_custom_action(const wchar_t* action) {};
   /* Enables the PowerToy. */
@@ -91,3 +117,19 @@ public:
   In case of errors return nullptr.
 */
 typedef PowertoyModuleIface* (__cdecl *powertoy_create_func)();
+
+/*
+  Typedef of the optional function that returns the startup flags of the PowerToy.
+
+  Can be exported by the DLL as powertoy_startup_flags(), e.g.:
+
+  extern "C" __declspec(dllexport) unsigned __cdecl powertoy_startup_flags()
+
+  Called by the PowerToys runner after loading the DLL, before powertoy_create().
+  PowerToys which don't export it are created on the runner's main thread.
+*/
+typedef unsigned (__cdecl *powertoy_startup_flags_func)();
+
+/* powertoy_create() doesn't create windows, hooks or other state bound to the calling thread,
+   so the runner can call it from a worker thread while other PowerToys are being created. */
+const unsigned POWERTOY_STARTUP_CONCURRENT_CREATE = 1 << 0;
@@ -4,6 +4,7 @@
 #include <settings.h>
 #include <trace.h>
 #include <common/settings_objects.h>
+#include <common/settings_schema.h>
 #include <common/common.h>
 #include "resource.h"
 #include <atomic>
@@ -13,6 +14,54 @@ HINSTANCE g_hInst = 0;
 
 extern "C" IMAGE_DOS_HEADER __ImageBase;
 
+namespace
+{
+    // Values of the PowerRename page of the settings window
+    struct PowerRenameConfig
+    {
+        bool persistInput;
+        bool mruEnabled;
+        int maxMRUSize;
+        bool showIconOnMenu;
+        bool extendedMenuOnly;
+    };
+
+    constexpr std::wstring_view PersistInputName = L"bool_persist_input";
+    constexpr std::wstring_view MRUEnabledName = L"bool_mru_enabled";
+    constexpr std::wstring_view MaxMRUSizeName = L"int_max_mru_size";
+    constexpr std::wstring_view ShowIconOnMenuName = L"bool_show_icon_on_menu";
+    constexpr std::wstring_view ExtendedMenuOnlyName = L"bool_show_extended_menu";
+
+    constexpr auto powerRenameConfigSchema = PowerToysSettings::make_schema(
+        PowerToysSettings::field(PersistInputName, &PowerRenameConfig::persistInput),
+        PowerToysSettings::field(MRUEnabledName, &PowerRenameConfig::mruEnabled),
+        PowerToysSettings::field(MaxMRUSizeName, &PowerRenameConfig::maxMRUSize),
+        PowerToysSettings::field(ShowIconOnMenuName, &PowerRenameConfig::showIconOnMenu),
+        PowerToysSettings::field(ExtendedMenuOnlyName, &PowerRenameConfig::extendedMenuOnly));
+
+    // The PowerRename settings hold the values of the settings page along with the ones of the
+    // rename dialog, so the page is read from and written to them
+    PowerRenameConfig GetConfigValues()
+    {
+        return {
+            CSettingsInstance().GetPersistState(),
+            CSettingsInstance().GetMRUEnabled(),
+            static_cast<int>(CSettingsInstance().GetMaxMRUSize()),
+            CSettingsInstance().GetShowIconOnMenu(),
+            CSettingsInstance().GetExtendedContextMenuOnly()
+        };
+    }
+
+    void SetConfigValues(const PowerRenameConfig& values)
+    {
+        CSettingsInstance().SetPersistState(values.persistInput);
+        CSettingsInstance().SetMRUEnabled(values.mruEnabled);
+        CSettingsInstance().SetMaxMRUSize(values.maxMRUSize);
+        CSettingsInstance().SetShowIconOnMenu(values.showIconOnMenu);
+        CSettingsInstance().SetExtendedContextMenuOnly(values.extendedMenuOnly);
+    }
+}
+
 class CPowerRenameClassFactory : public IClassFactory
 {
 public:
@@ -155,6 +204,8 @@ private:
     // Enabled by default
     bool m_enabled = true;
     std::wstring app_name;
+    // Bumped by set_config(), the settings get_config() reports don't change otherwise in the runner
+    unsigned long long m_configGeneration = 1;
 
 public:
     // Return the display name of the powertoy, this will be cached
@@ -204,59 +255,83 @@ public:
         // Link to the GitHub PowerRename sub-page
         settings.set_overview_link(GET_RESOURCE_STRING(IDS_OVERVIEW_LINK));
 
+        const auto values = GetConfigValues();
+
         settings.add_bool_toggle(
-            L"bool_persist_input",
+            PersistInputName,
             GET_RESOURCE_STRING(IDS_RESTORE_SEARCH),
-            CSettingsInstance().GetPersistState());
+            values.persistInput);
 
         settings.add_bool_toggle(
-            L"bool_mru_enabled",
+            MRUEnabledName,
             GET_RESOURCE_STRING(IDS_ENABLE_AUTO),
-            CSettingsInstance().GetMRUEnabled());
+            values.mruEnabled);
 
         settings.add_int_spinner(
-            L"int_max_mru_size",
+            MaxMRUSizeName,
             GET_RESOURCE_STRING(IDS_MAX_ITEMS),
-            CSettingsInstance().GetMaxMRUSize(),
+            values.maxMRUSize,
             0,
             20,
             1);
 
         settings.add_bool_toggle(
-            L"bool_show_icon_on_menu",
+            ShowIconOnMenuName,
             GET_RESOURCE_STRING(IDS_ICON_CONTEXT_MENU),
-            CSettingsInstance().GetShowIconOnMenu());
+            values.showIconOnMenu);
 
         settings.add_bool_toggle(
-            L"bool_show_extended_menu",
+            ExtendedMenuOnlyName,
             GET_RESOURCE_STRING(IDS_EXTENDED_MENU_INFO),
-            CSettingsInstance().GetExtendedContextMenuOnly());
+            values.extendedMenuOnly);
 
         return settings.serialize_to_buffer(buffer, buffer_size);
     }
 
+    virtual unsigned long long get_config_generation() override
+    {
+        return m_configGeneration;
+    }
+
     // Passes JSON with the configuration settings for the powertoy.
     // This is called when the user hits Save on the settings page.
     virtual void set_config(PCWSTR config) override
     {
+        set_changed_config({ config, nullptr });
+    }
+
+    // Saves the settings only if one of the PowerRename page changed, the runner passes the
+    // properties of the settings page which did.
+    virtual bool set_changed_config(const PowertoyConfigChanges& changes) override
+    {
+        if (changes.changed_properties && powerRenameConfigSchema.changes(changes.changed_properties).none())
+        {
+            return true;
+        }
+
         try
         {
-            // Parse the input JSON string.
-            PowerToysSettings::PowerToyValues values =
-                PowerToysSettings::PowerToyValues::from_json_string(config);
-
-            CSettingsInstance().SetPersistState(values.get_bool_value(L"bool_persist_input").value());
-            CSettingsInstance().SetMRUEnabled(values.get_bool_value(L"bool_mru_enabled").value());
-            CSettingsInstance().SetMaxMRUSize(values.get_int_value(L"int_max_mru_size").value());
-            CSettingsInstance().SetShowIconOnMenu(values.get_bool_value(L"bool_show_icon_on_menu").value());
-            CSettingsInstance().SetExtendedContextMenuOnly(values.get_bool_value(L"bool_show_extended_menu").value());
+            // Parse the input JSON string, the values missing from it stay as they are.
+            const auto current = GetConfigValues();
+            auto values = current;
+            powerRenameConfigSchema.parse(json::JsonObject::Parse(changes.config), values);
+            if (powerRenameConfigSchema.diff(current, values).none())
+            {
+                return true;
+            }
+
+            ++m_configGeneration;
+            SetConfigValues(values);
             CSettingsInstance().Save();
+            CSettingsInstance().PublishSnapshot();
 
             Trace::SettingsChanged();
+            return true;
         }
-        catch (std::exception)
+        catch (...)
         {
-            // Improper JSON.
+            // Improper JSON or the settings couldn't be saved.
+            return false;
         }
     }
 
@@ -284,6 +359,7 @@ public:
     void init_settings()
     {
         m_enabled = CSettingsInstance().GetEnabled();
+        CSettingsInstance().PublishSnapshot();
         Trace::EnablePowerRename(m_enabled);
     }
 
@@ -291,6 +367,7 @@ public:
     {
         CSettingsInstance().SetEnabled(m_enabled);
         CSettingsInstance().Save();
+        CSettingsInstance().PublishSnapshot();
         Trace::EnablePowerRename(m_enabled);
     }
 
@@ -307,3 +384,9 @@ extern "C" __declspec(dllexport) PowertoyModuleIface* __cdecl powertoy_create()
 {
     return new PowerRenameModule();
 }
+
+// Only reads the settings, so the runner can create it on a worker thread
+extern "C" __declspec(dllexport) unsigned __cdecl powertoy_startup_flags()
+{
+    return POWERTOY_STARTUP_CONCURRENT_CREATE;
+}
@@ -1,79 +1,15 @@
 #include "pch.h"
 #include "Helpers.h"
-#include <ShlGuid.h>
-
-HRESULT _ParseEnumItems(_In_ IEnumShellItems* pesi, _In_ IPowerRenameManager* psrm, _In_ int depth = 0)
-{
-    HRESULT hr = E_INVALIDARG;
-
-    // We shouldn't get this deep since we only enum the contents of
-    // regular folders but adding just in case
-    if ((pesi) && (depth < (MAX_PATH / 2)))
-    {
-        hr = S_OK;
-
-        ULONG celtFetched;
-        CComPtr<IShellItem> spsi;
-        while ((S_OK == pesi->Next(1, &spsi, &celtFetched)) && (SUCCEEDED(hr)))
-        {
-            CComPtr<IPowerRenameItemFactory> spsrif;
-            hr = psrm->get_renameItemFactory(&spsrif);
-            if (SUCCEEDED(hr))
-            {
-                CComPtr<IPowerRenameItem> spNewItem;
-                hr = spsrif->Create(spsi, &spNewItem);
-                if (SUCCEEDED(hr))
-                {
-                    spNewItem->put_depth(depth);
-                    hr = psrm->AddItem(spNewItem);
-                }
-
-                if (SUCCEEDED(hr))
-                {
-                    bool isFolder = false;
-                    if (SUCCEEDED(spNewItem->get_isFolder(&isFolder)) && isFolder)
-                    {
-                        // Bind to the IShellItem for the IEnumShellItems interface
-                        CComPtr<IEnumShellItems> spesiNext;
-                        hr = spsi->BindToHandler(nullptr, BHID_EnumItems, IID_PPV_ARGS(&spesiNext));
-                        if (SUCCEEDED(hr))
-                        {
-                            // Parse the folder contents recursively
-                            hr = _ParseEnumItems(spesiNext, psrm, depth + 1);
-                        }
-                    }
-                }
-            }
-
-            spsi = nullptr;
-        }
-    }
-
-    return hr;
-}
+#include "PowerRenameEnum.h"
 
 // Iterate through the data source and add paths to the rotation manager
 HRESULT EnumerateDataObject(_In_ IUnknown* dataSource, _In_ IPowerRenameManager* psrm)
 {
-    CComPtr<IShellItemArray> spsia;
-    IDataObject* dataObj{};
-    HRESULT hr;
-    if (SUCCEEDED(dataSource->QueryInterface(IID_IDataObject, reinterpret_cast<void**>(&dataObj))))
-    {
-        hr = SHCreateShellItemArrayFromDataObject(dataObj, IID_PPV_ARGS(&spsia));
-    }
-    else
-    {
-        hr = dataSource->QueryInterface(IID_IShellItemArray, reinterpret_cast<void**>(&spsia));
-    }
+    CPowerRenameEnum enumerator(psrm);
+    HRESULT hr = enumerator.Start(dataSource);
     if (SUCCEEDED(hr))
     {
-        CComPtr<IEnumShellItems> spesi;
-        hr = spsia->EnumItems(&spesi);
-        if (SUCCEEDED(hr))
-        {
-            hr = _ParseEnumItems(spesi, psrm);
-        }
+        hr = enumerator.Wait();
     }
 
     return hr;
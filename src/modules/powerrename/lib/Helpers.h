@@ -3,6 +3,7 @@
 #include <common.h>
 #include <lib/PowerRenameInterfaces.h>
 
+// Synchronous, see CPowerRenameEnum to enumerate in the background
 HRESULT EnumerateDataObject(_In_ IUnknown* pdo, _In_ IPowerRenameManager* psrm);
 BOOL GetEnumeratedFileName(
     __out_ecount(cchMax) PWSTR pszUniqueName,
@@ -0,0 +1,340 @@
+#include "pch.h"
+#include "PowerRenameCollisionIndex.h"
+#include <algorithm>
+
+namespace
+{
+    const size_t npos = std::wstring::npos;
+    // Longer numbers are left out of the families, enumerated names never get that far
+    const size_t c_maxNumberDigits = 9;
+
+    // Finds the first "(digits)" of the name, as GetEnumeratedFileName does
+    bool FindNumber(_In_ std::wstring_view name, _Out_ size_t& open, _Out_ size_t& close)
+    {
+        for (open = name.find(L'('); open != npos; open = name.find(L'(', open + 1))
+        {
+            close = open + 1;
+            while (close < name.length() && name[close] >= L'0' && name[close] <= L'9')
+            {
+                close++;
+            }
+
+            if (close < name.length() && name[close] == L')')
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::wstring FamilyKey(_In_ std::wstring_view foldedDirectory, _In_ std::wstring_view foldedPrefix, _In_ std::wstring_view foldedSuffix)
+    {
+        // * can't be part of a file name
+        std::wstring key;
+        key.reserve(foldedDirectory.length() + foldedPrefix.length() + foldedSuffix.length() + 2);
+        key.append(foldedDirectory).append(1, L'\\').append(foldedPrefix).append(1, L'*').append(foldedSuffix);
+        return key;
+    }
+
+    // Splits a path into its directory and name
+    void SplitPath(_In_ std::wstring_view path, _Out_ std::wstring_view& directory, _Out_ std::wstring_view& name)
+    {
+        const size_t slash = path.find_last_of(L'\\');
+        directory = slash == npos ? std::wstring_view() : path.substr(0, slash);
+        name = slash == npos ? path : path.substr(slash + 1);
+    }
+}
+
+std::wstring FoldName(_In_ std::wstring_view name)
+{
+    std::wstring folded(name);
+    if (!folded.empty())
+    {
+        LCMapStringEx(LOCALE_NAME_INVARIANT, LCMAP_UPPERCASE, name.data(), static_cast<int>(name.length()), folded.data(), static_cast<int>(folded.length()), nullptr, nullptr, 0);
+    }
+    return folded;
+}
+
+void CPowerRenameCollisionIndex::SetTarget(_In_ int id, _In_ PCWSTR path, _In_opt_ PCWSTR newName)
+{
+    std::wstring_view directory;
+    std::wstring_view originalName;
+    SplitPath(path, directory, originalName);
+
+    const std::wstring foldedDirectory = FoldName(directory);
+    _SeedDirectory(std::wstring(directory), foldedDirectory);
+
+    const size_t nameOffset = foldedDirectory.length() + 1;
+    std::wstring key = foldedDirectory + L'\\' + FoldName(newName ? std::wstring_view(newName) : originalName);
+
+    CSRWExclusiveAutoLock lock(&m_lock);
+    auto [target, inserted] = m_targets.try_emplace(id);
+    if (inserted)
+    {
+        // The item takes over the claim its file made when the directory was read
+        target->second.key = foldedDirectory + L'\\' + FoldName(originalName);
+        auto claim = m_claims.find(target->second.key);
+        if (claim == m_claims.end())
+        {
+            _AddClaim(target->second.key, nameOffset, id);
+        }
+        else
+        {
+            claim->second.ids.push_back(id);
+        }
+    }
+
+    if (target->second.key != key)
+    {
+        // Only the items of a claim going from two to one or one to two change, not every item
+        // of a name the whole batch is renamed to
+        const std::wstring oldKey = std::move(target->second.key);
+        _RemoveClaim(oldKey, id);
+        _AddClaim(key, nameOffset, id);
+        target->second.key = std::move(key);
+
+        auto oldClaim = m_claims.find(oldKey);
+        if (oldClaim != m_claims.end() && oldClaim->second.count == 1)
+        {
+            for (int other : oldClaim->second.ids)
+            {
+                _UpdateConflict(other);
+            }
+        }
+
+        const Claim& newClaim = m_claims[target->second.key];
+        if (newClaim.count == 2)
+        {
+            for (int other : newClaim.ids)
+            {
+                _UpdateConflict(other);
+            }
+        }
+    }
+    target->second.renamed = newName != nullptr;
+    _UpdateConflict(id);
+}
+
+bool CPowerRenameCollisionIndex::HasConflict(_In_ int id)
+{
+    CSRWSharedAutoLock lock(&m_lock);
+    auto target = m_targets.find(id);
+    return target != m_targets.end() && target->second.conflict;
+}
+
+UINT CPowerRenameCollisionIndex::ConflictCount()
+{
+    CSRWSharedAutoLock lock(&m_lock);
+    return m_conflictCount;
+}
+
+bool CPowerRenameCollisionIndex::GetEnumeratedName(_In_ int id, _In_ PCWSTR path, _In_ PCWSTR nameTemplate, _In_ unsigned long minNumber, _Out_ std::wstring& name)
+{
+    name.clear();
+
+    std::wstring_view directory;
+    std::wstring_view originalName;
+    SplitPath(path, directory, originalName);
+
+    const std::wstring foldedDirectory = FoldName(directory);
+    _SeedDirectory(std::wstring(directory), foldedDirectory);
+
+    // The number goes inside the first "(digits)", or in " (n)" added before the extension
+    const std::wstring_view templateView(nameTemplate);
+    std::wstring prefix;
+    std::wstring suffix;
+    size_t open = 0;
+    size_t close = 0;
+    if (FindNumber(templateView, open, close))
+    {
+        prefix = templateView.substr(0, open + 1);
+        suffix = templateView.substr(close);
+    }
+    else
+    {
+        const std::wstring_view extension(PathFindExtension(nameTemplate));
+        prefix = templateView.substr(0, templateView.length() - extension.length());
+        prefix += L" (";
+        suffix = L")";
+        suffix += extension;
+    }
+
+    const std::wstring familyKey = FamilyKey(foldedDirectory, FoldName(prefix), FoldName(suffix));
+    unsigned long number = minNumber;
+    {
+        CSRWSharedAutoLock lock(&m_lock);
+        auto family = m_families.find(familyKey);
+        if (family != m_families.end())
+        {
+            // A name only the item itself claims is free for it. Until the item is seen the
+            // name of its file is its claim.
+            auto target = m_targets.find(id);
+            auto ownClaim = m_claims.find(target != m_targets.end() ? target->second.key : foldedDirectory + L'\\' + FoldName(originalName));
+
+            for (auto used = family->second.lower_bound(number); used != family->second.end() && *used == number; ++used)
+            {
+                if (ownClaim != m_claims.end() && ownClaim->second.count == 1 && ownClaim->second.number == number && ownClaim->second.family == familyKey)
+                {
+                    break;
+                }
+
+                if (number == ULONG_MAX)
+                {
+                    return false;
+                }
+                number++;
+            }
+        }
+    }
+
+    name = prefix + std::to_wstring(number) + suffix;
+    return name.length() < MAX_PATH;
+}
+
+void CPowerRenameCollisionIndex::SetConflictCallback(_In_ std::function<void(int id, bool conflict)> callback)
+{
+    CSRWExclusiveAutoLock lock(&m_lock);
+    m_conflictCallback = std::move(callback);
+}
+
+void CPowerRenameCollisionIndex::Clear()
+{
+    CSRWExclusiveAutoLock lock(&m_lock);
+    m_seededDirectories.clear();
+    m_claims.clear();
+    m_families.clear();
+    m_targets.clear();
+    m_conflictCount = 0;
+}
+
+void CPowerRenameCollisionIndex::_SeedDirectory(_In_ const std::wstring& directory, _In_ const std::wstring& foldedDirectory)
+{
+    if (directory.empty())
+    {
+        return;
+    }
+
+    {
+        CSRWSharedAutoLock lock(&m_lock);
+        if (m_seededDirectories.count(foldedDirectory) > 0)
+        {
+            return;
+        }
+    }
+
+    // Read without holding the lock, large directories take a while
+    std::vector<std::wstring> names;
+    std::wstring pattern = directory + L"\\*";
+    if (pattern.length() >= MAX_PATH && pattern.rfind(L"\\\\", 0) != 0)
+    {
+        pattern.insert(0, L"\\\\?\\");
+    }
+
+    WIN32_FIND_DATAW findData = {};
+    HANDLE find = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    if (find != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            if (lstrcmp(findData.cFileName, L".") != 0 && lstrcmp(findData.cFileName, L"..") != 0)
+            {
+                names.push_back(FoldName(findData.cFileName));
+            }
+        } while (FindNextFileW(find, &findData));
+        FindClose(find);
+    }
+
+    CSRWExclusiveAutoLock lock(&m_lock);
+    if (m_seededDirectories.insert(foldedDirectory).second)
+    {
+        // Items of the directory are only seen after this, they take over these claims
+        for (const auto& name : names)
+        {
+            _AddClaim(foldedDirectory + L'\\' + name, foldedDirectory.length() + 1, -1);
+        }
+    }
+}
+
+void CPowerRenameCollisionIndex::_AddClaim(_In_ const std::wstring& key, _In_ size_t nameOffset, _In_ int id)
+{
+    Claim& claim = m_claims[key];
+    claim.count++;
+    if (id != -1)
+    {
+        claim.ids.push_back(id);
+    }
+    if (claim.count == 2)
+    {
+        m_conflictCount++;
+    }
+    else if (claim.count == 1)
+    {
+        // Only numbers written the way enumerated names write them
+        const std::wstring_view name = std::wstring_view(key).substr(nameOffset);
+        size_t open = 0;
+        size_t close = 0;
+        const size_t digits = FindNumber(name, open, close) ? close - open - 1 : 0;
+        if (digits > 0 && digits <= c_maxNumberDigits && (digits == 1 || name[open + 1] != L'0'))
+        {
+            claim.number = std::stoul(std::wstring(name.substr(open + 1, digits)));
+            claim.family = FamilyKey(std::wstring_view(key).substr(0, nameOffset - 1), name.substr(0, open + 1), name.substr(close));
+            m_families[claim.family].insert(claim.number);
+        }
+    }
+}
+
+void CPowerRenameCollisionIndex::_RemoveClaim(_In_ const std::wstring& key, _In_ int id)
+{
+    auto claim = m_claims.find(key);
+    if (claim == m_claims.end())
+    {
+        return;
+    }
+
+    auto& ids = claim->second.ids;
+    auto claimId = std::find(ids.begin(), ids.end(), id);
+    if (claimId != ids.end())
+    {
+        *claimId = ids.back();
+        ids.pop_back();
+    }
+
+    if (claim->second.count == 2)
+    {
+        m_conflictCount--;
+    }
+
+    if (--claim->second.count == 0)
+    {
+        if (!claim->second.family.empty())
+        {
+            auto family = m_families.find(claim->second.family);
+            family->second.erase(claim->second.number);
+            if (family->second.empty())
+            {
+                m_families.erase(family);
+            }
+        }
+        m_claims.erase(claim);
+    }
+}
+
+void CPowerRenameCollisionIndex::_UpdateConflict(_In_ int id)
+{
+    auto target = m_targets.find(id);
+    if (target == m_targets.end())
+    {
+        return;
+    }
+
+    auto claim = m_claims.find(target->second.key);
+    const bool conflict = target->second.renamed && claim != m_claims.end() && claim->second.count > 1;
+    if (conflict != target->second.conflict)
+    {
+        target->second.conflict = conflict;
+        if (m_conflictCallback)
+        {
+            m_conflictCallback(id, conflict);
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <functional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "srwlock.h"
+
+// Upper cases a file name the way the file system compares names
+std::wstring FoldName(_In_ std::wstring_view name);
+
+// Tracks the name every item of the batch will have once renamed, so items given the same name
+// as another item or as a file already in their directory are found while the preview is built
+// rather than when the rename fails.
+//
+// Names are keyed by their directory and case folded name. Every item claims its new name, or its
+// original name when it isn't renamed, and the files of a directory claim their names the first
+// time an item of that directory is seen; the directory is read once for that. Changing the
+// target of an item moves a single claim, and a name claimed more than once is a conflict.
+//
+// Numbered names such as "foo (3).txt" are also grouped by what surrounds the number, which gives
+// the free numbers for enumerated names without trying them one by one.
+class CPowerRenameCollisionIndex
+{
+public:
+    // Sets the name the item at path gets, its original name when newName is null.
+    void SetTarget(_In_ int id, _In_ PCWSTR path, _In_opt_ PCWSTR newName);
+
+    // Whether the item is renamed to a name something else in its directory has or gets.
+    bool HasConflict(_In_ int id);
+    // Number of names claimed more than once.
+    UINT ConflictCount();
+
+    // Numbers nameTemplate like GetEnumeratedFileName, with the smallest number at or above
+    // minNumber that leaves the name free in the directory of path. The name the item already
+    // claims counts as free. Returns false if the name doesn't fit in MAX_PATH.
+    bool GetEnumeratedName(_In_ int id, _In_ PCWSTR path, _In_ PCWSTR nameTemplate, _In_ unsigned long minNumber, _Out_ std::wstring& name);
+
+    // Called under the index lock whenever an item starts or stops having a conflict.
+    void SetConflictCallback(_In_ std::function<void(int id, bool conflict)> callback);
+
+    // Forgets everything, e.g. after the items were renamed or removed. Not reported to the
+    // conflict callback.
+    void Clear();
+
+private:
+    struct Claim
+    {
+        UINT count = 0;
+        std::wstring family; // Empty for names without a number
+        unsigned long number = 0;
+        std::vector<int> ids; // Items claiming the name, files that aren't items only count
+    };
+
+    struct Target
+    {
+        std::wstring key;
+        bool renamed = false;
+        bool conflict = false;
+    };
+
+    void _SeedDirectory(_In_ const std::wstring& directory, _In_ const std::wstring& foldedDirectory);
+    // id is -1 for files that aren't items
+    void _AddClaim(_In_ const std::wstring& key, _In_ size_t nameOffset, _In_ int id);
+    void _RemoveClaim(_In_ const std::wstring& key, _In_ int id);
+    void _UpdateConflict(_In_ int id);
+
+    CSRWLock m_lock;
+    _Guarded_by_(m_lock) std::unordered_set<std::wstring> m_seededDirectories;
+    // Folded directory, backslash and folded name
+    _Guarded_by_(m_lock) std::unordered_map<std::wstring, Claim> m_claims;
+    // Folded directory and the text around the number, with the numbers claimed
+    _Guarded_by_(m_lock) std::unordered_map<std::wstring, std::set<unsigned long>> m_families;
+    _Guarded_by_(m_lock) std::unordered_map<int, Target> m_targets;
+    _Guarded_by_(m_lock) UINT m_conflictCount = 0;
+    std::function<void(int id, bool conflict)> m_conflictCallback;
+};
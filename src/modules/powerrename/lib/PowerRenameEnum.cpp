@@ -0,0 +1,621 @@
+#include "pch.h"
+#include "PowerRenameEnum.h"
+#include <algorithm>
+#include <shlobj.h>
+#include <ShlGuid.h>
+#include <span_tracing.h>
+
+namespace
+{
+    // Number of items requested from IEnumShellItems at once
+    const ULONG c_enumBatchSize = 64;
+    // Number of items added to the manager between progress callbacks
+    const UINT c_progressChunkSize = 512;
+    // Enumerating folders is mostly waiting on the file system, a few workers are enough
+    const size_t c_maxWorkers = 8;
+    // We shouldn't get this deep since we only enum the contents of
+    // regular folders but adding just in case
+    const int c_maxDepth = MAX_PATH / 2;
+
+    // Hands the find data we already have to the file system folder, so parsing the
+    // path of an item doesn't have to read its attributes from the disk again.
+    class CFileSystemBindData : public IFileSystemBindData
+    {
+    public:
+        CFileSystemBindData() :
+            m_refCount(1)
+        {
+        }
+
+        // IUnknown
+        IFACEMETHODIMP QueryInterface(_In_ REFIID riid, _Outptr_ void** ppv)
+        {
+            static const QITAB qit[] = {
+                QITABENT(CFileSystemBindData, IFileSystemBindData),
+                { 0 }
+            };
+            return QISearch(this, qit, riid, ppv);
+        }
+
+        IFACEMETHODIMP_(ULONG) AddRef()
+        {
+            return InterlockedIncrement(&m_refCount);
+        }
+
+        IFACEMETHODIMP_(ULONG) Release()
+        {
+            long refCount = InterlockedDecrement(&m_refCount);
+            if (refCount == 0)
+            {
+                delete this;
+            }
+            return refCount;
+        }
+
+        // IFileSystemBindData
+        IFACEMETHODIMP SetFindData(_In_ const WIN32_FIND_DATAW* findData)
+        {
+            m_findData = *findData;
+            return S_OK;
+        }
+
+        IFACEMETHODIMP GetFindData(_Out_ WIN32_FIND_DATAW* findData)
+        {
+            *findData = m_findData;
+            return S_OK;
+        }
+
+    private:
+        ~CFileSystemBindData() = default;
+
+        long m_refCount;
+        WIN32_FIND_DATAW m_findData = {};
+    };
+
+    HRESULT CreateFileSystemBindContext(_In_ IFileSystemBindData* bindData, _COM_Outptr_ IBindCtx** ppbc)
+    {
+        *ppbc = nullptr;
+        CComPtr<IBindCtx> spbc;
+        HRESULT hr = CreateBindCtx(0, &spbc);
+        if (SUCCEEDED(hr))
+        {
+            // STGM_CREATE tells the parser not to verify the item exists
+            BIND_OPTS bindOptions = { sizeof(bindOptions), 0, STGM_CREATE, 0 };
+            hr = spbc->SetBindOptions(&bindOptions);
+            if (SUCCEEDED(hr))
+            {
+                hr = spbc->RegisterObjectParam(const_cast<PWSTR>(STR_FILE_SYS_BIND_DATA), bindData);
+            }
+        }
+
+        if (SUCCEEDED(hr))
+        {
+            *ppbc = spbc.Detach();
+        }
+        return hr;
+    }
+
+    bool IsEnumerableFolder(_In_ IShellItem* psi)
+    {
+        // Same check as CPowerRenameItem, some items can be both folders and streams (ex: zip folders).
+        SFGAOF att = 0;
+        return SUCCEEDED(psi->GetAttributes(SFGAO_STREAM | SFGAO_FOLDER, &att)) && (att & SFGAO_FOLDER) && !(att & SFGAO_STREAM);
+    }
+
+    bool IsDotOrDotDot(_In_ PCWSTR name)
+    {
+        return name[0] == L'.' && (name[1] == L'\0' || (name[1] == L'.' && name[2] == L'\0'));
+    }
+}
+
+CPowerRenameEnum::CPowerRenameEnum(_In_ IPowerRenameManager* psrm, _In_opt_ PowerRenameEnumCallback callback) :
+    m_spsrm(psrm),
+    m_callback(std::move(callback))
+{
+}
+
+CPowerRenameEnum::~CPowerRenameEnum()
+{
+    Cancel();
+    Wait();
+
+    for (auto pidl : m_rootIDLists)
+    {
+        CoTaskMemFree(pidl);
+    }
+}
+
+HRESULT CPowerRenameEnum::Start(_In_ IUnknown* dataSource)
+{
+    if (m_enumThread.joinable() || !m_rootIDLists.empty())
+    {
+        return E_UNEXPECTED;
+    }
+
+    HRESULT hr = m_spsrm->get_renameItemFactory(&m_spItemFactory);
+    CComPtr<IShellItemArray> spsia;
+    if (SUCCEEDED(hr))
+    {
+        CComPtr<IDataObject> spdo;
+        if (SUCCEEDED(dataSource->QueryInterface(IID_PPV_ARGS(&spdo))))
+        {
+            hr = SHCreateShellItemArrayFromDataObject(spdo, IID_PPV_ARGS(&spsia));
+        }
+        else
+        {
+            hr = dataSource->QueryInterface(IID_PPV_ARGS(&spsia));
+        }
+    }
+
+    // The data object may only be usable from this thread. Hand the items to the
+    // enumeration thread as ID lists and recreate them there.
+    CComPtr<IEnumShellItems> spesi;
+    if (SUCCEEDED(hr))
+    {
+        hr = spsia->EnumItems(&spesi);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        IShellItem* items[c_enumBatchSize] = {};
+        ULONG fetched = 0;
+        HRESULT hrNext = S_OK;
+        do
+        {
+            fetched = 0;
+            hrNext = spesi->Next(ARRAYSIZE(items), items, &fetched);
+            for (ULONG i = 0; i < fetched; i++)
+            {
+                PIDLIST_ABSOLUTE pidl = nullptr;
+                if (SUCCEEDED(SHGetIDListFromObject(items[i], &pidl)))
+                {
+                    m_rootIDLists.push_back(pidl);
+                }
+                items[i]->Release();
+            }
+        } while (hrNext == S_OK);
+
+        if (FAILED(hrNext))
+        {
+            hr = hrNext;
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        SHELLSTATE shellState = {};
+        SHGetSetSettings(&shellState, SSF_SHOWALLOBJECTS | SSF_SHOWSUPERHIDDEN, FALSE);
+        m_showHidden = shellState.fShowAllObjects;
+        m_showSuperHidden = shellState.fShowSuperHidden;
+
+        m_enumThread = std::thread(&CPowerRenameEnum::_EnumThread, this);
+    }
+
+    return hr;
+}
+
+void CPowerRenameEnum::Cancel()
+{
+    m_canceled = true;
+
+    // Wake up the enumeration thread if it is waiting for a folder
+    {
+        std::lock_guard<std::mutex> lock(m_readyLock);
+    }
+    m_readyCondition.notify_all();
+}
+
+HRESULT CPowerRenameEnum::Wait()
+{
+    if (m_enumThread.joinable())
+    {
+        m_enumThread.join();
+    }
+    return m_result;
+}
+
+void CPowerRenameEnum::_EnumThread()
+{
+    PERF_SPAN("PowerRenameEnum");
+    HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED | COINIT_DISABLE_OLE1DDE);
+    if (SUCCEEDED(hr))
+    {
+        m_root = std::make_unique<EnumFolder>();
+        for (auto pidl : m_rootIDLists)
+        {
+            CComPtr<IShellItem> spsi;
+            HRESULT hrItem = SHCreateItemFromIDList(pidl, IID_PPV_ARGS(&spsi));
+            if (SUCCEEDED(hrItem))
+            {
+                _AddEntry(m_root.get(), spsi, IsEnumerableFolder(spsi));
+            }
+            else
+            {
+                _SetResult(hrItem);
+            }
+        }
+        m_root->ready = true;
+
+        // Only spin up the workers if there is a folder to enumerate
+        if (std::any_of(m_root->entries.begin(), m_root->entries.end(), [](const EnumEntry& entry) { return entry.folder != nullptr; }))
+        {
+            _StartWorkers();
+            _ScheduleChildren(0, m_root.get());
+        }
+
+        _Emit(m_root.get());
+
+        // The tree may still be referenced by the worker queues until the workers are gone
+        _StopWorkers();
+        m_root.reset();
+
+        CoUninitialize();
+    }
+    else
+    {
+        _SetResult(hr);
+    }
+
+    _ReportProgress(true);
+}
+
+void CPowerRenameEnum::_WorkerThread(_In_ size_t index)
+{
+    const bool comInitialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED | COINIT_DISABLE_OLE1DDE));
+
+    while (EnumFolder* folder = _NextFolder(index))
+    {
+        if (!m_canceled)
+        {
+            HRESULT hr = _EnumerateFolder(folder);
+            if (FAILED(hr) && !m_canceled)
+            {
+                _SetResult(hr);
+            }
+
+            // Children must be queued before the folder is marked ready, the enumeration
+            // thread frees a folder once it and all its children have been added.
+            _ScheduleChildren(index, folder);
+        }
+
+        m_folderCount++;
+        _SetReady(folder);
+    }
+
+    if (comInitialized)
+    {
+        CoUninitialize();
+    }
+}
+
+void CPowerRenameEnum::_StartWorkers()
+{
+    const size_t workerCount = std::clamp<size_t>(std::thread::hardware_concurrency(), 2, c_maxWorkers);
+    for (size_t i = 0; i < workerCount; i++)
+    {
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    for (size_t i = 0; i < workerCount; i++)
+    {
+        m_workers.emplace_back(&CPowerRenameEnum::_WorkerThread, this, i);
+    }
+}
+
+void CPowerRenameEnum::_StopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_idleLock);
+        m_stopWorkers = true;
+    }
+    m_idleCondition.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+    m_queues.clear();
+}
+
+void CPowerRenameEnum::_ScheduleChildren(_In_ size_t index, _In_ EnumFolder* folder)
+{
+    // Workers take the most recently queued folder from their own queue. Queue the subfolders
+    // in reverse so they are enumerated in the order the enumeration thread adds them.
+    for (auto it = folder->entries.rbegin(); it != folder->entries.rend(); ++it)
+    {
+        if (it->folder)
+        {
+            m_queuedFolders++;
+            {
+                std::lock_guard<std::mutex> lock(m_queues[index]->lock);
+                m_queues[index]->folders.push_back(it->folder.get());
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_idleLock);
+            }
+            m_idleCondition.notify_one();
+        }
+    }
+}
+
+CPowerRenameEnum::EnumFolder* CPowerRenameEnum::_NextFolder(_In_ size_t index)
+{
+    for (;;)
+    {
+        // Our own queue first, newest folder first to stay close to the enumeration thread
+        {
+            auto& queue = *m_queues[index];
+            std::lock_guard<std::mutex> lock(queue.lock);
+            if (!queue.folders.empty())
+            {
+                EnumFolder* folder = queue.folders.back();
+                queue.folders.pop_back();
+                m_queuedFolders--;
+                return folder;
+            }
+        }
+
+        // Steal the oldest folder of another worker, it is likely the root of a large subtree
+        for (size_t i = 1; i < m_queues.size(); i++)
+        {
+            auto& queue = *m_queues[(index + i) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(queue.lock);
+            if (!queue.folders.empty())
+            {
+                EnumFolder* folder = queue.folders.front();
+                queue.folders.pop_front();
+                m_queuedFolders--;
+                return folder;
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(m_idleLock);
+        m_idleCondition.wait(lock, [this] { return m_stopWorkers || m_queuedFolders > 0; });
+        if (m_stopWorkers)
+        {
+            return nullptr;
+        }
+    }
+}
+
+void CPowerRenameEnum::_SetReady(_In_ EnumFolder* folder)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_readyLock);
+        folder->ready = true;
+    }
+    m_readyCondition.notify_all();
+}
+
+bool CPowerRenameEnum::_WaitReady(_In_ EnumFolder* folder)
+{
+    std::unique_lock<std::mutex> lock(m_readyLock);
+    if (!folder->ready && m_itemCount != m_reportedItemCount)
+    {
+        // Show what we have so far while a slow folder is being read
+        lock.unlock();
+        _ReportProgress(false);
+        lock.lock();
+    }
+
+    m_readyCondition.wait(lock, [&] { return folder->ready || m_canceled; });
+    return folder->ready && !m_canceled;
+}
+
+HRESULT CPowerRenameEnum::_EnumerateFolder(_In_ EnumFolder* folder)
+{
+    HRESULT hr = E_FAIL;
+
+    SFGAOF att = 0;
+    PWSTR path = nullptr;
+    if (SUCCEEDED(folder->item->GetAttributes(SFGAO_FILESYSTEM, &att)) && (att & SFGAO_FILESYSTEM) &&
+        SUCCEEDED(folder->item->GetDisplayName(SIGDN_FILESYSPATH, &path)))
+    {
+        hr = _EnumerateFileSystemFolder(folder, path);
+        CoTaskMemFree(path);
+    }
+
+    if (FAILED(hr) && !m_canceled)
+    {
+        // Not a file system folder or the fast path couldn't handle one of its items,
+        // let the shell enumerate it.
+        folder->entries.clear();
+        hr = _EnumerateShellFolder(folder);
+    }
+
+    return hr;
+}
+
+HRESULT CPowerRenameEnum::_EnumerateFileSystemFolder(_In_ EnumFolder* folder, _In_ PCWSTR path)
+{
+    std::wstring itemPath(path);
+    if (itemPath.empty() || itemPath.back() != L'\\')
+    {
+        itemPath += L'\\';
+    }
+    const size_t folderLength = itemPath.length();
+    itemPath += L'*';
+
+    WIN32_FIND_DATAW findData = {};
+    HANDLE find = FindFirstFileExW(itemPath.c_str(), FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    if (find == INVALID_HANDLE_VALUE)
+    {
+        DWORD error = GetLastError();
+        return (error == ERROR_FILE_NOT_FOUND) ? S_OK : HRESULT_FROM_WIN32(error);
+    }
+
+    CComPtr<IFileSystemBindData> spBindData;
+    spBindData.Attach(new CFileSystemBindData());
+    CComPtr<IBindCtx> spbc;
+    HRESULT hr = CreateFileSystemBindContext(spBindData, &spbc);
+    if (SUCCEEDED(hr))
+    {
+        do
+        {
+            if (m_canceled)
+            {
+                hr = E_ABORT;
+                break;
+            }
+
+            if (IsDotOrDotDot(findData.cFileName) || _IsHidden(findData.dwFileAttributes))
+            {
+                continue;
+            }
+
+            itemPath.resize(folderLength);
+            itemPath += findData.cFileName;
+            spBindData->SetFindData(&findData);
+
+            CComPtr<IShellItem> spsi;
+            hr = SHCreateItemFromParsingName(itemPath.c_str(), spbc, IID_PPV_ARGS(&spsi));
+            if (FAILED(hr))
+            {
+                break;
+            }
+
+            _AddEntry(folder, spsi, (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0);
+        } while (FindNextFileW(find, &findData));
+
+        if (SUCCEEDED(hr) && GetLastError() != ERROR_NO_MORE_FILES)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+    }
+
+    FindClose(find);
+    return hr;
+}
+
+HRESULT CPowerRenameEnum::_EnumerateShellFolder(_In_ EnumFolder* folder)
+{
+    // Bind to the IShellItem for the IEnumShellItems interface
+    CComPtr<IEnumShellItems> spesi;
+    HRESULT hr = folder->item->BindToHandler(nullptr, BHID_EnumItems, IID_PPV_ARGS(&spesi));
+    if (SUCCEEDED(hr))
+    {
+        IShellItem* items[c_enumBatchSize] = {};
+        ULONG fetched = 0;
+        HRESULT hrNext = S_OK;
+        do
+        {
+            fetched = 0;
+            hrNext = spesi->Next(ARRAYSIZE(items), items, &fetched);
+            for (ULONG i = 0; i < fetched; i++)
+            {
+                if (!m_canceled)
+                {
+                    _AddEntry(folder, items[i], IsEnumerableFolder(items[i]));
+                }
+                items[i]->Release();
+            }
+        } while (hrNext == S_OK && !m_canceled);
+
+        if (FAILED(hrNext))
+        {
+            hr = hrNext;
+        }
+    }
+
+    return hr;
+}
+
+void CPowerRenameEnum::_AddEntry(_In_ EnumFolder* folder, _In_ IShellItem* item, _In_ bool isFolder)
+{
+    EnumEntry entry;
+    entry.item = item;
+    if (isFolder && (folder->depth + 1 < c_maxDepth))
+    {
+        entry.folder = std::make_unique<EnumFolder>();
+        entry.folder->item = item;
+        entry.folder->depth = folder->depth + 1;
+    }
+    folder->entries.push_back(std::move(entry));
+}
+
+bool CPowerRenameEnum::_IsHidden(_In_ DWORD attributes)
+{
+    // Match what the user sees in Explorer
+    if (attributes & FILE_ATTRIBUTE_HIDDEN)
+    {
+        return !m_showHidden || ((attributes & FILE_ATTRIBUTE_SYSTEM) && !m_showSuperHidden);
+    }
+    return false;
+}
+
+bool CPowerRenameEnum::_Emit(_In_ EnumFolder* folder)
+{
+    for (auto& entry : folder->entries)
+    {
+        if (m_canceled)
+        {
+            return false;
+        }
+
+        CComPtr<IPowerRenameItem> spNewItem;
+        HRESULT hr = m_spItemFactory->Create(entry.item, &spNewItem);
+        if (SUCCEEDED(hr))
+        {
+            spNewItem->put_depth(folder->depth);
+            hr = m_spsrm->AddItem(spNewItem);
+        }
+
+        if (SUCCEEDED(hr))
+        {
+            if (++m_itemCount - m_reportedItemCount >= c_progressChunkSize)
+            {
+                _ReportProgress(false);
+            }
+        }
+        else
+        {
+            _SetResult(hr);
+        }
+        entry.item = nullptr;
+
+        if (entry.folder)
+        {
+            if (!_WaitReady(entry.folder.get()))
+            {
+                return false;
+            }
+
+            bool isFolder = false;
+            if (SUCCEEDED(hr) && SUCCEEDED(spNewItem->get_isFolder(&isFolder)) && isFolder)
+            {
+                if (!_Emit(entry.folder.get()))
+                {
+                    return false;
+                }
+
+                // Every folder below has been added and no worker references it anymore
+                entry.folder.reset();
+            }
+        }
+    }
+
+    return true;
+}
+
+void CPowerRenameEnum::_ReportProgress(_In_ bool completed)
+{
+    m_reportedItemCount = m_itemCount;
+    if (m_callback)
+    {
+        PowerRenameEnumProgress progress;
+        progress.itemCount = m_itemCount;
+        progress.folderCount = m_folderCount;
+        progress.completed = completed;
+        progress.result = m_result;
+        m_callback(progress);
+    }
+}
+
+void CPowerRenameEnum::_SetResult(_In_ HRESULT hr)
+{
+    // Keep the first failure
+    HRESULT expected = S_OK;
+    m_result.compare_exchange_strong(expected, hr);
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <lib/PowerRenameInterfaces.h>
+
+struct PowerRenameEnumProgress
+{
+    UINT itemCount = 0; // Items added to the manager so far
+    UINT folderCount = 0; // Folders whose contents have been enumerated so far
+    bool completed = false;
+    HRESULT result = S_OK; // First failure encountered, only meaningful once completed
+};
+
+// Called on the enumeration thread after every chunk of items added to the manager
+// and once more when enumeration completed or was canceled.
+using PowerRenameEnumCallback = std::function<void(_In_ const PowerRenameEnumProgress& progress)>;
+
+// Enumerates the items of a data object and the contents of its folders into a rename manager.
+//
+// Folder contents are read by a small pool of worker threads. Each worker keeps its own queue
+// of folders to enumerate and idle workers steal from the other queues. Items are handed to the
+// manager by a single thread in the same depth-first order as a sequential walk, so item ids and
+// list order don't depend on how the work was scheduled. Folders on the file system are read with
+// FindFirstFileEx and their items are created from the find data without going through the shell
+// folder enumerator; other folders are enumerated with IEnumShellItems, several items at a time.
+class CPowerRenameEnum
+{
+public:
+    CPowerRenameEnum(_In_ IPowerRenameManager* psrm, _In_opt_ PowerRenameEnumCallback callback = nullptr);
+    ~CPowerRenameEnum();
+
+    CPowerRenameEnum(const CPowerRenameEnum&) = delete;
+    CPowerRenameEnum& operator=(const CPowerRenameEnum&) = delete;
+
+    // Resolves the items of the data source on the calling thread and enumerates them in the background.
+    HRESULT Start(_In_ IUnknown* dataSource);
+    // Stops enumerating as soon as possible. Items already added stay in the manager.
+    void Cancel();
+    // Waits for the enumeration to finish and returns its result.
+    HRESULT Wait();
+
+private:
+    struct EnumFolder;
+
+    struct EnumEntry
+    {
+        CComPtr<IShellItem> item;
+        // Set when the entry is a folder whose contents are enumerated
+        std::unique_ptr<EnumFolder> folder;
+    };
+
+    struct EnumFolder
+    {
+        CComPtr<IShellItem> item;
+        int depth = 0; // Depth of the items in the folder
+        std::vector<EnumEntry> entries;
+        bool ready = false; // Guarded by m_readyLock
+    };
+
+    struct WorkerQueue
+    {
+        std::mutex lock;
+        std::deque<EnumFolder*> folders;
+    };
+
+    void _EnumThread();
+    void _WorkerThread(_In_ size_t index);
+
+    void _StartWorkers();
+    void _StopWorkers();
+    void _ScheduleChildren(_In_ size_t index, _In_ EnumFolder* folder);
+    EnumFolder* _NextFolder(_In_ size_t index);
+    void _SetReady(_In_ EnumFolder* folder);
+    bool _WaitReady(_In_ EnumFolder* folder);
+
+    HRESULT _EnumerateFolder(_In_ EnumFolder* folder);
+    HRESULT _EnumerateFileSystemFolder(_In_ EnumFolder* folder, _In_ PCWSTR path);
+    HRESULT _EnumerateShellFolder(_In_ EnumFolder* folder);
+    void _AddEntry(_In_ EnumFolder* folder, _In_ IShellItem* item, _In_ bool isFolder);
+    bool _IsHidden(_In_ DWORD attributes);
+
+    bool _Emit(_In_ EnumFolder* folder);
+    void _ReportProgress(_In_ bool completed);
+    void _SetResult(_In_ HRESULT hr);
+
+    CComPtr<IPowerRenameManager> m_spsrm;
+    CComPtr<IPowerRenameItemFactory> m_spItemFactory;
+    PowerRenameEnumCallback m_callback;
+
+    std::vector<PIDLIST_ABSOLUTE> m_rootIDLists;
+    std::unique_ptr<EnumFolder> m_root;
+    bool m_showHidden = false;
+    bool m_showSuperHidden = false;
+
+    std::thread m_enumThread;
+    std::vector<std::thread> m_workers;
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+
+    std::mutex m_idleLock;
+    std::condition_variable m_idleCondition;
+    std::atomic<size_t> m_queuedFolders = 0;
+    bool m_stopWorkers = false; // Guarded by m_idleLock
+
+    std::mutex m_readyLock;
+    std::condition_variable m_readyCondition;
+
+    std::atomic<bool> m_canceled = false;
+    std::atomic<UINT> m_folderCount = 0;
+    std::atomic<HRESULT> m_result = S_OK;
+    UINT m_itemCount = 0;
+    UINT m_reportedItemCount = 0;
+};
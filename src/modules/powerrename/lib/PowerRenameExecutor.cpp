@@ -0,0 +1,469 @@
+#include "pch.h"
+#include "PowerRenameExecutor.h"
+#include "PowerRenameCollisionIndex.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+    // Renames are mostly waiting on the file system, a few threads are enough
+    const size_t c_maxThreads = 8;
+    // Above this many renames in a directory, read the directory once instead of
+    // checking every target name separately
+    const size_t c_directoryScanThreshold = 32;
+
+    bool IsValidName(_In_ const std::wstring& name)
+    {
+        if (name.empty() || name == L"." || name == L"..")
+        {
+            return false;
+        }
+
+        for (wchar_t c : name)
+        {
+            if (c < 32 || wcschr(L"<>:\"/\\|?*", c))
+            {
+                return false;
+            }
+        }
+
+        // Win32 strips trailing spaces and dots, leave those to IFileOperation
+        return name.back() != L' ' && name.back() != L'.';
+    }
+
+    std::wstring JoinPath(_In_ const std::wstring& directory, _In_ const std::wstring& name)
+    {
+        std::wstring path;
+        path.reserve(directory.length() + name.length() + 8);
+        if (directory.length() + name.length() + 1 >= MAX_PATH && directory.rfind(L"\\\\?\\", 0) != 0)
+        {
+            if (directory.rfind(L"\\\\", 0) == 0)
+            {
+                path = L"\\\\?\\UNC";
+                path.append(directory, 1);
+            }
+            else
+            {
+                path = L"\\\\?\\";
+                path += directory;
+            }
+        }
+        else
+        {
+            path = directory;
+        }
+
+        if (path.empty() || path.back() != L'\\')
+        {
+            path += L'\\';
+        }
+        path += name;
+        return path;
+    }
+
+    // Renames an item in place. The new name has no path, so the item stays in its directory
+    // and only the name is updated; fails if the name is already taken.
+    HRESULT RenameInDirectory(_In_ const std::wstring& directory, _In_ const std::wstring& oldName, _In_ const std::wstring& newName)
+    {
+        HANDLE file = CreateFileW(JoinPath(directory, oldName).c_str(),
+                                  DELETE | SYNCHRONIZE,
+                                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                  nullptr,
+                                  OPEN_EXISTING,
+                                  FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OPEN_REPARSE_POINT,
+                                  nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        const DWORD nameSize = static_cast<DWORD>(newName.length() * sizeof(wchar_t));
+        std::vector<BYTE> buffer(sizeof(FILE_RENAME_INFO) + nameSize);
+        auto renameInfo = reinterpret_cast<FILE_RENAME_INFO*>(buffer.data());
+        renameInfo->ReplaceIfExists = FALSE;
+        renameInfo->RootDirectory = nullptr;
+        renameInfo->FileNameLength = nameSize;
+        memcpy(renameInfo->FileName, newName.c_str(), nameSize);
+
+        HRESULT hr = SetFileInformationByHandle(file, FileRenameInfo, renameInfo, static_cast<DWORD>(buffer.size())) ? S_OK : HRESULT_FROM_WIN32(GetLastError());
+        CloseHandle(file);
+        return hr;
+    }
+}
+
+void CRenameJournal::AddBatch(_In_ const std::wstring& directory, _In_ const std::vector<std::pair<std::wstring, std::wstring>>& renames)
+{
+    if (renames.empty())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_directories.push_back(directory);
+    for (const auto& [oldName, newName] : renames)
+    {
+        m_entries.push_back({ m_directories.size() - 1, oldName, newName });
+    }
+}
+
+HRESULT CRenameJournal::Rollback()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    HRESULT result = S_OK;
+    for (auto it = m_entries.rbegin(); it != m_entries.rend(); ++it)
+    {
+        HRESULT hr = RenameInDirectory(m_directories[it->directory], it->newName, it->oldName);
+        if (FAILED(hr) && SUCCEEDED(result))
+        {
+            result = hr;
+        }
+    }
+
+    if (SUCCEEDED(result))
+    {
+        m_entries.clear();
+        m_directories.clear();
+    }
+
+    return result;
+}
+
+size_t CRenameJournal::Count()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_entries.size();
+}
+
+std::vector<std::wstring> CRenameJournal::Directories()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    std::vector<std::wstring> directories;
+    std::unordered_set<std::wstring> seen;
+    for (const auto& directory : m_directories)
+    {
+        if (seen.insert(FoldName(directory)).second)
+        {
+            directories.push_back(directory);
+        }
+    }
+    return directories;
+}
+
+HRESULT CRenameJournal::Save(_In_ const std::wstring& filePath)
+{
+    std::wstring text;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        size_t directory = SIZE_MAX;
+        for (const auto& entry : m_entries)
+        {
+            // AddBatch keeps the renames of a batch together
+            if (entry.directory != directory)
+            {
+                directory = entry.directory;
+                text += m_directories[directory];
+                text += L'\n';
+            }
+            text += L'\t';
+            text += entry.oldName;
+            text += L'\t';
+            text += entry.newName;
+            text += L'\n';
+        }
+    }
+
+    std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(text.data()), text.size() * sizeof(wchar_t));
+    return file.good() ? S_OK : E_FAIL;
+}
+
+HRESULT CRenameJournal::Load(_In_ const std::wstring& filePath)
+{
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file)
+    {
+        return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    }
+    const std::string bytes{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    const std::wstring text(reinterpret_cast<const wchar_t*>(bytes.data()), bytes.size() / sizeof(wchar_t));
+
+    std::vector<std::wstring> directories;
+    std::vector<Entry> entries;
+    size_t start = 0;
+    while (start < text.length())
+    {
+        size_t end = text.find(L'\n', start);
+        if (end == std::wstring::npos)
+        {
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+        }
+
+        std::wstring_view line(text.data() + start, end - start);
+        if (line.empty() || line[0] != L'\t')
+        {
+            directories.emplace_back(line);
+        }
+        else
+        {
+            const size_t separator = line.find(L'\t', 1);
+            if (directories.empty() || separator == std::wstring_view::npos)
+            {
+                return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+            }
+            entries.push_back({ directories.size() - 1, std::wstring(line.substr(1, separator - 1)), std::wstring(line.substr(separator + 1)) });
+        }
+        start = end + 1;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_directories = std::move(directories);
+    m_entries = std::move(entries);
+    return S_OK;
+}
+
+CPowerRenameExecutor::CPowerRenameExecutor(_In_ std::vector<RenameOperation> operations) :
+    m_operations(std::move(operations))
+{
+}
+
+HRESULT CPowerRenameExecutor::Plan()
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    m_batches.clear();
+    m_collisions.clear();
+    m_planned = false;
+
+    std::map<std::pair<UINT, std::wstring>, size_t> batchIndex;
+    for (size_t i = 0; i < m_operations.size(); i++)
+    {
+        const auto& operation = m_operations[i];
+        const size_t separator = operation.path.find_last_of(L'\\');
+        if (separator == std::wstring::npos || separator + 1 >= operation.path.length() || !IsValidName(operation.newName))
+        {
+            return E_INVALIDARG;
+        }
+
+        std::wstring directory = operation.path.substr(0, separator);
+        auto [it, inserted] = batchIndex.try_emplace({ operation.depth, FoldName(directory) }, m_batches.size());
+        if (inserted)
+        {
+            DirectoryBatch batch;
+            batch.depth = operation.depth;
+            batch.directory = std::move(directory);
+            m_batches.push_back(std::move(batch));
+        }
+        m_batches[it->second].operations.push_back(i);
+    }
+
+    std::stable_sort(m_batches.begin(), m_batches.end(), [](const DirectoryBatch& a, const DirectoryBatch& b) {
+        return a.depth > b.depth;
+    });
+
+    m_stats = {};
+    for (size_t i = 0; i < m_batches.size(); i++)
+    {
+        _PlanBatch(m_batches[i]);
+        if (i == 0 || m_batches[i].depth != m_batches[i - 1].depth)
+        {
+            m_stats.levelCount++;
+        }
+    }
+    m_stats.directoryCount = m_batches.size();
+    m_stats.planTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    m_planned = true;
+    return S_OK;
+}
+
+void CPowerRenameExecutor::_PlanBatch(_In_ DirectoryBatch& batch)
+{
+    const size_t count = batch.operations.size();
+    const size_t none = SIZE_MAX;
+
+    // Names given up by the items renamed in this directory
+    std::unordered_map<std::wstring, size_t> sources;
+    for (size_t p = 0; p < count; p++)
+    {
+        const auto& path = m_operations[batch.operations[p]].path;
+        sources.emplace(FoldName(path.substr(path.find_last_of(L'\\') + 1)), p);
+    }
+
+    std::unordered_set<std::wstring> existingNames;
+    const bool scanDirectory = count > c_directoryScanThreshold;
+    if (scanDirectory)
+    {
+        WIN32_FIND_DATAW findData = {};
+        HANDLE find = FindFirstFileExW(JoinPath(batch.directory, L"*").c_str(), FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+        if (find != INVALID_HANDLE_VALUE)
+        {
+            do
+            {
+                existingNames.insert(FoldName(findData.cFileName));
+            } while (FindNextFileW(find, &findData));
+            FindClose(find);
+        }
+    }
+
+    // dependency[p] is the operation that has to give up the name operation p takes
+    std::vector<size_t> dependency(count, none);
+    std::unordered_map<std::wstring, size_t> targets;
+    for (size_t p = 0; p < count; p++)
+    {
+        const size_t operation = batch.operations[p];
+        const auto& path = m_operations[operation].path;
+        std::wstring target = FoldName(m_operations[operation].newName);
+
+        auto [it, inserted] = targets.try_emplace(target, operation);
+        if (!inserted)
+        {
+            m_collisions.push_back({ operation, it->second });
+            continue;
+        }
+
+        if (auto source = sources.find(target); source != sources.end())
+        {
+            // Renaming to a name given up by an item of the batch, or just changing the case of our own name
+            if (source->second != p)
+            {
+                dependency[p] = source->second;
+            }
+        }
+        else if (scanDirectory ? existingNames.count(target) > 0 : GetFileAttributesW(JoinPath(batch.directory, m_operations[operation].newName).c_str()) != INVALID_FILE_ATTRIBUTES)
+        {
+            m_collisions.push_back({ operation, RenameCollision::existingItem });
+        }
+    }
+
+    // Order the operations so an item gives up its name before another item takes it
+    enum class State
+    {
+        Pending,
+        Visiting,
+        Done
+    };
+    std::vector<State> state(count, State::Pending);
+    std::vector<size_t> order;
+    order.reserve(count);
+    std::vector<size_t> chain;
+    for (size_t p = 0; p < count; p++)
+    {
+        chain.clear();
+        size_t q = p;
+        while (q != none && state[q] == State::Pending)
+        {
+            state[q] = State::Visiting;
+            chain.push_back(q);
+            q = dependency[q];
+        }
+
+        if (q != none && state[q] == State::Visiting)
+        {
+            // Items swapping names, can't be done without a temporary name
+            m_collisions.push_back({ batch.operations[chain.back()], batch.operations[q] });
+        }
+
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+        {
+            state[*it] = State::Done;
+            order.push_back(batch.operations[*it]);
+        }
+    }
+    batch.operations = std::move(order);
+}
+
+HRESULT CPowerRenameExecutor::Execute(_In_ CRenameJournal& journal)
+{
+    if (!m_planned || !m_collisions.empty())
+    {
+        return E_UNEXPECTED;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::atomic<bool> failed = false;
+    std::atomic<HRESULT> failure = S_OK;
+
+    size_t levelStart = 0;
+    while (levelStart < m_batches.size() && !failed)
+    {
+        size_t levelEnd = levelStart;
+        while (levelEnd < m_batches.size() && m_batches[levelEnd].depth == m_batches[levelStart].depth)
+        {
+            levelEnd++;
+        }
+
+        std::atomic<size_t> next = levelStart;
+        auto worker = [&] {
+            for (size_t b = next++; b < levelEnd && !failed; b = next++)
+            {
+                HRESULT hr = _ExecuteBatch(m_batches[b], journal, failed);
+                if (FAILED(hr))
+                {
+                    HRESULT expected = S_OK;
+                    failure.compare_exchange_strong(expected, hr);
+                    failed = true;
+                }
+            }
+        };
+
+        // Directories of the same level are independent, the calling thread takes part too
+        const size_t threadCount = std::min(levelEnd - levelStart, c_maxThreads);
+        m_stats.threadCount = std::max(m_stats.threadCount, threadCount);
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < threadCount; i++)
+        {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        levelStart = levelEnd;
+    }
+
+    m_stats.renamedCount = journal.Count();
+    if (failed)
+    {
+        m_stats.rolledBack = SUCCEEDED(journal.Rollback());
+    }
+    m_stats.executeTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    return failure;
+}
+
+HRESULT CPowerRenameExecutor::_ExecuteBatch(_In_ const DirectoryBatch& batch, _In_ CRenameJournal& journal, _In_ const std::atomic<bool>& failed)
+{
+    std::vector<std::pair<std::wstring, std::wstring>> renamed;
+    renamed.reserve(batch.operations.size());
+
+    HRESULT hr = S_OK;
+    for (size_t operation : batch.operations)
+    {
+        if (failed)
+        {
+            break;
+        }
+
+        const auto& path = m_operations[operation].path;
+        std::wstring oldName = path.substr(path.find_last_of(L'\\') + 1);
+        hr = RenameInDirectory(batch.directory, oldName, m_operations[operation].newName);
+        if (FAILED(hr))
+        {
+            break;
+        }
+        renamed.emplace_back(std::move(oldName), m_operations[operation].newName);
+    }
+
+    journal.AddBatch(batch.directory, renamed);
+    return hr;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct RenameOperation
+{
+    std::wstring path; // Full path of the item to rename
+    std::wstring newName; // New name of the item, without its path
+    UINT depth = 0;
+};
+
+struct RenameCollision
+{
+    static const size_t existingItem = SIZE_MAX;
+
+    size_t operation = 0;
+    // Operation renaming to the same name, or existingItem when the name is taken by an item on disk
+    size_t other = existingItem;
+};
+
+struct RenameStats
+{
+    size_t renamedCount = 0;
+    size_t directoryCount = 0;
+    size_t levelCount = 0;
+    size_t threadCount = 0;
+    std::chrono::microseconds planTime{};
+    std::chrono::microseconds executeTime{};
+    bool rolledBack = false;
+};
+
+// Undo journal of the renames done by CPowerRenameExecutor. Renames are recorded per directory in
+// the order they were done and undone in reverse order when a batch fails. Direct renames don't go
+// through IFileOperation, so Explorer can't undo them; the manager saves the journal of the last
+// batch so it can be undone later.
+class CRenameJournal
+{
+public:
+    CRenameJournal() = default;
+
+    CRenameJournal(const CRenameJournal&) = delete;
+    CRenameJournal& operator=(const CRenameJournal&) = delete;
+
+    // Records renames done in the same directory, each pair is the old and the new name.
+    void AddBatch(_In_ const std::wstring& directory, _In_ const std::vector<std::pair<std::wstring, std::wstring>>& renames);
+    // Undoes every recorded rename, most recent first. The journal is emptied only if every rename
+    // was undone.
+    HRESULT Rollback();
+
+    size_t Count();
+    // Directories holding the recorded renames, in the order they were first renamed in
+    std::vector<std::wstring> Directories();
+
+    // The file has a line per directory, followed by a line per rename done in it, with the old
+    // and the new name separated by a tab. Neither paths nor names can hold tabs or line breaks.
+    HRESULT Save(_In_ const std::wstring& filePath);
+    // Replaces the recorded renames with the ones of the file
+    HRESULT Load(_In_ const std::wstring& filePath);
+
+private:
+    struct Entry
+    {
+        size_t directory;
+        std::wstring oldName;
+        std::wstring newName;
+    };
+
+    std::mutex m_lock;
+    std::vector<std::wstring> m_directories;
+    std::vector<Entry> m_entries;
+};
+
+// Renames plain file system items without going through IFileOperation.
+//
+// Renames are grouped per directory. Directories are processed deepest level first so the path of
+// a folder only changes once everything inside it was renamed, and the directories of a level are
+// processed concurrently since they don't affect each other. Inside a directory, an item taking the
+// name another item gives up is renamed after it. Targets are checked for collisions with each
+// other and with the items on disk before anything is renamed.
+class CPowerRenameExecutor
+{
+public:
+    explicit CPowerRenameExecutor(_In_ std::vector<RenameOperation> operations);
+
+    // Groups the renames and checks for collisions. Fails if an operation has an invalid path or name.
+    HRESULT Plan();
+    // Collisions found by Plan. Nothing is renamed while there are collisions.
+    const std::vector<RenameCollision>& Collisions() const { return m_collisions; }
+
+    // Performs the planned renames, recording them in the journal. If a rename fails, every rename
+    // done so far is undone and the error is returned; Stats().rolledBack tells if the undo succeeded.
+    HRESULT Execute(_In_ CRenameJournal& journal);
+
+    const RenameStats& Stats() const { return m_stats; }
+
+private:
+    struct DirectoryBatch
+    {
+        UINT depth = 0;
+        std::wstring directory;
+        std::vector<size_t> operations; // In execution order once planned
+    };
+
+    void _PlanBatch(_In_ DirectoryBatch& batch);
+    HRESULT _ExecuteBatch(_In_ const DirectoryBatch& batch, _In_ CRenameJournal& journal, _In_ const std::atomic<bool>& failed);
+
+    std::vector<RenameOperation> m_operations;
+    std::vector<DirectoryBatch> m_batches; // Deepest level first
+    std::vector<RenameCollision> m_collisions;
+    RenameStats m_stats;
+    bool m_planned = false;
+};
@@ -0,0 +1,197 @@
+#include "pch.h"
+#include "PowerRenameIconCache.h"
+#include "PowerRenameCollisionIndex.h"
+
+namespace
+{
+    // Types whose icon is read from the file itself, upper cased
+    const PCWSTR c_perFileExtensions[] = {
+        L".ANI",
+        L".APPREF-MS",
+        L".CPL",
+        L".CUR",
+        L".EXE",
+        L".ICO",
+        L".LNK",
+        L".MSC",
+        L".SCR",
+        L".URL",
+        L".WEBSITE",
+    };
+
+    int GenericIconIndex(_In_ PCWSTR name, _In_ DWORD attributes)
+    {
+        SHFILEINFO shFileInfo = { 0 };
+        SHGetFileInfo(name, attributes, &shFileInfo, sizeof(shFileInfo), SHGFI_SYSICONINDEX | SHGFI_SMALLICON | SHGFI_USEFILEATTRIBUTES);
+        return shFileInfo.iIcon;
+    }
+}
+
+CPowerRenameIconCache::CPowerRenameIconCache(_In_ PowerRenameIconCallback callback) :
+    m_callback(std::move(callback))
+{
+    // Placeholders, the shell doesn't touch the disk for these
+    m_fileIcon = GenericIconIndex(L"file", FILE_ATTRIBUTE_NORMAL);
+    m_folderIcon = GenericIconIndex(L"folder", FILE_ATTRIBUTE_DIRECTORY);
+
+    for (size_t i = 0; i < c_workerCount; i++)
+    {
+        m_workers.emplace_back(&CPowerRenameIconCache::_WorkerThread, this);
+    }
+}
+
+CPowerRenameIconCache::~CPowerRenameIconCache()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queueLock);
+        m_stopWorkers = true;
+        m_queue.clear();
+    }
+    m_queueCondition.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+bool CPowerRenameIconCache::GetIconIndex(_In_ PCWSTR path, _In_ bool isFolder, _Out_ int* index)
+{
+    bool perFile = false;
+    std::wstring key = IconKey(path, isFolder, &perFile);
+    *index = isFolder ? m_folderIcon : m_fileIcon;
+
+    {
+        CSRWSharedAutoLock lock(&m_lock);
+        auto icon = m_icons.find(key);
+        if (icon != m_icons.end())
+        {
+            if (icon->second == -1)
+            {
+                return false;
+            }
+
+            *index = icon->second;
+            return true;
+        }
+    }
+
+    {
+        CSRWExclusiveAutoLock lock(&m_lock);
+        auto [icon, inserted] = m_icons.try_emplace(key, -1);
+        if (!inserted)
+        {
+            // Queued or resolved by another thread in the meantime
+            if (icon->second == -1)
+            {
+                return false;
+            }
+
+            *index = icon->second;
+            return true;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_queueLock);
+        m_queue.push_back({ std::move(key), path, perFile, isFolder });
+    }
+    m_queueCondition.notify_one();
+
+    return false;
+}
+
+void CPowerRenameIconCache::ResumeNotifications()
+{
+    m_notifyPending = false;
+}
+
+bool CPowerRenameIconCache::WaitForLookups(_In_ size_t count, _In_ DWORD timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(m_queueLock);
+    return m_lookupCondition.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this, count] { return m_lookupCount >= count; });
+}
+
+std::wstring CPowerRenameIconCache::IconKey(_In_ PCWSTR path, _In_ bool isFolder, _Out_ bool* perFile)
+{
+    *perFile = isFolder;
+    std::wstring extension = FoldName(PathFindExtension(path));
+    for (PCWSTR perFileExtension : c_perFileExtensions)
+    {
+        if (extension == perFileExtension)
+        {
+            *perFile = true;
+            break;
+        }
+    }
+
+    // Paths contain a backslash, extensions don't, so the two kinds of keys can't collide
+    return *perFile ? FoldName(path) : extension;
+}
+
+void CPowerRenameIconCache::_WorkerThread()
+{
+    // The shell expects COM on threads calling SHGetFileInfo
+    const bool comInitialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE));
+
+    while (true)
+    {
+        Lookup lookup;
+        {
+            std::unique_lock<std::mutex> lock(m_queueLock);
+            m_queueCondition.wait(lock, [this] { return m_stopWorkers || !m_queue.empty(); });
+            if (m_stopWorkers)
+            {
+                break;
+            }
+
+            // Newest first, those are the rows on screen
+            lookup = std::move(m_queue.back());
+            m_queue.pop_back();
+        }
+
+        const int index = _Resolve(lookup);
+        {
+            CSRWExclusiveAutoLock lock(&m_lock);
+            m_icons[lookup.key] = index;
+        }
+
+        if (!m_notifyPending.exchange(true))
+        {
+            m_callback();
+        }
+
+        // Counted once the lookup is done with, so a waiter doesn't see it half way
+        {
+            std::lock_guard<std::mutex> lock(m_queueLock);
+            m_lookupCount++;
+        }
+        m_lookupCondition.notify_all();
+    }
+
+    if (comInitialized)
+    {
+        CoUninitialize();
+    }
+}
+
+int CPowerRenameIconCache::_Resolve(_In_ const Lookup& lookup)
+{
+    SHFILEINFO shFileInfo = { 0 };
+    if (lookup.perFile)
+    {
+        // Reads the item, which is why this never runs on the UI thread
+        if (SHGetFileInfo(lookup.path.c_str(), 0, &shFileInfo, sizeof(shFileInfo), SHGFI_SYSICONINDEX | SHGFI_SMALLICON))
+        {
+            return shFileInfo.iIcon;
+        }
+        return lookup.isFolder ? m_folderIcon : m_fileIcon;
+    }
+
+    // Any name with the extension gives the icon of the extension
+    if (SHGetFileInfo(lookup.path.c_str(), FILE_ATTRIBUTE_NORMAL, &shFileInfo, sizeof(shFileInfo), SHGFI_SYSICONINDEX | SHGFI_SMALLICON | SHGFI_USEFILEATTRIBUTES))
+    {
+        return shFileInfo.iIcon;
+    }
+    return m_fileIcon;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "srwlock.h"
+
+// Called on a lookup thread once icons were resolved. Not called again until the owner calls
+// ResumeNotifications, so a burst of icons results in a single repaint.
+using PowerRenameIconCallback = std::function<void()>;
+
+// System image list indices of the items shown in the list view.
+//
+// Most files share the icon of their extension, so icons are cached per extension and a folder
+// with 100k photos costs a single shell lookup. Folders and types whose icon depends on the file
+// itself, such as .exe or .lnk, are cached per path. Lookups never run on the calling thread:
+// unknown icons are queued to a small pool of threads and a generic file or folder icon is
+// returned until they are resolved. The most recently requested icons are looked up first since
+// those are the rows on screen while the list is scrolled.
+class CPowerRenameIconCache
+{
+public:
+    explicit CPowerRenameIconCache(_In_ PowerRenameIconCallback callback);
+    ~CPowerRenameIconCache();
+
+    CPowerRenameIconCache(const CPowerRenameIconCache&) = delete;
+    CPowerRenameIconCache& operator=(const CPowerRenameIconCache&) = delete;
+
+    // Returns true with the icon of the item if it is known. Otherwise queues its lookup and
+    // returns false with a placeholder icon.
+    bool GetIconIndex(_In_ PCWSTR path, _In_ bool isFolder, _Out_ int* index);
+
+    // Lets the callback be called again, once the owner handled the last notification.
+    void ResumeNotifications();
+
+    // Key the icon of an item is cached under, its upper cased path if the icon is per file
+    static std::wstring IconKey(_In_ PCWSTR path, _In_ bool isFolder, _Out_ bool* perFile);
+
+    // Lookups completed so far, the icon stored and the owner notified if it had to be
+    size_t LookupCount() const { return m_lookupCount; }
+
+    // Returns false if fewer than count lookups completed within the timeout
+    bool WaitForLookups(_In_ size_t count, _In_ DWORD timeoutMs);
+
+private:
+    struct Lookup
+    {
+        std::wstring key;
+        std::wstring path;
+        bool perFile;
+        bool isFolder;
+    };
+
+    static const size_t c_workerCount = 2;
+
+    void _WorkerThread();
+    int _Resolve(_In_ const Lookup& lookup);
+
+    PowerRenameIconCallback m_callback;
+    int m_fileIcon = 0;
+    int m_folderIcon = 0;
+
+    CSRWLock m_lock;
+    // Icon index per key, -1 while the lookup is queued
+    _Guarded_by_(m_lock) std::unordered_map<std::wstring, int> m_icons;
+
+    std::mutex m_queueLock;
+    std::condition_variable m_queueCondition;
+    std::condition_variable m_lookupCondition;
+    std::deque<Lookup> m_queue; // Guarded by m_queueLock
+    bool m_stopWorkers = false; // Guarded by m_queueLock
+    std::vector<std::thread> m_workers;
+
+    std::atomic<bool> m_notifyPending = false;
+    std::atomic<size_t> m_lookupCount = 0; // Written under m_queueLock
+};
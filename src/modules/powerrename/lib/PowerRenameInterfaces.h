@@ -14,6 +14,15 @@ enum PowerRenameFlags
     ExtensionOnly = 0x100
 };
 
+// Items the list view shows
+enum PowerRenameFilter
+{
+    ShowAllItems = 0,
+    ShowChangedItems, // Items given a new name
+    ShowSelectedItems,
+    ShowConflictItems // Items given a name that is taken
+};
+
 interface __declspec(uuid("3ECBA62B-E0F0-4472-AA2E-DEE7A1AA46B9")) IPowerRenameRegExEvents : public IUnknown
 {
 public:
@@ -56,21 +65,44 @@ public:
     IFACEMETHOD(Reset)() = 0;
 };
 
+interface __declspec(uuid("9812890E-EB84-421D-A276-2663B16249A3")) IPowerRenameItem2 : public IPowerRenameItem
+{
+public:
+    // Views of the names owned by the item, without a copy. The path and the original name don't
+    // change for the lifetime of the item. The new name is valid until the next put_newName or
+    // Reset, and at most until the factory has begun two more name passes, so only the thread
+    // setting the new names may use get_newNameView while a preview pass runs; other threads
+    // copy it with CopyNewName.
+    IFACEMETHOD(get_pathView)(_Outptr_ PCWSTR* path) = 0;
+    IFACEMETHOD(get_originalNameView)(_Outptr_ PCWSTR* originalName) = 0;
+    IFACEMETHOD(get_newNameView)(_Outptr_result_maybenull_ PCWSTR* newName) = 0;
+    IFACEMETHOD(CopyNewName)(_Out_writes_(bufferSize) PWSTR buffer, _In_ UINT bufferSize) = 0;
+};
+
 interface __declspec(uuid("{26CBFFD9-13B3-424E-BAC9-D12B0539149C}")) IPowerRenameItemFactory : public IUnknown
 {
 public:
     IFACEMETHOD(Create)(_In_ IShellItem* psi, _COM_Outptr_ IPowerRenameItem** ppItem) = 0;
 };
 
+interface __declspec(uuid("18A6F136-643F-4159-9890-D82C27A73174")) IPowerRenameItemFactory2 : public IPowerRenameItemFactory
+{
+public:
+    // Releases the new names of all the created items at once before a preview pass sets them again
+    IFACEMETHOD(BeginNamePass)() = 0;
+    IFACEMETHOD(get_namePassBytes)(_Out_ SIZE_T* bytes) = 0;
+};
+
 interface __declspec(uuid("87FC43F9-7634-43D9-99A5-20876AFCE4AD")) IPowerRenameManagerEvents : public IUnknown
 {
 public:
     IFACEMETHOD(OnItemAdded)(_In_ IPowerRenameItem* renameItem) = 0;
     IFACEMETHOD(OnUpdate)(_In_ IPowerRenameItem* renameItem) = 0;
     IFACEMETHOD(OnError)(_In_ IPowerRenameItem* renameItem) = 0;
-    IFACEMETHOD(OnRegExStarted)(_In_ DWORD threadId) = 0;
-    IFACEMETHOD(OnRegExCanceled)(_In_ DWORD threadId) = 0;
-    IFACEMETHOD(OnRegExCompleted)(_In_ DWORD threadId) = 0;
+    // regExId identifies the search request, later requests have larger ids
+    IFACEMETHOD(OnRegExStarted)(_In_ DWORD regExId) = 0;
+    IFACEMETHOD(OnRegExCanceled)(_In_ DWORD regExId) = 0;
+    IFACEMETHOD(OnRegExCompleted)(_In_ DWORD regExId) = 0;
     IFACEMETHOD(OnRenameStarted)() = 0;
     IFACEMETHOD(OnRenameCompleted)() = 0;
 };
@@ -84,13 +116,28 @@ public:
     IFACEMETHOD(Stop)() = 0;
     IFACEMETHOD(Reset)() = 0;
     IFACEMETHOD(Shutdown)() = 0;
+    // Renames the items with the names of the current preview. While the preview is running the
+    // rename is started when it completes, OnRenameStarted and OnRenameCompleted tell when it ran.
     IFACEMETHOD(Rename)(_In_ HWND hwndParent) = 0;
+    // Gives the items of the last direct rename their previous names. Renames done through
+    // IFileOperation are undone from Explorer instead, fails if the last rename was one of them.
+    IFACEMETHOD(UndoLastRename)() = 0;
     IFACEMETHOD(AddItem)(_In_ IPowerRenameItem* pItem) = 0;
     IFACEMETHOD(GetItemByIndex)(_In_ UINT index, _COM_Outptr_ IPowerRenameItem** ppItem) = 0;
     IFACEMETHOD(GetItemById)(_In_ int id, _COM_Outptr_ IPowerRenameItem** ppItem) = 0;
     IFACEMETHOD(GetItemCount)(_Out_ UINT* count) = 0;
     IFACEMETHOD(GetSelectedItemCount)(_Out_ UINT* count) = 0;
     IFACEMETHOD(GetRenameItemCount)(_Out_ UINT* count) = 0;
+    // Names given to more than one item, or to an item and a file already in its folder
+    IFACEMETHOD(GetConflictCount)(_Out_ UINT* count) = 0;
+    IFACEMETHOD(GetItemConflict)(_In_ int id, _Out_ bool* conflict) = 0;
+    // Rows of the list view, the items of the current PowerRenameFilter in id order
+    IFACEMETHOD(get_filter)(_Out_ DWORD* filter) = 0;
+    IFACEMETHOD(put_filter)(_In_ DWORD filter) = 0;
+    IFACEMETHOD(GetVisibleItemCount)(_Out_ UINT* count) = 0;
+    IFACEMETHOD(GetVisibleItemByIndex)(_In_ UINT index, _COM_Outptr_ IPowerRenameItem** ppItem) = 0;
+    // Selects the item and keeps the selected items filter up to date
+    IFACEMETHOD(SetItemSelected)(_In_ IPowerRenameItem* pItem, _In_ bool selected) = 0;
     IFACEMETHOD(get_flags)(_Out_ DWORD* flags) = 0;
     IFACEMETHOD(put_flags)(_In_ DWORD flags) = 0;
     IFACEMETHOD(get_renameRegEx)(_COM_Outptr_ IPowerRenameRegEx** ppRegEx) = 0;
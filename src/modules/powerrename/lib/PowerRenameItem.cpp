@@ -4,6 +4,34 @@
 
 int CPowerRenameItem::s_id = 0;
 
+namespace
+{
+    // Keeps the store from releasing a new name while another thread reads it
+    class CNewNameSharedAutoLock
+    {
+    public:
+        CNewNameSharedAutoLock(_In_opt_ CPowerRenameItemStore* store, _In_ LONG pass) :
+            m_lock(store ? store->NewNames(pass).Lock() : nullptr)
+        {
+            if (m_lock)
+            {
+                m_lock->LockShared();
+            }
+        }
+
+        ~CNewNameSharedAutoLock()
+        {
+            if (m_lock)
+            {
+                m_lock->ReleaseShared();
+            }
+        }
+
+    private:
+        CSRWLock* m_lock;
+    };
+}
+
 IFACEMETHODIMP_(ULONG) CPowerRenameItem::AddRef()
 {
     return InterlockedIncrement(&m_refCount);
@@ -24,7 +52,9 @@ IFACEMETHODIMP CPowerRenameItem::QueryInterface(_In_ REFIID riid, _Outptr_ void*
 {
     static const QITAB qit[] = {
         QITABENT(CPowerRenameItem, IPowerRenameItem),
+        QITABENT(CPowerRenameItem, IPowerRenameItem2),
         QITABENT(CPowerRenameItem, IPowerRenameItemFactory),
+        QITABENT(CPowerRenameItem, IPowerRenameItemFactory2),
         { 0 }
     };
     return QISearch(this, qit, riid, ppv);
@@ -60,13 +90,21 @@ IFACEMETHODIMP CPowerRenameItem::get_originalName(_Outptr_ PWSTR* originalName)
 
 IFACEMETHODIMP CPowerRenameItem::put_newName(_In_opt_ PCWSTR newName)
 {
-    CSRWSharedAutoLock lock(&m_lock);
-    CoTaskMemFree(m_newName);
-    m_newName = nullptr;
+    CSRWExclusiveAutoLock lock(&m_lock);
     HRESULT hr = S_OK;
-    if (newName != nullptr)
+    if (m_store)
     {
-        hr = SHStrDup(newName, &m_newName);
+        // The previous name stays in the store until the next pass releases it
+        m_newName = newName ? m_store->StoreNewName(newName, &m_newNamePass) : nullptr;
+    }
+    else
+    {
+        CoTaskMemFree(m_newName);
+        m_newName = nullptr;
+        if (newName != nullptr)
+        {
+            hr = SHStrDup(newName, &m_newName);
+        }
     }
     return hr;
 }
@@ -74,10 +112,12 @@ IFACEMETHODIMP CPowerRenameItem::put_newName(_In_opt_ PCWSTR newName)
 IFACEMETHODIMP CPowerRenameItem::get_newName(_Outptr_ PWSTR* newName)
 {
     CSRWSharedAutoLock lock(&m_lock);
-    HRESULT hr = m_newName ? S_OK : E_FAIL;
+    CNewNameSharedAutoLock newNameLock(m_store.get(), m_newNamePass);
+    PCWSTR name = _NewName();
+    HRESULT hr = name ? S_OK : E_FAIL;
     if (SUCCEEDED(hr))
     {
-        hr = SHStrDup(m_newName, newName);
+        hr = SHStrDup(name, newName);
     }
     return hr;
 }
@@ -141,9 +181,13 @@ IFACEMETHODIMP CPowerRenameItem::put_depth(_In_ int depth)
 
 IFACEMETHODIMP CPowerRenameItem::ShouldRenameItem(_In_ DWORD flags, _Out_ bool* shouldRename)
 {
+    CSRWSharedAutoLock lock(&m_lock);
+    CNewNameSharedAutoLock newNameLock(m_store.get(), m_newNamePass);
+
     // Should we perform a rename on this item given its
     // state and the options that were set?
-    bool hasChanged = m_newName != nullptr && (lstrcmp(m_originalName, m_newName) != 0);
+    PCWSTR newName = _NewName();
+    bool hasChanged = newName != nullptr && (lstrcmp(m_originalName, newName) != 0);
     bool excludeBecauseFolder = (m_isFolder && (flags & PowerRenameFlags::ExcludeFolders));
     bool excludeBecauseFile = (!m_isFolder && (flags & PowerRenameFlags::ExcludeFiles));
     bool excludeBecauseSubFolderContent = (m_depth > 0 && (flags & PowerRenameFlags::ExcludeSubfolders));
@@ -155,13 +199,70 @@ IFACEMETHODIMP CPowerRenameItem::ShouldRenameItem(_In_ DWORD flags, _Out_ bool*
 
 IFACEMETHODIMP CPowerRenameItem::Reset()
 {
-    CSRWSharedAutoLock lock(&m_lock);
-    CoTaskMemFree(m_newName);
+    CSRWExclusiveAutoLock lock(&m_lock);
+    if (!m_store)
+    {
+        CoTaskMemFree(m_newName);
+    }
     m_newName = nullptr;
     return S_OK;
 }
 
+IFACEMETHODIMP CPowerRenameItem::get_pathView(_Outptr_ PCWSTR* path)
+{
+    *path = m_path;
+    return m_path ? S_OK : E_FAIL;
+}
+
+IFACEMETHODIMP CPowerRenameItem::get_originalNameView(_Outptr_ PCWSTR* originalName)
+{
+    *originalName = m_originalName;
+    return m_originalName ? S_OK : E_FAIL;
+}
+
+IFACEMETHODIMP CPowerRenameItem::get_newNameView(_Outptr_result_maybenull_ PCWSTR* newName)
+{
+    CSRWSharedAutoLock lock(&m_lock);
+    *newName = _NewName();
+    return S_OK;
+}
+
+IFACEMETHODIMP CPowerRenameItem::CopyNewName(_Out_writes_(bufferSize) PWSTR buffer, _In_ UINT bufferSize)
+{
+    CSRWSharedAutoLock lock(&m_lock);
+    CNewNameSharedAutoLock newNameLock(m_store.get(), m_newNamePass);
+    PCWSTR name = _NewName();
+    HRESULT hr = StringCchCopy(buffer, bufferSize, name ? name : L"");
+    return (SUCCEEDED(hr) && !name) ? S_FALSE : hr;
+}
+
+IFACEMETHODIMP CPowerRenameItem::Create(_In_ IShellItem* psi, _Outptr_ IPowerRenameItem** ppItem)
+{
+    return CPowerRenameItem::s_CreateInstance(psi, m_store, IID_PPV_ARGS(ppItem));
+}
+
+IFACEMETHODIMP CPowerRenameItem::BeginNamePass()
+{
+    if (m_store)
+    {
+        m_store->BeginPass();
+    }
+    return S_OK;
+}
+
+IFACEMETHODIMP CPowerRenameItem::get_namePassBytes(_Out_ SIZE_T* bytes)
+{
+    *bytes = m_store ? m_store->PassBytes() : 0;
+    return S_OK;
+}
+
 HRESULT CPowerRenameItem::s_CreateInstance(_In_opt_ IShellItem* psi, _In_ REFIID iid, _Outptr_ void** resultInterface)
+{
+    // Factories get the store their items share
+    return s_CreateInstance(psi, psi ? nullptr : std::make_shared<CPowerRenameItemStore>(), iid, resultInterface);
+}
+
+HRESULT CPowerRenameItem::s_CreateInstance(_In_opt_ IShellItem* psi, _In_ const std::shared_ptr<CPowerRenameItemStore>& store, _In_ REFIID iid, _Outptr_ void** resultInterface)
 {
     *resultInterface = nullptr;
 
@@ -169,6 +270,7 @@ HRESULT CPowerRenameItem::s_CreateInstance(_In_opt_ IShellItem* psi, _In_ REFIID
     HRESULT hr = newRenameItem ? S_OK : E_OUTOFMEMORY;
     if (SUCCEEDED(hr))
     {
+        newRenameItem->m_store = store;
         if (psi != nullptr)
         {
             hr = newRenameItem->_Init(psi);
@@ -192,18 +294,34 @@ CPowerRenameItem::CPowerRenameItem() :
 
 CPowerRenameItem::~CPowerRenameItem()
 {
-    CoTaskMemFree(m_path);
-    CoTaskMemFree(m_newName);
-    CoTaskMemFree(m_originalName);
+    if (!m_store)
+    {
+        CoTaskMemFree(m_path);
+        CoTaskMemFree(m_newName);
+        CoTaskMemFree(m_originalName);
+    }
 }
 
 HRESULT CPowerRenameItem::_Init(_In_ IShellItem* psi)
 {
     // Get the full filesystem path from the shell item
-    HRESULT hr = psi->GetDisplayName(SIGDN_FILESYSPATH, &m_path);
+    PWSTR path = nullptr;
+    HRESULT hr = psi->GetDisplayName(SIGDN_FILESYSPATH, &path);
     if (SUCCEEDED(hr))
     {
-        hr = SHStrDup(PathFindFileName(m_path), &m_originalName);
+        if (m_store)
+        {
+            // The original name is the end of the path
+            m_path = m_store->Names().Store(path);
+            m_originalName = PathFindFileName(m_path);
+            CoTaskMemFree(path);
+        }
+        else
+        {
+            m_path = path;
+            hr = SHStrDup(PathFindFileName(m_path), &m_originalName);
+        }
+
         if (SUCCEEDED(hr))
         {
             // Check if we are a folder now so we can check this attribute quickly later
@@ -219,3 +337,9 @@ HRESULT CPowerRenameItem::_Init(_In_ IShellItem* psi)
 
     return hr;
 }
+
+PCWSTR CPowerRenameItem::_NewName() const
+{
+    // Names set before the previous pass have been released
+    return (m_store && !m_store->IsLive(m_newNamePass)) ? nullptr : m_newName;
+}
@@ -1,11 +1,12 @@
 #pragma once
 #include "pch.h"
 #include "PowerRenameInterfaces.h"
+#include "PowerRenameItemStore.h"
 #include "srwlock.h"
 
 class CPowerRenameItem :
-    public IPowerRenameItem,
-    public IPowerRenameItemFactory
+    public IPowerRenameItem2,
+    public IPowerRenameItemFactory2
 {
 public:
     // IUnknown
@@ -30,13 +31,22 @@ public:
     IFACEMETHODIMP Reset();
     IFACEMETHODIMP ShouldRenameItem(_In_ DWORD flags, _Out_ bool* shouldRename);
 
+    // IPowerRenameItem2
+    IFACEMETHODIMP get_pathView(_Outptr_ PCWSTR* path);
+    IFACEMETHODIMP get_originalNameView(_Outptr_ PCWSTR* originalName);
+    IFACEMETHODIMP get_newNameView(_Outptr_result_maybenull_ PCWSTR* newName);
+    IFACEMETHODIMP CopyNewName(_Out_writes_(bufferSize) PWSTR buffer, _In_ UINT bufferSize);
+
     // IPowerRenameItemFactory
-    IFACEMETHODIMP Create(_In_ IShellItem* psi, _Outptr_ IPowerRenameItem** ppItem)
-    {
-        return CPowerRenameItem::s_CreateInstance(psi, IID_PPV_ARGS(ppItem));
-    }
+    IFACEMETHODIMP Create(_In_ IShellItem* psi, _Outptr_ IPowerRenameItem** ppItem);
+
+    // IPowerRenameItemFactory2
+    IFACEMETHODIMP BeginNamePass();
+    IFACEMETHODIMP get_namePassBytes(_Out_ SIZE_T* bytes);
 
 public:
+    // Creates a factory when psi is null. The items a factory creates keep their names in a store
+    // shared with each other instead of separate allocations.
     static HRESULT s_CreateInstance(_In_opt_ IShellItem* psi, _In_ REFIID iid, _Outptr_ void** resultInterface);
 
 protected:
@@ -44,7 +54,10 @@ protected:
     CPowerRenameItem();
     virtual ~CPowerRenameItem();
 
+    static HRESULT s_CreateInstance(_In_opt_ IShellItem* psi, _In_ const std::shared_ptr<CPowerRenameItemStore>& store, _In_ REFIID iid, _Outptr_ void** resultInterface);
+
     HRESULT _Init(_In_ IShellItem* psi);
+    PCWSTR _NewName() const;
 
     bool     m_selected = true;
     bool     m_isFolder = false;
@@ -55,6 +68,9 @@ protected:
     PWSTR    m_path = nullptr;
     PWSTR    m_originalName = nullptr;
     PWSTR    m_newName = nullptr;
+    // Set for items created by a factory: the strings above point into the store and aren't freed
+    std::shared_ptr<CPowerRenameItemStore> m_store;
+    LONG     m_newNamePass = 0;
     CSRWLock m_lock;
     long     m_refCount = 0;
 };
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include "pch.h"
+#include "PowerRenameItemFilters.h"
+#include <algorithm>
+
+namespace
+{
+    size_t LowBit(_In_ size_t i)
+    {
+        return i & (~i + 1);
+    }
+}
+
+void CPowerRenameItemFilters::AddItem(_In_ int id, _In_ bool selected)
+{
+    const BYTE members = selected ? _Bit(ShowSelectedItems) : 0;
+
+    CSRWExclusiveAutoLock lock(&m_lock);
+    for (size_t tree = 0; tree < c_treeCount; tree++)
+    {
+        m_counts[tree] += (members >> tree) & 1;
+    }
+
+    if (m_ids.empty() || m_ids.back() < id)
+    {
+        m_ids.push_back(id);
+        m_members.push_back(members);
+
+        // Node i covers the rows (i - LowBit(i), i], its sum comes from the nodes already there
+        const size_t i = m_ids.size();
+        for (size_t tree = 0; tree < c_treeCount; tree++)
+        {
+            const UINT member = (members >> tree) & 1;
+            m_trees[tree].push_back(member + _Prefix(tree, i - 1) - _Prefix(tree, i - LowBit(i)));
+        }
+        return;
+    }
+
+    auto it = std::lower_bound(m_ids.begin(), m_ids.end(), id);
+    if (*it == id)
+    {
+        for (size_t tree = 0; tree < c_treeCount; tree++)
+        {
+            m_counts[tree] -= (members >> tree) & 1;
+        }
+        return;
+    }
+
+    const size_t row = it - m_ids.begin();
+    m_ids.insert(it, id);
+    m_members.insert(m_members.begin() + row, members);
+    _Rebuild();
+}
+
+void CPowerRenameItemFilters::SetMember(_In_ int id, _In_ PowerRenameFilter filter, _In_ bool member)
+{
+    if (filter == ShowAllItems)
+    {
+        return;
+    }
+
+    CSRWExclusiveAutoLock lock(&m_lock);
+    auto it = std::lower_bound(m_ids.begin(), m_ids.end(), id);
+    if (it == m_ids.end() || *it != id)
+    {
+        return;
+    }
+
+    const size_t row = it - m_ids.begin();
+    const size_t tree = _Tree(filter);
+    const bool wasMember = (m_members[row] & _Bit(filter)) != 0;
+    if (member != wasMember)
+    {
+        m_members[row] ^= _Bit(filter);
+        _Add(tree, row, member ? 1 : -1);
+        m_counts[tree] += member ? 1 : -1;
+    }
+}
+
+void CPowerRenameItemFilters::ClearFilter(_In_ PowerRenameFilter filter)
+{
+    if (filter == ShowAllItems)
+    {
+        return;
+    }
+
+    CSRWExclusiveAutoLock lock(&m_lock);
+    const size_t tree = _Tree(filter);
+    for (auto& members : m_members)
+    {
+        members &= ~_Bit(filter);
+    }
+    std::fill(m_trees[tree].begin(), m_trees[tree].end(), 0);
+    m_counts[tree] = 0;
+}
+
+void CPowerRenameItemFilters::Clear()
+{
+    CSRWExclusiveAutoLock lock(&m_lock);
+    m_ids.clear();
+    m_members.clear();
+    for (size_t tree = 0; tree < c_treeCount; tree++)
+    {
+        m_trees[tree].clear();
+        m_counts[tree] = 0;
+    }
+}
+
+UINT CPowerRenameItemFilters::Count(_In_ PowerRenameFilter filter)
+{
+    CSRWSharedAutoLock lock(&m_lock);
+    return filter == ShowAllItems ? static_cast<UINT>(m_ids.size()) : m_counts[_Tree(filter)];
+}
+
+bool CPowerRenameItemFilters::GetId(_In_ PowerRenameFilter filter, _In_ UINT row, _Out_ int* id)
+{
+    *id = -1;
+
+    CSRWSharedAutoLock lock(&m_lock);
+    if (filter == ShowAllItems)
+    {
+        if (row >= m_ids.size())
+        {
+            return false;
+        }
+        *id = m_ids[row];
+        return true;
+    }
+
+    const size_t tree = _Tree(filter);
+    if (row >= m_counts[tree])
+    {
+        return false;
+    }
+
+    // Descends the tree to the last position with at most row members before it
+    const std::vector<UINT>& nodes = m_trees[tree];
+    size_t step = 1;
+    while (step * 2 <= nodes.size())
+    {
+        step *= 2;
+    }
+
+    size_t position = 0;
+    UINT remaining = row + 1;
+    for (; step > 0; step /= 2)
+    {
+        if (position + step <= nodes.size() && nodes[position + step - 1] < remaining)
+        {
+            position += step;
+            remaining -= nodes[position - 1];
+        }
+    }
+
+    *id = m_ids[position];
+    return true;
+}
+
+UINT CPowerRenameItemFilters::_Prefix(_In_ size_t tree, _In_ size_t rowCount) const
+{
+    UINT sum = 0;
+    for (size_t i = rowCount; i > 0; i -= LowBit(i))
+    {
+        sum += m_trees[tree][i - 1];
+    }
+    return sum;
+}
+
+void CPowerRenameItemFilters::_Add(_In_ size_t tree, _In_ size_t row, _In_ int delta)
+{
+    std::vector<UINT>& nodes = m_trees[tree];
+    for (size_t i = row + 1; i <= nodes.size(); i += LowBit(i))
+    {
+        nodes[i - 1] += delta;
+    }
+}
+
+void CPowerRenameItemFilters::_Rebuild()
+{
+    for (size_t tree = 0; tree < c_treeCount; tree++)
+    {
+        std::vector<UINT>& nodes = m_trees[tree];
+        nodes.assign(m_members.size(), 0);
+        for (size_t i = 1; i <= nodes.size(); i++)
+        {
+            nodes[i - 1] += (m_members[i - 1] >> tree) & 1;
+            const size_t parent = i + LowBit(i);
+            if (parent <= nodes.size())
+            {
+                nodes[parent - 1] += nodes[i - 1];
+            }
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include "srwlock.h"
+#include "PowerRenameInterfaces.h"
+
+// Rows of the filtered views of the list view.
+//
+// Every item has a row in the unfiltered view, in id order, and belongs to the filters the preview
+// and the selection put it in. Each filter keeps a Fenwick tree over the rows counting its
+// members, so the item on a row of a filter, the number of rows and a change of a single item
+// are all O(log n). Switching the view to another filter only switches the tree, nothing is
+// rescanned.
+class CPowerRenameItemFilters
+{
+public:
+    // Items are almost always added in id order, an item with a smaller id rebuilds the trees
+    void AddItem(_In_ int id, _In_ bool selected);
+    void SetMember(_In_ int id, _In_ PowerRenameFilter filter, _In_ bool member);
+    // Takes every item out of the filter
+    void ClearFilter(_In_ PowerRenameFilter filter);
+    void Clear();
+
+    UINT Count(_In_ PowerRenameFilter filter);
+    // Id of the item on the row of the filter
+    bool GetId(_In_ PowerRenameFilter filter, _In_ UINT row, _Out_ int* id);
+
+private:
+    // ShowAllItems needs no tree
+    static const size_t c_treeCount = 3;
+
+    static size_t _Tree(_In_ PowerRenameFilter filter) { return static_cast<size_t>(filter) - 1; }
+    static BYTE _Bit(_In_ PowerRenameFilter filter) { return static_cast<BYTE>(1 << _Tree(filter)); }
+
+    UINT _Prefix(_In_ size_t tree, _In_ size_t rowCount) const;
+    void _Add(_In_ size_t tree, _In_ size_t row, _In_ int delta);
+    void _Rebuild();
+
+    CSRWLock m_lock;
+    _Guarded_by_(m_lock) std::vector<int> m_ids; // Ascending, the unfiltered rows
+    _Guarded_by_(m_lock) std::vector<BYTE> m_members; // Bit per filter
+    _Guarded_by_(m_lock) std::vector<UINT> m_trees[c_treeCount];
+    _Guarded_by_(m_lock) UINT m_counts[c_treeCount] = {};
+};
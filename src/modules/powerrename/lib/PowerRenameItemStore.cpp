@@ -0,0 +1,57 @@
+#include "pch.h"
+#include "PowerRenameItemStore.h"
+#include <algorithm>
+
+PWSTR CPowerRenameNameArena::Store(_In_ std::wstring_view text)
+{
+    const size_t length = text.size() + 1;
+
+    CSRWExclusiveAutoLock lock(&m_lock);
+    while (m_block < m_blocks.size() && m_blocks[m_block].capacity - m_used < length)
+    {
+        m_block++;
+        m_used = 0;
+    }
+
+    if (m_block == m_blocks.size())
+    {
+        // Long strings get a block of their own
+        const size_t capacity = std::max(c_blockCapacity, length);
+        m_blocks.push_back({ std::make_unique<wchar_t[]>(capacity), capacity });
+        m_bytesReserved += capacity * sizeof(wchar_t);
+        m_used = 0;
+    }
+
+    wchar_t* copy = m_blocks[m_block].data.get() + m_used;
+    text.copy(copy, text.size());
+    copy[text.size()] = L'\0';
+    m_used += length;
+    m_bytesAllocated += length * sizeof(wchar_t);
+    return copy;
+}
+
+void CPowerRenameNameArena::Reset()
+{
+    CSRWExclusiveAutoLock lock(&m_lock);
+    m_block = 0;
+    m_used = 0;
+    m_bytesAllocated = 0;
+}
+
+PWSTR CPowerRenameItemStore::StoreNewName(_In_ std::wstring_view name, _Out_ LONG* pass)
+{
+    *pass = m_pass;
+    return NewNames(m_pass).Store(name);
+}
+
+void CPowerRenameItemStore::BeginPass()
+{
+    // Readers of the names of two passes ago hold this lock while they check IsLive, once they
+    // see the new pass they leave the arena alone
+    CPowerRenameNameArena& newNames = NewNames(m_pass + 1);
+    {
+        CSRWExclusiveAutoLock lock(newNames.Lock());
+        m_pass++;
+    }
+    newNames.Reset();
+}
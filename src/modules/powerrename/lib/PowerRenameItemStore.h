@@ -0,0 +1,65 @@
+#pragma once
+#include "pch.h"
+#include <atomic>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "srwlock.h"
+
+// Bump allocator for null terminated strings. Strings are never freed one by one, Reset releases
+// all of them at once and keeps the blocks for the next strings.
+class CPowerRenameNameArena
+{
+public:
+    // Copies text into the arena, the copy is valid until the next Reset
+    PWSTR Store(_In_ std::wstring_view text);
+    void Reset();
+
+    // Bytes handed out since the last Reset
+    size_t BytesAllocated() const { return m_bytesAllocated; }
+    // Bytes held by the blocks
+    size_t BytesReserved() const { return m_bytesReserved; }
+
+    // Held shared by readers of strings that another thread may Reset
+    CSRWLock* Lock() { return &m_lock; }
+
+private:
+    struct Block
+    {
+        std::unique_ptr<wchar_t[]> data;
+        size_t capacity;
+    };
+
+    static constexpr size_t c_blockCapacity = 16 * 1024;
+
+    CSRWLock m_lock;
+    std::vector<Block> m_blocks;
+    size_t m_block = 0;
+    size_t m_used = 0;
+    size_t m_bytesAllocated = 0;
+    size_t m_bytesReserved = 0;
+};
+
+// Storage shared by the items created by one item factory. Paths and original names are kept for
+// as long as any of the items. New names go to the arena of the current preview pass; the names
+// of the previous pass stay readable so they can be compared with the new ones, older ones are
+// released when a pass begins.
+class CPowerRenameItemStore
+{
+public:
+    CPowerRenameNameArena& Names() { return m_names; }
+
+    // Called by the thread setting the new names
+    PWSTR StoreNewName(_In_ std::wstring_view name, _Out_ LONG* pass);
+    void BeginPass();
+
+    CPowerRenameNameArena& NewNames(_In_ LONG pass) { return m_newNames[pass % 2]; }
+    // Whether the names stored during pass are still there, with the lock of NewNames(pass) held
+    bool IsLive(_In_ LONG pass) const { return pass + 1 >= m_pass; }
+    size_t PassBytes() { return NewNames(m_pass).BytesAllocated(); }
+
+private:
+    CPowerRenameNameArena m_names;
+    CPowerRenameNameArena m_newNames[2];
+    std::atomic<LONG> m_pass = 0;
+};
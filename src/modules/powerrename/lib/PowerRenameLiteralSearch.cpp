@@ -0,0 +1,229 @@
+#include "pch.h"
+#include "PowerRenameLiteralSearch.h"
+#include <string>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <intrin.h>
+#include <immintrin.h>
+#define LITERAL_SEARCH_VECTOR_KERNELS
+#endif
+
+namespace
+{
+    const size_t npos = std::wstring::npos;
+
+    bool MatchesAt(std::wstring_view text, std::wstring_view needle, size_t position, bool caseInsensitive)
+    {
+        for (size_t j = 0; j < needle.size(); j++)
+        {
+            const wchar_t c = text[position + j];
+            if (caseInsensitive ? towlower(c) != towlower(needle[j]) : c != needle[j])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t FindScalar(std::wstring_view text, std::wstring_view needle, bool caseInsensitive, size_t pos)
+    {
+        if (!caseInsensitive)
+        {
+            return text.find(needle, pos);
+        }
+
+        const wint_t first = towlower(needle[0]);
+        for (size_t i = pos; i + needle.size() <= text.size(); i++)
+        {
+            if (towlower(text[i]) == first && MatchesAt(text, needle, i, true))
+            {
+                return i;
+            }
+        }
+        return npos;
+    }
+
+    bool IsAscii(std::wstring_view text)
+    {
+        for (wchar_t c : text)
+        {
+            if (c > 0x7F)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    wchar_t FoldAscii(wchar_t c)
+    {
+        return (c >= L'A' && c <= L'Z') ? static_cast<wchar_t>(c + (L'a' - L'A')) : c;
+    }
+
+#ifdef LITERAL_SEARCH_VECTOR_KERNELS
+    bool IsAvx2Supported()
+    {
+        int info[4] = {};
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+
+        // The OS has to save the AVX registers too
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+        {
+            return false;
+        }
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    }
+
+    struct Sse2
+    {
+        using Vector = __m128i;
+        static const size_t width = 8;
+
+        static Vector Load(const wchar_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+        static Vector Broadcast(wchar_t c) { return _mm_set1_epi16(static_cast<short>(c)); }
+        static Vector Equal(Vector a, Vector b) { return _mm_cmpeq_epi16(a, b); }
+        static Vector And(Vector a, Vector b) { return _mm_and_si128(a, b); }
+        static Vector Or(Vector a, Vector b) { return _mm_or_si128(a, b); }
+
+        // Adds 0x20 to A-Z. Signed compares leave characters above 0x7FFF alone.
+        static Vector Fold(Vector x)
+        {
+            const Vector upper = _mm_and_si128(_mm_cmpgt_epi16(x, _mm_set1_epi16(L'A' - 1)), _mm_cmplt_epi16(x, _mm_set1_epi16(L'Z' + 1)));
+            return _mm_add_epi16(x, _mm_and_si128(upper, _mm_set1_epi16(0x20)));
+        }
+
+        static Vector NonAscii(Vector x)
+        {
+            const Vector ascii = _mm_cmpeq_epi16(_mm_and_si128(x, _mm_set1_epi16(static_cast<short>(0xFF80))), _mm_setzero_si128());
+            return _mm_xor_si128(ascii, _mm_set1_epi16(-1));
+        }
+
+        // One bit per character, every other bit of the byte mask
+        static unsigned long Mask(Vector x) { return static_cast<unsigned long>(_mm_movemask_epi8(x)) & 0x5555; }
+    };
+
+    struct Avx2
+    {
+        using Vector = __m256i;
+        static const size_t width = 16;
+
+        static Vector Load(const wchar_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+        static Vector Broadcast(wchar_t c) { return _mm256_set1_epi16(static_cast<short>(c)); }
+        static Vector Equal(Vector a, Vector b) { return _mm256_cmpeq_epi16(a, b); }
+        static Vector And(Vector a, Vector b) { return _mm256_and_si256(a, b); }
+        static Vector Or(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+
+        static Vector Fold(Vector x)
+        {
+            const Vector upper = _mm256_andnot_si256(_mm256_cmpgt_epi16(x, _mm256_set1_epi16(L'Z')), _mm256_cmpgt_epi16(x, _mm256_set1_epi16(L'A' - 1)));
+            return _mm256_add_epi16(x, _mm256_and_si256(upper, _mm256_set1_epi16(0x20)));
+        }
+
+        static Vector NonAscii(Vector x)
+        {
+            const Vector ascii = _mm256_cmpeq_epi16(_mm256_and_si256(x, _mm256_set1_epi16(static_cast<short>(0xFF80))), _mm256_setzero_si256());
+            return _mm256_xor_si256(ascii, _mm256_set1_epi16(-1));
+        }
+
+        static unsigned long Mask(Vector x) { return static_cast<unsigned long>(_mm256_movemask_epi8(x)) & 0x55555555; }
+    };
+
+    // Case insensitive searches need an ASCII needle
+    template<typename Isa>
+    size_t FindVector(std::wstring_view text, std::wstring_view needle, bool caseInsensitive, size_t pos)
+    {
+        const size_t last = needle.size() - 1;
+        const auto firstChar = Isa::Broadcast(caseInsensitive ? FoldAscii(needle[0]) : needle[0]);
+        const auto lastChar = Isa::Broadcast(caseInsensitive ? FoldAscii(needle[last]) : needle[last]);
+
+        size_t i = pos;
+        for (; i + last + Isa::width <= text.size(); i += Isa::width)
+        {
+            const auto first = Isa::Load(text.data() + i);
+            const auto end = Isa::Load(text.data() + i + last);
+
+            typename Isa::Vector candidates;
+            if (caseInsensitive)
+            {
+                candidates = Isa::And(Isa::Equal(Isa::Fold(first), firstChar), Isa::Equal(Isa::Fold(end), lastChar));
+                candidates = Isa::Or(candidates, Isa::Or(Isa::NonAscii(first), Isa::NonAscii(end)));
+            }
+            else
+            {
+                candidates = Isa::And(Isa::Equal(first, firstChar), Isa::Equal(end, lastChar));
+            }
+
+            for (unsigned long mask = Isa::Mask(candidates); mask != 0; mask &= mask - 1)
+            {
+                unsigned long bit = 0;
+                _BitScanForward(&bit, mask);
+                const size_t candidate = i + bit / 2;
+                if (MatchesAt(text, needle, candidate, caseInsensitive))
+                {
+                    return candidate;
+                }
+            }
+        }
+
+        // Fewer characters left than a vector holds
+        return FindScalar(text, needle, caseInsensitive, i);
+    }
+#endif
+}
+
+LiteralSearchKernel BestLiteralSearchKernel()
+{
+#ifdef LITERAL_SEARCH_VECTOR_KERNELS
+    static const LiteralSearchKernel kernel = IsAvx2Supported() ? LiteralSearchKernel::Avx2 : LiteralSearchKernel::Sse2;
+    return kernel;
+#else
+    return LiteralSearchKernel::Scalar;
+#endif
+}
+
+size_t FindLiteral(_In_ std::wstring_view text, _In_ std::wstring_view needle, _In_ bool caseInsensitive, _In_ size_t pos)
+{
+    return FindLiteral(text, needle, caseInsensitive, pos, BestLiteralSearchKernel());
+}
+
+size_t FindLiteral(_In_ std::wstring_view text, _In_ std::wstring_view needle, _In_ bool caseInsensitive, _In_ size_t pos, _In_ LiteralSearchKernel kernel)
+{
+    if (needle.empty())
+    {
+        return pos <= text.size() ? pos : npos;
+    }
+    if (pos >= text.size() || needle.size() > text.size() - pos)
+    {
+        return npos;
+    }
+
+    if (caseInsensitive && !IsAscii(needle))
+    {
+        kernel = LiteralSearchKernel::Scalar;
+    }
+    else if (kernel > BestLiteralSearchKernel())
+    {
+        kernel = BestLiteralSearchKernel();
+    }
+
+    switch (kernel)
+    {
+#ifdef LITERAL_SEARCH_VECTOR_KERNELS
+    case LiteralSearchKernel::Avx2:
+        return FindVector<Avx2>(text, needle, caseInsensitive, pos);
+    case LiteralSearchKernel::Sse2:
+        return FindVector<Sse2>(text, needle, caseInsensitive, pos);
+#endif
+    default:
+        return FindScalar(text, needle, caseInsensitive, pos);
+    }
+}
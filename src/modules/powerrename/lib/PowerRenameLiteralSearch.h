@@ -0,0 +1,26 @@
+#pragma once
+#include <string_view>
+
+enum class LiteralSearchKernel
+{
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+// Most capable kernel supported by the CPU, detected once.
+LiteralSearchKernel BestLiteralSearchKernel();
+
+// Finds the first occurrence of needle in text at or after pos, std::wstring::npos if there is none.
+// Case insensitive searches compare towlower of each character, like lower casing both strings
+// before searching them.
+//
+// The vector kernels compare 8 or 16 positions at once against the first and last character of
+// the needle and only check the rest of the needle where both match. ASCII letters are folded in
+// the vector registers; positions where the text isn't ASCII are always checked one by one, since
+// towlower maps a few other characters to ASCII letters.
+size_t FindLiteral(_In_ std::wstring_view text, _In_ std::wstring_view needle, _In_ bool caseInsensitive, _In_ size_t pos);
+
+// Same with a given kernel, for tests and benchmarks. Kernels the CPU doesn't support are replaced
+// by the best supported one.
+size_t FindLiteral(_In_ std::wstring_view text, _In_ std::wstring_view needle, _In_ bool caseInsensitive, _In_ size_t pos, _In_ LiteralSearchKernel kernel);
@@ -7,6 +7,9 @@
 #include "window_helpers.h"
 #include <filesystem>
 #include "trace.h"
+#include "PowerRenameExecutor.h"
+#include "Settings.h"
+#include "settings_helpers.h"
 
 namespace fs = std::filesystem;
 
@@ -15,6 +18,98 @@ extern HINSTANCE g_hInst;
 // The default FOF flags to use in the rename operations
 #define FOF_DEFAULTFLAGS (FOF_ALLOWUNDO | FOFX_ADDUNDORECORD | FOFX_SHOWELEVATIONPROMPT | FOF_RENAMEONCOLLISION)
 
+// Below this many renames IFileOperation is used so the rename can be undone from Explorer.
+// Larger batches are renamed directly when the DirectRename setting is on, undone as a whole if one
+// of the renames fails, and can be undone later with UndoLastRename.
+const size_t c_directRenameMinItemCount = 1000;
+
+// Journal of the last direct rename, in the PowerRename settings folder
+const wchar_t c_renameJournalFileName[] = L"\\last-rename-journal";
+
+// The regex worker checks for a newer request after this many items
+const UINT c_regExChunkSize = 64;
+
+// Reads the names of an item. Items implementing IPowerRenameItem2 hand out views, for other
+// items a copy is kept until the name is read again or the reader goes away.
+class CItemNameReader
+{
+public:
+    CItemNameReader(_In_ IPowerRenameItem* item) :
+        m_item(item)
+    {
+        item->QueryInterface(IID_PPV_ARGS(&m_views));
+    }
+
+    ~CItemNameReader()
+    {
+        CoTaskMemFree(m_path);
+        CoTaskMemFree(m_originalName);
+        CoTaskMemFree(m_newName);
+    }
+
+    PCWSTR Path() { return _Read(&IPowerRenameItem2::get_pathView, &IPowerRenameItem::get_path, m_path); }
+    PCWSTR OriginalName() { return _Read(&IPowerRenameItem2::get_originalNameView, &IPowerRenameItem::get_originalName, m_originalName); }
+    // Null when the item has no new name
+    PCWSTR NewName() { return _Read(&IPowerRenameItem2::get_newNameView, &IPowerRenameItem::get_newName, m_newName); }
+
+private:
+    PCWSTR _Read(_In_ HRESULT (STDMETHODCALLTYPE IPowerRenameItem2::*view)(PCWSTR*), _In_ HRESULT (STDMETHODCALLTYPE IPowerRenameItem::*copy)(PWSTR*), _Inout_ PWSTR& copied)
+    {
+        PCWSTR name = nullptr;
+        if (m_views)
+        {
+            if (FAILED((m_views->*view)(&name)))
+            {
+                name = nullptr;
+            }
+        }
+        else
+        {
+            CoTaskMemFree(copied);
+            copied = nullptr;
+            if (SUCCEEDED((m_item->*copy)(&copied)))
+            {
+                name = copied;
+            }
+        }
+        return name;
+    }
+
+    IPowerRenameItem* m_item;
+    CComPtr<IPowerRenameItem2> m_views;
+    PWSTR m_path = nullptr;
+    PWSTR m_originalName = nullptr;
+    PWSTR m_newName = nullptr;
+};
+
+std::wstring GetRenameJournalPath()
+{
+    return PTSettingsHelper::get_module_save_folder_location(L"PowerRename") + c_renameJournalFileName;
+}
+
+// IFileOperation tells the shell about the renames it does, the direct renames have to do it
+void NotifyDirectoriesChanged(_In_ const std::vector<std::wstring>& directories)
+{
+    for (const auto& directory : directories)
+    {
+        SHChangeNotify(SHCNE_UPDATEDIR, SHCNF_PATH | SHCNF_FLUSHNOWAIT, directory.c_str(), nullptr);
+    }
+}
+
+// Tells the user about a direct rename which failed and couldn't be undone
+void ReportDirectRenameFailure(_In_opt_ HWND hwndParent, _In_ HRESULT hr)
+{
+    std::wstring message = L"Some items couldn't be renamed, and the items renamed before them couldn't be given back their previous names.";
+    wchar_t* error = nullptr;
+    if (FormatMessageW(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, nullptr, hr, 0, reinterpret_cast<LPWSTR>(&error), 0, nullptr) && error)
+    {
+        message += L"\n\n";
+        message += error;
+        LocalFree(error);
+    }
+    MessageBoxW(hwndParent, message.c_str(), L"PowerRename", MB_OK | MB_ICONERROR);
+}
+
 IFACEMETHODIMP_(ULONG) CPowerRenameManager::AddRef()
 {
     return InterlockedIncrement(&m_refCount);
@@ -92,9 +187,37 @@ IFACEMETHODIMP CPowerRenameManager::Stop()
 IFACEMETHODIMP CPowerRenameManager::Rename(_In_ HWND hwndParent)
 {
     m_hwndParent = hwndParent;
+
+    // The new names come from the preview of the current request. Rather than block this thread
+    // while it runs, the rename is started when it completes.
+    if (!_IsRegExWorkerIdle())
+    {
+        m_renamePending = true;
+        return S_OK;
+    }
+
     return _PerformFileOperation();
 }
 
+IFACEMETHODIMP CPowerRenameManager::UndoLastRename()
+{
+    const std::wstring journalPath = GetRenameJournalPath();
+    CRenameJournal journal;
+    HRESULT hr = journal.Load(journalPath);
+    if (SUCCEEDED(hr))
+    {
+        const auto directories = journal.Directories();
+        hr = journal.Rollback();
+        NotifyDirectoriesChanged(directories);
+        if (SUCCEEDED(hr))
+        {
+            DeleteFileW(journalPath.c_str());
+        }
+    }
+
+    return hr;
+}
+
 IFACEMETHODIMP CPowerRenameManager::Reset()
 {
     // Stop all threads and wait
@@ -122,6 +245,10 @@ IFACEMETHODIMP CPowerRenameManager::AddItem(_In_ IPowerRenameItem* pItem)
         {
             m_renameItems[id] = pItem;
             pItem->AddRef();
+
+            bool selected = false;
+            pItem->get_selected(&selected);
+            m_filters.AddItem(id, selected);
             hr = S_OK;
         }
     }
@@ -137,18 +264,15 @@ IFACEMETHODIMP CPowerRenameManager::AddItem(_In_ IPowerRenameItem* pItem)
 IFACEMETHODIMP CPowerRenameManager::GetItemByIndex(_In_ UINT index, _COM_Outptr_ IPowerRenameItem** ppItem)
 {
     *ppItem = nullptr;
-    CSRWSharedAutoLock lock(&m_lockItems);
-    HRESULT hr = E_FAIL;
-    if (index < m_renameItems.size())
+
+    // The unfiltered rows are the ids in order, no need to walk the map
+    int id = 0;
+    if (!m_filters.GetId(ShowAllItems, index, &id))
     {
-        std::map<int, IPowerRenameItem*>::iterator it = m_renameItems.begin();
-        std::advance(it, index);
-        *ppItem = it->second;
-        (*ppItem)->AddRef();
-        hr = S_OK;
+        return E_FAIL;
     }
 
-    return hr;
+    return GetItemById(id, ppItem);
 }
 
 IFACEMETHODIMP CPowerRenameManager::GetItemById(_In_ int id, _COM_Outptr_ IPowerRenameItem** ppItem)
@@ -212,6 +336,70 @@ IFACEMETHODIMP CPowerRenameManager::GetRenameItemCount(_Out_ UINT* count)
     return S_OK;
 }
 
+IFACEMETHODIMP CPowerRenameManager::GetConflictCount(_Out_ UINT* count)
+{
+    *count = m_collisionIndex.ConflictCount();
+    return S_OK;
+}
+
+IFACEMETHODIMP CPowerRenameManager::GetItemConflict(_In_ int id, _Out_ bool* conflict)
+{
+    *conflict = m_collisionIndex.HasConflict(id);
+    return S_OK;
+}
+
+IFACEMETHODIMP CPowerRenameManager::get_filter(_Out_ DWORD* filter)
+{
+    *filter = m_filter;
+    return S_OK;
+}
+
+IFACEMETHODIMP CPowerRenameManager::put_filter(_In_ DWORD filter)
+{
+    if (filter > ShowConflictItems)
+    {
+        return E_INVALIDARG;
+    }
+
+    m_filter = filter;
+    return S_OK;
+}
+
+IFACEMETHODIMP CPowerRenameManager::GetVisibleItemCount(_Out_ UINT* count)
+{
+    *count = m_filters.Count(static_cast<PowerRenameFilter>(m_filter));
+    return S_OK;
+}
+
+IFACEMETHODIMP CPowerRenameManager::GetVisibleItemByIndex(_In_ UINT index, _COM_Outptr_ IPowerRenameItem** ppItem)
+{
+    *ppItem = nullptr;
+    int id = 0;
+    if (!m_filters.GetId(static_cast<PowerRenameFilter>(m_filter), index, &id))
+    {
+        return E_FAIL;
+    }
+
+    return GetItemById(id, ppItem);
+}
+
+IFACEMETHODIMP CPowerRenameManager::SetItemSelected(_In_ IPowerRenameItem* pItem, _In_ bool selected)
+{
+    int id = 0;
+    HRESULT hr = pItem->get_id(&id);
+    if (SUCCEEDED(hr))
+    {
+        hr = pItem->put_selected(selected);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        m_filters.SetMember(id, ShowSelectedItems, selected);
+    }
+
+    return hr;
+}
+
 IFACEMETHODIMP CPowerRenameManager::get_flags(_Out_ DWORD* flags)
 {
     _EnsureRegEx();
@@ -308,33 +496,38 @@ HRESULT CPowerRenameManager::s_CreateInstance(_Outptr_ IPowerRenameManager** pps
 CPowerRenameManager::CPowerRenameManager() :
     m_refCount(1)
 {
-    InitializeCriticalSection(&m_critsecReentrancy);
 }
 
 CPowerRenameManager::~CPowerRenameManager()
 {
-    DeleteCriticalSection(&m_critsecReentrancy);
+    // The worker doesn't hold a reference, it has to be gone before the manager is
+    _StopRegExWorkerThread();
 }
 
 HRESULT CPowerRenameManager::_Init()
 {
     // Guaranteed to succeed
     m_startFileOpWorkerEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
-    m_startRegExWorkerEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
-    m_cancelRegExWorkerEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    m_regExRequestEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    m_regExIdleEvent = CreateEvent(nullptr, TRUE, TRUE, nullptr);
 
     m_hwndMessage = CreateMsgWindow(g_hInst, s_msgWndProc, this);
 
+    m_collisionIndex.SetConflictCallback([this](int id, bool conflict) {
+        m_filters.SetMember(id, ShowConflictItems, conflict);
+    });
+
     return S_OK;
 }
 
 // Custom messages for worker threads
 enum
 {
+    // The regex messages carry the generation of their request in wParam
     SRM_REGEX_ITEM_UPDATED = (WM_APP + 1),  // Single rename item processed by regex worker thread
     SRM_REGEX_STARTED,                      // RegEx operation was started
     SRM_REGEX_CANCELED,                     // Regex operation was canceled
-    SRM_REGEX_COMPLETE,                     // Regex worker thread completed
+    SRM_REGEX_COMPLETE,                     // Regex operation completed
     SRM_FILEOP_COMPLETE                     // File Operation worker thread completed
 };
 
@@ -342,9 +535,11 @@ struct WorkerThreadData
 {
     HWND hwndManager = nullptr;
     HANDLE startEvent = nullptr;
-    HANDLE cancelEvent = nullptr;
     HWND hwndParent = nullptr;
+    bool directRename = false;
     CComPtr<IPowerRenameManager> spsrm;
+    // Snapshot of the items, taken by the manager thread for the file operation worker
+    std::vector<CComPtr<IPowerRenameItem>> items;
 };
 
 // Msg-only worker window proc for communication from our worker threads
@@ -381,6 +576,14 @@ LRESULT CPowerRenameManager::_WndProc(_In_ HWND hwnd, _In_ UINT msg, _In_ WPARAM
     case SRM_REGEX_ITEM_UPDATED:
     {
         int id = static_cast<int>(lParam);
+        if (static_cast<DWORD>(wParam) != m_regExGeneration)
+        {
+            // From a request that was superseded, reported once the current one completes
+            m_staleUpdateIds.insert(id);
+            break;
+        }
+
+        m_staleUpdateIds.erase(id);
         CComPtr<IPowerRenameItem> spItem;
         if (SUCCEEDED(GetItemById(id, &spItem)))
         {
@@ -388,16 +591,44 @@ LRESULT CPowerRenameManager::_WndProc(_In_ HWND hwnd, _In_ UINT msg, _In_ WPARAM
         }
         break;
     }
+    // Only the current request is reported as started, the others have already been superseded.
+    // A request reported as started is always reported as canceled or completed afterwards. It is
+    // canceled once superseded, so its end is matched with the reported start, not the generation.
     case SRM_REGEX_STARTED:
-        _OnRegExStarted(static_cast<DWORD>(wParam));
+        if (static_cast<DWORD>(wParam) == m_regExGeneration)
+        {
+            m_reportedRegExId = static_cast<DWORD>(wParam);
+            _OnRegExStarted(m_reportedRegExId);
+        }
         break;
 
     case SRM_REGEX_CANCELED:
-        _OnRegExCanceled(static_cast<DWORD>(wParam));
+        if (static_cast<DWORD>(wParam) == m_reportedRegExId)
+        {
+            m_reportedRegExId = 0;
+            _OnRegExCanceled(static_cast<DWORD>(wParam));
+        }
         break;
 
     case SRM_REGEX_COMPLETE:
-        _OnRegExCompleted(static_cast<DWORD>(wParam));
+        if (static_cast<DWORD>(wParam) == m_regExGeneration)
+        {
+            m_reportedRegExId = 0;
+            _OnStaleUpdates();
+            _OnRegExCompleted(static_cast<DWORD>(wParam));
+
+            if (m_renamePending)
+            {
+                m_renamePending = false;
+                _PerformFileOperation();
+            }
+        }
+        else if (static_cast<DWORD>(wParam) == m_reportedRegExId)
+        {
+            // Superseded after it completed, its results are dropped like those of a canceled one
+            m_reportedRegExId = 0;
+            _OnRegExCanceled(static_cast<DWORD>(wParam));
+        }
         break;
 
     default:
@@ -430,8 +661,9 @@ void CPowerRenameManager::_LogOperationTelemetry()
         CComPtr<IPowerRenameItem> spItem;
         if (SUCCEEDED(GetItemByIndex(i, &spItem)))
         {
-            PWSTR originalName;
-            if (SUCCEEDED(spItem->get_originalName(&originalName)))
+            CItemNameReader names(spItem);
+            PCWSTR originalName = names.OriginalName();
+            if (originalName)
             {
                 std::wstring extension = fs::path(originalName).extension().wstring();
                 std::map<std::wstring, int>::iterator it = extensionsMap.find(extension);
@@ -443,8 +675,6 @@ void CPowerRenameManager::_LogOperationTelemetry()
                 {
                     it->second++;
                 }
-
-                CoTaskMemFree(originalName);
             }
         }
     }
@@ -472,9 +702,6 @@ HRESULT CPowerRenameManager::_PerformFileOperation()
 
     _LogOperationTelemetry();
 
-    // Wait for existing regex thread to finish
-    _WaitForRegExWorkerThread();
-
     // Create worker thread which will perform the actual rename
     HRESULT hr = _CreateFileOpWorkerThread();
     if (SUCCEEDED(hr))
@@ -509,6 +736,11 @@ HRESULT CPowerRenameManager::_PerformFileOperation()
             }
         }
 
+        // Renamed items have new original names, the recorded matches and targets no longer apply
+        m_matchCache.Invalidate();
+        m_collisionIndex.Clear();
+        m_filters.ClearFilter(ShowConflictItems);
+
         _OnRenameCompleted();
     }
 
@@ -522,9 +754,18 @@ HRESULT CPowerRenameManager::_CreateFileOpWorkerThread()
     if (SUCCEEDED(hr))
     {
         pwtd->hwndManager = m_hwndMessage;
-        pwtd->startEvent = m_startRegExWorkerEvent;
-        pwtd->cancelEvent = nullptr;
+        pwtd->startEvent = m_startFileOpWorkerEvent;
+        pwtd->hwndParent = m_hwndParent;
+        pwtd->directRename = CSettingsInstance().GetDirectRename();
         pwtd->spsrm = this;
+        {
+            CSRWSharedAutoLock lock(&m_lockItems);
+            pwtd->items.reserve(m_renameItems.size());
+            for (auto it : m_renameItems)
+            {
+                pwtd->items.push_back(it.second);
+            }
+        }
         m_fileOpWorkerThreadHandle = CreateThread(nullptr, 0, s_fileOpWorkerThread, pwtd, 0, nullptr);
         hr = (m_fileOpWorkerThreadHandle) ? S_OK : E_FAIL;
         if (FAILED(hr))
@@ -549,73 +790,119 @@ DWORD WINAPI CPowerRenameManager::s_fileOpWorkerThread(_In_ void* pv)
                 CComPtr<IPowerRenameRegEx> spRenameRegEx;
                 if (SUCCEEDED(pwtd->spsrm->get_renameRegEx(&spRenameRegEx)))
                 {
-                    // Create IFileOperation interface
-                    CComPtr<IFileOperation> spFileOp;
-                    if (SUCCEEDED(CoCreateInstance(CLSID_FileOperation, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&spFileOp))))
+                    DWORD flags = 0;
+                    spRenameRegEx->get_flags(&flags);
+
+                    struct RenameItem
                     {
-                        DWORD flags = 0;
-                        spRenameRegEx->get_flags(&flags);
+                        CComPtr<IPowerRenameItem> item;
+                        UINT depth;
+                    };
 
-                        UINT itemCount = 0;
-                        pwtd->spsrm->GetItemCount(&itemCount);
+                    std::vector<RenameItem> renameItems;
+                    for (const auto& spItem : pwtd->items)
+                    {
+                        bool shouldRename = false;
+                        if (SUCCEEDED(spItem->ShouldRenameItem(flags, &shouldRename)) && shouldRename)
+                        {
+                            UINT depth = 0;
+                            spItem->get_depth(&depth);
+                            renameItems.push_back({ spItem, depth });
+                        }
+                    }
 
-                        // We add the items to the operation in depth-first order.  This allows child items to be
-                        // renamed before parent items.
+                    // We rename the items in depth-first order.  This allows child items to be
+                    // renamed before parent items.
+                    std::stable_sort(renameItems.begin(), renameItems.end(), [](const RenameItem& a, const RenameItem& b) {
+                        return a.depth > b.depth;
+                    });
 
-                        // Creating a vector of vectors of items of the same depth
-                        std::vector<std::vector<UINT>> matrix(itemCount);
+                    bool renamed = false;
+                    if (pwtd->directRename && renameItems.size() >= c_directRenameMinItemCount)
+                    {
+                        std::vector<RenameOperation> operations;
+                        operations.reserve(renameItems.size());
+                        for (const auto& renameItem : renameItems)
+                        {
+                            // The regex worker is done, the names won't change under us
+                            CItemNameReader names(renameItem.item);
+                            PCWSTR path = names.Path();
+                            PCWSTR newName = names.NewName();
+                            if (path && newName)
+                            {
+                                operations.push_back({ path, newName, renameItem.depth });
+                            }
+                        }
 
-                        for (UINT u = 0; u < itemCount; u++)
+                        // Anything the direct rename can't handle (collisions, names Win32 would alter,
+                        // access denied, ...) is left to IFileOperation, which can prompt the user.
+                        if (operations.size() == renameItems.size())
                         {
-                            CComPtr<IPowerRenameItem> spItem;
-                            if (SUCCEEDED(pwtd->spsrm->GetItemByIndex(u, &spItem)))
+                            CPowerRenameExecutor executor(std::move(operations));
+                            HRESULT hr = executor.Plan();
+                            if (SUCCEEDED(hr) && executor.Collisions().empty())
                             {
-                                UINT depth = 0;
-                                spItem->get_depth(&depth);
-                                matrix[depth].push_back(u);
+                                CRenameJournal journal;
+                                hr = executor.Execute(journal);
+                                renamed = SUCCEEDED(hr);
+                                if (FAILED(hr) && !executor.Stats().rolledBack)
+                                {
+                                    // Some items keep their new name, renaming the batch again would
+                                    // rename them twice. Leave the items as they are and tell the user.
+                                    renamed = true;
+                                    ReportDirectRenameFailure(pwtd->hwndParent, hr);
+                                }
+
+                                if (journal.Count() > 0)
+                                {
+                                    NotifyDirectoriesChanged(journal.Directories());
+                                    journal.Save(GetRenameJournalPath());
+                                }
                             }
+
+                            Trace::DirectRenameOperation(executor.Stats(), executor.Collisions().size(), hr);
                         }
+                    }
+
+                    if (!renamed)
+                    {
+                        // Explorer undoes this rename, the journal of an older direct rename would
+                        // undo the renames done before it
+                        DeleteFileW(GetRenameJournalPath().c_str());
 
-                        // From the greatest depth first, add all items of that depth to the operation
-                        for (LONG v = itemCount - 1; v >= 0; v--)
+                        // Create IFileOperation interface
+                        CComPtr<IFileOperation> spFileOp;
+                        if (SUCCEEDED(CoCreateInstance(CLSID_FileOperation, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&spFileOp))))
                         {
-                            for (auto it : matrix[v])
+                            for (const auto& renameItem : renameItems)
                             {
-                                CComPtr<IPowerRenameItem> spItem;
-                                if (SUCCEEDED(pwtd->spsrm->GetItemByIndex(it, &spItem)))
+                                CItemNameReader names(renameItem.item);
+                                PCWSTR newName = names.NewName();
+                                if (newName)
                                 {
-                                    bool shouldRename = false;
-                                    if (SUCCEEDED(spItem->ShouldRenameItem(flags, &shouldRename)) && shouldRename)
+                                    CComPtr<IShellItem> spShellItem;
+                                    if (SUCCEEDED(renameItem.item->get_shellItem(&spShellItem)))
                                     {
-                                        PWSTR newName = nullptr;
-                                        if (SUCCEEDED(spItem->get_newName(&newName)))
-                                        {
-                                            CComPtr<IShellItem> spShellItem;
-                                            if (SUCCEEDED(spItem->get_shellItem(&spShellItem)))
-                                            {
-                                                spFileOp->RenameItem(spShellItem, newName, nullptr);
-                                            }
-                                            CoTaskMemFree(newName);
-                                        }
+                                        spFileOp->RenameItem(spShellItem, newName, nullptr);
                                     }
                                 }
                             }
-                        }
 
-                        // Set the operation flags
-                        if (SUCCEEDED(spFileOp->SetOperationFlags(FOF_DEFAULTFLAGS)))
-                        {
-                            // Set the parent window
-                            if (pwtd->hwndParent)
+                            // Set the operation flags
+                            if (SUCCEEDED(spFileOp->SetOperationFlags(FOF_DEFAULTFLAGS)))
                             {
-                                spFileOp->SetOwnerWindow(pwtd->hwndParent);
+                                // Set the parent window
+                                if (pwtd->hwndParent)
+                                {
+                                    spFileOp->SetOwnerWindow(pwtd->hwndParent);
+                                }
+
+                                // Perform the operation
+                                // We don't care about the return code here. We would rather
+                                // return control back to explorer so the user can cleanly
+                                // undo the operation if it failed halfway through.
+                                spFileOp->PerformOperations();
                             }
-                            
-                            // Perform the operation
-                            // We don't care about the return code here. We would rather
-                            // return control back to explorer so the user can cleanly
-                            // undo the operation if it failed halfway through.
-                            spFileOp->PerformOperations();
                         }
                     }
                 }
@@ -634,248 +921,299 @@ DWORD WINAPI CPowerRenameManager::s_fileOpWorkerThread(_In_ void* pv)
 
 HRESULT CPowerRenameManager::_PerformRegExRename()
 {
-    HRESULT hr = E_FAIL;
-
-    if (!TryEnterCriticalSection(&m_critsecReentrancy))
+    // Never waits for the worker, a pass still previewing an older request stops at its next
+    // chunk and its results are dropped by generation
+    HRESULT hr = m_regExWorkerThreadHandle ? S_OK : _CreateRegExWorkerThread();
+    if (SUCCEEDED(hr))
     {
-        // Ensure we do not re-enter since we pump messages here.
-        // TODO: If we do, post a message back to ourselves
+        CSRWExclusiveAutoLock lock(&m_lockRegExRequests);
+        m_regExRequests.push_back(++m_regExGeneration);
+        ResetEvent(m_regExIdleEvent);
+        SetEvent(m_regExRequestEvent);
     }
-    else
-    {
-        // Ensure previous thread is canceled
-        _CancelRegExWorkerThread();
 
-        // Create worker thread which will message us progress and completion.
-        hr = _CreateRegExWorkerThread();
-        if (SUCCEEDED(hr))
-        {
-            ResetEvent(m_cancelRegExWorkerEvent);
+    return hr;
+}
 
-            // Signal the worker thread that they can start working. We needed to wait until we
-            // were ready to process thread messages.
-            SetEvent(m_startRegExWorkerEvent);
-        }
+HRESULT CPowerRenameManager::_CreateRegExWorkerThread()
+{
+    m_regExWorkerStopping = false;
+    m_regExWorkerThreadHandle = CreateThread(nullptr, 0, s_regexWorkerThread, this, 0, nullptr);
+    return (m_regExWorkerThreadHandle) ? S_OK : E_FAIL;
+}
+
+DWORD WINAPI CPowerRenameManager::s_regexWorkerThread(_In_ void* pv)
+{
+    if (SUCCEEDED(CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE)))
+    {
+        CPowerRenameManager* pThis = reinterpret_cast<CPowerRenameManager*>(pv);
+        pThis->_RegExWorker();
+        CoUninitialize();
     }
 
-    return hr;
+    return 0;
 }
 
-HRESULT CPowerRenameManager::_CreateRegExWorkerThread()
+void CPowerRenameManager::_RegExWorker()
 {
-    WorkerThreadData* pwtd = new WorkerThreadData;
-    HRESULT hr = pwtd ? S_OK : E_OUTOFMEMORY;
-    if (SUCCEEDED(hr))
+    while (WaitForSingleObject(m_regExRequestEvent, INFINITE) == WAIT_OBJECT_0 && !m_regExWorkerStopping)
     {
-        pwtd->hwndManager = m_hwndMessage;
-        pwtd->startEvent = m_startRegExWorkerEvent;
-        pwtd->cancelEvent = m_cancelRegExWorkerEvent;
-        pwtd->hwndParent = m_hwndParent;
-        pwtd->spsrm = this;
-        m_regExWorkerThreadHandle = CreateThread(nullptr, 0, s_regexWorkerThread, pwtd, 0, nullptr);
-        hr = (m_regExWorkerThreadHandle) ? S_OK : E_FAIL;
-        if (FAILED(hr))
+        DWORD generation = 0;
         {
-            delete pwtd;
+            CSRWExclusiveAutoLock lock(&m_lockRegExRequests);
+            if (m_regExRequests.empty())
+            {
+                continue;
+            }
+
+            // Only the newest request is previewed, the ones queued before it are stale
+            generation = m_regExRequests.back();
+            m_regExRequests.clear();
         }
-    }
 
-    return hr;
+        PostMessage(m_hwndMessage, SRM_REGEX_STARTED, generation, 0);
+        const bool completed = _RegExWorkerPass(generation);
+        PostMessage(m_hwndMessage, completed ? SRM_REGEX_COMPLETE : SRM_REGEX_CANCELED, generation, 0);
+
+        CSRWExclusiveAutoLock lock(&m_lockRegExRequests);
+        if (m_regExRequests.empty())
+        {
+            SetEvent(m_regExIdleEvent);
+        }
+    }
 }
 
-DWORD WINAPI CPowerRenameManager::s_regexWorkerThread(_In_ void* pv)
+bool CPowerRenameManager::_RegExWorkerPass(_In_ DWORD generation)
 {
-    if (SUCCEEDED(CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE)))
+    bool canceled = false;
+    CComPtr<IPowerRenameRegEx> spRenameRegEx;
+    if (SUCCEEDED(get_renameRegEx(&spRenameRegEx)))
     {
-        WorkerThreadData* pwtd = reinterpret_cast<WorkerThreadData*>(pv);
-        if (pwtd)
+        DWORD flags = 0;
+        spRenameRegEx->get_flags(&flags);
+
+        PWSTR searchTerm = nullptr;
+        spRenameRegEx->get_searchTerm(&searchTerm);
+
+        UINT itemCount = 0;
+        unsigned long itemEnumIndex = 1;
+        GetItemCount(&itemCount);
+
+        // Items the cache knows can't match the search term keep an empty new name and aren't visited
+        CPowerRenameMatchCache::Pass pass = m_matchCache.BeginPass(searchTerm, flags, itemCount);
+        CoTaskMemFree(searchTerm);
+
+        // New names from two passes ago are released, the ones from the last pass are
+        // kept to tell which items changed
+        CComPtr<IPowerRenameItemFactory> spItemFactory;
+        CComPtr<IPowerRenameItemFactory2> spItemFactory2;
+        if (SUCCEEDED(get_renameItemFactory(&spItemFactory)) && SUCCEEDED(spItemFactory->QueryInterface(IID_PPV_ARGS(&spItemFactory2))))
         {
-            PostMessage(pwtd->hwndManager, SRM_REGEX_STARTED, GetCurrentThreadId(), 0);
+            spItemFactory2->BeginNamePass();
+        }
 
-            // Wait to be told we can begin
-            if (WaitForSingleObject(pwtd->startEvent, INFINITE) == WAIT_OBJECT_0)
+        std::vector<int> matches;
+        const UINT visitCount = pass.incremental ? static_cast<UINT>(pass.ids.size()) : itemCount;
+        for (UINT u = 0; u < visitCount; u++)
+        {
+            // Cooperative cancellation, a newer request supersedes this one
+            if (u % c_regExChunkSize == 0 && generation != m_regExGeneration)
             {
-                CComPtr<IPowerRenameRegEx> spRenameRegEx;
-                if (SUCCEEDED(pwtd->spsrm->get_renameRegEx(&spRenameRegEx)))
-                {
-                    DWORD flags = 0;
-                    spRenameRegEx->get_flags(&flags);
+                canceled = true;
+                break;
+            }
 
-                    UINT itemCount = 0;
-                    unsigned long itemEnumIndex = 1;
-                    pwtd->spsrm->GetItemCount(&itemCount);
-                    for (UINT u = 0; u <= itemCount; u++)
+            CComPtr<IPowerRenameItem> spItem;
+            HRESULT hrItem = pass.incremental ? GetItemById(pass.ids[u], &spItem) : GetItemByIndex(u, &spItem);
+            if (SUCCEEDED(hrItem))
+            {
+                int id = -1;
+                spItem->get_id(&id);
+
+                CItemNameReader names(spItem);
+                PCWSTR path = names.Path();
+
+                bool isFolder = false;
+                bool isSubFolderContent = false;
+                spItem->get_isFolder(&isFolder);
+                spItem->get_isSubFolderContent(&isSubFolderContent);
+                if ((isFolder && (flags & PowerRenameFlags::ExcludeFolders)) ||
+                    (!isFolder && (flags & PowerRenameFlags::ExcludeFiles)) ||
+                    (isSubFolderContent && (flags & PowerRenameFlags::ExcludeSubfolders)))
+                {
+                    // Exclude this item from renaming.  Ensure new name is cleared.
+                    spItem->put_newName(nullptr);
+                    m_matchCache.SetNamed(id, false);
+                    m_filters.SetMember(id, ShowChangedItems, false);
+                    if (path)
                     {
-                        // Check if cancel event is signaled
-                        if (WaitForSingleObject(pwtd->cancelEvent, 0) == WAIT_OBJECT_0)
-                        {
-                            // Canceled from manager
-                            // Send the manager thread the canceled message
-                            PostMessage(pwtd->hwndManager, SRM_REGEX_CANCELED, GetCurrentThreadId(), 0);
-                            break;
-                        }
-
-                        CComPtr<IPowerRenameItem> spItem;
-                        if (SUCCEEDED(pwtd->spsrm->GetItemByIndex(u, &spItem)))
-                        {
-                            int id = -1;
-                            spItem->get_id(&id);
-
-                            bool isFolder = false;
-                            bool isSubFolderContent = false;
-                            spItem->get_isFolder(&isFolder);
-                            spItem->get_isSubFolderContent(&isSubFolderContent);
-                            if ((isFolder && (flags & PowerRenameFlags::ExcludeFolders)) ||
-                                (!isFolder && (flags & PowerRenameFlags::ExcludeFiles)) ||
-                                (isSubFolderContent && (flags & PowerRenameFlags::ExcludeSubfolders)))
-                            {
-                                // Exclude this item from renaming.  Ensure new name is cleared.
-                                spItem->put_newName(nullptr);
+                        m_collisionIndex.SetTarget(id, path, nullptr);
+                    }
 
-                                // Send the manager thread the item processed message
-                                PostMessage(pwtd->hwndManager, SRM_REGEX_ITEM_UPDATED, GetCurrentThreadId(), id);
+                    // Send the manager thread the item processed message
+                    PostMessage(m_hwndMessage, SRM_REGEX_ITEM_UPDATED, generation, id);
 
-                                continue;
-                            }
+                    continue;
+                }
 
-                            PWSTR originalName = nullptr;
-                            if (SUCCEEDED(spItem->get_originalName(&originalName)))
-                            {
-                                PWSTR currentNewName = nullptr;
-                                spItem->get_newName(&currentNewName);
+                // Views are safe here, this thread is the only one setting new names
+                PCWSTR originalName = names.OriginalName();
+                if (originalName)
+                {
+                    PCWSTR currentNewName = names.NewName();
 
-                                wchar_t sourceName[MAX_PATH] = { 0 };
-                                if (flags & NameOnly)
-                                {
-                                    StringCchCopy(sourceName, ARRAYSIZE(sourceName), fs::path(originalName).stem().c_str());
-                                }
-                                else if (flags & ExtensionOnly)
-                                {
-                                    std::wstring extension = fs::path(originalName).extension().wstring();
-                                    if (!extension.empty() && extension.front() == '.')
-                                    {
-                                        extension = extension.erase(0, 1);
-                                    }
-                                    StringCchCopy(sourceName, ARRAYSIZE(sourceName), extension.c_str());
-                                }
-                                else
-                                {
-                                    StringCchCopy(sourceName, ARRAYSIZE(sourceName), originalName);
-                                }
+                    wchar_t sourceName[MAX_PATH] = { 0 };
+                    if (flags & NameOnly)
+                    {
+                        StringCchCopy(sourceName, ARRAYSIZE(sourceName), fs::path(originalName).stem().c_str());
+                    }
+                    else if (flags & ExtensionOnly)
+                    {
+                        std::wstring extension = fs::path(originalName).extension().wstring();
+                        if (!extension.empty() && extension.front() == '.')
+                        {
+                            extension = extension.erase(0, 1);
+                        }
+                        StringCchCopy(sourceName, ARRAYSIZE(sourceName), extension.c_str());
+                    }
+                    else
+                    {
+                        StringCchCopy(sourceName, ARRAYSIZE(sourceName), originalName);
+                    }
 
+                    if (CPowerRenameMatchCache::IsMatch(pass, sourceName))
+                    {
+                        matches.push_back(id);
+                    }
 
-                                PWSTR newName = nullptr;
-                                // Failure here means we didn't match anything or had nothing to match
-                                // Call put_newName with null in that case to reset it
-                                spRenameRegEx->Replace(sourceName, &newName);
+                    PWSTR newName = nullptr;
+                    // Failure here means we didn't match anything or had nothing to match
+                    // Call put_newName with null in that case to reset it
+                    spRenameRegEx->Replace(sourceName, &newName);
 
-                                wchar_t resultName[MAX_PATH] = { 0 };
+                    wchar_t resultName[MAX_PATH] = { 0 };
 
-                                PWSTR newNameToUse = nullptr;
+                    PWSTR newNameToUse = nullptr;
 
-                                // newName == nullptr likely means we have an empty search string.  We should leave newNameToUse
-                                // as nullptr so we clear the renamed column
-                                if (newName != nullptr)
-                                {
-                                    newNameToUse = resultName;
-                                    if (flags & NameOnly)
-                                    {
-                                        StringCchPrintf(resultName, ARRAYSIZE(resultName), L"%s%s", newName, fs::path(originalName).extension().c_str());
-                                    }
-                                    else if (flags & ExtensionOnly)
-                                    {
-                                        std::wstring extension = fs::path(originalName).extension().wstring();
-                                        if (!extension.empty())
-                                        {
-                                            StringCchPrintf(resultName, ARRAYSIZE(resultName), L"%s.%s", fs::path(originalName).stem().c_str(), newName);
-                                        }
-                                        else
-                                        {
-                                            StringCchCopy(resultName, ARRAYSIZE(resultName), originalName);
-                                        }
-                                    }
-                                    else
-                                    {
-                                        StringCchCopy(resultName, ARRAYSIZE(resultName), newName);
-                                    }
-                                }
-                                
-                                // No change from originalName so set newName to
-                                // null so we clear it from our UI as well.
-                                if (lstrcmp(originalName, newNameToUse) == 0)
-                                {
-                                    newNameToUse = nullptr;
-                                }
+                    // newName == nullptr likely means we have an empty search string.  We should leave newNameToUse
+                    // as nullptr so we clear the renamed column
+                    if (newName != nullptr)
+                    {
+                        newNameToUse = resultName;
+                        if (flags & NameOnly)
+                        {
+                            StringCchPrintf(resultName, ARRAYSIZE(resultName), L"%s%s", newName, fs::path(originalName).extension().c_str());
+                        }
+                        else if (flags & ExtensionOnly)
+                        {
+                            std::wstring extension = fs::path(originalName).extension().wstring();
+                            if (!extension.empty())
+                            {
+                                StringCchPrintf(resultName, ARRAYSIZE(resultName), L"%s.%s", fs::path(originalName).stem().c_str(), newName);
+                            }
+                            else
+                            {
+                                StringCchCopy(resultName, ARRAYSIZE(resultName), originalName);
+                            }
+                        }
+                        else
+                        {
+                            StringCchCopy(resultName, ARRAYSIZE(resultName), newName);
+                        }
+                    }
+                    
+                    // No change from originalName so set newName to
+                    // null so we clear it from our UI as well.
+                    if (lstrcmp(originalName, newNameToUse) == 0)
+                    {
+                        newNameToUse = nullptr;
+                    }
 
-                                wchar_t uniqueName[MAX_PATH] = { 0 };
-                                if (newNameToUse != nullptr && (flags & EnumerateItems))
-                                {
-                                    unsigned long countUsed = 0;
-                                    if (GetEnumeratedFileName(uniqueName, ARRAYSIZE(uniqueName), newNameToUse, nullptr, itemEnumIndex, &countUsed))
-                                    {
-                                        newNameToUse = uniqueName;
-                                    }
-                                    itemEnumIndex++;
-                                }
+                    // The collision index knows which numbers are taken in the folder
+                    std::wstring uniqueName;
+                    if (newNameToUse != nullptr && (flags & EnumerateItems))
+                    {
+                        if (path && m_collisionIndex.GetEnumeratedName(id, path, newNameToUse, itemEnumIndex, uniqueName))
+                        {
+                            newNameToUse = uniqueName.data();
+                        }
+                        itemEnumIndex++;
+                    }
 
-                                spItem->put_newName(newNameToUse);
+                    // Was there a change? Checked first since the view may not outlive put_newName
+                    const bool changed = lstrcmp(currentNewName, newNameToUse) != 0;
 
-                                // Was there a change?
-                                if (lstrcmp(currentNewName, newNameToUse) != 0)
-                                {
-                                    // Send the manager thread the item processed message
-                                    PostMessage(pwtd->hwndManager, SRM_REGEX_ITEM_UPDATED, GetCurrentThreadId(), id);
-                                }
+                    spItem->put_newName(newNameToUse);
+                    m_matchCache.SetNamed(id, newNameToUse != nullptr);
+                    m_filters.SetMember(id, ShowChangedItems, newNameToUse != nullptr);
+                    if (path)
+                    {
+                        m_collisionIndex.SetTarget(id, path, newNameToUse);
+                    }
 
-                                CoTaskMemFree(newName);
-                                CoTaskMemFree(currentNewName);
-                                CoTaskMemFree(originalName);
-                            }
-                        }
+                    if (changed)
+                    {
+                        // Send the manager thread the item processed message
+                        PostMessage(m_hwndMessage, SRM_REGEX_ITEM_UPDATED, generation, id);
                     }
+
+                    CoTaskMemFree(newName);
                 }
             }
+        }
 
-            // Send the manager thread the completion message
-            PostMessage(pwtd->hwndManager, SRM_REGEX_COMPLETE, GetCurrentThreadId(), 0);
+        m_previewStats.passCount++;
+        if (canceled)
+        {
+            m_previewStats.canceledCount++;
+        }
+        else
+        {
+            m_previewStats.itemCount += visitCount;
+            SIZE_T nameBytes = 0;
+            if (spItemFactory2 && SUCCEEDED(spItemFactory2->get_namePassBytes(&nameBytes)))
+            {
+                m_previewStats.peakNameBytes = std::max(m_previewStats.peakNameBytes, nameBytes);
+            }
 
-            delete pwtd;
+            m_matchCache.CompletePass(pass, std::move(matches));
         }
-        CoUninitialize();
     }
 
-    return 0;
+    return !canceled;
 }
 
-void CPowerRenameManager::_CancelRegExWorkerThread()
+void CPowerRenameManager::_StopRegExWorkerThread()
 {
-    if (m_startRegExWorkerEvent)
+    if (m_regExWorkerThreadHandle)
     {
-        SetEvent(m_startRegExWorkerEvent);
-    }
+        // Bumping the generation stops a running pass at its next chunk
+        m_regExWorkerStopping = true;
+        m_regExGeneration++;
+        SetEvent(m_regExRequestEvent);
 
-    if (m_cancelRegExWorkerEvent)
-    {
-        SetEvent(m_cancelRegExWorkerEvent);
+        WaitForSingleObject(m_regExWorkerThreadHandle, INFINITE);
+        CloseHandle(m_regExWorkerThreadHandle);
+        m_regExWorkerThreadHandle = nullptr;
     }
-
-    _WaitForRegExWorkerThread();
 }
 
-void CPowerRenameManager::_WaitForRegExWorkerThread()
+bool CPowerRenameManager::_IsRegExWorkerIdle()
 {
-    if (m_regExWorkerThreadHandle)
+    if (!m_regExWorkerThreadHandle)
     {
-        WaitForSingleObject(m_regExWorkerThreadHandle, INFINITE);
-        CloseHandle(m_regExWorkerThreadHandle);
-        m_regExWorkerThreadHandle = nullptr;
+        return true;
     }
+
+    // The thread handle too, in case the worker couldn't start
+    HANDLE handles[] = { m_regExIdleEvent, m_regExWorkerThreadHandle };
+    return WaitForMultipleObjects(ARRAYSIZE(handles), handles, FALSE, 0) != WAIT_TIMEOUT;
 }
 
 void CPowerRenameManager::_Cancel()
 {
     SetEvent(m_startFileOpWorkerEvent);
-    _CancelRegExWorkerThread();
+    _StopRegExWorkerThread();
 }
 
 HRESULT CPowerRenameManager::_EnsureRegEx()
@@ -957,7 +1295,22 @@ void CPowerRenameManager::_OnError(_In_ IPowerRenameItem* renameItem)
     }
 }
 
-void CPowerRenameManager::_OnRegExStarted(_In_ DWORD threadId)
+void CPowerRenameManager::_OnStaleUpdates()
+{
+    // Items updated by superseded requests, the current one may have left them as they were
+    std::set<int> ids;
+    ids.swap(m_staleUpdateIds);
+    for (int id : ids)
+    {
+        CComPtr<IPowerRenameItem> spItem;
+        if (SUCCEEDED(GetItemById(id, &spItem)))
+        {
+            _OnUpdate(spItem);
+        }
+    }
+}
+
+void CPowerRenameManager::_OnRegExStarted(_In_ DWORD regExId)
 {
     CSRWSharedAutoLock lock(&m_lockEvents);
 
@@ -965,12 +1318,12 @@ void CPowerRenameManager::_OnRegExStarted(_In_ DWORD threadId)
     {
         if (it.pEvents)
         {
-            it.pEvents->OnRegExStarted(threadId);
+            it.pEvents->OnRegExStarted(regExId);
         }
     }
 }
 
-void CPowerRenameManager::_OnRegExCanceled(_In_ DWORD threadId)
+void CPowerRenameManager::_OnRegExCanceled(_In_ DWORD regExId)
 {
     CSRWSharedAutoLock lock(&m_lockEvents);
 
@@ -978,12 +1331,12 @@ void CPowerRenameManager::_OnRegExCanceled(_In_ DWORD threadId)
     {
         if (it.pEvents)
         {
-            it.pEvents->OnRegExCanceled(threadId);
+            it.pEvents->OnRegExCanceled(regExId);
         }
     }
 }
 
-void CPowerRenameManager::_OnRegExCompleted(_In_ DWORD threadId)
+void CPowerRenameManager::_OnRegExCompleted(_In_ DWORD regExId)
 {
     CSRWSharedAutoLock lock(&m_lockEvents);
 
@@ -991,7 +1344,7 @@ void CPowerRenameManager::_OnRegExCompleted(_In_ DWORD threadId)
     {
         if (it.pEvents)
         {
-            it.pEvents->OnRegExCompleted(threadId);
+            it.pEvents->OnRegExCompleted(regExId);
         }
     }
 }
@@ -1056,10 +1409,26 @@ void CPowerRenameManager::_ClearPowerRenameItems()
     }
 
     m_renameItems.clear();
+    m_matchCache.Clear();
+    m_collisionIndex.Clear();
+    m_filters.Clear();
+    m_staleUpdateIds.clear();
+    m_reportedRegExId = 0;
+    m_renamePending = false;
 }
 
 void CPowerRenameManager::_Cleanup()
 {
+    // Stopped first, it posts to the message window
+    _StopRegExWorkerThread();
+
+    // One event per session, the previews run on every change of the search term
+    if (m_previewStats.passCount > 0)
+    {
+        Trace::PreviewSession(m_previewStats.passCount, m_previewStats.canceledCount, m_previewStats.itemCount, m_previewStats.peakNameBytes);
+        m_previewStats = {};
+    }
+
     if (m_hwndMessage)
     {
         DestroyWindow(m_hwndMessage);
@@ -1069,11 +1438,11 @@ void CPowerRenameManager::_Cleanup()
     CloseHandle(m_startFileOpWorkerEvent);
     m_startFileOpWorkerEvent = nullptr;
 
-    CloseHandle(m_startRegExWorkerEvent);
-    m_startRegExWorkerEvent = nullptr;
+    CloseHandle(m_regExRequestEvent);
+    m_regExRequestEvent = nullptr;
 
-    CloseHandle(m_cancelRegExWorkerEvent);
-    m_cancelRegExWorkerEvent = nullptr;
+    CloseHandle(m_regExIdleEvent);
+    m_regExIdleEvent = nullptr;
 
     _ClearRegEx();
     _ClearEventHandlers();
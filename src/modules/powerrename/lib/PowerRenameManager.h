@@ -1,7 +1,13 @@
 #pragma once
+#include <atomic>
+#include <deque>
 #include <vector>
 #include <map>
+#include <set>
 #include "srwlock.h"
+#include "PowerRenameCollisionIndex.h"
+#include "PowerRenameItemFilters.h"
+#include "PowerRenameMatchCache.h"
 
 #include <lib/PowerRenameManager.h>
 #include <lib/PowerRenameInterfaces.h>
@@ -24,12 +30,20 @@ public:
     IFACEMETHODIMP Reset();
     IFACEMETHODIMP Shutdown();
     IFACEMETHODIMP Rename(_In_ HWND hwndParent);
+    IFACEMETHODIMP UndoLastRename();
     IFACEMETHODIMP AddItem(_In_ IPowerRenameItem* pItem);
     IFACEMETHODIMP GetItemByIndex(_In_ UINT index, _COM_Outptr_ IPowerRenameItem** ppItem);
     IFACEMETHODIMP GetItemById(_In_ int id, _COM_Outptr_ IPowerRenameItem** ppItem);
     IFACEMETHODIMP GetItemCount(_Out_ UINT* count);
     IFACEMETHODIMP GetSelectedItemCount(_Out_ UINT* count);
     IFACEMETHODIMP GetRenameItemCount(_Out_ UINT* count);
+    IFACEMETHODIMP GetConflictCount(_Out_ UINT* count);
+    IFACEMETHODIMP GetItemConflict(_In_ int id, _Out_ bool* conflict);
+    IFACEMETHODIMP get_filter(_Out_ DWORD* filter);
+    IFACEMETHODIMP put_filter(_In_ DWORD filter);
+    IFACEMETHODIMP GetVisibleItemCount(_Out_ UINT* count);
+    IFACEMETHODIMP GetVisibleItemByIndex(_In_ UINT index, _COM_Outptr_ IPowerRenameItem** ppItem);
+    IFACEMETHODIMP SetItemSelected(_In_ IPowerRenameItem* pItem, _In_ bool selected);
     IFACEMETHODIMP get_flags(_Out_ DWORD* flags);
     IFACEMETHODIMP put_flags(_In_ DWORD flags);
     IFACEMETHODIMP get_renameRegEx(_COM_Outptr_ IPowerRenameRegEx** ppRegEx);
@@ -56,9 +70,10 @@ protected:
     void _OnItemAdded(_In_ IPowerRenameItem* renameItem);
     void _OnUpdate(_In_ IPowerRenameItem* renameItem);
     void _OnError(_In_ IPowerRenameItem* renameItem);
-    void _OnRegExStarted(_In_ DWORD threadId);
-    void _OnRegExCanceled(_In_ DWORD threadId);
-    void _OnRegExCompleted(_In_ DWORD threadId);
+    void _OnStaleUpdates();
+    void _OnRegExStarted(_In_ DWORD regExId);
+    void _OnRegExCanceled(_In_ DWORD regExId);
+    void _OnRegExCompleted(_In_ DWORD regExId);
     void _OnRenameStarted();
     void _OnRenameCompleted();
 
@@ -69,16 +84,20 @@ protected:
     HRESULT _PerformFileOperation();
 
     HRESULT _CreateRegExWorkerThread();
-    void _CancelRegExWorkerThread();
-    void _WaitForRegExWorkerThread();
+    void _StopRegExWorkerThread();
+    bool _IsRegExWorkerIdle();
     HRESULT _CreateFileOpWorkerThread();
 
     HRESULT _EnsureRegEx();
     HRESULT _InitRegEx();
     void _ClearRegEx();
 
-    // Thread proc for performing the regex rename of each item
+    // Thread proc of the regex worker, which lives as long as the manager and previews the
+    // requests queued by _PerformRegExRename
     static DWORD WINAPI s_regexWorkerThread(_In_ void* pv);
+    void _RegExWorker();
+    // Performs the regex rename of each item, returns false if a newer request superseded it
+    bool _RegExWorkerPass(_In_ DWORD generation);
     // Thread proc for performing the actual file operation that does the file rename
     static DWORD WINAPI s_fileOpWorkerThread(_In_ void* pv);
 
@@ -88,16 +107,20 @@ protected:
     void _LogOperationTelemetry();
 
     HANDLE m_regExWorkerThreadHandle = nullptr;
-    HANDLE m_startRegExWorkerEvent = nullptr;
-    HANDLE m_cancelRegExWorkerEvent = nullptr;
+    // Auto reset, signaled when a request is queued or the worker has to stop
+    HANDLE m_regExRequestEvent = nullptr;
+    // Manual reset, signaled while the worker has no request left
+    HANDLE m_regExIdleEvent = nullptr;
 
     HANDLE m_fileOpWorkerThreadHandle = nullptr;
     HANDLE m_startFileOpWorkerEvent = nullptr;
 
     CSRWLock m_lockEvents;
     CSRWLock m_lockItems;
+    CSRWLock m_lockRegExRequests;
 
     DWORD m_flags = 0;
+    DWORD m_filter = ShowAllItems;
 
     DWORD m_cookie = 0;
     DWORD m_regExAdviseCookie = 0;
@@ -113,13 +136,40 @@ protected:
 
     _Guarded_by_(m_lockEvents) std::vector<RENAME_MGR_EVENT> m_powerRenameManagerEvents;
     _Guarded_by_(m_lockItems) std::map<int, IPowerRenameItem*> m_renameItems;
+    // Generations of the requests the worker hasn't picked up yet
+    _Guarded_by_(m_lockRegExRequests) std::deque<DWORD> m_regExRequests;
+
+    // Generation of the newest request, results of older ones are dropped
+    std::atomic<DWORD> m_regExGeneration = 0;
+    std::atomic<bool> m_regExWorkerStopping = false;
+    // Items whose updates came from superseded requests, only used by the manager thread
+    std::set<int> m_staleUpdateIds;
+    // Request whose start was reported and whose end hasn't been yet, only used by the manager thread
+    DWORD m_reportedRegExId = 0;
+    // Rename asked for while a preview was running, started once the current request completes
+    bool m_renamePending = false;
+
+    // Preview passes of the session, reported once when the manager is cleaned up. Only used by
+    // the regex worker until it has stopped.
+    struct
+    {
+        UINT passCount = 0;
+        UINT canceledCount = 0;
+        UINT64 itemCount = 0;
+        SIZE_T peakNameBytes = 0;
+    } m_previewStats;
+
+    // Matches of the recent search terms, used to preview only the items that can still match
+    CPowerRenameMatchCache m_matchCache;
+    // Target names of the items, to flag conflicts and pick free numbers for enumerated names
+    CPowerRenameCollisionIndex m_collisionIndex;
+    // Rows of the list view for each filter
+    CPowerRenameItemFilters m_filters;
 
     // Parent HWND used by IFileOperation
     HWND m_hwndParent = nullptr;
 
     HWND m_hwndMessage = nullptr;
 
-    CRITICAL_SECTION m_critsecReentrancy;
-
     long m_refCount;
 };
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "pch.h"
+#include "PowerRenameMatchCache.h"
+#include <algorithm>
+#include <lib/PowerRenameInterfaces.h>
+
+namespace
+{
+    // Flags that don't change which items match a search term
+    const DWORD c_nonMatchFlags = MatchAllOccurences | EnumerateItems;
+
+    // Same folding as the literal search done by CPowerRenameRegEx
+    std::wstring FoldTerm(_In_ PCWSTR text, _In_ DWORD flags)
+    {
+        std::wstring folded(text ? text : L"");
+        if (!(flags & CaseSensitive))
+        {
+            std::transform(folded.begin(), folded.end(), folded.begin(), ::towlower);
+        }
+        return folded;
+    }
+}
+
+CPowerRenameMatchCache::Pass CPowerRenameMatchCache::BeginPass(_In_opt_ PCWSTR searchTerm, _In_ DWORD flags, _In_ UINT itemCount)
+{
+    Pass pass;
+    pass.flags = flags & ~c_nonMatchFlags;
+    pass.itemCount = itemCount;
+    if (flags & UseRegularExpressions)
+    {
+        return pass;
+    }
+
+    pass.cacheable = true;
+    pass.searchTerm = FoldTerm(searchTerm, flags);
+
+    CSRWExclusiveAutoLock lock(&m_lock);
+    pass.generation = m_generation;
+    if (pass.flags != m_flags || itemCount != m_itemCount)
+    {
+        // Items were added or the way they are matched changed
+        m_chain.clear();
+        m_flags = pass.flags;
+        m_itemCount = itemCount;
+    }
+
+    const std::vector<int>* candidates = nullptr;
+    static const std::vector<int> noCandidates;
+    if (pass.searchTerm.empty())
+    {
+        // Nothing matches an empty search term
+        candidates = &noCandidates;
+    }
+    else
+    {
+        // The deepest term contained in the new one has the fewest candidates
+        for (auto it = m_chain.rbegin(); it != m_chain.rend(); ++it)
+        {
+            if (pass.searchTerm.find(it->searchTerm) != std::wstring::npos)
+            {
+                candidates = &it->matches;
+                break;
+            }
+        }
+    }
+
+    if (candidates)
+    {
+        // Items named by an earlier pass have to be visited too so their new name is cleared
+        std::vector<int> named(m_namedIds.begin(), m_namedIds.end());
+        std::sort(named.begin(), named.end());
+
+        pass.incremental = true;
+        pass.ids.reserve(candidates->size() + named.size());
+        std::set_union(candidates->begin(), candidates->end(), named.begin(), named.end(), std::back_inserter(pass.ids));
+    }
+
+    return pass;
+}
+
+void CPowerRenameMatchCache::CompletePass(_In_ const Pass& pass, _In_ std::vector<int> matches)
+{
+    if (!pass.cacheable || pass.searchTerm.empty())
+    {
+        return;
+    }
+
+    CSRWExclusiveAutoLock lock(&m_lock);
+    if (pass.generation != m_generation || pass.flags != m_flags || pass.itemCount != m_itemCount)
+    {
+        return;
+    }
+
+    // Keep the terms the new one contains before it and the terms containing it after it,
+    // everything else isn't related to the new term anymore
+    std::vector<Entry> chain;
+    chain.reserve(m_chain.size() + 1);
+    size_t insertAt = 0;
+    for (auto& entry : m_chain)
+    {
+        if (entry.searchTerm == pass.searchTerm)
+        {
+            continue;
+        }
+
+        if (pass.searchTerm.find(entry.searchTerm) != std::wstring::npos)
+        {
+            chain.push_back(std::move(entry));
+            insertAt = chain.size();
+        }
+        else if (entry.searchTerm.find(pass.searchTerm) != std::wstring::npos)
+        {
+            chain.push_back(std::move(entry));
+        }
+    }
+    chain.insert(chain.begin() + insertAt, { pass.searchTerm, std::move(matches) });
+
+    if (chain.size() > c_maxEntries)
+    {
+        chain.erase(chain.begin(), chain.begin() + (chain.size() - c_maxEntries));
+    }
+    m_chain = std::move(chain);
+}
+
+bool CPowerRenameMatchCache::IsMatch(_In_ const Pass& pass, _In_ PCWSTR source)
+{
+    return pass.cacheable && !pass.searchTerm.empty() && FoldTerm(source, pass.flags).find(pass.searchTerm) != std::wstring::npos;
+}
+
+void CPowerRenameMatchCache::SetNamed(_In_ int id, _In_ bool named)
+{
+    CSRWExclusiveAutoLock lock(&m_lock);
+    if (named)
+    {
+        m_namedIds.insert(id);
+    }
+    else
+    {
+        m_namedIds.erase(id);
+    }
+}
+
+void CPowerRenameMatchCache::Invalidate()
+{
+    CSRWExclusiveAutoLock lock(&m_lock);
+    m_chain.clear();
+    m_generation++;
+}
+
+void CPowerRenameMatchCache::Clear()
+{
+    CSRWExclusiveAutoLock lock(&m_lock);
+    m_chain.clear();
+    m_namedIds.clear();
+    m_generation++;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "srwlock.h"
+
+// Remembers which items matched the recent literal search terms so the preview only has to
+// re-evaluate the items that can still match.
+//
+// An item containing a term also contains every part of it, so when the search term is extended
+// only the items that matched a shorter term need to be looked at again. The terms are kept as a
+// chain where each term contains the previous one. Going back to a term of the chain, such as after
+// a backspace, reuses its matches as they are; every other item is a known non-match.
+// Regular expressions have no such relation between terms, every item is evaluated for those.
+class CPowerRenameMatchCache
+{
+public:
+    struct Pass
+    {
+        // Only the items in ids have to be visited, in that order. Otherwise every item is visited.
+        bool incremental = false;
+        std::vector<int> ids;
+
+        bool cacheable = false;
+        std::wstring searchTerm; // Lower cased unless the search is case sensitive
+        DWORD flags = 0;
+        UINT itemCount = 0;
+        UINT generation = 0;
+    };
+
+    // Decides which items a preview pass for the search term has to visit.
+    Pass BeginPass(_In_opt_ PCWSTR searchTerm, _In_ DWORD flags, _In_ UINT itemCount);
+    // Records the items that matched, in ascending id order, once a pass visited every item it had to.
+    void CompletePass(_In_ const Pass& pass, _In_ std::vector<int> matches);
+
+    // Returns true if the item should be recorded as a match of the pass.
+    static bool IsMatch(_In_ const Pass& pass, _In_ PCWSTR source);
+
+    // Tracks the items that currently have a new name, those have to be visited to clear it.
+    void SetNamed(_In_ int id, _In_ bool named);
+
+    // Forgets the recorded matches, e.g. after the items were renamed.
+    void Invalidate();
+    // Forgets everything, e.g. after the items were removed.
+    void Clear();
+
+private:
+    struct Entry
+    {
+        std::wstring searchTerm;
+        std::vector<int> matches;
+    };
+
+    // Bounds the memory used for large item sets, the broadest terms are dropped first
+    static const size_t c_maxEntries = 16;
+
+    CSRWLock m_lock;
+    _Guarded_by_(m_lock) std::vector<Entry> m_chain; // Each term contains the previous one
+    _Guarded_by_(m_lock) std::unordered_set<int> m_namedIds;
+    _Guarded_by_(m_lock) DWORD m_flags = 0;
+    _Guarded_by_(m_lock) UINT m_itemCount = 0;
+    _Guarded_by_(m_lock) UINT m_generation = 0;
+};
@@ -95,6 +95,7 @@ IFACEMETHODIMP CPowerRenameRegEx::put_searchTerm(_In_ PCWSTR searchTerm)
             changed = true;
             CoTaskMemFree(m_searchTerm);
             hr = SHStrDup(searchTerm, &m_searchTerm);
+            _UpdateMatcher();
         }
     }
 
@@ -149,9 +150,19 @@ IFACEMETHODIMP CPowerRenameRegEx::get_flags(_Out_ DWORD* flags)
 
 IFACEMETHODIMP CPowerRenameRegEx::put_flags(_In_ DWORD flags)
 {
-    if (m_flags != flags)
+    bool changed = false;
+    {
+        CSRWExclusiveAutoLock lock(&m_lock);
+        if (m_flags != flags)
+        {
+            changed = true;
+            m_flags = flags;
+            _UpdateMatcher();
+        }
+    }
+
+    if (changed)
     {
-        m_flags = flags;
         _OnFlagsChanged();
     }
     return S_OK;
@@ -191,29 +202,34 @@ HRESULT CPowerRenameRegEx::Replace(_In_ PCWSTR source, _Outptr_ PWSTR* result)
 
     CSRWSharedAutoLock lock(&m_lock);
     HRESULT hr = (source && wcslen(source) > 0 && m_searchTerm && wcslen(m_searchTerm) > 0) ? S_OK : E_INVALIDARG;
+    if (SUCCEEDED(hr) && (m_flags & UseRegularExpressions) && !m_matcher)
+    {
+        // The search term isn't a valid regular expression
+        hr = E_FAIL;
+    }
+
     if (SUCCEEDED(hr))
     {
         wstring res = source;
         try
         {
-            // TODO: creating the regex could be costly.  May want to cache this.
             std::wstring sourceToUse(source);
             std::wstring searchTerm(m_searchTerm);
             std::wstring replaceTerm(m_replaceTerm ? wstring(m_replaceTerm) : wstring(L""));
 
             if (m_flags & UseRegularExpressions)
             {
-                std::wregex pattern(m_searchTerm, (!(m_flags & CaseSensitive)) ? regex_constants::icase | regex_constants::ECMAScript : regex_constants::ECMAScript);
+                // The search term was compiled when it or the flags changed
                 if (m_flags & MatchAllOccurences)
                 {
-                    res = regex_replace(wstring(source), pattern, replaceTerm);
+                    res = RegExReplace(*m_matcher, sourceToUse, replaceTerm);
                 }
                 else
                 {
-                    std::wsmatch m;
-                    if (std::regex_search(sourceToUse, m, pattern))
+                    RegExMatch m;
+                    if (m_matcher->Search(sourceToUse, 0, false, false, m))
                     {
-                        res = sourceToUse.replace(m.prefix().length(), m.length(), replaceTerm);
+                        res = sourceToUse.replace(m.position, m.length, replaceTerm);
                     }
                 }
             }
@@ -248,17 +264,26 @@ HRESULT CPowerRenameRegEx::Replace(_In_ PCWSTR source, _Outptr_ PWSTR* result)
     return hr;
 }
 
-size_t CPowerRenameRegEx::_Find(std::wstring data, std::wstring toSearch, bool caseInsensitive, size_t pos)
+size_t CPowerRenameRegEx::_Find(const std::wstring& data, const std::wstring& toSearch, bool caseInsensitive, size_t pos)
 {
-    if (caseInsensitive)
+    // Find sub string position in given string starting at position pos
+    return FindLiteral(data, toSearch, caseInsensitive, pos);
+}
+
+void CPowerRenameRegEx::_UpdateMatcher()
+{
+    m_matcher.reset();
+    if ((m_flags & UseRegularExpressions) && m_searchTerm && wcslen(m_searchTerm) > 0)
     {
-        // Convert to lower
-        std::transform(data.begin(), data.end(), data.begin(), ::towlower);
-        std::transform(toSearch.begin(), toSearch.end(), toSearch.begin(), ::towlower);
+        try
+        {
+            m_matcher = CreateRegExMatcher(m_searchTerm, !(m_flags & CaseSensitive));
+        }
+        catch (regex_error e)
+        {
+            // Invalid regular expression, Replace fails until the search term is fixed
+        }
     }
-
-    // Find sub string position in given string starting at position pos
-    return data.find(toSearch, pos);
 }
 
 void CPowerRenameRegEx::_OnSearchTermChanged()
@@ -2,7 +2,10 @@
 #include "pch.h"
 #include <vector>
 #include <string>
+#include <memory>
 #include "srwlock.h"
+#include "PowerRenameLiteralSearch.h"
+#include "PowerRenameRegExEngine.h"
 
 #include "PowerRenameInterfaces.h"
 
@@ -37,12 +40,16 @@ protected:
     void _OnReplaceTermChanged();
     void _OnFlagsChanged();
 
-    size_t _Find(std::wstring data, std::wstring toSearch, bool caseInsensitive, size_t pos);
+    size_t _Find(const std::wstring& data, const std::wstring& toSearch, bool caseInsensitive, size_t pos);
+    void _UpdateMatcher();
 
     DWORD m_flags = DEFAULT_FLAGS;
     PWSTR m_searchTerm = nullptr;
     PWSTR m_replaceTerm = nullptr;
 
+    // Search term compiled for the current flags, null when it isn't a valid regular expression
+    _Guarded_by_(m_lock) std::unique_ptr<CRegExMatcher> m_matcher;
+
     CSRWLock m_lock;
     CSRWLock m_lockEvents;
 
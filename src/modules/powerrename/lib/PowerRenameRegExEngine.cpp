@@ -0,0 +1,1200 @@
+#include "pch.h"
+#include "PowerRenameRegExEngine.h"
+#include <regex>
+
+namespace
+{
+    const size_t npos = std::wstring::npos;
+
+    // Bounds of the patterns compiled to an automaton, larger ones are left to std::wregex
+    const size_t c_maxInstructions = 10000;
+    const int c_maxRepeat = 1000;
+    const int c_maxNesting = 100;
+
+    // Same character categories as std::regex_traits<wchar_t>
+    bool IsDigit(wchar_t c)
+    {
+        return iswdigit(c) != 0;
+    }
+
+    bool IsWordChar(wchar_t c)
+    {
+        return c == L'_' || iswalnum(c);
+    }
+
+    bool IsSpace(wchar_t c)
+    {
+        return iswspace(c) != 0;
+    }
+
+    bool IsWordBoundary(const std::wstring& text, size_t pos)
+    {
+        const bool before = pos > 0 && IsWordChar(text[pos - 1]);
+        const bool after = pos < text.size() && IsWordChar(text[pos]);
+        return before != after;
+    }
+
+    struct CharClass
+    {
+        bool negated = false;
+        std::vector<std::pair<wchar_t, wchar_t>> ranges;
+        // Class escapes, \d, \w and \s and their negations
+        bool digit = false;
+        bool notDigit = false;
+        bool word = false;
+        bool notWord = false;
+        bool space = false;
+        bool notSpace = false;
+
+        bool Matches(wchar_t c, bool caseInsensitive) const
+        {
+            bool found = _Contains(c) || (caseInsensitive && (_Contains(towlower(c)) || _Contains(towupper(c))));
+            return found != negated;
+        }
+
+    private:
+        bool _Contains(wchar_t c) const
+        {
+            for (const auto& [first, last] : ranges)
+            {
+                if (c >= first && c <= last)
+                {
+                    return true;
+                }
+            }
+
+            return (digit && IsDigit(c)) || (notDigit && !IsDigit(c)) ||
+                   (word && IsWordChar(c)) || (notWord && !IsWordChar(c)) ||
+                   (space && IsSpace(c)) || (notSpace && !IsSpace(c));
+        }
+    };
+
+    struct Node
+    {
+        enum class Kind
+        {
+            Empty,
+            Char,
+            Any,
+            Class,
+            Concat,
+            Alternation,
+            Group,
+            Repeat,
+            LineStart,
+            LineEnd,
+            WordBoundary,
+            NotWordBoundary
+        };
+
+        Kind kind = Kind::Empty;
+        wchar_t c = 0;
+        size_t charClass = 0;
+        int group = -1; // -1 for non-capturing groups
+        int min = 0;
+        int max = 0; // -1 when unbounded
+        bool greedy = true;
+        std::vector<std::unique_ptr<Node>> children;
+    };
+
+    // Recursive descent parser for the ECMAScript subset supported by the automaton. Parsing fails
+    // on anything outside of it, valid or not, and std::wregex has the final say on those patterns.
+    class CParser
+    {
+    public:
+        CParser(const std::wstring& pattern, std::vector<CharClass>& classes) :
+            m_pattern(pattern), m_classes(classes)
+        {
+        }
+
+        std::unique_ptr<Node> Parse(int& groupCount)
+        {
+            auto root = _Disjunction();
+            if (!root || m_pos != m_pattern.size())
+            {
+                return nullptr;
+            }
+
+            groupCount = m_groupCount;
+            return root;
+        }
+
+    private:
+        bool _AtEnd() const { return m_pos >= m_pattern.size(); }
+        wchar_t _Peek() const { return _AtEnd() ? L'\0' : m_pattern[m_pos]; }
+
+        static std::unique_ptr<Node> _MakeNode(Node::Kind kind)
+        {
+            auto node = std::make_unique<Node>();
+            node->kind = kind;
+            return node;
+        }
+
+        std::unique_ptr<Node> _Disjunction()
+        {
+            auto first = _Alternative();
+            if (!first || _Peek() != L'|')
+            {
+                return first;
+            }
+
+            auto alternation = _MakeNode(Node::Kind::Alternation);
+            alternation->children.push_back(std::move(first));
+            while (!_AtEnd() && _Peek() == L'|')
+            {
+                m_pos++;
+                auto next = _Alternative();
+                if (!next)
+                {
+                    return nullptr;
+                }
+                alternation->children.push_back(std::move(next));
+            }
+            return alternation;
+        }
+
+        std::unique_ptr<Node> _Alternative()
+        {
+            auto concat = _MakeNode(Node::Kind::Concat);
+            while (!_AtEnd() && _Peek() != L'|' && _Peek() != L')')
+            {
+                auto term = _Term();
+                if (!term)
+                {
+                    return nullptr;
+                }
+                concat->children.push_back(std::move(term));
+            }
+
+            if (concat->children.empty())
+            {
+                return _MakeNode(Node::Kind::Empty);
+            }
+            if (concat->children.size() == 1)
+            {
+                return std::move(concat->children.front());
+            }
+            return concat;
+        }
+
+        std::unique_ptr<Node> _Term()
+        {
+            std::unique_ptr<Node> assertion;
+            if (_Peek() == L'^')
+            {
+                assertion = _MakeNode(Node::Kind::LineStart);
+            }
+            else if (_Peek() == L'$')
+            {
+                assertion = _MakeNode(Node::Kind::LineEnd);
+            }
+            else if (_Peek() == L'\\' && m_pos + 1 < m_pattern.size() && (m_pattern[m_pos + 1] == L'b' || m_pattern[m_pos + 1] == L'B'))
+            {
+                assertion = _MakeNode(m_pattern[m_pos + 1] == L'b' ? Node::Kind::WordBoundary : Node::Kind::NotWordBoundary);
+                m_pos++;
+            }
+
+            if (assertion)
+            {
+                m_pos++;
+                // Quantified assertions aren't supported
+                return _IsQuantifier() ? nullptr : std::move(assertion);
+            }
+
+            const int groupCount = m_groupCount;
+            auto atom = _Atom();
+            if (!atom || !_IsQuantifier())
+            {
+                return atom;
+            }
+            // ECMAScript clears the captures of a quantified group on every iteration and rejects
+            // empty iterations, which the automaton doesn't model, e.g. (.*?)+?a
+            if (m_groupCount != groupCount)
+            {
+                return nullptr;
+            }
+
+            auto repeat = _MakeNode(Node::Kind::Repeat);
+            if (!_Quantifier(*repeat))
+            {
+                return nullptr;
+            }
+            repeat->children.push_back(std::move(atom));
+            return repeat;
+        }
+
+        bool _IsQuantifier() const
+        {
+            const wchar_t c = _Peek();
+            return !_AtEnd() && (c == L'*' || c == L'+' || c == L'?' || c == L'{');
+        }
+
+        bool _Quantifier(Node& repeat)
+        {
+            switch (m_pattern[m_pos++])
+            {
+            case L'*':
+                repeat.min = 0;
+                repeat.max = -1;
+                break;
+            case L'+':
+                repeat.min = 1;
+                repeat.max = -1;
+                break;
+            case L'?':
+                repeat.min = 0;
+                repeat.max = 1;
+                break;
+            default:
+                if (!_Number(repeat.min))
+                {
+                    return false;
+                }
+                repeat.max = repeat.min;
+                if (_Peek() == L',')
+                {
+                    m_pos++;
+                    repeat.max = -1;
+                    if (_Peek() != L'}' && !_Number(repeat.max))
+                    {
+                        return false;
+                    }
+                }
+                if (_Peek() != L'}' || (repeat.max >= 0 && repeat.max < repeat.min))
+                {
+                    return false;
+                }
+                m_pos++;
+                break;
+            }
+
+            if (_Peek() == L'?')
+            {
+                m_pos++;
+                repeat.greedy = false;
+            }
+            return true;
+        }
+
+        bool _Number(int& value)
+        {
+            value = 0;
+            const size_t start = m_pos;
+            while (!_AtEnd() && _Peek() >= L'0' && _Peek() <= L'9')
+            {
+                value = value * 10 + (_Peek() - L'0');
+                if (value > c_maxRepeat)
+                {
+                    return false;
+                }
+                m_pos++;
+            }
+            return m_pos > start;
+        }
+
+        std::unique_ptr<Node> _Atom()
+        {
+            const wchar_t c = m_pattern[m_pos];
+            switch (c)
+            {
+            case L'.':
+                m_pos++;
+                return _MakeNode(Node::Kind::Any);
+
+            case L'(':
+            {
+                m_pos++;
+                int group = -1;
+                if (_Peek() == L'?')
+                {
+                    // Only non-capturing groups, no lookaheads or named groups
+                    if (m_pos + 1 >= m_pattern.size() || m_pattern[m_pos + 1] != L':')
+                    {
+                        return nullptr;
+                    }
+                    m_pos += 2;
+                }
+                else
+                {
+                    group = ++m_groupCount;
+                }
+
+                if (++m_nesting > c_maxNesting)
+                {
+                    return nullptr;
+                }
+                auto inner = _Disjunction();
+                m_nesting--;
+                if (!inner || _Peek() != L')')
+                {
+                    return nullptr;
+                }
+                m_pos++;
+
+                auto node = _MakeNode(Node::Kind::Group);
+                node->group = group;
+                node->children.push_back(std::move(inner));
+                return node;
+            }
+
+            case L'[':
+                return _Class();
+
+            case L'\\':
+            {
+                m_pos++;
+                if (_AtEnd())
+                {
+                    return nullptr;
+                }
+
+                CharClass charClass;
+                if (_ClassEscape(m_pattern[m_pos], charClass))
+                {
+                    m_pos++;
+                    auto node = _MakeNode(Node::Kind::Class);
+                    node->charClass = m_classes.size();
+                    m_classes.push_back(std::move(charClass));
+                    return node;
+                }
+
+                auto node = _MakeNode(Node::Kind::Char);
+                return _CharacterEscape(node->c) ? std::move(node) : nullptr;
+            }
+
+            case L')':
+            case L']':
+            case L'{':
+            case L'}':
+            case L'*':
+            case L'+':
+            case L'?':
+                return nullptr;
+
+            default:
+            {
+                m_pos++;
+                auto node = _MakeNode(Node::Kind::Char);
+                node->c = c;
+                return node;
+            }
+            }
+        }
+
+        std::unique_ptr<Node> _Class()
+        {
+            m_pos++;
+            CharClass charClass;
+            if (_Peek() == L'^')
+            {
+                charClass.negated = true;
+                m_pos++;
+            }
+
+            // Empty classes are left to std::wregex
+            if (_Peek() == L']')
+            {
+                return nullptr;
+            }
+
+            while (true)
+            {
+                if (_AtEnd())
+                {
+                    return nullptr;
+                }
+                if (_Peek() == L']')
+                {
+                    m_pos++;
+                    break;
+                }
+
+                wchar_t first = 0;
+                bool isChar = false;
+                if (!_ClassAtom(charClass, first, isChar))
+                {
+                    return nullptr;
+                }
+
+                if (_Peek() == L'-' && m_pos + 1 < m_pattern.size() && m_pattern[m_pos + 1] != L']')
+                {
+                    m_pos++;
+                    wchar_t last = 0;
+                    bool isLastChar = false;
+                    if (!isChar || !_ClassAtom(charClass, last, isLastChar) || !isLastChar || last < first)
+                    {
+                        return nullptr;
+                    }
+                    charClass.ranges.emplace_back(first, last);
+                }
+                else if (isChar)
+                {
+                    charClass.ranges.emplace_back(first, first);
+                }
+            }
+
+            auto node = _MakeNode(Node::Kind::Class);
+            node->charClass = m_classes.size();
+            m_classes.push_back(std::move(charClass));
+            return node;
+        }
+
+        // Reads a character or a class escape of a class
+        bool _ClassAtom(CharClass& charClass, wchar_t& c, bool& isChar)
+        {
+            if (_Peek() != L'\\')
+            {
+                c = m_pattern[m_pos++];
+                isChar = true;
+                return true;
+            }
+
+            m_pos++;
+            if (_AtEnd())
+            {
+                return false;
+            }
+
+            if (_ClassEscape(m_pattern[m_pos], charClass))
+            {
+                m_pos++;
+                isChar = false;
+                return true;
+            }
+
+            if (m_pattern[m_pos] == L'b')
+            {
+                m_pos++;
+                c = L'\b';
+                isChar = true;
+                return true;
+            }
+
+            if (m_pattern[m_pos] == L'-')
+            {
+                m_pos++;
+                c = L'-';
+                isChar = true;
+                return true;
+            }
+
+            isChar = true;
+            return _CharacterEscape(c);
+        }
+
+        static bool _ClassEscape(wchar_t escape, CharClass& charClass)
+        {
+            switch (escape)
+            {
+            case L'd':
+                charClass.digit = true;
+                return true;
+            case L'D':
+                charClass.notDigit = true;
+                return true;
+            case L'w':
+                charClass.word = true;
+                return true;
+            case L'W':
+                charClass.notWord = true;
+                return true;
+            case L's':
+                charClass.space = true;
+                return true;
+            case L'S':
+                charClass.notSpace = true;
+                return true;
+            }
+            return false;
+        }
+
+        // Reads the character escape after a backslash
+        bool _CharacterEscape(wchar_t& c)
+        {
+            const wchar_t escape = m_pattern[m_pos++];
+            switch (escape)
+            {
+            case L't':
+                c = L'\t';
+                return true;
+            case L'n':
+                c = L'\n';
+                return true;
+            case L'r':
+                c = L'\r';
+                return true;
+            case L'f':
+                c = L'\f';
+                return true;
+            case L'v':
+                c = L'\v';
+                return true;
+            case L'0':
+                // \0 followed by a digit is an octal or backreference escape
+                c = L'\0';
+                return _AtEnd() || _Peek() < L'0' || _Peek() > L'9';
+            case L'x':
+                return _Hex(2, c);
+            case L'u':
+                return _Hex(4, c);
+            }
+
+            // Syntax characters stand for themselves, backreferences and other escapes aren't supported
+            if (wcschr(L"^$\\.*+?()[]{}|/", escape))
+            {
+                c = escape;
+                return true;
+            }
+            return false;
+        }
+
+        bool _Hex(int digits, wchar_t& c)
+        {
+            unsigned int value = 0;
+            for (int i = 0; i < digits; i++)
+            {
+                if (_AtEnd() || !iswxdigit(_Peek()))
+                {
+                    return false;
+                }
+                const wchar_t digit = m_pattern[m_pos++];
+                value = value * 16 + (digit <= L'9' ? digit - L'0' : (towlower(digit) - L'a' + 10));
+            }
+            c = static_cast<wchar_t>(value);
+            return true;
+        }
+
+        const std::wstring& m_pattern;
+        std::vector<CharClass>& m_classes;
+        size_t m_pos = 0;
+        int m_groupCount = 0;
+        int m_nesting = 0;
+    };
+
+    enum class Op : uint8_t
+    {
+        Char,
+        Any,
+        Class,
+        Match,
+        // Instructions that don't consume a character
+        Split,
+        Jump,
+        Save,
+        LineStart,
+        LineEnd,
+        WordBoundary,
+        NotWordBoundary
+    };
+
+    struct Instruction
+    {
+        Op op = Op::Match;
+        wchar_t c = 0;
+        size_t x = 0; // Jump target, preferred Split target, Save slot or class index
+        size_t y = 0; // Other Split target
+    };
+
+    class CAutomatonMatcher : public CRegExMatcher
+    {
+    public:
+        CAutomatonMatcher(bool caseInsensitive) :
+            m_caseInsensitive(caseInsensitive)
+        {
+        }
+
+        // Returns false when the pattern can't be compiled to an automaton
+        bool Compile(const std::wstring& pattern)
+        {
+            int groupCount = 0;
+            CParser parser(pattern, m_classes);
+            auto root = parser.Parse(groupCount);
+            if (!root)
+            {
+                return false;
+            }
+
+            m_groupCount = groupCount;
+            _Emit(Op::Save, 0);
+            if (!_Compile(*root))
+            {
+                return false;
+            }
+            _Emit(Op::Save, 1);
+            _Emit(Op::Match);
+
+            // Every match starts with this character when the pattern starts with one
+            if (m_program[1].op == Op::Char)
+            {
+                m_firstChar = m_program[1].c;
+            }
+            m_anchored = m_program[1].op == Op::LineStart;
+            return true;
+        }
+
+        RegExBackend Backend() const override { return RegExBackend::Automaton; }
+        size_t GroupCount() const override { return m_groupCount; }
+
+        // Pike VM: every thread of the NFA advances one character at a time, in priority order, so a
+        // thread reaching a state first has precedence and the match is the one a backtracking
+        // matcher would find. At most one thread per instruction is kept for each position.
+        bool Search(_In_ const std::wstring& text, _In_ size_t start, _In_ bool continuous, _In_ bool notEmpty, _Out_ RegExMatch& match) const override
+        {
+            match = {};
+            if (start > text.size())
+            {
+                return false;
+            }
+
+            // Buffers are kept per thread, searches are done for every item of every preview
+            static thread_local Scratch scratch;
+            const size_t slotCount = 2 * (m_groupCount + 1);
+            for (auto& list : scratch.lists)
+            {
+                list.pcs.clear();
+                list.captures.clear();
+                list.stamps.assign(m_program.size(), npos);
+            }
+            ThreadList* current = &scratch.lists[0];
+            ThreadList* next = &scratch.lists[1];
+
+            std::vector<size_t>& captures = scratch.captures;
+            std::vector<StackEntry>& stack = scratch.stack;
+            std::vector<size_t>& best = scratch.best;
+            captures.assign(slotCount, npos);
+            best.clear();
+
+            for (size_t pos = start;; pos++)
+            {
+                if (current->pcs.empty() && best.empty() && !continuous)
+                {
+                    // Nothing in progress, skip to where a match can start
+                    if (m_anchored && pos > 0)
+                    {
+                        break;
+                    }
+
+                    if (m_firstChar != npos)
+                    {
+                        pos = _FindFirstChar(text, pos);
+                        if (pos >= text.size())
+                        {
+                            break;
+                        }
+                    }
+                }
+
+                if (best.empty() && (pos == start || !continuous))
+                {
+                    // New threads start after the existing ones, leftmost matches have precedence
+                    std::fill(captures.begin(), captures.end(), npos);
+                    _AddThread(*current, 0, captures, pos, text, stack);
+                }
+
+                if (current->pcs.empty() && (!best.empty() || continuous || pos >= text.size()))
+                {
+                    break;
+                }
+
+                next->pcs.clear();
+                next->captures.clear();
+                for (size_t t = 0; t < current->pcs.size(); t++)
+                {
+                    const size_t pc = current->pcs[t];
+                    const Instruction& instruction = m_program[pc];
+                    const size_t* threadCaptures = current->captures.data() + t * slotCount;
+                    if (instruction.op == Op::Match)
+                    {
+                        if (notEmpty && threadCaptures[0] == pos)
+                        {
+                            continue;
+                        }
+
+                        // Lower priority threads are cut off, higher priority ones carry on
+                        best.assign(threadCaptures, threadCaptures + slotCount);
+                        break;
+                    }
+
+                    if (pos < text.size() && _Consumes(instruction, text[pos]))
+                    {
+                        captures.assign(threadCaptures, threadCaptures + slotCount);
+                        _AddThread(*next, pc + 1, captures, pos + 1, text, stack);
+                    }
+                }
+
+                std::swap(current, next);
+                if (pos >= text.size())
+                {
+                    break;
+                }
+            }
+
+            if (best.empty())
+            {
+                return false;
+            }
+
+            match.position = best[0];
+            match.length = best[1] - best[0];
+            match.groups.resize(m_groupCount);
+            for (size_t group = 0; group < m_groupCount; group++)
+            {
+                const size_t first = best[2 * (group + 1)];
+                const size_t last = best[2 * (group + 1) + 1];
+                match.groups[group] = (first != npos && last != npos) ? std::make_pair(first, last) : std::make_pair(npos, npos);
+            }
+            return true;
+        }
+
+    private:
+        struct ThreadList
+        {
+            std::vector<size_t> pcs;
+            std::vector<size_t> captures; // Capture slots of each thread, in the order of pcs
+            std::vector<size_t> stamps; // Position each instruction was last added at
+        };
+
+        struct StackEntry
+        {
+            size_t pc;
+            size_t slot; // Capture slot to restore, npos for instructions to follow
+            size_t value;
+        };
+
+        struct Scratch
+        {
+            ThreadList lists[2];
+            std::vector<size_t> captures;
+            std::vector<StackEntry> stack;
+            std::vector<size_t> best;
+        };
+
+        size_t _FindFirstChar(const std::wstring& text, size_t pos) const
+        {
+            if (!m_caseInsensitive)
+            {
+                return text.find(static_cast<wchar_t>(m_firstChar), pos);
+            }
+
+            while (pos < text.size() && static_cast<size_t>(towlower(text[pos])) != m_firstChar)
+            {
+                pos++;
+            }
+            return pos;
+        }
+
+        size_t _Emit(Op op, size_t x = 0)
+        {
+            Instruction instruction;
+            instruction.op = op;
+            instruction.x = x;
+            m_program.push_back(instruction);
+            return m_program.size() - 1;
+        }
+
+        bool _Compile(const Node& node)
+        {
+            if (m_program.size() > c_maxInstructions)
+            {
+                return false;
+            }
+
+            switch (node.kind)
+            {
+            case Node::Kind::Empty:
+                break;
+
+            case Node::Kind::Char:
+                m_program[_Emit(Op::Char)].c = m_caseInsensitive ? static_cast<wchar_t>(towlower(node.c)) : node.c;
+                break;
+
+            case Node::Kind::Any:
+                _Emit(Op::Any);
+                break;
+
+            case Node::Kind::Class:
+                _Emit(Op::Class, node.charClass);
+                break;
+
+            case Node::Kind::LineStart:
+                _Emit(Op::LineStart);
+                break;
+
+            case Node::Kind::LineEnd:
+                _Emit(Op::LineEnd);
+                break;
+
+            case Node::Kind::WordBoundary:
+                _Emit(Op::WordBoundary);
+                break;
+
+            case Node::Kind::NotWordBoundary:
+                _Emit(Op::NotWordBoundary);
+                break;
+
+            case Node::Kind::Concat:
+                for (const auto& child : node.children)
+                {
+                    if (!_Compile(*child))
+                    {
+                        return false;
+                    }
+                }
+                break;
+
+            case Node::Kind::Alternation:
+            {
+                std::vector<size_t> jumps;
+                for (size_t i = 0; i < node.children.size(); i++)
+                {
+                    size_t split = npos;
+                    if (i + 1 < node.children.size())
+                    {
+                        split = _Emit(Op::Split, m_program.size() + 1);
+                    }
+                    if (!_Compile(*node.children[i]))
+                    {
+                        return false;
+                    }
+                    if (split != npos)
+                    {
+                        jumps.push_back(_Emit(Op::Jump));
+                        m_program[split].y = m_program.size();
+                    }
+                }
+                for (size_t jump : jumps)
+                {
+                    m_program[jump].x = m_program.size();
+                }
+                break;
+            }
+
+            case Node::Kind::Group:
+                if (node.group >= 0)
+                {
+                    _Emit(Op::Save, 2 * node.group);
+                }
+                if (!_Compile(*node.children.front()))
+                {
+                    return false;
+                }
+                if (node.group >= 0)
+                {
+                    _Emit(Op::Save, 2 * node.group + 1);
+                }
+                break;
+
+            case Node::Kind::Repeat:
+            {
+                const Node& child = *node.children.front();
+                for (int i = 0; i < node.min; i++)
+                {
+                    if (!_Compile(child))
+                    {
+                        return false;
+                    }
+                }
+
+                if (node.max < 0)
+                {
+                    const size_t split = _Emit(Op::Split);
+                    if (!_Compile(child))
+                    {
+                        return false;
+                    }
+                    _Emit(Op::Jump, split);
+                    _SetSplit(split, split + 1, m_program.size(), node.greedy);
+                }
+                else
+                {
+                    // Each optional repetition can only be tried if the previous one was taken
+                    std::vector<size_t> splits;
+                    for (int i = node.min; i < node.max; i++)
+                    {
+                        splits.push_back(_Emit(Op::Split));
+                        if (!_Compile(child))
+                        {
+                            return false;
+                        }
+                    }
+                    for (size_t split : splits)
+                    {
+                        _SetSplit(split, split + 1, m_program.size(), node.greedy);
+                    }
+                }
+                break;
+            }
+            }
+
+            return m_program.size() <= c_maxInstructions;
+        }
+
+        void _SetSplit(size_t split, size_t body, size_t out, bool greedy)
+        {
+            m_program[split].x = greedy ? body : out;
+            m_program[split].y = greedy ? out : body;
+        }
+
+        bool _Consumes(const Instruction& instruction, wchar_t c) const
+        {
+            switch (instruction.op)
+            {
+            case Op::Char:
+                return static_cast<wchar_t>(m_caseInsensitive ? towlower(c) : c) == instruction.c;
+            case Op::Any:
+                return c != L'\n' && c != L'\r';
+            case Op::Class:
+                return m_classes[instruction.x].Matches(c, m_caseInsensitive);
+            default:
+                return false;
+            }
+        }
+
+        // Follows the instructions that don't consume a character, in priority order, and adds
+        // the threads reaching a character or the match to the list.
+        void _AddThread(ThreadList& list, size_t pc, std::vector<size_t>& captures, size_t pos, const std::wstring& text, std::vector<StackEntry>& stack) const
+        {
+            stack.clear();
+            stack.push_back({ pc, npos, 0 });
+            while (!stack.empty())
+            {
+                const StackEntry entry = stack.back();
+                stack.pop_back();
+                if (entry.slot != npos)
+                {
+                    captures[entry.slot] = entry.value;
+                    continue;
+                }
+
+                if (list.stamps[entry.pc] == pos)
+                {
+                    continue;
+                }
+                list.stamps[entry.pc] = pos;
+
+                const Instruction& instruction = m_program[entry.pc];
+                switch (instruction.op)
+                {
+                case Op::Jump:
+                    stack.push_back({ instruction.x, npos, 0 });
+                    break;
+                case Op::Split:
+                    stack.push_back({ instruction.y, npos, 0 });
+                    stack.push_back({ instruction.x, npos, 0 });
+                    break;
+                case Op::Save:
+                    stack.push_back({ 0, instruction.x, captures[instruction.x] });
+                    captures[instruction.x] = pos;
+                    stack.push_back({ entry.pc + 1, npos, 0 });
+                    break;
+                case Op::LineStart:
+                    if (pos == 0)
+                    {
+                        stack.push_back({ entry.pc + 1, npos, 0 });
+                    }
+                    break;
+                case Op::LineEnd:
+                    if (pos == text.size())
+                    {
+                        stack.push_back({ entry.pc + 1, npos, 0 });
+                    }
+                    break;
+                case Op::WordBoundary:
+                case Op::NotWordBoundary:
+                    if (IsWordBoundary(text, pos) == (instruction.op == Op::WordBoundary))
+                    {
+                        stack.push_back({ entry.pc + 1, npos, 0 });
+                    }
+                    break;
+                default:
+                    list.pcs.push_back(entry.pc);
+                    list.captures.insert(list.captures.end(), captures.begin(), captures.end());
+                    break;
+                }
+            }
+        }
+
+        bool m_caseInsensitive;
+        size_t m_groupCount = 0;
+        size_t m_firstChar = npos; // Folded when case insensitive
+        bool m_anchored = false; // Matches can only start at the beginning of the text
+        std::vector<Instruction> m_program;
+        std::vector<CharClass> m_classes;
+    };
+
+    class CStdMatcher : public CRegExMatcher
+    {
+    public:
+        CStdMatcher(const std::wstring& pattern, bool caseInsensitive) :
+            m_regex(pattern, caseInsensitive ? std::regex_constants::icase | std::regex_constants::ECMAScript : std::regex_constants::ECMAScript)
+        {
+        }
+
+        RegExBackend Backend() const override { return RegExBackend::Std; }
+        size_t GroupCount() const override { return m_regex.mark_count(); }
+
+        bool Search(_In_ const std::wstring& text, _In_ size_t start, _In_ bool continuous, _In_ bool notEmpty, _Out_ RegExMatch& match) const override
+        {
+            match = {};
+            if (start > text.size())
+            {
+                return false;
+            }
+
+            auto flags = std::regex_constants::match_default;
+            if (start > 0)
+            {
+                flags |= std::regex_constants::match_prev_avail;
+            }
+            if (continuous)
+            {
+                flags |= std::regex_constants::match_continuous;
+            }
+            if (notEmpty)
+            {
+                flags |= std::regex_constants::match_not_null;
+            }
+
+            std::wsmatch m;
+            if (!std::regex_search(text.cbegin() + start, text.cend(), m, m_regex, flags))
+            {
+                return false;
+            }
+
+            match.position = start + static_cast<size_t>(m.position(0));
+            match.length = static_cast<size_t>(m.length(0));
+            match.groups.resize(m.size() - 1);
+            for (size_t group = 1; group < m.size(); group++)
+            {
+                const size_t first = start + static_cast<size_t>(m.position(group));
+                match.groups[group - 1] = m[group].matched ? std::make_pair(first, first + static_cast<size_t>(m.length(group))) : std::make_pair(npos, npos);
+            }
+            return true;
+        }
+
+    private:
+        std::wregex m_regex;
+    };
+
+    // Expands the format for a match like std::match_results::format. prefixStart is where the
+    // text not consumed by the previous match starts.
+    void AppendFormat(std::wstring& result, const std::wstring& source, const RegExMatch& match, size_t prefixStart, const std::wstring& format)
+    {
+        const size_t groupCount = match.groups.size();
+        auto appendGroup = [&](size_t group) {
+            if (group == 0)
+            {
+                result.append(source, match.position, match.length);
+            }
+            else if (match.groups[group - 1].first != npos)
+            {
+                result.append(source, match.groups[group - 1].first, match.groups[group - 1].second - match.groups[group - 1].first);
+            }
+        };
+
+        for (size_t i = 0; i < format.size(); i++)
+        {
+            const wchar_t c = format[i];
+            if (c != L'$' || i + 1 >= format.size())
+            {
+                result += c;
+                continue;
+            }
+
+            const wchar_t next = format[i + 1];
+            if (next == L'$')
+            {
+                result += L'$';
+                i++;
+            }
+            else if (next == L'&')
+            {
+                appendGroup(0);
+                i++;
+            }
+            else if (next == L'`')
+            {
+                result.append(source, prefixStart, match.position - prefixStart);
+                i++;
+            }
+            else if (next == L'\'')
+            {
+                result.append(source, match.position + match.length);
+                i++;
+            }
+            else if (next >= L'0' && next <= L'9')
+            {
+                // Up to two digits, groups that don't exist expand to nothing
+                size_t group = next - L'0';
+                i++;
+                if (i + 1 < format.size() && format[i + 1] >= L'0' && format[i + 1] <= L'9')
+                {
+                    group = group * 10 + (format[i + 1] - L'0');
+                    i++;
+                }
+
+                if (group <= groupCount)
+                {
+                    appendGroup(group);
+                }
+            }
+            else
+            {
+                result += c;
+            }
+        }
+    }
+}
+
+std::unique_ptr<CRegExMatcher> CreateRegExMatcher(_In_ const std::wstring& pattern, _In_ bool caseInsensitive, _In_ RegExBackend backend)
+{
+    // std::wregex decides which patterns are valid whatever the backend, the automaton parser
+    // accepts some patterns it rejects, e.g. "[[:]"
+    auto stdMatcher = std::make_unique<CStdMatcher>(pattern, caseInsensitive);
+
+    if (backend == RegExBackend::Automaton)
+    {
+        auto automaton = std::make_unique<CAutomatonMatcher>(caseInsensitive);
+        if (automaton->Compile(pattern))
+        {
+            return automaton;
+        }
+    }
+
+    return stdMatcher;
+}
+
+std::wstring RegExReplace(_In_ const CRegExMatcher& matcher, _In_ const std::wstring& source, _In_ const std::wstring& format)
+{
+    std::wstring result;
+    size_t prefixStart = 0;
+
+    RegExMatch match;
+    bool found = matcher.Search(source, 0, false, false, match);
+    while (found)
+    {
+        result.append(source, prefixStart, match.position - prefixStart);
+        AppendFormat(result, source, match, prefixStart, format);
+        prefixStart = match.position + match.length;
+
+        if (match.length > 0)
+        {
+            found = matcher.Search(source, prefixStart, false, false, match);
+        }
+        else if (match.position < source.size())
+        {
+            // Same as std::regex_iterator after an empty match: a non-empty match at the same
+            // position, or else the next match one character further
+            const size_t position = match.position;
+            found = matcher.Search(source, position, true, true, match) ||
+                    matcher.Search(source, position + 1, false, false, match);
+        }
+        else
+        {
+            found = false;
+        }
+    }
+
+    result.append(source, prefixStart, npos);
+    return result;
+}
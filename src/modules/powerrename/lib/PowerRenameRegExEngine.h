@@ -0,0 +1,47 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct RegExMatch
+{
+    size_t position = 0;
+    size_t length = 0;
+    // Start and end of each capture group, both npos when the group didn't participate in the match
+    std::vector<std::pair<size_t, size_t>> groups;
+};
+
+enum class RegExBackend
+{
+    // Thompson NFA simulated over all its states at once, linear in the length of the text
+    Automaton,
+    // std::wregex, a backtracking matcher supporting the whole ECMAScript grammar
+    Std
+};
+
+// Compiled search pattern of CPowerRenameRegEx. Matchers are immutable once created and can be
+// used from several threads at the same time.
+class CRegExMatcher
+{
+public:
+    virtual ~CRegExMatcher() = default;
+
+    virtual RegExBackend Backend() const = 0;
+    virtual size_t GroupCount() const = 0;
+
+    // Finds the leftmost match starting at or after start. The text before start is still used
+    // by ^ and \b. When continuous is set the match has to start at start, and when notEmpty is
+    // set empty matches are skipped, like match_continuous and match_not_null.
+    virtual bool Search(_In_ const std::wstring& text, _In_ size_t start, _In_ bool continuous, _In_ bool notEmpty, _Out_ RegExMatch& match) const = 0;
+};
+
+// Compiles the pattern with the automaton when it only uses the syntax the automaton supports:
+// characters, escapes and classes, ., ^, $, \b, \B, capturing and non-capturing groups,
+// alternation and greedy or lazy quantifiers. Other patterns, such as ones with lookaheads,
+// backreferences or quantified groups holding capture groups, are compiled with std::wregex. Every pattern is validated with std::wregex, which
+// throws std::regex_error for the invalid ones.
+std::unique_ptr<CRegExMatcher> CreateRegExMatcher(_In_ const std::wstring& pattern, _In_ bool caseInsensitive, _In_ RegExBackend backend = RegExBackend::Automaton);
+
+// Replaces every match like std::regex_replace, expanding $&, $n, $nn, $`, $' and $$ in the format.
+std::wstring RegExReplace(_In_ const CRegExMatcher& matcher, _In_ const std::wstring& source, _In_ const std::wstring& format);
@@ -28,6 +28,7 @@ namespace
     const wchar_t c_searchText[] = L"SearchText";
     const wchar_t c_replaceText[] = L"ReplaceText";
     const wchar_t c_mruEnabled[] = L"MRUEnabled";
+    const wchar_t c_directRename[] = L"DirectRename";
     const wchar_t c_mruList[] = L"MRUList";
     const wchar_t c_insertionIdx[] = L"InsertionIdx";
 
@@ -413,6 +414,7 @@ void CSettings::Save()
     jsonData.SetNamedValue(c_maxMRUSize,              json::value(settings.maxMRUSize));
     jsonData.SetNamedValue(c_searchText,              json::value(settings.searchText));
     jsonData.SetNamedValue(c_replaceText,             json::value(settings.replaceText));
+    jsonData.SetNamedValue(c_directRename,            json::value(settings.directRename));
 
     json::to_file(jsonFilePath, jsonData);
     GetSystemTimeAsFileTime(&lastLoadedTime);
@@ -434,6 +436,26 @@ void CSettings::Load()
     }
 }
 
+void CSettings::PublishSnapshot()
+{
+    shell_extension_settings::ModuleState state;
+    state.enabled = settings.enabled;
+    if (settings.showIconOnMenu)
+    {
+        state.flags |= shell_extension_settings::flags::POWER_RENAME_SHOW_ICON_ON_MENU;
+    }
+    if (settings.extendedContextMenuOnly)
+    {
+        state.flags |= shell_extension_settings::flags::POWER_RENAME_EXTENDED_CONTEXT_MENU_ONLY;
+    }
+    shell_extension_settings::publish(shell_extension_settings::Module::PowerRename, state);
+}
+
+std::optional<shell_extension_settings::ModuleState> CSettings::ReadSnapshot()
+{
+    return shell_extension_settings::read(shell_extension_settings::Module::PowerRename);
+}
+
 void CSettings::Reload()
 {
     // Load json settings from data file if it is modified in the meantime.
@@ -498,6 +520,10 @@ void CSettings::ParseJson()
             {
                 settings.replaceText = jsonSettings.GetNamedString(c_replaceText);
             }
+            if (json::has(jsonSettings, c_directRename, json::JsonValueType::Boolean))
+            {
+                settings.directRename = jsonSettings.GetNamedBoolean(c_directRename);
+            }
         }
         catch (const winrt::hresult_error&) { }
     }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "json.h"
+#include "shell_extension_settings.h"
 
 class CSettings
 {
@@ -11,6 +12,11 @@ public:
 
     inline bool GetEnabled()
     {
+        // Prefer the snapshot published by the runner, it doesn't touch the disk.
+        if (auto snapshot = ReadSnapshot())
+        {
+            return snapshot->enabled;
+        }
         Reload();
         return settings.enabled;
     }
@@ -23,6 +29,10 @@ public:
 
     inline bool GetShowIconOnMenu() const
     {
+        if (auto snapshot = ReadSnapshot())
+        {
+            return (snapshot->flags & shell_extension_settings::flags::POWER_RENAME_SHOW_ICON_ON_MENU) != 0;
+        }
         return settings.showIconOnMenu;
     }
 
@@ -33,6 +43,10 @@ public:
 
     inline bool GetExtendedContextMenuOnly() const
     {
+        if (auto snapshot = ReadSnapshot())
+        {
+            return (snapshot->flags & shell_extension_settings::flags::POWER_RENAME_EXTENDED_CONTEXT_MENU_ONLY) != 0;
+        }
         return settings.extendedContextMenuOnly;
     }
 
@@ -71,6 +85,13 @@ public:
         settings.maxMRUSize = maxMRUSize;
     }
 
+    // Large batches are renamed without IFileOperation, see CPowerRenameExecutor. Off until it is
+    // measured against IFileOperation, only set in the settings file for now.
+    inline bool GetDirectRename() const
+    {
+        return settings.directRename;
+    }
+
     inline unsigned int GetFlags() const
     {
         return settings.flags;
@@ -106,6 +127,7 @@ public:
 
     void Save();
     void Load();
+    void PublishSnapshot();
 
 private:
     struct Settings
@@ -116,6 +138,7 @@ private:
         bool persistState{ true };
         bool MRUEnabled{ true };
         unsigned int maxMRUSize{ 10 };
+        bool directRename{ false };
         unsigned int flags{ 0 };
         std::wstring searchText{};
         std::wstring replaceText{};
@@ -125,6 +148,8 @@ private:
     void MigrateFromRegistry();
     void ParseJson();
 
+    static std::optional<shell_extension_settings::ModuleState> ReadSnapshot();
+
     void ReadFlags();
     void WriteFlags();
 
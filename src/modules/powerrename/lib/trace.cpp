@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "trace.h"
 #include "Settings.h"
+#include "PowerRenameExecutor.h"
 
 TRACELOGGING_DEFINE_PROVIDER(
       g_hProvider,
@@ -72,6 +73,37 @@ void Trace::RenameOperation(_In_ UINT totalItemCount, _In_ UINT selectedItemCoun
         TraceLoggingWideString(extensionList, "ExtensionList"));
 }
 
+void Trace::DirectRenameOperation(_In_ const RenameStats& stats, _In_ size_t collisionCount, _In_ HRESULT hr) noexcept
+{
+    TraceLoggingWrite(
+        g_hProvider,
+        "PowerRename_DirectRenameOperation",
+        ProjectTelemetryPrivacyDataTag(ProjectTelemetryTag_ProductAndServicePerformance),
+        TraceLoggingKeyword(PROJECT_KEYWORD_MEASURE),
+        TraceLoggingUInt64(stats.renamedCount, "RenamedCount"),
+        TraceLoggingUInt64(stats.directoryCount, "DirectoryCount"),
+        TraceLoggingUInt64(stats.levelCount, "LevelCount"),
+        TraceLoggingUInt64(stats.threadCount, "ThreadCount"),
+        TraceLoggingUInt64(collisionCount, "CollisionCount"),
+        TraceLoggingInt64(stats.planTime.count(), "PlanTimeMicroseconds"),
+        TraceLoggingInt64(stats.executeTime.count(), "ExecuteTimeMicroseconds"),
+        TraceLoggingBoolean(stats.rolledBack, "RolledBack"),
+        TraceLoggingHResult(hr));
+}
+
+void Trace::PreviewSession(_In_ UINT passCount, _In_ UINT canceledCount, _In_ UINT64 itemCount, _In_ size_t peakNameBytes) noexcept
+{
+    TraceLoggingWrite(
+        g_hProvider,
+        "PowerRename_PreviewSession",
+        ProjectTelemetryPrivacyDataTag(ProjectTelemetryTag_ProductAndServicePerformance),
+        TraceLoggingKeyword(PROJECT_KEYWORD_MEASURE),
+        TraceLoggingUInt32(passCount, "PassCount"),
+        TraceLoggingUInt32(canceledCount, "CanceledCount"),
+        TraceLoggingUInt64(itemCount, "ItemCount"),
+        TraceLoggingUInt64(peakNameBytes, "PeakNameBytes"));
+}
+
 void Trace::SettingsChanged() noexcept
 {
     TraceLoggingWrite(
@@ -1,5 +1,7 @@
 #pragma once
 
+struct RenameStats;
+
 class Trace {
 public:
   static void RegisterProvider() noexcept;
@@ -14,5 +16,14 @@ public:
       _In_ UINT renameItemCount,
       _In_ DWORD flags,
       _In_ PCWSTR extensionList) noexcept;
+  static void DirectRenameOperation(
+      _In_ const RenameStats& stats,
+      _In_ size_t collisionCount,
+      _In_ HRESULT hr) noexcept;
+  static void PreviewSession(
+      _In_ UINT passCount,
+      _In_ UINT canceledCount,
+      _In_ UINT64 itemCount,
+      _In_ size_t peakNameBytes) noexcept;
   static void SettingsChanged() noexcept;
 };
@@ -8,9 +8,16 @@
 #include <windowsx.h>
 #include <thread>
 #include <trace.h>
+#include <span_tracing.h>
 
 extern HINSTANCE g_hInst;
 
+// Posted by the enumeration thread, wParam is the enumeration generation and lParam is
+// nonzero once enumeration completed
+#define WM_POWERRENAME_ENUMPROGRESS (WM_APP + 1)
+// Posted by the icon cache when icons of the list view were resolved
+#define WM_POWERRENAME_ICONSREADY (WM_APP + 2)
+
 int g_rgnMatchModeResIDs[] = {
     IDS_ENTIREITEMNAME,
     IDS_NAMEONLY,
@@ -172,12 +179,11 @@ IFACEMETHODIMP CPowerRenameUI::OnItemAdded(_In_ IPowerRenameItem*)
 
 IFACEMETHODIMP CPowerRenameUI::OnUpdate(_In_ IPowerRenameItem*)
 {
-    UINT itemCount = 0;
     if (m_spsrm)
     {
-        m_spsrm->GetItemCount(&itemCount);
+        // The item may have entered or left the filter of the view
+        m_listview.UpdateItemCount(m_spsrm);
     }
-    m_listview.RedrawItems(0, itemCount);
     _UpdateCounts();
     return S_OK;
 }
@@ -187,17 +193,17 @@ IFACEMETHODIMP CPowerRenameUI::OnError(_In_ IPowerRenameItem*)
     return S_OK;
 }
 
-IFACEMETHODIMP CPowerRenameUI::OnRegExStarted(_In_ DWORD threadId)
+IFACEMETHODIMP CPowerRenameUI::OnRegExStarted(_In_ DWORD regExId)
 {
     m_disableCountUpdate = true;
-    m_currentRegExId = threadId;
+    m_currentRegExId = regExId;
     _UpdateCounts();
     return S_OK;
 }
 
-IFACEMETHODIMP CPowerRenameUI::OnRegExCanceled(_In_ DWORD threadId)
+IFACEMETHODIMP CPowerRenameUI::OnRegExCanceled(_In_ DWORD regExId)
 {
-    if (m_currentRegExId == threadId)
+    if (m_currentRegExId == regExId)
     {
         m_disableCountUpdate = false;
         _UpdateCounts();
@@ -206,10 +212,10 @@ IFACEMETHODIMP CPowerRenameUI::OnRegExCanceled(_In_ DWORD threadId)
     return S_OK;
 }
 
-IFACEMETHODIMP CPowerRenameUI::OnRegExCompleted(_In_ DWORD threadId)
+IFACEMETHODIMP CPowerRenameUI::OnRegExCompleted(_In_ DWORD regExId)
 {
     // Enable list view
-    if (m_currentRegExId == threadId)
+    if (m_currentRegExId == regExId)
     {
         m_disableCountUpdate = false;
         _UpdateCounts();
@@ -354,6 +360,16 @@ HRESULT CPowerRenameUI::_InitAutoComplete()
 
 void CPowerRenameUI::_Cleanup()
 {
+    // Cancels a pending enumeration and waits for it to stop
+    m_enumerator.reset();
+    m_enumerating = false;
+    m_pendingDrops.clear();
+
+    // Waits for the icon lookups in progress
+    m_iconCache.reset();
+
+    PERF_SPAN_WRITE_TRACE(L"PowerRename");
+
     if (m_spsrm && m_cookie != 0)
     {
         m_spsrm->UnAdvise(m_cookie);
@@ -374,21 +390,159 @@ void CPowerRenameUI::_Cleanup()
 
 void CPowerRenameUI::_EnumerateItems(_In_ IUnknown* pdtobj)
 {
-    // Enumerate the data object and populate the manager
+    // Enumerate the data object and populate the manager. Items are streamed into the
+    // manager in the background and the list view grows as progress is reported.
     if (m_spsrm)
     {
-        m_disableCountUpdate = true;
-        EnumerateDataObject(pdtobj, m_spsrm);
-        m_disableCountUpdate = false;
+        // Dropped items are appended after the items of the running enumeration
+        if (m_enumerating)
+        {
+            _QueueDrop(pdtobj);
+            return;
+        }
+        m_enumerator.reset();
+
+        HWND hwnd = m_hwnd;
+        UINT generation = ++m_enumGeneration;
+        m_enumerator = std::make_unique<CPowerRenameEnum>(m_spsrm, [hwnd, generation](const PowerRenameEnumProgress& progress) {
+            PostMessage(hwnd, WM_POWERRENAME_ENUMPROGRESS, generation, progress.completed);
+        });
+
+        m_enumerating = SUCCEEDED(m_enumerator->Start(pdtobj));
+        if (!m_enumerating)
+        {
+            m_enumerator.reset();
+        }
 
         UINT itemCount = 0;
-        m_spsrm->GetItemCount(&itemCount);
+        m_spsrm->GetVisibleItemCount(&itemCount);
         m_listview.SetItemCount(itemCount);
 
         _UpdateCounts();
     }
 }
 
+void CPowerRenameUI::_QueueDrop(_In_ IUnknown* pdtobj)
+{
+    // The data object of a drop may not be usable once the drop is over, keep a copy of its items
+    CComPtr<IShellItemArray> spsia;
+    CComPtr<IDataObject> spdo;
+    if (SUCCEEDED(pdtobj->QueryInterface(IID_PPV_ARGS(&spdo))))
+    {
+        SHCreateShellItemArrayFromDataObject(spdo, IID_PPV_ARGS(&spsia));
+    }
+    else
+    {
+        pdtobj->QueryInterface(IID_PPV_ARGS(&spsia));
+    }
+
+    std::vector<PIDLIST_ABSOLUTE> idLists;
+    CComPtr<IEnumShellItems> spesi;
+    if (spsia && SUCCEEDED(spsia->EnumItems(&spesi)))
+    {
+        CComPtr<IShellItem> spsi;
+        while (spesi->Next(1, &spsi, nullptr) == S_OK)
+        {
+            PIDLIST_ABSOLUTE pidl = nullptr;
+            if (SUCCEEDED(SHGetIDListFromObject(spsi, &pidl)))
+            {
+                idLists.push_back(pidl);
+            }
+            spsi = nullptr;
+        }
+    }
+
+    CComPtr<IShellItemArray> spsiaCopy;
+    if (!idLists.empty() &&
+        SUCCEEDED(SHCreateShellItemArrayFromIDLists(static_cast<UINT>(idLists.size()), reinterpret_cast<PCIDLIST_ABSOLUTE_ARRAY>(idLists.data()), &spsiaCopy)))
+    {
+        m_pendingDrops.push_back(spsiaCopy);
+    }
+
+    for (auto pidl : idLists)
+    {
+        CoTaskMemFree(pidl);
+    }
+}
+
+bool CPowerRenameUI::_CancelEnumeration()
+{
+    if (!m_enumerating)
+    {
+        return false;
+    }
+
+    // The items added so far stay, the completion is reported as usual
+    m_pendingDrops.clear();
+    if (m_enumerator)
+    {
+        m_enumerator->Cancel();
+    }
+    return true;
+}
+
+void CPowerRenameUI::_OnEnumerateProgress(_In_ UINT generation, _In_ bool completed)
+{
+    // Ignore progress of an enumeration that was replaced by a newer one
+    if (!m_spsrm || generation != m_enumGeneration)
+    {
+        return;
+    }
+
+    UINT itemCount = 0;
+    m_spsrm->GetVisibleItemCount(&itemCount);
+    m_listview.SetItemCount(itemCount);
+
+    if (completed)
+    {
+        m_enumerating = false;
+        m_enumerator.reset();
+
+        if (!m_pendingDrops.empty())
+        {
+            CComPtr<IShellItemArray> spsia = m_pendingDrops.front();
+            m_pendingDrops.pop_front();
+            _EnumerateItems(spsia);
+            if (m_enumerating)
+            {
+                return;
+            }
+        }
+
+        // The search and replace terms may have been evaluated against part of the items,
+        // evaluate them again now that all of them are there.
+        CComPtr<IPowerRenameRegExEvents> spRegExEvents;
+        if (SUCCEEDED(m_spsrm->QueryInterface(IID_PPV_ARGS(&spRegExEvents))))
+        {
+            DWORD flags = 0;
+            m_spsrm->get_flags(&flags);
+            spRegExEvents->OnFlagsChanged(flags);
+        }
+
+        _UpdateCounts();
+        EnableWindow(GetDlgItem(m_hwnd, ID_RENAME), (m_renamingCount > 0));
+    }
+}
+
+void CPowerRenameUI::_OnIconsReady()
+{
+    if (m_iconCache)
+    {
+        // Icons resolved from now on post again, even while the rows are repainted
+        m_iconCache->ResumeNotifications();
+        m_listview.RedrawVisibleItems();
+    }
+}
+
+void CPowerRenameUI::_OnFilterChanged()
+{
+    const int filter = ComboBox_GetCurSel(GetDlgItem(m_hwnd, IDC_COMBO_FILTER));
+    if (m_spsrm && filter != CB_ERR && SUCCEEDED(m_spsrm->put_filter(filter)))
+    {
+        m_listview.UpdateItemCount(m_spsrm);
+    }
+}
+
 HRESULT CPowerRenameUI::_ReadSettings()
 {
     // Check if we should read flags from settings
@@ -456,6 +610,9 @@ HRESULT CPowerRenameUI::_WriteSettings()
 
 void CPowerRenameUI::_OnCloseDlg()
 {
+    // Stop the enumeration first so destroying the window doesn't wait for all the items
+    _CancelEnumeration();
+
     if (m_hwnd != NULL)
     {
         if (m_modeless)
@@ -481,6 +638,12 @@ void CPowerRenameUI::_OnDestroyDlg()
 
 void CPowerRenameUI::_OnRename()
 {
+    // Don't rename a partial list of items
+    if (m_enumerating)
+    {
+        return;
+    }
+
     if (m_spsrm)
     {
         m_spsrm->Rename(m_hwnd);
@@ -588,6 +751,14 @@ INT_PTR CPowerRenameUI::_DlgProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
         _OnDestroyDlg();
         break;
 
+    case WM_POWERRENAME_ENUMPROGRESS:
+        _OnEnumerateProgress(static_cast<UINT>(wParam), lParam != 0);
+        break;
+
+    case WM_POWERRENAME_ICONSREADY:
+        _OnIconsReady();
+        break;
+
     default:
         bRet = FALSE;
     }
@@ -600,6 +771,21 @@ void CPowerRenameUI::_OnInitDlg()
 
     m_listview.Init(m_hwndLV);
 
+    // In the order of PowerRenameFilter
+    HWND hwndFilter = GetDlgItem(m_hwnd, IDC_COMBO_FILTER);
+    for (UINT stringId : { IDS_FILTER_ALL, IDS_FILTER_CHANGED, IDS_FILTER_SELECTED, IDS_FILTER_CONFLICTS })
+    {
+        wchar_t filterName[100] = { 0 };
+        LoadString(g_hInst, stringId, filterName, ARRAYSIZE(filterName));
+        ComboBox_AddString(hwndFilter, filterName);
+    }
+    ComboBox_SetCurSel(hwndFilter, ShowAllItems);
+
+    HWND hwnd = m_hwnd;
+    m_iconCache = std::make_unique<CPowerRenameIconCache>([hwnd]() {
+        PostMessage(hwnd, WM_POWERRENAME_ICONSREADY, 0, 0);
+    });
+
     if (m_dataSource)
     {
         // Populate the manager from the data object
@@ -663,7 +849,11 @@ void CPowerRenameUI::_OnCommand(_In_ WPARAM wParam, _In_ LPARAM lParam)
         break;
 
     case IDCANCEL:
-        _OnCloseDlg();
+        // Cancel stops a running enumeration and keeps the items found so far, otherwise it closes
+        if (!_CancelEnumeration())
+        {
+            _OnCloseDlg();
+        }
         break;
 
     case IDC_EDIT_REPLACEWITH:
@@ -689,6 +879,13 @@ void CPowerRenameUI::_OnCommand(_In_ WPARAM wParam, _In_ LPARAM lParam)
             _GetFlagsFromCheckboxes();
         }
         break;
+
+    case IDC_COMBO_FILTER:
+        if (GET_WM_COMMAND_CMD(wParam, lParam) == CBN_SELCHANGE)
+        {
+            _OnFilterChanged();
+        }
+        break;
     }
 }
 
@@ -734,7 +931,7 @@ BOOL CPowerRenameUI::_OnNotify(_In_ WPARAM wParam, _In_ LPARAM lParam)
         case LVN_GETDISPINFO:
             if (m_spsrm)
             {
-                m_listview.GetDisplayInfo(m_spsrm, (LV_DISPINFO*)pnmlv);
+                m_listview.GetDisplayInfo(m_spsrm, m_iconCache.get(), (LV_DISPINFO*)pnmlv);
             }
             break;
 
@@ -911,31 +1108,35 @@ void CPowerRenameUI::_UpdateCounts()
 {
     // This method is CPU intensive.  We disable it during certain operations
     // for performance reasons.
-    if (m_disableCountUpdate)
+    if (m_disableCountUpdate || m_enumerating)
     {
         return;
     }
 
     UINT selectedCount = 0;
     UINT renamingCount = 0;
+    UINT conflictCount = 0;
     if (m_spsrm)
     {
         m_spsrm->GetSelectedItemCount(&selectedCount);
         m_spsrm->GetRenameItemCount(&renamingCount);
+        m_spsrm->GetConflictCount(&conflictCount);
     }
 
     if (m_selectedCount != selectedCount ||
-        m_renamingCount != renamingCount)
+        m_renamingCount != renamingCount ||
+        m_conflictCount != conflictCount)
     {
         m_selectedCount = selectedCount;
         m_renamingCount = renamingCount;
+        m_conflictCount = conflictCount;
 
-        // Update selected and rename count label
+        // Update selected and rename count label, with the name conflicts if there are any
         wchar_t countsLabelFormat[100] = { 0 };
-        LoadString(g_hInst, IDS_COUNTSLABELFMT, countsLabelFormat, ARRAYSIZE(countsLabelFormat));
+        LoadString(g_hInst, conflictCount > 0 ? IDS_COUNTSCONFLICTSLABELFMT : IDS_COUNTSLABELFMT, countsLabelFormat, ARRAYSIZE(countsLabelFormat));
 
         wchar_t countsLabel[100] = { 0 };
-        StringCchPrintf(countsLabel, ARRAYSIZE(countsLabel), countsLabelFormat, selectedCount, renamingCount);
+        StringCchPrintf(countsLabel, ARRAYSIZE(countsLabel), countsLabelFormat, selectedCount, renamingCount, conflictCount);
         SetDlgItemText(m_hwnd, IDC_STATUS_MESSAGE, countsLabel);
 
         // Update Rename button state
@@ -1022,31 +1223,48 @@ void CPowerRenameListView::ToggleAll(_In_ IPowerRenameManager* psrm, _In_ bool s
 {
     if (m_hwndLV)
     {
+        // Collected first, unselecting items changes the rows of the selected items filter
         UINT itemCount = 0;
-        psrm->GetItemCount(&itemCount);
+        psrm->GetVisibleItemCount(&itemCount);
+        std::vector<CComPtr<IPowerRenameItem>> items;
+        items.reserve(itemCount);
         for (UINT i = 0; i < itemCount; i++)
         {
             CComPtr<IPowerRenameItem> spItem;
-            if (SUCCEEDED(psrm->GetItemByIndex(i, &spItem)))
+            if (SUCCEEDED(psrm->GetVisibleItemByIndex(i, &spItem)))
             {
-                spItem->put_selected(selected);
+                items.push_back(spItem);
             }
         }
 
-        RedrawItems(0, itemCount);
+        for (auto& spItem : items)
+        {
+            psrm->SetItemSelected(spItem, selected);
+        }
+
+        UpdateItemCount(psrm);
     }
 }
 
 void CPowerRenameListView::ToggleItem(_In_ IPowerRenameManager* psrm, _In_ int item)
 {
     CComPtr<IPowerRenameItem> spItem;
-    if (SUCCEEDED(psrm->GetItemByIndex(item, &spItem)))
+    if (SUCCEEDED(psrm->GetVisibleItemByIndex(item, &spItem)))
     {
         bool selected = false;
         spItem->get_selected(&selected);
-        spItem->put_selected(!selected);
+        psrm->SetItemSelected(spItem, !selected);
 
-        RedrawItems(item, item);
+        DWORD filter = ShowAllItems;
+        psrm->get_filter(&filter);
+        if (filter == ShowSelectedItems)
+        {
+            UpdateItemCount(psrm);
+        }
+        else
+        {
+            RedrawItems(item, item);
+        }
     }
 }
 
@@ -1084,18 +1302,26 @@ void CPowerRenameListView::UpdateItemCheckState(_In_ IPowerRenameManager* psrm,
     if (psrm && m_hwndLV && (iItem > -1))
     {
         CComPtr<IPowerRenameItem> spItem;
-        if (SUCCEEDED(psrm->GetItemByIndex(iItem, &spItem)))
+        if (SUCCEEDED(psrm->GetVisibleItemByIndex(iItem, &spItem)))
         {
             bool checked = ListView_GetCheckState(m_hwndLV, iItem);
-            spItem->put_selected(checked);
+            psrm->SetItemSelected(spItem, checked);
 
             UINT uSelected = (checked) ? LVIS_SELECTED : 0;
             ListView_SetItemState(m_hwndLV, iItem, uSelected, LVIS_SELECTED);
 
-            // Update the rename column if necessary
-            int id = 0;
-            spItem->get_id(&id);
-            RedrawItems(id, id);
+            // Unchecked items drop out of the list when only the selected ones are shown,
+            // otherwise update the rename column if necessary
+            DWORD filter = ShowAllItems;
+            psrm->get_filter(&filter);
+            if (filter == ShowSelectedItems)
+            {
+                UpdateItemCount(psrm);
+            }
+            else
+            {
+                RedrawItems(iItem, iItem);
+            }
         }
 
         // Get the total number of list items and compare it to what is selected
@@ -1109,10 +1335,10 @@ void CPowerRenameListView::UpdateItemCheckState(_In_ IPowerRenameManager* psrm,
 #define COL_ORIGINAL_NAME 0
 #define COL_NEW_NAME 1
 
-void CPowerRenameListView::GetDisplayInfo(_In_ IPowerRenameManager* psrm, _Inout_ LV_DISPINFO* plvdi)
+void CPowerRenameListView::GetDisplayInfo(_In_ IPowerRenameManager* psrm, _In_opt_ CPowerRenameIconCache* iconCache, _Inout_ LV_DISPINFO* plvdi)
 {
     UINT count = 0;
-    psrm->GetItemCount(&count);
+    psrm->GetVisibleItemCount(&count);
     if (plvdi->item.iItem < 0 || plvdi->item.iItem > static_cast<int>(count))
     {
         // Invalid index
@@ -1120,11 +1346,26 @@ void CPowerRenameListView::GetDisplayInfo(_In_ IPowerRenameManager* psrm, _Inout
     }
 
     CComPtr<IPowerRenameItem> renameItem;
-    if (SUCCEEDED(psrm->GetItemByIndex((int)plvdi->item.iItem, &renameItem)))
+    if (SUCCEEDED(psrm->GetVisibleItemByIndex((int)plvdi->item.iItem, &renameItem)))
     {
+        // Gives the names without a copy, items that don't implement it are read the old way
+        CComPtr<IPowerRenameItem2> renameItemViews;
+        renameItem->QueryInterface(IID_PPV_ARGS(&renameItemViews));
+
         if (plvdi->item.mask & LVIF_IMAGE)
         {
-            renameItem->get_iconIndex(&plvdi->item.iImage);
+            // The cache never asks the shell on this thread, rows are repainted when their icon arrives
+            PCWSTR path = nullptr;
+            bool isFolder = false;
+            renameItem->get_isFolder(&isFolder);
+            if (iconCache && renameItemViews && SUCCEEDED(renameItemViews->get_pathView(&path)))
+            {
+                iconCache->GetIconIndex(path, isFolder, &plvdi->item.iImage);
+            }
+            else
+            {
+                renameItem->get_iconIndex(&plvdi->item.iImage);
+            }
         }
 
         if (plvdi->item.mask & LVIF_STATE)
@@ -1161,10 +1402,18 @@ void CPowerRenameListView::GetDisplayInfo(_In_ IPowerRenameManager* psrm, _Inout
 
         if (plvdi->item.mask & LVIF_TEXT)
         {
-            PWSTR subItemText = nullptr;
+            // Copied straight from the item, the names aren't duplicated for each call
+            bool copied = false;
             if (plvdi->item.iSubItem == COL_ORIGINAL_NAME)
             {
-                renameItem->get_originalName(&subItemText);
+                PCWSTR originalName = nullptr;
+                PWSTR originalNameCopy = nullptr;
+                if (renameItemViews ? SUCCEEDED(renameItemViews->get_originalNameView(&originalName)) : SUCCEEDED(renameItem->get_originalName(&originalNameCopy)))
+                {
+                    StringCchCopy(plvdi->item.pszText, plvdi->item.cchTextMax, originalNameCopy ? originalNameCopy : originalName);
+                    copied = true;
+                }
+                CoTaskMemFree(originalNameCopy);
             }
             else if (plvdi->item.iSubItem == COL_NEW_NAME)
             {
@@ -1173,13 +1422,29 @@ void CPowerRenameListView::GetDisplayInfo(_In_ IPowerRenameManager* psrm, _Inout
                 bool shouldRename = false;
                 if (SUCCEEDED(renameItem->ShouldRenameItem(flags, &shouldRename)) && shouldRename)
                 {
-                    renameItem->get_newName(&subItemText);
+                    if (renameItemViews)
+                    {
+                        // Writes an empty string when there is no new name
+                        renameItemViews->CopyNewName(plvdi->item.pszText, plvdi->item.cchTextMax);
+                        copied = true;
+                    }
+                    else
+                    {
+                        PWSTR newName = nullptr;
+                        if (SUCCEEDED(renameItem->get_newName(&newName)))
+                        {
+                            StringCchCopy(plvdi->item.pszText, plvdi->item.cchTextMax, newName);
+                            copied = true;
+                            CoTaskMemFree(newName);
+                        }
+                    }
                 }
             }
 
-            StringCchCopy(plvdi->item.pszText, plvdi->item.cchTextMax, subItemText ? subItemText : L"");
-            CoTaskMemFree(subItemText);
-            subItemText = nullptr;
+            if (!copied)
+            {
+                StringCchCopy(plvdi->item.pszText, plvdi->item.cchTextMax, L"");
+            }
         }
     }
 }
@@ -1197,11 +1462,28 @@ void CPowerRenameListView::RedrawItems(_In_ int first, _In_ int last)
     ListView_RedrawItems(m_hwndLV, first, last);
 }
 
+void CPowerRenameListView::RedrawVisibleItems()
+{
+    const int first = ListView_GetTopIndex(m_hwndLV);
+    RedrawItems(first, first + ListView_GetCountPerPage(m_hwndLV));
+}
+
 void CPowerRenameListView::SetItemCount(_In_ UINT itemCount)
 {
     ListView_SetItemCount(m_hwndLV, itemCount);
 }
 
+void CPowerRenameListView::UpdateItemCount(_In_ IPowerRenameManager* psrm)
+{
+    UINT itemCount = 0;
+    psrm->GetVisibleItemCount(&itemCount);
+    if (static_cast<int>(itemCount) != ListView_GetItemCount(m_hwndLV))
+    {
+        SetItemCount(itemCount);
+    }
+    RedrawItems(0, itemCount);
+}
+
 void CPowerRenameListView::_UpdateColumns()
 {
     if (m_hwndLV)
@@ -1,7 +1,10 @@
 #pragma once
 #include <PowerRenameInterfaces.h>
+#include <PowerRenameEnum.h>
+#include <PowerRenameIconCache.h>
 #include <settings.h>
 #include <shldisp.h>
+#include <deque>
 
 void ModuleAddRef();
 void ModuleRelease();
@@ -17,10 +20,13 @@ public:
     void ToggleItem(_In_ IPowerRenameManager* psrm, _In_ int item);
     void UpdateItemCheckState(_In_ IPowerRenameManager* psrm, _In_ int iItem);
     void RedrawItems(_In_ int first, _In_ int last);
+    void RedrawVisibleItems();
     void SetItemCount(_In_ UINT itemCount);
+    // Sizes the list to the items of the current filter and repaints every row
+    void UpdateItemCount(_In_ IPowerRenameManager* psrm);
     void OnKeyDown(_In_ IPowerRenameManager* psrm, _In_ LV_KEYDOWN* lvKeyDown);
     void OnClickList(_In_ IPowerRenameManager* psrm, NM_LISTVIEW* pnmListView);
-    void GetDisplayInfo(_In_ IPowerRenameManager* psrm, _Inout_ LV_DISPINFO* plvdi);
+    void GetDisplayInfo(_In_ IPowerRenameManager* psrm, _In_opt_ CPowerRenameIconCache* iconCache, _Inout_ LV_DISPINFO* plvdi);
     void OnSize();
     HWND GetHWND() { return m_hwndLV; }
 
@@ -58,9 +64,9 @@ public:
     IFACEMETHODIMP OnItemAdded(_In_ IPowerRenameItem* renameItem);
     IFACEMETHODIMP OnUpdate(_In_ IPowerRenameItem* renameItem);
     IFACEMETHODIMP OnError(_In_ IPowerRenameItem* renameItem);
-    IFACEMETHODIMP OnRegExStarted(_In_ DWORD threadId);
-    IFACEMETHODIMP OnRegExCanceled(_In_ DWORD threadId);
-    IFACEMETHODIMP OnRegExCompleted(_In_ DWORD threadId);
+    IFACEMETHODIMP OnRegExStarted(_In_ DWORD regExId);
+    IFACEMETHODIMP OnRegExCanceled(_In_ DWORD regExId);
+    IFACEMETHODIMP OnRegExCompleted(_In_ DWORD regExId);
     IFACEMETHODIMP OnRenameStarted();
     IFACEMETHODIMP OnRenameCompleted();
 
@@ -137,6 +143,11 @@ private:
     void _ValidateFlagCheckbox(_In_ DWORD checkBoxId);
 
     void _EnumerateItems(_In_ IUnknown* pdtobj);
+    void _QueueDrop(_In_ IUnknown* pdtobj);
+    bool _CancelEnumeration();
+    void _OnEnumerateProgress(_In_ UINT generation, _In_ bool completed);
+    void _OnIconsReady();
+    void _OnFilterChanged();
     void _UpdateCounts();
 
     void _CollectItemPosition(_In_ DWORD id);
@@ -145,6 +156,8 @@ private:
     bool m_initialized = false;
     bool m_enableDragDrop = false;
     bool m_disableCountUpdate = false;
+    bool m_enumerating = false;
+    UINT m_enumGeneration = 0;
     bool m_modeless = true;
     HWND m_hwnd = nullptr;
     HWND m_hwndLV = nullptr;
@@ -153,6 +166,7 @@ private:
     DWORD m_currentRegExId = 0;
     UINT m_selectedCount = 0;
     UINT m_renamingCount = 0;
+    UINT m_conflictCount = 0;
     UINT m_initialDPI = 0;
     DialogItemsPositioning m_itemsPositioning {};
     int m_initialWidth = 0;
@@ -161,6 +175,10 @@ private:
     int m_lastHeight = 0;
     CComPtr<IPowerRenameManager> m_spsrm;
     CComPtr<IUnknown> m_dataSource;
+    std::unique_ptr<CPowerRenameEnum> m_enumerator;
+    // Items dropped while an enumeration runs, enumerated once it completes
+    std::deque<CComPtr<IShellItemArray>> m_pendingDrops;
+    std::unique_ptr<CPowerRenameIconCache> m_iconCache;
     CComPtr<IDropTargetHelper> m_spdth;
     CComPtr<IAutoComplete2> m_spSearchAC;
     CComPtr<IUnknown> m_spSearchACL;
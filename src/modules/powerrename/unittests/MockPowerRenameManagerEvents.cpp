@@ -47,21 +47,24 @@ IFACEMETHODIMP CMockPowerRenameManagerEvents::OnError(_In_ IPowerRenameItem* pIt
     return S_OK;
 }
 
-IFACEMETHODIMP CMockPowerRenameManagerEvents::OnRegExStarted(_In_ DWORD threadId)
+IFACEMETHODIMP CMockPowerRenameManagerEvents::OnRegExStarted(_In_ DWORD regExId)
 {
     m_regExStarted = true;
+    m_regExRunningCount++;
     return S_OK;
 }
 
-IFACEMETHODIMP CMockPowerRenameManagerEvents::OnRegExCanceled(_In_ DWORD threadId)
+IFACEMETHODIMP CMockPowerRenameManagerEvents::OnRegExCanceled(_In_ DWORD regExId)
 {
     m_regExCanceled = true;
+    m_regExRunningCount--;
     return S_OK;
 }
 
-IFACEMETHODIMP CMockPowerRenameManagerEvents::OnRegExCompleted(_In_ DWORD threadId)
+IFACEMETHODIMP CMockPowerRenameManagerEvents::OnRegExCompleted(_In_ DWORD regExId)
 {
     m_regExCompleted = true;
+    m_regExRunningCount--;
     return S_OK;
 }
 
@@ -21,9 +21,9 @@ public:
     IFACEMETHODIMP OnItemAdded(_In_ IPowerRenameItem* renameItem);
     IFACEMETHODIMP OnUpdate(_In_ IPowerRenameItem* renameItem);
     IFACEMETHODIMP OnError(_In_ IPowerRenameItem* renameItem);
-    IFACEMETHODIMP OnRegExStarted(_In_ DWORD threadId);
-    IFACEMETHODIMP OnRegExCanceled(_In_ DWORD threadId);
-    IFACEMETHODIMP OnRegExCompleted(_In_ DWORD threadId);
+    IFACEMETHODIMP OnRegExStarted(_In_ DWORD regExId);
+    IFACEMETHODIMP OnRegExCanceled(_In_ DWORD regExId);
+    IFACEMETHODIMP OnRegExCompleted(_In_ DWORD regExId);
     IFACEMETHODIMP OnRenameStarted();
     IFACEMETHODIMP OnRenameCompleted();
 
@@ -39,6 +39,8 @@ public:
     bool m_regExStarted = false;
     bool m_regExCanceled = false;
     bool m_regExCompleted = false;
+    // Requests reported as started and not yet as canceled or completed
+    int m_regExRunningCount = 0;
     bool m_renameStarted = false;
     bool m_renameCompleted = false;
     long m_refCount = 0;
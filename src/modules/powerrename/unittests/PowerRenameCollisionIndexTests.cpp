@@ -0,0 +1,146 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <PowerRenameCollisionIndex.h>
+#include <map>
+#include "TestFileHelper.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace PowerRenameCollisionIndexTests
+{
+    TEST_CLASS(SimpleTests)
+    {
+    public:
+        TEST_METHOD(VerifyDuplicateTargets)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFile(L"a.txt"));
+            Assert::IsTrue(testFileHelper.AddFile(L"b.txt"));
+
+            CPowerRenameCollisionIndex index;
+            index.SetTarget(1, testFileHelper.GetFullPath(L"a.txt").c_str(), L"c.txt");
+            Assert::IsFalse(index.HasConflict(1));
+            index.SetTarget(2, testFileHelper.GetFullPath(L"b.txt").c_str(), L"C.TXT");
+            Assert::IsTrue(index.HasConflict(1));
+            Assert::IsTrue(index.HasConflict(2));
+            Assert::AreEqual(1u, index.ConflictCount());
+
+            index.SetTarget(2, testFileHelper.GetFullPath(L"b.txt").c_str(), L"d.txt");
+            Assert::IsFalse(index.HasConflict(1));
+            Assert::IsFalse(index.HasConflict(2));
+            Assert::AreEqual(0u, index.ConflictCount());
+        }
+
+        TEST_METHOD(VerifyConflictCallback)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFile(L"a.txt"));
+            Assert::IsTrue(testFileHelper.AddFile(L"b.txt"));
+            Assert::IsTrue(testFileHelper.AddFile(L"c.txt"));
+
+            std::map<int, bool> conflicts;
+            CPowerRenameCollisionIndex index;
+            index.SetConflictCallback([&conflicts](int id, bool conflict) { conflicts[id] = conflict; });
+
+            index.SetTarget(1, testFileHelper.GetFullPath(L"a.txt").c_str(), L"d.txt");
+            index.SetTarget(2, testFileHelper.GetFullPath(L"b.txt").c_str(), L"d.txt");
+            index.SetTarget(3, testFileHelper.GetFullPath(L"c.txt").c_str(), L"d.txt");
+            Assert::IsTrue(conflicts[1] && conflicts[2] && conflicts[3]);
+
+            // The items left with the name are told once it's no longer shared
+            index.SetTarget(2, testFileHelper.GetFullPath(L"b.txt").c_str(), L"e.txt");
+            Assert::IsTrue(conflicts[1] && !conflicts[2] && conflicts[3]);
+            index.SetTarget(3, testFileHelper.GetFullPath(L"c.txt").c_str(), nullptr);
+            Assert::IsFalse(conflicts[1] || conflicts[3]);
+        }
+
+        TEST_METHOD(VerifyExistingFile)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFile(L"a.txt"));
+            Assert::IsTrue(testFileHelper.AddFile(L"existing.txt"));
+
+            CPowerRenameCollisionIndex index;
+            index.SetTarget(1, testFileHelper.GetFullPath(L"a.txt").c_str(), L"Existing.txt");
+            Assert::IsTrue(index.HasConflict(1));
+            Assert::AreEqual(1u, index.ConflictCount());
+
+            // Back to its own name
+            index.SetTarget(1, testFileHelper.GetFullPath(L"a.txt").c_str(), nullptr);
+            Assert::IsFalse(index.HasConflict(1));
+            Assert::AreEqual(0u, index.ConflictCount());
+        }
+
+        TEST_METHOD(VerifySwapAndCaseOnlyRename)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFile(L"a.txt"));
+            Assert::IsTrue(testFileHelper.AddFile(L"b.txt"));
+            Assert::IsTrue(testFileHelper.AddFile(L"c.txt"));
+
+            CPowerRenameCollisionIndex index;
+            index.SetTarget(1, testFileHelper.GetFullPath(L"a.txt").c_str(), L"b.txt");
+            index.SetTarget(2, testFileHelper.GetFullPath(L"b.txt").c_str(), L"a.txt");
+            index.SetTarget(3, testFileHelper.GetFullPath(L"c.txt").c_str(), L"C.txt");
+            Assert::IsFalse(index.HasConflict(1));
+            Assert::IsFalse(index.HasConflict(2));
+            Assert::IsFalse(index.HasConflict(3));
+            Assert::AreEqual(0u, index.ConflictCount());
+        }
+
+        TEST_METHOD(VerifyOtherFolder)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFolder(L"sub"));
+            Assert::IsTrue(testFileHelper.AddFile(L"a.txt"));
+            Assert::IsTrue(testFileHelper.AddFile(L"sub\\b.txt"));
+
+            CPowerRenameCollisionIndex index;
+            index.SetTarget(1, testFileHelper.GetFullPath(L"a.txt").c_str(), L"c.txt");
+            index.SetTarget(2, testFileHelper.GetFullPath(L"sub\\b.txt").c_str(), L"c.txt");
+            Assert::IsFalse(index.HasConflict(1));
+            Assert::IsFalse(index.HasConflict(2));
+        }
+
+        TEST_METHOD(VerifyEnumeratedNames)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFile(L"foo1.txt"));
+            Assert::IsTrue(testFileHelper.AddFile(L"foo2.txt"));
+            Assert::IsTrue(testFileHelper.AddFile(L"foo3.txt"));
+            Assert::IsTrue(testFileHelper.AddFile(L"bar (1).txt"));
+            Assert::IsTrue(testFileHelper.AddFile(L"BAR (2).TXT"));
+            Assert::IsTrue(testFileHelper.AddFile(L"bar (04).txt"));
+
+            CPowerRenameCollisionIndex index;
+            std::wstring name;
+            Assert::IsTrue(index.GetEnumeratedName(1, testFileHelper.GetFullPath(L"foo1.txt").c_str(), L"bar.txt", 1, name));
+            Assert::AreEqual(std::wstring(L"bar (3).txt"), name);
+            index.SetTarget(1, testFileHelper.GetFullPath(L"foo1.txt").c_str(), name.c_str());
+
+            // The number of the template is replaced, "(04)" isn't a number enumerated names use
+            Assert::IsTrue(index.GetEnumeratedName(2, testFileHelper.GetFullPath(L"foo2.txt").c_str(), L"bar (9).txt", 2, name));
+            Assert::AreEqual(std::wstring(L"bar (4).txt"), name);
+            index.SetTarget(2, testFileHelper.GetFullPath(L"foo2.txt").c_str(), name.c_str());
+
+            Assert::IsTrue(index.GetEnumeratedName(3, testFileHelper.GetFullPath(L"foo3.txt").c_str(), L"baz", 3, name));
+            Assert::AreEqual(std::wstring(L"baz (3)"), name);
+            Assert::AreEqual(0u, index.ConflictCount());
+        }
+
+        TEST_METHOD(VerifyEnumeratedNameKeepsOwnName)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFile(L"bar (1).txt"));
+
+            CPowerRenameCollisionIndex index;
+            std::wstring name;
+            Assert::IsTrue(index.GetEnumeratedName(1, testFileHelper.GetFullPath(L"bar (1).txt").c_str(), L"bar.txt", 1, name));
+            Assert::AreEqual(std::wstring(L"bar (1).txt"), name);
+
+            index.SetTarget(1, testFileHelper.GetFullPath(L"bar (1).txt").c_str(), L"bar (5).txt");
+            Assert::IsTrue(index.GetEnumeratedName(1, testFileHelper.GetFullPath(L"bar (1).txt").c_str(), L"bar.txt", 5, name));
+            Assert::AreEqual(std::wstring(L"bar (5).txt"), name);
+        }
+    };
+}
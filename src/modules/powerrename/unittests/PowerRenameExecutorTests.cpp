@@ -0,0 +1,217 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <lib/PowerRenameExecutor.h>
+#include "TestFileHelper.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace PowerRenameExecutorTests
+{
+    TEST_CLASS(SimpleTests)
+    {
+    public:
+        RenameOperation Operation(CTestFileHelper& testFileHelper, PCWSTR path, PCWSTR newName, UINT depth = 0)
+        {
+            return { testFileHelper.GetFullPath(path).wstring(), newName, depth };
+        }
+
+        TEST_METHOD(VerifyRename)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFile(L"foo1.txt"));
+            Assert::IsTrue(testFileHelper.AddFile(L"foo2.txt"));
+
+            CPowerRenameExecutor executor({ Operation(testFileHelper, L"foo1.txt", L"bar1.txt"),
+                                            Operation(testFileHelper, L"foo2.txt", L"bar2.txt") });
+            Assert::IsTrue(executor.Plan() == S_OK);
+            Assert::IsTrue(executor.Collisions().empty());
+
+            CRenameJournal journal;
+            Assert::IsTrue(executor.Execute(journal) == S_OK);
+            Assert::AreEqual(size_t{ 2 }, journal.Count());
+            Assert::AreEqual(size_t{ 2 }, executor.Stats().renamedCount);
+            Assert::IsFalse(testFileHelper.PathExists(L"foo1.txt"));
+            Assert::IsTrue(testFileHelper.PathExists(L"bar1.txt"));
+            Assert::IsTrue(testFileHelper.PathExists(L"bar2.txt"));
+        }
+
+        TEST_METHOD(VerifyChildrenRenamedBeforeParent)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFolder(L"foo"));
+            Assert::IsTrue(testFileHelper.AddFolder(L"foo\\foo"));
+            Assert::IsTrue(testFileHelper.AddFile(L"foo\\foo\\foo.txt"));
+
+            CPowerRenameExecutor executor({ Operation(testFileHelper, L"foo", L"bar", 0),
+                                            Operation(testFileHelper, L"foo\\foo", L"bar", 1),
+                                            Operation(testFileHelper, L"foo\\foo\\foo.txt", L"bar.txt", 2) });
+            Assert::IsTrue(executor.Plan() == S_OK);
+            Assert::AreEqual(size_t{ 3 }, executor.Stats().levelCount);
+
+            CRenameJournal journal;
+            Assert::IsTrue(executor.Execute(journal) == S_OK);
+            Assert::IsTrue(testFileHelper.PathExists(L"bar\\bar\\bar.txt"));
+        }
+
+        TEST_METHOD(VerifyDuplicateTargetCollision)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFile(L"foo1.txt"));
+            Assert::IsTrue(testFileHelper.AddFile(L"foo2.txt"));
+
+            CPowerRenameExecutor executor({ Operation(testFileHelper, L"foo1.txt", L"bar.txt"),
+                                            Operation(testFileHelper, L"foo2.txt", L"BAR.txt") });
+            Assert::IsTrue(executor.Plan() == S_OK);
+            Assert::AreEqual(size_t{ 1 }, executor.Collisions().size());
+            Assert::AreEqual(size_t{ 1 }, executor.Collisions()[0].operation);
+            Assert::AreEqual(size_t{ 0 }, executor.Collisions()[0].other);
+
+            // Nothing is renamed while there are collisions
+            CRenameJournal journal;
+            Assert::IsTrue(FAILED(executor.Execute(journal)));
+            Assert::IsTrue(testFileHelper.PathExists(L"foo1.txt"));
+        }
+
+        TEST_METHOD(VerifyExistingItemCollision)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFile(L"foo.txt"));
+            Assert::IsTrue(testFileHelper.AddFile(L"bar.txt"));
+
+            CPowerRenameExecutor executor({ Operation(testFileHelper, L"foo.txt", L"bar.txt") });
+            Assert::IsTrue(executor.Plan() == S_OK);
+            Assert::AreEqual(size_t{ 1 }, executor.Collisions().size());
+            Assert::IsTrue(executor.Collisions()[0].other == RenameCollision::existingItem);
+        }
+
+        TEST_METHOD(VerifyChainedRenames)
+        {
+            // a -> b and b -> c, b has to be renamed first
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFile(L"a"));
+            Assert::IsTrue(testFileHelper.AddFile(L"b"));
+
+            CPowerRenameExecutor executor({ Operation(testFileHelper, L"a", L"b"),
+                                            Operation(testFileHelper, L"b", L"c") });
+            Assert::IsTrue(executor.Plan() == S_OK);
+            Assert::IsTrue(executor.Collisions().empty());
+
+            CRenameJournal journal;
+            Assert::IsTrue(executor.Execute(journal) == S_OK);
+            Assert::IsFalse(testFileHelper.PathExists(L"a"));
+            Assert::IsTrue(testFileHelper.PathExists(L"b"));
+            Assert::IsTrue(testFileHelper.PathExists(L"c"));
+        }
+
+        TEST_METHOD(VerifySwapCollision)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFile(L"a"));
+            Assert::IsTrue(testFileHelper.AddFile(L"b"));
+
+            CPowerRenameExecutor executor({ Operation(testFileHelper, L"a", L"b"),
+                                            Operation(testFileHelper, L"b", L"a") });
+            Assert::IsTrue(executor.Plan() == S_OK);
+            Assert::AreEqual(size_t{ 1 }, executor.Collisions().size());
+        }
+
+        TEST_METHOD(VerifyCaseOnlyRename)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFile(L"foo.txt"));
+
+            CPowerRenameExecutor executor({ Operation(testFileHelper, L"foo.txt", L"FOO.txt") });
+            Assert::IsTrue(executor.Plan() == S_OK);
+            Assert::IsTrue(executor.Collisions().empty());
+        }
+
+        TEST_METHOD(VerifyInvalidName)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFile(L"foo.txt"));
+
+            CPowerRenameExecutor executor({ Operation(testFileHelper, L"foo.txt", L"bar?.txt") });
+            Assert::IsTrue(executor.Plan() == E_INVALIDARG);
+        }
+
+        TEST_METHOD(VerifyJournalRollback)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFolder(L"foo"));
+            Assert::IsTrue(testFileHelper.AddFile(L"foo\\foo.txt"));
+
+            CPowerRenameExecutor executor({ Operation(testFileHelper, L"foo", L"bar", 0),
+                                            Operation(testFileHelper, L"foo\\foo.txt", L"bar.txt", 1) });
+            Assert::IsTrue(executor.Plan() == S_OK);
+
+            CRenameJournal journal;
+            Assert::IsTrue(executor.Execute(journal) == S_OK);
+            Assert::IsTrue(testFileHelper.PathExists(L"bar\\bar.txt"));
+
+            // The parent is renamed back before its child
+            Assert::AreEqual(size_t{ 2 }, journal.Count());
+            Assert::IsTrue(journal.Rollback() == S_OK);
+            Assert::AreEqual(size_t{ 0 }, journal.Count());
+            Assert::IsTrue(testFileHelper.PathExists(L"foo\\foo.txt"));
+            Assert::IsFalse(testFileHelper.PathExists(L"bar"));
+        }
+
+        TEST_METHOD(VerifyJournalSaveAndLoad)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFolder(L"foo"));
+            Assert::IsTrue(testFileHelper.AddFile(L"foo\\foo.txt"));
+            Assert::IsTrue(testFileHelper.AddFile(L"foo2.txt"));
+
+            CPowerRenameExecutor executor({ Operation(testFileHelper, L"foo", L"bar", 0),
+                                            Operation(testFileHelper, L"foo2.txt", L"bar2.txt", 0),
+                                            Operation(testFileHelper, L"foo\\foo.txt", L"bar.txt", 1) });
+            Assert::IsTrue(executor.Plan() == S_OK);
+
+            const std::wstring journalPath = testFileHelper.GetFullPath(L"journal").wstring();
+            {
+                CRenameJournal journal;
+                Assert::IsTrue(executor.Execute(journal) == S_OK);
+                Assert::AreEqual(size_t{ 2 }, journal.Directories().size());
+                Assert::IsTrue(journal.Save(journalPath) == S_OK);
+            }
+            Assert::IsTrue(testFileHelper.PathExists(L"bar\\bar.txt"));
+            Assert::IsTrue(testFileHelper.PathExists(L"bar2.txt"));
+
+            // A later session undoes the batch from the saved journal
+            CRenameJournal journal;
+            Assert::IsTrue(journal.Load(journalPath) == S_OK);
+            Assert::AreEqual(size_t{ 3 }, journal.Count());
+            Assert::IsTrue(journal.Rollback() == S_OK);
+            Assert::IsTrue(testFileHelper.PathExists(L"foo\\foo.txt"));
+            Assert::IsTrue(testFileHelper.PathExists(L"foo2.txt"));
+            Assert::IsFalse(testFileHelper.PathExists(L"bar"));
+        }
+
+        TEST_METHOD(VerifyJournalLoadMissingFile)
+        {
+            CTestFileHelper testFileHelper;
+            CRenameJournal journal;
+            Assert::IsTrue(FAILED(journal.Load(testFileHelper.GetFullPath(L"journal").wstring())));
+            Assert::AreEqual(size_t{ 0 }, journal.Count());
+        }
+
+        TEST_METHOD(VerifyFailedBatchRolledBack)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFile(L"foo1.txt"));
+            Assert::IsTrue(testFileHelper.AddFile(L"foo2.txt"));
+
+            // The second item doesn't exist, the first rename has to be undone
+            CPowerRenameExecutor executor({ Operation(testFileHelper, L"foo1.txt", L"bar1.txt"),
+                                            Operation(testFileHelper, L"missing.txt", L"bar2.txt") });
+            Assert::IsTrue(executor.Plan() == S_OK);
+
+            CRenameJournal journal;
+            Assert::IsTrue(FAILED(executor.Execute(journal)));
+            Assert::IsTrue(executor.Stats().rolledBack);
+            Assert::IsTrue(testFileHelper.PathExists(L"foo1.txt"));
+            Assert::IsFalse(testFileHelper.PathExists(L"bar1.txt"));
+        }
+    };
+}
@@ -0,0 +1,101 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <PowerRenameIconCache.h>
+#include "TestFileHelper.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace PowerRenameIconCacheTests
+{
+    TEST_CLASS(SimpleTests)
+    {
+    public:
+        TEST_METHOD(VerifyIconKeys)
+        {
+            bool perFile = false;
+            Assert::AreEqual(std::wstring(L".TXT"), CPowerRenameIconCache::IconKey(L"c:\\foo\\a.txt", false, &perFile));
+            Assert::IsFalse(perFile);
+            Assert::AreEqual(std::wstring(L".TXT"), CPowerRenameIconCache::IconKey(L"c:\\foo\\B.Txt", false, &perFile));
+            Assert::AreEqual(std::wstring(L""), CPowerRenameIconCache::IconKey(L"c:\\foo\\noext", false, &perFile));
+            Assert::IsFalse(perFile);
+
+            Assert::AreEqual(std::wstring(L"C:\\FOO\\APP.EXE"), CPowerRenameIconCache::IconKey(L"c:\\foo\\app.exe", false, &perFile));
+            Assert::IsTrue(perFile);
+            Assert::AreEqual(std::wstring(L"C:\\FOO\\LINK.LNK"), CPowerRenameIconCache::IconKey(L"c:\\foo\\link.lnk", false, &perFile));
+            Assert::IsTrue(perFile);
+            Assert::AreEqual(std::wstring(L"C:\\FOO\\DIR.TXT"), CPowerRenameIconCache::IconKey(L"c:\\foo\\dir.txt", true, &perFile));
+            Assert::IsTrue(perFile);
+        }
+
+        TEST_METHOD(VerifyOneLookupPerExtension)
+        {
+            CTestFileHelper testFileHelper;
+            HANDLE iconsReady = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+            CPowerRenameIconCache cache([iconsReady]() { SetEvent(iconsReady); });
+
+            const int itemCount = 100;
+            for (int i = 0; i < itemCount; i++)
+            {
+                Assert::IsTrue(testFileHelper.AddFile(L"foo" + std::to_wstring(i) + L".txt"));
+            }
+
+            // Unknown at first, the placeholder is returned and a single lookup is queued
+            int index = -1;
+            for (int i = 0; i < itemCount; i++)
+            {
+                Assert::IsFalse(cache.GetIconIndex(testFileHelper.GetFullPath(L"foo" + std::to_wstring(i) + L".txt").c_str(), false, &index));
+                Assert::AreNotEqual(-1, index);
+            }
+
+            Assert::AreEqual(static_cast<DWORD>(WAIT_OBJECT_0), WaitForSingleObject(iconsReady, 10000));
+            Assert::IsTrue(cache.WaitForLookups(1, 10000));
+            int first = -1;
+            Assert::IsTrue(cache.GetIconIndex(testFileHelper.GetFullPath(L"foo0.txt").c_str(), false, &first));
+            for (int i = 1; i < itemCount; i++)
+            {
+                Assert::IsTrue(cache.GetIconIndex(testFileHelper.GetFullPath(L"foo" + std::to_wstring(i) + L".txt").c_str(), false, &index));
+                Assert::AreEqual(first, index);
+            }
+            Assert::AreEqual(size_t{ 1 }, cache.LookupCount());
+
+            CloseHandle(iconsReady);
+        }
+
+        TEST_METHOD(VerifyPerFileLookupsAndNotifications)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFolder(L"a"));
+            Assert::IsTrue(testFileHelper.AddFolder(L"b"));
+            Assert::IsTrue(testFileHelper.AddFile(L"a.lnk"));
+
+            std::atomic<int> notifications = 0;
+            HANDLE iconsReady = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+            CPowerRenameIconCache cache([&notifications, iconsReady]() {
+                notifications++;
+                SetEvent(iconsReady);
+            });
+
+            int index = -1;
+            cache.GetIconIndex(testFileHelper.GetFullPath(L"a").c_str(), true, &index);
+            cache.GetIconIndex(testFileHelper.GetFullPath(L"b").c_str(), true, &index);
+            cache.GetIconIndex(testFileHelper.GetFullPath(L"a.lnk").c_str(), false, &index);
+
+            // Every path is looked up, the owner only hears about it once until it resumes notifications
+            // Waits for the lookups to be done with, not only stored, so no notification is still on its way
+            Assert::IsTrue(cache.WaitForLookups(3, 10000));
+            Assert::AreEqual(size_t{ 3 }, cache.LookupCount());
+            Assert::AreEqual(1, notifications.load());
+            Assert::AreEqual(static_cast<DWORD>(WAIT_OBJECT_0), WaitForSingleObject(iconsReady, 0));
+
+            cache.ResumeNotifications();
+            Assert::IsTrue(testFileHelper.AddFolder(L"c"));
+            cache.GetIconIndex(testFileHelper.GetFullPath(L"c").c_str(), true, &index);
+            Assert::IsTrue(cache.WaitForLookups(4, 10000));
+            Assert::AreEqual(static_cast<DWORD>(WAIT_OBJECT_0), WaitForSingleObject(iconsReady, 0));
+            Assert::AreEqual(2, notifications.load());
+            Assert::IsTrue(cache.GetIconIndex(testFileHelper.GetFullPath(L"c").c_str(), true, &index));
+
+            CloseHandle(iconsReady);
+        }
+    };
+}
@@ -0,0 +1,100 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <PowerRenameItemFilters.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace PowerRenameItemFiltersTests
+{
+    TEST_CLASS(SimpleTests)
+    {
+    public:
+        TEST_METHOD(VerifyRowsOfEachFilter)
+        {
+            CPowerRenameItemFilters filters;
+            for (int id = 0; id < 100; id++)
+            {
+                filters.AddItem(id, id % 2 == 0);
+            }
+
+            Assert::AreEqual(100u, filters.Count(ShowAllItems));
+            Assert::AreEqual(50u, filters.Count(ShowSelectedItems));
+            Assert::AreEqual(0u, filters.Count(ShowChangedItems));
+
+            int id = -1;
+            for (UINT row = 0; row < 50; row++)
+            {
+                Assert::IsTrue(filters.GetId(ShowSelectedItems, row, &id));
+                Assert::AreEqual(static_cast<int>(row * 2), id);
+            }
+            Assert::IsFalse(filters.GetId(ShowSelectedItems, 50, &id));
+            Assert::IsTrue(filters.GetId(ShowAllItems, 99, &id));
+            Assert::AreEqual(99, id);
+            Assert::IsFalse(filters.GetId(ShowAllItems, 100, &id));
+
+            filters.SetMember(97, ShowChangedItems, true);
+            filters.SetMember(3, ShowChangedItems, true);
+            filters.SetMember(3, ShowChangedItems, true);
+            Assert::AreEqual(2u, filters.Count(ShowChangedItems));
+            Assert::IsTrue(filters.GetId(ShowChangedItems, 0, &id));
+            Assert::AreEqual(3, id);
+            Assert::IsTrue(filters.GetId(ShowChangedItems, 1, &id));
+            Assert::AreEqual(97, id);
+
+            filters.SetMember(3, ShowChangedItems, false);
+            Assert::AreEqual(1u, filters.Count(ShowChangedItems));
+            Assert::IsTrue(filters.GetId(ShowChangedItems, 0, &id));
+            Assert::AreEqual(97, id);
+        }
+
+        TEST_METHOD(VerifyItemAddedOutOfOrder)
+        {
+            CPowerRenameItemFilters filters;
+            filters.AddItem(10, true);
+            filters.AddItem(30, true);
+            filters.AddItem(20, false);
+            filters.AddItem(5, true);
+            filters.AddItem(20, true);
+
+            Assert::AreEqual(4u, filters.Count(ShowAllItems));
+            Assert::AreEqual(3u, filters.Count(ShowSelectedItems));
+
+            const int expected[] = { 5, 10, 30 };
+            int id = -1;
+            for (UINT row = 0; row < ARRAYSIZE(expected); row++)
+            {
+                Assert::IsTrue(filters.GetId(ShowSelectedItems, row, &id));
+                Assert::AreEqual(expected[row], id);
+            }
+
+            filters.SetMember(20, ShowSelectedItems, true);
+            Assert::IsTrue(filters.GetId(ShowSelectedItems, 2, &id));
+            Assert::AreEqual(20, id);
+        }
+
+        TEST_METHOD(VerifyClearFilter)
+        {
+            CPowerRenameItemFilters filters;
+            for (int id = 0; id < 10; id++)
+            {
+                filters.AddItem(id, true);
+                filters.SetMember(id, ShowConflictItems, true);
+            }
+
+            filters.ClearFilter(ShowConflictItems);
+            Assert::AreEqual(0u, filters.Count(ShowConflictItems));
+            Assert::AreEqual(10u, filters.Count(ShowSelectedItems));
+
+            // Items added after the clear keep working
+            filters.AddItem(10, false);
+            filters.SetMember(10, ShowConflictItems, true);
+            int id = -1;
+            Assert::IsTrue(filters.GetId(ShowConflictItems, 0, &id));
+            Assert::AreEqual(10, id);
+
+            filters.Clear();
+            Assert::AreEqual(0u, filters.Count(ShowAllItems));
+            Assert::IsFalse(filters.GetId(ShowAllItems, 0, &id));
+        }
+    };
+}
@@ -0,0 +1,143 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <PowerRenameItem.h>
+#include <PowerRenameItemStore.h>
+#include "TestFileHelper.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace PowerRenameItemStoreTests
+{
+    TEST_CLASS(SimpleTests)
+    {
+    public:
+        TEST_METHOD(VerifyArenaStore)
+        {
+            CPowerRenameNameArena arena;
+            PCWSTR first = arena.Store(L"first.txt");
+            PCWSTR empty = arena.Store(L"");
+            PCWSTR second = arena.Store(std::wstring_view(L"second.txt.bak", 10));
+            Assert::AreEqual(L"first.txt", first);
+            Assert::AreEqual(L"", empty);
+            Assert::AreEqual(L"second.txt", second);
+            Assert::AreEqual((10 + 1 + 11) * sizeof(wchar_t), arena.BytesAllocated());
+        }
+
+        TEST_METHOD(VerifyArenaLongStrings)
+        {
+            CPowerRenameNameArena arena;
+            std::wstring longName(100000, L'x');
+            PCWSTR small = arena.Store(L"small");
+            PCWSTR large = arena.Store(longName);
+            PCWSTR after = arena.Store(L"after");
+            Assert::AreEqual(L"small", small);
+            Assert::AreEqual(longName.c_str(), large);
+            Assert::AreEqual(L"after", after);
+        }
+
+        TEST_METHOD(VerifyArenaResetReusesBlocks)
+        {
+            CPowerRenameNameArena arena;
+            for (int i = 0; i < 10000; i++)
+            {
+                arena.Store(L"IMG_" + std::to_wstring(i) + L".jpg");
+            }
+            const size_t reserved = arena.BytesReserved();
+            Assert::IsTrue(reserved >= arena.BytesAllocated());
+
+            arena.Reset();
+            Assert::AreEqual(size_t{ 0 }, arena.BytesAllocated());
+            for (int i = 0; i < 10000; i++)
+            {
+                arena.Store(L"IMG_" + std::to_wstring(i) + L".jpg");
+            }
+            Assert::AreEqual(reserved, arena.BytesReserved());
+        }
+
+        TEST_METHOD(VerifyNewNamesLastTwoPasses)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFile(L"foo.txt"));
+
+            CComPtr<IPowerRenameItemFactory2> factory;
+            Assert::IsTrue(CPowerRenameItem::s_CreateInstance(nullptr, IID_PPV_ARGS(&factory)) == S_OK);
+            CComPtr<IShellItem> shellItem;
+            Assert::IsTrue(SHCreateItemFromParsingName(testFileHelper.GetFullPath(L"foo.txt").c_str(), nullptr, IID_PPV_ARGS(&shellItem)) == S_OK);
+            CComPtr<IPowerRenameItem> createdItem;
+            Assert::IsTrue(factory->Create(shellItem, &createdItem) == S_OK);
+            CComPtr<IPowerRenameItem2> item;
+            Assert::IsTrue(createdItem->QueryInterface(IID_PPV_ARGS(&item)) == S_OK);
+
+            PCWSTR path = nullptr;
+            PCWSTR originalName = nullptr;
+            Assert::IsTrue(item->get_pathView(&path) == S_OK);
+            Assert::IsTrue(item->get_originalNameView(&originalName) == S_OK);
+            Assert::AreEqual(testFileHelper.GetFullPath(L"foo.txt").c_str(), path);
+            Assert::AreEqual(L"foo.txt", originalName);
+
+            Assert::IsTrue(factory->BeginNamePass() == S_OK);
+            Assert::IsTrue(item->put_newName(L"bar.txt") == S_OK);
+            SIZE_T bytes = 0;
+            Assert::IsTrue(factory->get_namePassBytes(&bytes) == S_OK);
+            Assert::AreEqual(SIZE_T{ 8 * sizeof(wchar_t) }, bytes);
+
+            // Still there during the next pass
+            Assert::IsTrue(factory->BeginNamePass() == S_OK);
+            PCWSTR newName = nullptr;
+            Assert::IsTrue(item->get_newNameView(&newName) == S_OK);
+            Assert::AreEqual(L"bar.txt", newName);
+            wchar_t buffer[MAX_PATH] = { 0 };
+            Assert::IsTrue(item->CopyNewName(buffer, ARRAYSIZE(buffer)) == S_OK);
+            Assert::AreEqual(L"bar.txt", buffer);
+            Assert::IsTrue(factory->get_namePassBytes(&bytes) == S_OK);
+            Assert::AreEqual(SIZE_T{ 0 }, bytes);
+
+            // Released by the one after
+            Assert::IsTrue(factory->BeginNamePass() == S_OK);
+            Assert::IsTrue(item->get_newNameView(&newName) == S_OK);
+            Assert::IsNull(newName);
+            Assert::IsTrue(item->CopyNewName(buffer, ARRAYSIZE(buffer)) == S_FALSE);
+            Assert::AreEqual(L"", buffer);
+            bool shouldRename = true;
+            Assert::IsTrue(item->ShouldRenameItem(0, &shouldRename) == S_OK);
+            Assert::IsFalse(shouldRename);
+        }
+
+        TEST_METHOD(VerifyItemInterfaces)
+        {
+            // The views and name passes came with new interfaces, the first ones are unchanged
+            CComPtr<IPowerRenameItemFactory> factory;
+            Assert::IsTrue(CPowerRenameItem::s_CreateInstance(nullptr, IID_PPV_ARGS(&factory)) == S_OK);
+            CComPtr<IPowerRenameItemFactory2> factory2;
+            Assert::IsTrue(factory->QueryInterface(IID_PPV_ARGS(&factory2)) == S_OK);
+            CComPtr<IPowerRenameItem> item;
+            Assert::IsTrue(factory->QueryInterface(IID_PPV_ARGS(&item)) == S_OK);
+            CComPtr<IPowerRenameItem2> item2;
+            Assert::IsTrue(item->QueryInterface(IID_PPV_ARGS(&item2)) == S_OK);
+            Assert::IsTrue(__uuidof(IPowerRenameItem) != __uuidof(IPowerRenameItem2));
+            Assert::IsTrue(__uuidof(IPowerRenameItemFactory) != __uuidof(IPowerRenameItemFactory2));
+        }
+
+        TEST_METHOD(VerifyItemWithoutStore)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFile(L"foo.txt"));
+
+            CComPtr<IShellItem> shellItem;
+            Assert::IsTrue(SHCreateItemFromParsingName(testFileHelper.GetFullPath(L"foo.txt").c_str(), nullptr, IID_PPV_ARGS(&shellItem)) == S_OK);
+            CComPtr<IPowerRenameItem2> item;
+            Assert::IsTrue(CPowerRenameItem::s_CreateInstance(shellItem, IID_PPV_ARGS(&item)) == S_OK);
+
+            Assert::IsTrue(item->put_newName(L"bar.txt") == S_OK);
+            PWSTR newName = nullptr;
+            Assert::IsTrue(item->get_newName(&newName) == S_OK);
+            Assert::AreEqual(L"bar.txt", newName);
+            CoTaskMemFree(newName);
+
+            Assert::IsTrue(item->Reset() == S_OK);
+            PCWSTR newNameView = nullptr;
+            Assert::IsTrue(item->get_newNameView(&newNameView) == S_OK);
+            Assert::IsNull(newNameView);
+        }
+    };
+}
@@ -0,0 +1,167 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <PowerRenameLiteralSearch.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace PowerRenameLiteralSearchTests
+{
+    // The search CPowerRenameRegEx used before the vector kernels
+    size_t ReferenceFind(std::wstring data, std::wstring toSearch, bool caseInsensitive, size_t pos)
+    {
+        if (caseInsensitive)
+        {
+            std::transform(data.begin(), data.end(), data.begin(), ::towlower);
+            std::transform(toSearch.begin(), toSearch.end(), toSearch.begin(), ::towlower);
+        }
+        return data.find(toSearch, pos);
+    }
+
+    const LiteralSearchKernel c_kernels[] = { LiteralSearchKernel::Scalar, LiteralSearchKernel::Sse2, LiteralSearchKernel::Avx2 };
+
+    void VerifyAllKernels(const std::wstring& text, const std::wstring& needle, bool caseInsensitive, size_t pos)
+    {
+        const size_t expected = ReferenceFind(text, needle, caseInsensitive, pos);
+        for (auto kernel : c_kernels)
+        {
+            Assert::AreEqual(expected, FindLiteral(text, needle, caseInsensitive, pos, kernel), (text + L" / " + needle).c_str());
+        }
+    }
+
+    TEST_CLASS(SimpleTests)
+    {
+    public:
+        TEST_METHOD(VerifyCaseSensitive)
+        {
+            VerifyAllKernels(L"foo Foo FOO foo", L"Foo", false, 0);
+            VerifyAllKernels(L"foo Foo FOO foo", L"FOO", false, 0);
+            VerifyAllKernels(L"foo Foo FOO foo", L"foo", false, 1);
+            VerifyAllKernels(L"foo Foo FOO foo", L"bar", false, 0);
+        }
+
+        TEST_METHOD(VerifyCaseInsensitive)
+        {
+            VerifyAllKernels(L"IMG_0001 Copy.JPG", L"copy", true, 0);
+            VerifyAllKernels(L"IMG_0001 Copy.JPG", L".jpg", true, 0);
+            VerifyAllKernels(L"IMG_0001 Copy.JPG", L"img", true, 1);
+            VerifyAllKernels(L"[@]^_`{", L"@", true, 0);
+            VerifyAllKernels(L"[@]^_`{", L"`", true, 0);
+        }
+
+        TEST_METHOD(VerifyEdgeCases)
+        {
+            VerifyAllKernels(L"", L"a", true, 0);
+            VerifyAllKernels(L"abc", L"abcd", true, 0);
+            VerifyAllKernels(L"abc", L"abc", true, 0);
+            VerifyAllKernels(L"abc", L"c", true, 2);
+            VerifyAllKernels(L"abc", L"c", true, 3);
+            VerifyAllKernels(L"abc", L"c", true, 10);
+            Assert::AreEqual(size_t{ 2 }, FindLiteral(L"abc", L"", true, 2));
+        }
+
+        TEST_METHOD(VerifyNonAsciiText)
+        {
+            // U+212A KELVIN SIGN and U+0130 lower case to ASCII letters
+            VerifyAllKernels(L"0123456789 \x212A\x212A\x212A abcdefghijklmnop", L"kkk", true, 0);
+            VerifyAllKernels(L"0123456789 \x0130\x0130 abcdefghijklmnop", L"ii", true, 0);
+            VerifyAllKernels(L"0123456789 Stra\x00DF" L"e Caf\x00C9 abcdefghijklmnop", L"caf\x00E9", true, 0);
+            VerifyAllKernels(L"0123456789 Stra\x00DF" L"e Caf\x00C9 abcdefghijklmnop", L"CAF\x00C9", false, 0);
+            VerifyAllKernels(L"\xFF21\xFF22\xFF23 0123456789abcdefghijklmnop", L"\xFF41\xFF42", true, 0);
+        }
+
+        TEST_METHOD(VerifyVectorBoundaries)
+        {
+            for (size_t length = 1; length < 70; length++)
+            {
+                for (size_t at = 0; at + 3 <= length; at++)
+                {
+                    std::wstring text(length, L'x');
+                    text.replace(at, 3, L"AbC");
+                    VerifyAllKernels(text, L"abc", true, 0);
+                    VerifyAllKernels(text, L"AbC", false, at / 2);
+                }
+            }
+        }
+
+        TEST_METHOD(VerifyRandomText)
+        {
+            const wchar_t alphabet[] = L"abcABC_.kK\x212A\x00E9\x00C9\x0130iI";
+            const size_t alphabetSize = ARRAYSIZE(alphabet) - 1;
+            std::mt19937 random(42);
+            for (int i = 0; i < 20000; i++)
+            {
+                std::wstring text;
+                std::wstring needle;
+                const size_t textLength = random() % 70;
+                for (size_t j = 0; j < textLength; j++)
+                {
+                    text += alphabet[random() % alphabetSize];
+                }
+                if (textLength > 0 && random() % 2)
+                {
+                    needle = text.substr(random() % textLength, 1 + random() % 5);
+                }
+                else
+                {
+                    for (size_t j = 1 + random() % 5; j > 0; j--)
+                    {
+                        needle += alphabet[random() % alphabetSize];
+                    }
+                }
+                VerifyAllKernels(text, needle, random() % 2 == 0, random() % (textLength + 2));
+            }
+        }
+    };
+
+    TEST_CLASS(Benchmarks)
+    {
+    public:
+        template<typename Find>
+        static long long Measure(const std::vector<std::wstring>& corpus, Find find)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            size_t found = 0;
+            for (const auto& name : corpus)
+            {
+                found += find(name) != std::wstring::npos;
+            }
+            Assert::IsTrue(found > 0);
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        static void Compare(PCWSTR name, const std::vector<std::wstring>& corpus, const std::wstring& needle)
+        {
+            std::wstring message = std::wstring(name) + L": lower casing " + std::to_wstring(Measure(corpus, [&](const std::wstring& text) { return ReferenceFind(text, needle, true, 0); })) + L" ms";
+            PCWSTR kernelNames[] = { L"scalar", L"SSE2", L"AVX2" };
+            for (auto kernel : c_kernels)
+            {
+                if (kernel <= BestLiteralSearchKernel())
+                {
+                    message += std::wstring(L", ") + kernelNames[static_cast<int>(kernel)] + L" " + std::to_wstring(Measure(corpus, [&](const std::wstring& text) { return FindLiteral(text, needle, true, 0, kernel); })) + L" ms";
+                }
+            }
+            message += L"\n";
+            Logger::WriteMessage(message.c_str());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkNameCorpus)
+            TEST_METHOD_ATTRIBUTE(L"Category", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(BenchmarkNameCorpus)
+        {
+            std::vector<std::wstring> corpus;
+            corpus.reserve(1000000);
+            for (int i = 0; i < 1000000; i++)
+            {
+                corpus.push_back(L"IMG_" + std::to_wstring(20200000 + i) + (i % 3 ? L"_holiday at the beach Copy (2).jpg" : L".png"));
+            }
+
+            Compare(L"1M names, 'copy'", corpus, L"copy");
+            Compare(L"1M names, 'missing'", corpus, L"missing");
+            Compare(L"1M names, 'caf\x00E9'", corpus, L"caf\x00E9");
+        }
+    };
+}
@@ -3,6 +3,7 @@
 #include <PowerRenameInterfaces.h>
 #include <PowerRenameManager.h>
 #include <PowerRenameItem.h>
+#include <lib/Helpers.h>
 #include "MockPowerRenameItem.h"
 #include "MockPowerRenameManagerEvents.h"
 #include "TestFileHelper.h"
@@ -229,5 +230,190 @@ namespace PowerRenameManagerTests
 
             RenameHelper(renamePairs, ARRAYSIZE(renamePairs), L"foo", L"bar", DEFAULT_FLAGS | ExcludeSubfolders);
         }
+
+        TEST_METHOD(VerifyEnumeratedNameSkipsExistingFile)
+        {
+            // Verify enumerated names don't take the name of a file already in the folder
+            rename_pairs renamePairs[] = {
+                { L"foo.txt", L"bar (2).txt", true, true, 0 },
+                { L"bar (1).txt", L"bar (1)_norename.txt", true, false, 0 }
+            };
+
+            RenameHelper(renamePairs, ARRAYSIZE(renamePairs), L"foo", L"bar", DEFAULT_FLAGS | EnumerateItems);
+        }
+
+        TEST_METHOD(VerifyRenameAfterRapidSearchChanges)
+        {
+            CTestFileHelper testFileHelper;
+            CComPtr<IPowerRenameManager> mgr;
+            Assert::IsTrue(CPowerRenameManager::s_CreateInstance(&mgr) == S_OK);
+            CMockPowerRenameManagerEvents* mockMgrEvents = new CMockPowerRenameManagerEvents();
+            CComPtr<IPowerRenameManagerEvents> mgrEvents;
+            Assert::IsTrue(mockMgrEvents->QueryInterface(IID_PPV_ARGS(&mgrEvents)) == S_OK);
+            DWORD cookie = 0;
+            Assert::IsTrue(mgr->Advise(mgrEvents, &cookie) == S_OK);
+
+            const int itemCount = 500;
+            for (int i = 0; i < itemCount; i++)
+            {
+                std::wstring name = L"foo" + std::to_wstring(i) + L".txt";
+                Assert::IsTrue(testFileHelper.AddFile(name));
+                CComPtr<IPowerRenameItem> item;
+                CMockPowerRenameItem::CreateInstance(testFileHelper.GetFullPath(name).c_str(), name.c_str(), 0, false, &item);
+                mgr->AddItem(item);
+            }
+
+            CComPtr<IPowerRenameRegEx> renRegEx;
+            Assert::IsTrue(mgr->get_renameRegEx(&renRegEx) == S_OK);
+            renRegEx->put_flags(DEFAULT_FLAGS);
+            renRegEx->put_replaceTerm(L"bar");
+
+            // Every change only queues a request, the worker previews the last one
+            for (int i = 0; i < 50; i++)
+            {
+                renRegEx->put_searchTerm(i % 2 == 0 ? L"f" : L"fo");
+            }
+            renRegEx->put_searchTerm(L"foo");
+
+            // Rename doesn't wait for the preview of the last request, it is started on this
+            // thread when the preview completes
+            Assert::IsTrue(mgr->Rename(0) == S_OK);
+            const ULONGLONG timeout = GetTickCount64() + 10000;
+            while (!mockMgrEvents->m_renameCompleted && GetTickCount64() < timeout)
+            {
+                MSG msg;
+                if (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+                {
+                    DispatchMessage(&msg);
+                }
+                else
+                {
+                    Sleep(1);
+                }
+            }
+            Assert::IsTrue(mockMgrEvents->m_renameCompleted);
+
+            // Every request reported as started was reported as canceled or completed
+            Assert::IsTrue(mockMgrEvents->m_regExCompleted);
+            Assert::AreEqual(0, mockMgrEvents->m_regExRunningCount);
+
+            for (int i = 0; i < itemCount; i++)
+            {
+                Assert::IsFalse(testFileHelper.PathExists(L"foo" + std::to_wstring(i) + L".txt"));
+                Assert::IsTrue(testFileHelper.PathExists(L"bar" + std::to_wstring(i) + L".txt"));
+            }
+
+            Assert::IsTrue(mgr->Shutdown() == S_OK);
+
+            mockMgrEvents->Release();
+        }
+
+        TEST_METHOD(VerifyFilteredViews)
+        {
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFile(L"bar1.txt"));
+            CComPtr<IPowerRenameManager> mgr;
+            Assert::IsTrue(CPowerRenameManager::s_CreateInstance(&mgr) == S_OK);
+
+            const PCWSTR names[] = { L"foo0.txt", L"foo1.txt", L"foo2.txt", L"other.txt" };
+            std::vector<CComPtr<IPowerRenameItem>> items;
+            for (PCWSTR name : names)
+            {
+                Assert::IsTrue(testFileHelper.AddFile(name));
+                CComPtr<IPowerRenameItem> item;
+                CMockPowerRenameItem::CreateInstance(testFileHelper.GetFullPath(name).c_str(), name, 0, false, &item);
+                mgr->AddItem(item);
+                items.push_back(item);
+            }
+
+            CComPtr<IPowerRenameRegEx> renRegEx;
+            Assert::IsTrue(mgr->get_renameRegEx(&renRegEx) == S_OK);
+            renRegEx->put_flags(DEFAULT_FLAGS);
+            renRegEx->put_replaceTerm(L"bar");
+            renRegEx->put_searchTerm(L"foo");
+
+            Sleep(1000);
+
+            UINT count = 0;
+            Assert::IsTrue(mgr->put_filter(ShowChangedItems) == S_OK);
+            Assert::IsTrue(mgr->GetVisibleItemCount(&count) == S_OK);
+            Assert::AreEqual(3u, count);
+
+            // foo1.txt would take the name of bar1.txt
+            Assert::IsTrue(mgr->put_filter(ShowConflictItems) == S_OK);
+            Assert::IsTrue(mgr->GetVisibleItemCount(&count) == S_OK);
+            Assert::AreEqual(1u, count);
+            CComPtr<IPowerRenameItem> conflictItem;
+            Assert::IsTrue(mgr->GetVisibleItemByIndex(0, &conflictItem) == S_OK);
+            Assert::IsTrue(conflictItem == items[1]);
+
+            Assert::IsTrue(mgr->put_filter(ShowSelectedItems) == S_OK);
+            Assert::IsTrue(mgr->SetItemSelected(items[0], false) == S_OK);
+            Assert::IsTrue(mgr->GetVisibleItemCount(&count) == S_OK);
+            Assert::AreEqual(3u, count);
+            CComPtr<IPowerRenameItem> firstSelected;
+            Assert::IsTrue(mgr->GetVisibleItemByIndex(0, &firstSelected) == S_OK);
+            Assert::IsTrue(firstSelected == items[1]);
+
+            Assert::IsTrue(mgr->Shutdown() == S_OK);
+        }
+
+        TEST_METHOD(VerifyEnumerateFolderTree)
+        {
+            // Verify folder contents are added depth first with their depth, whatever the
+            // order the folders were enumerated in
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFolder(L"a"));
+            Assert::IsTrue(testFileHelper.AddFile(L"a\\1.txt"));
+            Assert::IsTrue(testFileHelper.AddFolder(L"a\\b"));
+            Assert::IsTrue(testFileHelper.AddFile(L"a\\b\\2.txt"));
+            Assert::IsTrue(testFileHelper.AddFolder(L"a\\c"));
+            Assert::IsTrue(testFileHelper.AddFile(L"a\\c\\3.txt"));
+
+            CComPtr<IPowerRenameManager> mgr;
+            Assert::IsTrue(CPowerRenameManager::s_CreateInstance(&mgr) == S_OK);
+            CComPtr<IPowerRenameItemFactory> factory;
+            Assert::IsTrue(CPowerRenameItem::s_CreateInstance(nullptr, IID_PPV_ARGS(&factory)) == S_OK);
+            Assert::IsTrue(mgr->put_renameItemFactory(factory) == S_OK);
+
+            CComPtr<IShellItem> folder;
+            Assert::IsTrue(SHCreateItemFromParsingName(testFileHelper.GetFullPath(L"a").c_str(), nullptr, IID_PPV_ARGS(&folder)) == S_OK);
+            CComPtr<IShellItemArray> items;
+            Assert::IsTrue(SHCreateShellItemArrayFromShellItem(folder, IID_PPV_ARGS(&items)) == S_OK);
+
+            Assert::IsTrue(EnumerateDataObject(items, mgr) == S_OK);
+
+            struct expected_item
+            {
+                std::wstring name;
+                UINT depth;
+            };
+            expected_item expected[] = {
+                { L"a", 0 },
+                { L"1.txt", 1 },
+                { L"b", 1 },
+                { L"2.txt", 2 },
+                { L"c", 1 },
+                { L"3.txt", 2 }
+            };
+
+            UINT itemCount = 0;
+            Assert::IsTrue(mgr->GetItemCount(&itemCount) == S_OK);
+            Assert::AreEqual(static_cast<UINT>(ARRAYSIZE(expected)), itemCount);
+            for (UINT i = 0; i < itemCount; i++)
+            {
+                CComPtr<IPowerRenameItem> item;
+                Assert::IsTrue(mgr->GetItemByIndex(i, &item) == S_OK);
+                PWSTR originalName = nullptr;
+                Assert::IsTrue(item->get_originalName(&originalName) == S_OK);
+                Assert::AreEqual(expected[i].name.c_str(), originalName);
+                CoTaskMemFree(originalName);
+                UINT depth = 0;
+                Assert::IsTrue(item->get_depth(&depth) == S_OK);
+                Assert::AreEqual(expected[i].depth, depth);
+            }
+
+            Assert::IsTrue(mgr->Shutdown() == S_OK);
+        }
     };
 }
\ No newline at end of file
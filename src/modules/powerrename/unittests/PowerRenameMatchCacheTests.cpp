@@ -0,0 +1,170 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <lib/PowerRenameInterfaces.h>
+#include <lib/PowerRenameMatchCache.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace PowerRenameMatchCacheTests
+{
+    TEST_CLASS(SimpleTests)
+    {
+    public:
+        // Completes a pass over the items, recording the ones that match and named state like the regex worker
+        CPowerRenameMatchCache::Pass RunPass(CPowerRenameMatchCache& cache, PCWSTR searchTerm, DWORD flags, const std::vector<PCWSTR>& names)
+        {
+            CPowerRenameMatchCache::Pass pass = cache.BeginPass(searchTerm, flags, static_cast<UINT>(names.size()));
+            std::vector<int> matches;
+            auto visit = [&](int id) {
+                bool match = CPowerRenameMatchCache::IsMatch(pass, names[id]);
+                if (match)
+                {
+                    matches.push_back(id);
+                }
+                cache.SetNamed(id, match);
+            };
+
+            if (pass.incremental)
+            {
+                for (int id : pass.ids)
+                {
+                    visit(id);
+                }
+            }
+            else
+            {
+                for (int id = 0; id < static_cast<int>(names.size()); id++)
+                {
+                    visit(id);
+                }
+            }
+
+            cache.CompletePass(pass, std::move(matches));
+            return pass;
+        }
+
+        TEST_METHOD(VerifyFirstPassVisitsEverything)
+        {
+            CPowerRenameMatchCache cache;
+            auto pass = RunPass(cache, L"IMG_", 0, { L"IMG_1.jpg", L"doc.txt" });
+            Assert::IsFalse(pass.incremental);
+        }
+
+        TEST_METHOD(VerifyExtendedTermVisitsMatchesOnly)
+        {
+            std::vector<PCWSTR> names = { L"IMG_1.jpg", L"doc.txt", L"IMG_2.jpg", L"img_20.jpg", L"notes.txt" };
+            CPowerRenameMatchCache cache;
+            RunPass(cache, L"IMG_", 0, names);
+
+            auto pass = RunPass(cache, L"IMG_2", 0, names);
+            Assert::IsTrue(pass.incremental);
+            Assert::IsTrue(pass.ids == std::vector<int>{ 0, 2, 3 });
+
+            // Only the items that matched IMG_2 are left to visit
+            pass = RunPass(cache, L"IMG_20", 0, names);
+            Assert::IsTrue(pass.incremental);
+            Assert::IsTrue(pass.ids == std::vector<int>{ 2, 3 });
+        }
+
+        TEST_METHOD(VerifyShrunkTermReusesMatches)
+        {
+            std::vector<PCWSTR> names = { L"IMG_1.jpg", L"doc.txt", L"IMG_2.jpg", L"notes.txt" };
+            CPowerRenameMatchCache cache;
+            RunPass(cache, L"IMG_", 0, names);
+            RunPass(cache, L"IMG_2", 0, names);
+
+            // Back to IMG_, the items that didn't match it aren't visited
+            auto pass = RunPass(cache, L"IMG_", 0, names);
+            Assert::IsTrue(pass.incremental);
+            Assert::IsTrue(pass.ids == std::vector<int>{ 0, 2 });
+
+            // And forward again
+            pass = RunPass(cache, L"IMG_2", 0, names);
+            Assert::IsTrue(pass.incremental);
+            Assert::IsTrue(pass.ids == std::vector<int>{ 0, 2 });
+        }
+
+        TEST_METHOD(VerifyUnrelatedTermVisitsEverything)
+        {
+            std::vector<PCWSTR> names = { L"IMG_1.jpg", L"doc.txt" };
+            CPowerRenameMatchCache cache;
+            RunPass(cache, L"IMG_", 0, names);
+
+            auto pass = RunPass(cache, L"doc", 0, names);
+            Assert::IsFalse(pass.incremental);
+        }
+
+        TEST_METHOD(VerifyEmptyTermClearsNamedItems)
+        {
+            std::vector<PCWSTR> names = { L"IMG_1.jpg", L"doc.txt" };
+            CPowerRenameMatchCache cache;
+            RunPass(cache, L"IMG_", 0, names);
+
+            auto pass = RunPass(cache, L"", 0, names);
+            Assert::IsTrue(pass.incremental);
+            Assert::IsTrue(pass.ids == std::vector<int>{ 0 });
+
+            pass = RunPass(cache, L"", 0, names);
+            Assert::IsTrue(pass.ids.empty());
+        }
+
+        TEST_METHOD(VerifyCaseSensitivity)
+        {
+            std::vector<PCWSTR> names = { L"IMG_1.jpg", L"img_2.jpg" };
+            CPowerRenameMatchCache cache;
+            RunPass(cache, L"img", 0, names);
+            auto pass = RunPass(cache, L"img_", 0, names);
+            Assert::IsTrue(pass.ids == std::vector<int>{ 0, 1 });
+
+            // Changing the flags starts over
+            pass = RunPass(cache, L"img_", CaseSensitive, names);
+            Assert::IsFalse(pass.incremental);
+            pass = RunPass(cache, L"img_2", CaseSensitive, names);
+            Assert::IsTrue(pass.ids == std::vector<int>{ 1 });
+        }
+
+        TEST_METHOD(VerifyReplaceFlagsKeepMatches)
+        {
+            std::vector<PCWSTR> names = { L"IMG_1.jpg", L"doc.txt" };
+            CPowerRenameMatchCache cache;
+            RunPass(cache, L"IMG_", 0, names);
+
+            auto pass = RunPass(cache, L"IMG_", MatchAllOccurences | EnumerateItems, names);
+            Assert::IsTrue(pass.incremental);
+            Assert::IsTrue(pass.ids == std::vector<int>{ 0 });
+        }
+
+        TEST_METHOD(VerifyRegularExpressionsNotCached)
+        {
+            std::vector<PCWSTR> names = { L"IMG_1.jpg", L"doc.txt" };
+            CPowerRenameMatchCache cache;
+            RunPass(cache, L"IMG", UseRegularExpressions, names);
+            auto pass = RunPass(cache, L"IMG_", UseRegularExpressions, names);
+            Assert::IsFalse(pass.incremental);
+        }
+
+        TEST_METHOD(VerifyAddedItemsVisitEverything)
+        {
+            std::vector<PCWSTR> names = { L"IMG_1.jpg", L"doc.txt" };
+            CPowerRenameMatchCache cache;
+            RunPass(cache, L"IMG", 0, names);
+
+            names.push_back(L"IMG_2.jpg");
+            auto pass = RunPass(cache, L"IMG_", 0, names);
+            Assert::IsFalse(pass.incremental);
+        }
+
+        TEST_METHOD(VerifyInvalidate)
+        {
+            std::vector<PCWSTR> names = { L"IMG_1.jpg", L"doc.txt" };
+            CPowerRenameMatchCache cache;
+            auto pass = cache.BeginPass(L"IMG", 0, static_cast<UINT>(names.size()));
+
+            // A pass started before the items were renamed isn't recorded
+            cache.Invalidate();
+            cache.CompletePass(pass, { 0 });
+            pass = RunPass(cache, L"IMG_", 0, names);
+            Assert::IsFalse(pass.incremental);
+        }
+    };
+}
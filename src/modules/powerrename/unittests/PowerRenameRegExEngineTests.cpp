@@ -0,0 +1,244 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <PowerRenameRegExEngine.h>
+#include <chrono>
+#include <regex>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace PowerRenameRegExEngineTests
+{
+    struct ReplaceCase
+    {
+        PCWSTR pattern;
+        bool caseInsensitive;
+        PCWSTR source;
+        PCWSTR format;
+    };
+
+    // Patterns covered by the automaton, the result has to be the same as with std::wregex
+    const ReplaceCase c_replaceCases[] = {
+        { L"IMG_(\\d+)\\.(jpg|png)", false, L"IMG_123.jpg", L"photo_$1.$2" },
+        { L"a", false, L"banana", L"o" },
+        { L"A", true, L"banana", L"o" },
+        { L"x*", false, L"abc", L"-" },
+        { L"a*", false, L"baaac", L"-" },
+        { L"a*?", false, L"baaac", L"-" },
+        { L"a??", false, L"aa", L"-" },
+        { L"(a|ab)(c|bcd)(d*)", false, L"abcd", L"[$1,$2,$3]" },
+        { L"^\\w+", false, L"hello world", L"X" },
+        { L"\\w+$", false, L"hello world", L"X" },
+        { L"\\bw", false, L"hello world wide", L"W" },
+        { L"\\Bl", false, L"hello world", L"L" },
+        { L"[a-c]+", false, L"xxabcabcyy", L"<$&>" },
+        { L"[^a-c]+", false, L"xxabcabcyy", L"<$&>" },
+        { L"[A-C]+", true, L"xxabcABcyy", L"<$&>" },
+        { L"(\\d{2,3})", false, L"1 22 333 4444 55555", L"[$1]" },
+        { L"(\\d{2,3}?)", false, L"1 22 333 4444 55555", L"[$1]" },
+        { L"(\\d{2,})", false, L"1 22 333 4444", L"[$1]" },
+        { L"(a)|(b)", false, L"abc", L"[$1|$2]" },
+        { L"(?:ab)+", false, L"ababab c ab", L"X" },
+        { L"(?:a+)+$", false, L"aaaab", L"X" },
+        { L"\\.", false, L"a.b.c", L"$$" },
+        { L"b", false, L"abc", L"[$`|$']" },
+        { L"(.)(.)", false, L"abcd", L"$2$1" },
+        { L"(.)", false, L"abcd", L"$5" },
+        { L"", false, L"abc", L"-" },
+        { L"\\s+", false, L"a  b \t c", L"_" },
+        { L"[\\w-]+", false, L"a-b c", L"#" },
+        { L"\\x41\\u0042", false, L"xABx", L"#" },
+        { L"(\\w+)\\s(\\w+)", false, L"John Smith", L"$2, $1" },
+        { L"colou?r", true, L"Color COLOUR", L"x" },
+        { L"(ab|a)(?:bc|c)?", false, L"abc", L"[$1]" },
+    };
+
+    // Quantified groups holding capture groups, left to std::wregex since the captures of the
+    // iterations differ from the automaton's
+    const ReplaceCase c_quantifiedCaptureCases[] = {
+        { L"(.*?)+?a", false, L"xx.1a", L"$1" },
+        { L"(.*?)*?\\d", false, L"BB1", L"$1" },
+        { L"(a+)+$", false, L"aaaab", L"[$1]" },
+        { L"(ab|a)(bc|c)?", false, L"abc", L"[$1|$2]" },
+        { L"(?:(a)|b)+", false, L"ab", L"[$1]" },
+        { L"(a*)?", false, L"b", L"[$1]" },
+    };
+
+    TEST_CLASS(SimpleTests)
+    {
+    public:
+        TEST_METHOD(VerifyBackendsReplaceTheSame)
+        {
+            for (const auto& replaceCase : c_replaceCases)
+            {
+                auto automaton = CreateRegExMatcher(replaceCase.pattern, replaceCase.caseInsensitive);
+                auto standard = CreateRegExMatcher(replaceCase.pattern, replaceCase.caseInsensitive, RegExBackend::Std);
+                Assert::IsTrue(automaton->Backend() == RegExBackend::Automaton, replaceCase.pattern);
+                Assert::AreEqual(RegExReplace(*standard, replaceCase.source, replaceCase.format), RegExReplace(*automaton, replaceCase.source, replaceCase.format));
+            }
+        }
+
+        TEST_METHOD(VerifyQuantifiedCapturesFallBack)
+        {
+            for (const auto& replaceCase : c_quantifiedCaptureCases)
+            {
+                auto matcher = CreateRegExMatcher(replaceCase.pattern, replaceCase.caseInsensitive);
+                auto standard = CreateRegExMatcher(replaceCase.pattern, replaceCase.caseInsensitive, RegExBackend::Std);
+                Assert::IsTrue(matcher->Backend() == RegExBackend::Std, replaceCase.pattern);
+
+                std::wregex pattern(replaceCase.pattern, std::regex_constants::ECMAScript);
+                const std::wstring expected = std::regex_replace(std::wstring(replaceCase.source), pattern, std::wstring(replaceCase.format));
+                Assert::AreEqual(expected, RegExReplace(*matcher, replaceCase.source, replaceCase.format), replaceCase.pattern);
+                Assert::AreEqual(expected, RegExReplace(*standard, replaceCase.source, replaceCase.format), replaceCase.pattern);
+            }
+        }
+
+        TEST_METHOD(VerifyStdRegexReplaceEquivalent)
+        {
+            for (const auto& replaceCase : c_replaceCases)
+            {
+                auto standard = CreateRegExMatcher(replaceCase.pattern, replaceCase.caseInsensitive, RegExBackend::Std);
+                std::wregex pattern(replaceCase.pattern, replaceCase.caseInsensitive ? std::regex_constants::icase | std::regex_constants::ECMAScript : std::regex_constants::ECMAScript);
+                Assert::AreEqual(std::regex_replace(std::wstring(replaceCase.source), pattern, std::wstring(replaceCase.format)), RegExReplace(*standard, replaceCase.source, replaceCase.format));
+            }
+        }
+
+        TEST_METHOD(VerifyCaptureGroups)
+        {
+            auto matcher = CreateRegExMatcher(L"(\\d+)-(x)?(\\w+)", false);
+            RegExMatch match;
+            Assert::IsTrue(matcher->Search(L"ab 12-cd", 0, false, false, match));
+            Assert::AreEqual(size_t{ 3 }, match.position);
+            Assert::AreEqual(size_t{ 5 }, match.length);
+            Assert::AreEqual(size_t{ 3 }, match.groups.size());
+            Assert::IsTrue(match.groups[0] == std::make_pair(size_t{ 3 }, size_t{ 5 }));
+            Assert::IsTrue(match.groups[1].first == std::wstring::npos);
+            Assert::IsTrue(match.groups[2] == std::make_pair(size_t{ 6 }, size_t{ 8 }));
+        }
+
+        TEST_METHOD(VerifyUnsupportedSyntaxFallsBack)
+        {
+            for (PCWSTR pattern : { L"(?=a)a", L"(a)\\1", L"(?!a)b" })
+            {
+                Assert::IsTrue(CreateRegExMatcher(pattern, false)->Backend() == RegExBackend::Std, pattern);
+            }
+        }
+
+        TEST_METHOD(VerifyInvalidPatternThrows)
+        {
+            for (PCWSTR pattern : { L"(a", L"*a", L"[a" })
+            {
+                bool threw = false;
+                try
+                {
+                    CreateRegExMatcher(pattern, false);
+                }
+                catch (std::regex_error)
+                {
+                    threw = true;
+                }
+                Assert::IsTrue(threw, pattern);
+            }
+        }
+
+        TEST_METHOD(VerifyValidityMatchesStdRegex)
+        {
+            // Includes patterns the automaton parser accepts on its own but std::wregex rejects
+            for (PCWSTR pattern : { L"[[:]", L"[[.]", L"[[=]", L"s[[=]", L"[a-\\d]", L"a{3,2}", L"a{0}", L"()", L"[\\b]", L"(?=a)a" })
+            {
+                bool stdValid = true;
+                try
+                {
+                    std::wregex regex(pattern, std::regex_constants::ECMAScript);
+                }
+                catch (std::regex_error)
+                {
+                    stdValid = false;
+                }
+
+                bool valid = true;
+                try
+                {
+                    CreateRegExMatcher(pattern, false);
+                }
+                catch (std::regex_error)
+                {
+                    valid = false;
+                }
+                Assert::AreEqual(stdValid, valid, pattern);
+            }
+        }
+
+        TEST_METHOD(VerifyNestedQuantifiersLinear)
+        {
+            // Exponential for a backtracking matcher
+            std::wstring source(10000, L'a');
+            source += L'b';
+            auto matcher = CreateRegExMatcher(L"(?:a+)+$", false);
+            Assert::IsTrue(matcher->Backend() == RegExBackend::Automaton);
+            Assert::AreEqual(source, RegExReplace(*matcher, source, L"x"));
+        }
+    };
+
+    TEST_CLASS(Benchmarks)
+    {
+    public:
+        static std::wstring Measure(RegExBackend backend, PCWSTR pattern, const std::vector<std::wstring>& corpus, PCWSTR format)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            std::wstring outcome;
+            try
+            {
+                auto matcher = CreateRegExMatcher(pattern, true, backend);
+                for (const auto& name : corpus)
+                {
+                    RegExReplace(*matcher, name, format);
+                }
+                outcome = std::to_wstring(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()) + L" ms";
+            }
+            catch (std::regex_error)
+            {
+                // std::wregex gives up on patterns that are too complex
+                outcome = L"failed after " + std::to_wstring(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()) + L" ms";
+            }
+            return outcome;
+        }
+
+        static void Compare(PCWSTR name, PCWSTR pattern, const std::vector<std::wstring>& corpus, PCWSTR format)
+        {
+            std::wstring message = std::wstring(name) + L": automaton " + Measure(RegExBackend::Automaton, pattern, corpus, format) +
+                                   L", std::wregex " + Measure(RegExBackend::Std, pattern, corpus, format) + L"\n";
+            Logger::WriteMessage(message.c_str());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkNameCorpus)
+            TEST_METHOD_ATTRIBUTE(L"Category", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(BenchmarkNameCorpus)
+        {
+            std::vector<std::wstring> corpus;
+            corpus.reserve(100000);
+            for (int i = 0; i < 100000; i++)
+            {
+                corpus.push_back(L"IMG_" + std::to_wstring(20200000 + i) + (i % 3 ? L"_holiday copy.jpg" : L".png"));
+            }
+
+            Compare(L"100k names, literal", L"holiday", corpus, L"trip");
+            Compare(L"100k names, groups", L"^IMG_(\\d{4})(\\d+)_?(.*)\\.(jpg|png)$", corpus, L"$1-$2 $3.$4");
+            Compare(L"100k names, classes", L"[^a-z0-9]+", corpus, L"_");
+            Compare(L"100k names, lazy", L"(.+?)(\\d)", corpus, L"$2$1");
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkAdversarial)
+            TEST_METHOD_ATTRIBUTE(L"Category", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(BenchmarkAdversarial)
+        {
+            // Kept short, std::wregex doubles its work with every character
+            std::vector<std::wstring> corpus(100, std::wstring(20, L'a') + L"!");
+            // Non-capturing, quantified capture groups are always left to std::wregex
+            Compare(L"(?:a+)+$", L"(?:a+)+$", corpus, L"x");
+            Compare(L"(?:a|a)*$", L"(?:a|a)*$", corpus, L"x");
+            Compare(L"(?:a*)*b", L"(?:a*)*b", corpus, L"x");
+        }
+    };
+}
@@ -53,3 +53,9 @@ extern "C" __declspec(dllexport) PowertoyModuleIface* __cdecl powertoy_create()
 {
     return new PowerPreviewModule();
 }
+
+// Only reads the settings and the registry, so the runner can create it on a worker thread
+extern "C" __declspec(dllexport) unsigned __cdecl powertoy_startup_flags()
+{
+    return POWERTOY_STARTUP_CONCURRENT_CREATE;
+}
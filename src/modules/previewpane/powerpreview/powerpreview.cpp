@@ -71,8 +71,14 @@ bool PowerPreviewModule::get_config(_Out_ wchar_t* buffer, _Out_ int* buffer_siz
 }
 
 // Called by the runner to pass the updated settings values as a serialized JSON.
+unsigned long long PowerPreviewModule::get_config_generation()
+{
+    return m_configGeneration;
+}
+
 void PowerPreviewModule::set_config(const wchar_t* config)
 {
+    ++m_configGeneration;
     try
     {
         PowerToysSettings::PowerToyValues settings = PowerToysSettings::PowerToyValues::from_json_string(config);
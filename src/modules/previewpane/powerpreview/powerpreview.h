@@ -16,6 +16,8 @@ private:
     // The PowerToy state.
     bool m_enabled = false;
     std::wstring m_moduleName;
+    // Bumped by set_config(), which is the only place the toggle states change
+    unsigned long long m_configGeneration = 1;
     std::vector<FileExplorerPreviewSettings *> m_previewHandlers;
 
 public:
@@ -48,6 +50,7 @@ public:
     virtual const wchar_t* get_name();
     virtual const wchar_t** get_events();
     virtual bool get_config(_Out_ wchar_t* buffer, _Out_ int* buffer_size);
+    virtual unsigned long long get_config_generation();
     virtual void set_config(const wchar_t* config);
     virtual void enable();
     virtual void disable();
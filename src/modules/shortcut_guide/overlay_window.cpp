@@ -11,6 +11,22 @@
 
 extern "C" IMAGE_DOS_HEADER __ImageBase;
 
+namespace
+{
+    // Ids of the elements in OverlayElement order
+    const wchar_t* overlay_element_ids[] = { L"KeyUpGroup", L"KeyDownGroup", L"KeyLeftGroup", L"KeyRightGroup" };
+    static_assert(ARRAYSIZE(overlay_element_ids) == (size_t)OverlayElement::Count);
+
+    // Ids of the arrow pointers in D2DArrowSVG::Direction order
+    const wchar_t* arrow_direction_ids[] = { L"left", L"right", L"top", L"bottom" };
+    static_assert(ARRAYSIZE(arrow_direction_ids) == (size_t)D2DArrowSVG::DirectionCount);
+
+    const DWORD REFRESH_INTERVAL_MS = 250;
+
+    // The window events carry no context, there is a single overlay
+    D2DOverlayWindow* win_event_overlay = nullptr;
+}
+
 D2DOverlaySVG& D2DOverlaySVG::load(const std::wstring& filename, ID2D1DeviceContext5* d2d_dc)
 {
     D2DSVG::load(filename, d2d_dc);
@@ -18,6 +34,12 @@ D2DOverlaySVG& D2DOverlaySVG::load(const std::wstring& filename, ID2D1DeviceCont
     thumbnail_top_left = {};
     thumbnail_bottom_right = {};
     thumbnail_scaled_rect = {};
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        elements[i] = nullptr;
+        svg->FindElementById(overlay_element_ids[i], elements[i].put());
+    }
+    key_buttons.clear();
     return *this;
 }
 
@@ -83,11 +105,38 @@ ScaleResult D2DOverlaySVG::get_thumbnail_rect_and_scale(int x_offset, int y_offs
     return result;
 }
 
-winrt::com_ptr<ID2D1SvgElement> D2DOverlaySVG::find_element(const std::wstring& id)
+ID2D1SvgElement* D2DOverlaySVG::get_element(OverlayElement element) const
 {
-    winrt::com_ptr<ID2D1SvgElement> element;
-    winrt::check_hresult(svg->FindElementById(id.c_str(), element.put()));
-    return element;
+    return elements[(size_t)element].get();
+}
+
+winrt::com_ptr<ID2D1SvgElement> D2DOverlaySVG::find_key_button(const std::wstring& id)
+{
+    if (auto found = key_buttons.find(id); found != key_buttons.end())
+    {
+        return found->second;
+    }
+    // The button is the filled sibling of the key label
+    winrt::com_ptr<ID2D1SvgElement> button_letter, parent, button;
+    if (svg->FindElementById(id.c_str(), button_letter.put()) == S_OK && button_letter)
+    {
+        button_letter->GetParent(parent.put());
+    }
+    if (parent)
+    {
+        parent->GetPreviousChild(button_letter.get(), button.put());
+        if (!button || !button->IsAttributeSpecified(L"fill"))
+        {
+            button = nullptr;
+            parent->GetNextChild(button_letter.get(), button.put());
+        }
+        if (button && !button->IsAttributeSpecified(L"fill"))
+        {
+            button = nullptr;
+        }
+    }
+    key_buttons[id] = button;
+    return button;
 }
 
 D2DOverlaySVG& D2DOverlaySVG::toggle_window_group(bool active)
@@ -99,6 +148,32 @@ D2DOverlaySVG& D2DOverlaySVG::toggle_window_group(bool active)
     return *this;
 }
 
+D2DArrowSVG& D2DArrowSVG::load(const std::wstring& filename, ID2D1DeviceContext5* d2d_dc)
+{
+    D2DSVG::load(filename, d2d_dc);
+    for (size_t i = 0; i < directions.size(); ++i)
+    {
+        directions[i] = nullptr;
+        svg->FindElementById(arrow_direction_ids[i], directions[i].put());
+    }
+    directions_set = false;
+    return *this;
+}
+
+D2DArrowSVG& D2DArrowSVG::show_directions(std::bitset<DirectionCount> shown)
+{
+    for (size_t i = 0; i < directions.size(); ++i)
+    {
+        if (!directions_set || shown[i] != shown_directions[i])
+        {
+            toggle_element(directions[i].get(), shown[i]);
+        }
+    }
+    shown_directions = shown;
+    directions_set = true;
+    return *this;
+}
+
 D2D1_RECT_F D2DOverlaySVG::get_maximize_label() const
 {
     D2D1_RECT_F result;
@@ -187,67 +262,111 @@ D2D1_RECT_F D2DOverlaySVG::get_snap_right() const
 D2DOverlayWindow::D2DOverlayWindow() :
     total_screen({}), animation(0.3)
 {
+    // Created on the window thread, which gets the events of the out of context hooks
+    win_event_overlay = this;
+    foreground_hook = SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, nullptr, on_win_event, 0, 0, WINEVENT_OUTOFCONTEXT);
+    minimize_hook = SetWinEventHook(EVENT_SYSTEM_MINIMIZESTART, EVENT_SYSTEM_MINIMIZEEND, nullptr, on_win_event, 0, 0, WINEVENT_OUTOFCONTEXT);
+    refresh_timer = CreateThreadpoolTimer(on_refresh_timer, this, nullptr);
+    tasklist.set_changed_callback([&] {
+        tasklist_cv_mutex.lock();
+        tasklist_update = true;
+        tasklist_cv_mutex.unlock();
+        tasklist_cv.notify_one();
+    });
     tasklist_thread = std::thread([&] {
+        // UI Automation only delivers events to handlers registered from a multithreaded apartment
+        const bool com_initialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+        // Start with a full walk, so the buttons are ready when the overlay is first shown.
+        // From then on the taskbar events wake this thread, it no longer polls.
+        tasklist_cv_mutex.lock();
+        tasklist_update = true;
+        tasklist_cv_mutex.unlock();
+        // Set while the taskbar couldn't be tracked, no event would wake this thread then
+        bool retry = false;
         while (running)
         {
             // Removing <std::mutex> causes C3538 on std::unique_lock lock(mutex); in show(..)
             std::unique_lock<std::mutex> lock(tasklist_cv_mutex);
-            tasklist_cv.wait(lock, [&] { return !running || tasklist_update; });
+            auto woken = [&] { return !running || tasklist_update; };
+            if (retry)
+            {
+                tasklist_cv.wait_for(lock, std::chrono::seconds(1), woken);
+            }
+            else
+            {
+                tasklist_cv.wait(lock, woken);
+            }
             if (!running)
-                return;
+                break;
+            tasklist_update = false;
             lock.unlock();
-            while (running && tasklist_update)
+            try
+            {
+                // Finds the taskbar again if Explorer restarted
+                tasklist.update();
+                retry = false;
+            }
+            catch (const winrt::hresult_error& error)
             {
-                std::vector<TasklistButton> buttons;
-                if (tasklist.update_buttons(buttons))
+                // Start over with new UI Automation objects on the next try. Until then the
+                // overlay keeps the buttons it got last.
+                Trace::TasklistError(error.code());
+                tasklist.release();
+                retry = true;
+            }
+            std::vector<TasklistButton> buttons;
+            if (tasklist.update_buttons(buttons))
+            {
+                std::unique_lock lock(mutex);
+                if (tasklist_buttons_shown)
                 {
-                    std::unique_lock lock(mutex);
                     tasklist_buttons.swap(buttons);
+                    invalidate();
                 }
-                std::this_thread::sleep_for(std::chrono::milliseconds(500));
             }
         }
+        // The UI Automation objects belong to this thread's apartment
+        tasklist.release();
+        if (com_initialized)
+        {
+            CoUninitialize();
+        }
     });
 }
 
 void D2DOverlayWindow::show(HWND active_window, bool snappable)
 {
     std::unique_lock lock(mutex);
-    tasklist_buttons.clear();
+    // Check if taskbar is auto-hidden. If so, don't display the number arrows
+    APPBARDATA param = {};
+    param.cbSize = sizeof(APPBARDATA);
+    tasklist_buttons_shown = (UINT)SHAppBarMessage(ABM_GETSTATE, &param) != ABS_AUTOHIDE;
+    // The buttons tracked while the overlay was hidden are shown from the first frame
+    tasklist_buttons = tasklist_buttons_shown ? tasklist.get_cached_buttons() : std::vector<TasklistButton>();
     this->active_window = active_window;
     this->active_window_snappable = snappable;
     auto old_bck = colors.start_color_menu;
     auto colors_updated = colors.update();
     auto new_light_mode = (theme_setting == Light) || (theme_setting == System && colors.light_mode);
-    if (initialized && (colors_updated || light_mode != new_light_mode))
+    if (initialized && colors_updated)
     {
         // update background colors
-        landscape.recolor(old_bck, colors.start_color_menu);
-        portrait.recolor(old_bck, colors.start_color_menu);
-        for (auto& arrow : arrows)
-        {
-            arrow.recolor(old_bck, colors.start_color_menu);
-        }
-        light_mode = new_light_mode;
-        if (light_mode)
-        {
-            landscape.recolor(0xDDDDDD, 0x222222);
-            portrait.recolor(0xDDDDDD, 0x222222);
-            for (auto& arrow : arrows)
-            {
-                arrow.recolor(0xDDDDDD, 0x222222);
-            }
-        }
-        else
+        for (auto theme : { &light_theme, &dark_theme })
         {
-            landscape.recolor(0x222222, 0xDDDDDD);
-            portrait.recolor(0x222222, 0xDDDDDD);
-            for (auto& arrow : arrows)
+            theme->landscape.recolor(old_bck, colors.start_color_menu);
+            theme->portrait.recolor(old_bck, colors.start_color_menu);
+            for (auto& arrow : theme->arrows)
             {
-                arrow.recolor(0x222222, 0xDDDDDD);
+                arrow.recolor(old_bck, colors.start_color_menu);
             }
         }
     }
+    if (initialized && light_mode != new_light_mode)
+    {
+        // resize() called by D2DWindow::show picks the documents of the theme
+        light_mode = new_light_mode;
+        use_theme = light_mode ? &light_theme : &dark_theme;
+    }
     monitors = MonitorInfo::GetMonitors(true);
     // calculate the rect covering all the screens
     total_screen = ScreenSize(monitors[0].rect);
@@ -265,22 +384,27 @@ void D2DOverlayWindow::show(HWND active_window, bool snappable)
     total_screen.rect.right += monitor_dx;
     total_screen.rect.top += monitor_dy;
     total_screen.rect.bottom += monitor_dy;
-    tasklist.update();
     if (active_window)
     {
         // Ignore errors, if this fails we will just not show the thumbnail
         DwmRegisterThumbnail(hwnd, active_window, &thumbnail);
     }
     animation.reset();
+    layered_alpha = -1;
+    track_animation(animation);
     auto primary_screen = MonitorInfo::GetPrimaryMonitor();
     shown_start_time = std::chrono::steady_clock::now();
+    if (refresh_timer)
+    {
+        ULARGE_INTEGER due_time;
+        due_time.QuadPart = static_cast<ULONGLONG>(-static_cast<LONGLONG>(REFRESH_INTERVAL_MS) * 10000);
+        FILETIME due_filetime = { due_time.LowPart, due_time.HighPart };
+        SetThreadpoolTimer(refresh_timer, &due_filetime, REFRESH_INTERVAL_MS, REFRESH_INTERVAL_MS / 5);
+    }
     lock.unlock();
     D2DWindow::show(primary_screen.left(), primary_screen.top(), primary_screen.width(), primary_screen.height());
     key_pressed.clear();
-    // Check if taskbar is auto-hidden. If so, don't display the number arrows
-    APPBARDATA param = {};
-    param.cbSize = sizeof(APPBARDATA);
-    if ((UINT)SHAppBarMessage(ABM_GETSTATE, &param) != ABS_AUTOHIDE)
+    if (tasklist_buttons_shown)
     {
         tasklist_cv_mutex.lock();
         tasklist_update = true;
@@ -305,6 +429,7 @@ void D2DOverlayWindow::animate(int vk_code, int offset)
         if (animation.vk_code == vk_code)
         {
             animation.animation.reset(0.1, 0, 1);
+            track_animation(animation.animation);
             done = true;
         }
     }
@@ -315,7 +440,6 @@ void D2DOverlayWindow::animate(int vk_code, int offset)
     AnimateKeys animation;
     std::wstring id;
     animation.vk_code = vk_code;
-    winrt::com_ptr<ID2D1SvgElement> button_letter, parent;
     if (vk_code >= 0x41 && vk_code <= 0x5A)
     {
         id.push_back('A' + (vk_code - 0x41));
@@ -368,23 +492,8 @@ void D2DOverlayWindow::animate(int vk_code, int offset)
     {
         id += L"_" + std::to_wstring(offset);
     }
-    button_letter = use_overlay->find_element(id);
-    if (!button_letter)
-    {
-        return;
-    }
-    button_letter->GetParent(parent.put());
-    if (!parent)
-    {
-        return;
-    }
-    parent->GetPreviousChild(button_letter.get(), animation.button.put());
-    if (!animation.button || !animation.button->IsAttributeSpecified(L"fill"))
-    {
-        animation.button = nullptr;
-        parent->GetNextChild(button_letter.get(), animation.button.put());
-    }
-    if (!animation.button || !animation.button->IsAttributeSpecified(L"fill"))
+    animation.button = use_overlay->find_key_button(id);
+    if (!animation.button)
     {
         return;
     }
@@ -395,6 +504,7 @@ void D2DOverlayWindow::animate(int vk_code, int offset)
     std::unique_lock lock(mutex);
     animation.animation.reset(0.1, 0, 1);
     key_animations.push_back(animation);
+    track_animation(animation.animation);
     key_pressed.push_back(vk_code);
 }
 
@@ -405,10 +515,14 @@ void D2DOverlayWindow::on_show()
 
 void D2DOverlayWindow::on_hide()
 {
-    tasklist_cv_mutex.lock();
-    tasklist_update = false;
-    tasklist_cv_mutex.unlock();
-    tasklist_cv.notify_one();
+    if (refresh_timer)
+    {
+        SetThreadpoolTimer(refresh_timer, nullptr, 0, 0);
+    }
+    {
+        std::unique_lock lock(mutex);
+        tasklist_buttons_shown = false;
+    }
     if (thumbnail)
     {
         DwmUnregisterThumbnail(thumbnail);
@@ -425,11 +539,43 @@ void D2DOverlayWindow::on_hide()
 
 D2DOverlayWindow::~D2DOverlayWindow()
 {
+    wait_for_prewarm();
+    // Late taskbar events must not reach the members destroyed before the tasklist
+    tasklist.set_changed_callback(nullptr);
     tasklist_cv_mutex.lock();
     running = false;
     tasklist_cv_mutex.unlock();
     tasklist_cv.notify_one();
     tasklist_thread.join();
+    if (foreground_hook)
+    {
+        UnhookWinEvent(foreground_hook);
+    }
+    if (minimize_hook)
+    {
+        UnhookWinEvent(minimize_hook);
+    }
+    win_event_overlay = nullptr;
+    if (refresh_timer)
+    {
+        SetThreadpoolTimer(refresh_timer, nullptr, 0, 0);
+        WaitForThreadpoolTimerCallbacks(refresh_timer, TRUE);
+        CloseThreadpoolTimer(refresh_timer);
+    }
+}
+
+void CALLBACK D2DOverlayWindow::on_win_event(HWINEVENTHOOK, DWORD, HWND, LONG, LONG, DWORD, DWORD)
+{
+    // The next frame checks Start, the Windows key and the active window again
+    if (win_event_overlay && IsWindowVisible(win_event_overlay->hwnd))
+    {
+        win_event_overlay->invalidate();
+    }
+}
+
+void CALLBACK D2DOverlayWindow::on_refresh_timer(PTP_CALLBACK_INSTANCE, PVOID context, PTP_TIMER)
+{
+    static_cast<D2DOverlayWindow*>(context)->invalidate();
 }
 
 void D2DOverlayWindow::apply_overlay_opacity(float opacity)
@@ -478,48 +624,55 @@ float D2DOverlayWindow::get_overlay_opacity()
     return overlay_opacity;
 }
 
-void D2DOverlayWindow::init()
+void D2DOverlayWindow::load_theme(OverlayTheme& theme, bool dark)
 {
-    colors.update();
-    landscape.load(L"svgs\\overlay.svg", d2d_dc.get())
+    theme.landscape.load(L"svgs\\overlay.svg", d2d_dc.get())
         .find_thumbnail(L"path-1")
         .find_window_group(L"Group-1")
         .recolor(0x000000, colors.start_color_menu);
-    portrait.load(L"svgs\\overlay_portrait.svg", d2d_dc.get())
+    theme.portrait.load(L"svgs\\overlay_portrait.svg", d2d_dc.get())
         .find_thumbnail(L"path-1")
         .find_window_group(L"Group-1")
         .recolor(0x000000, colors.start_color_menu);
-    no_active.load(L"svgs\\no_active_window.svg", d2d_dc.get());
-    arrows.resize(10);
-    for (unsigned i = 0; i < arrows.size(); ++i)
+    theme.arrows.resize(10);
+    for (unsigned i = 0; i < theme.arrows.size(); ++i)
     {
-        arrows[i].load(L"svgs\\" + std::to_wstring((i + 1) % 10) + L".svg", d2d_dc.get()).recolor(0x000000, colors.start_color_menu);
+        theme.arrows[i].load(L"svgs\\" + std::to_wstring((i + 1) % 10) + L".svg", d2d_dc.get()).recolor(0x000000, colors.start_color_menu);
     }
-    light_mode = (theme_setting == Light) || (theme_setting == System && colors.light_mode);
-    if (!light_mode)
+    if (dark)
     {
-        landscape.recolor(0x222222, 0xDDDDDD);
-        portrait.recolor(0x222222, 0xDDDDDD);
-        for (auto& arrow : arrows)
+        theme.landscape.recolor(0x222222, 0xDDDDDD);
+        theme.portrait.recolor(0x222222, 0xDDDDDD);
+        for (auto& arrow : theme.arrows)
         {
             arrow.recolor(0x222222, 0xDDDDDD);
         }
     }
 }
 
+void D2DOverlayWindow::init()
+{
+    colors.update();
+    load_theme(light_theme, false);
+    load_theme(dark_theme, true);
+    no_active.load(L"svgs\\no_active_window.svg", d2d_dc.get());
+    light_mode = (theme_setting == Light) || (theme_setting == System && colors.light_mode);
+    use_theme = light_mode ? &light_theme : &dark_theme;
+}
+
 void D2DOverlayWindow::resize()
 {
     window_rect = *get_window_pos(hwnd);
     float no_active_scale, font;
     if (window_width >= window_height)
     { // portrait is broke right now
-        use_overlay = &landscape;
+        use_overlay = &use_theme->landscape;
         no_active_scale = 0.3f;
         font = 15.0f;
     }
     else
     {
-        use_overlay = &portrait;
+        use_overlay = &use_theme->portrait;
         no_active_scale = 0.5f;
         font = 16.0f;
     }
@@ -533,34 +686,32 @@ void D2DOverlayWindow::resize()
     text.resize(font, use_overlay->get_scale());
 }
 
-void render_arrow(D2DSVG& arrow, TasklistButton& button, RECT window, float max_scale, ID2D1DeviceContext5* d2d_dc)
+void render_arrow(D2DArrowSVG& arrow, TasklistButton& button, RECT window, float max_scale, ID2D1DeviceContext5* d2d_dc)
 {
     int dx = 0, dy = 0;
     // Calculate taskbar orientation
-    arrow.toggle_element(L"left", false);
-    arrow.toggle_element(L"right", false);
-    arrow.toggle_element(L"top", false);
-    arrow.toggle_element(L"bottom", false);
+    std::bitset<D2DArrowSVG::DirectionCount> directions;
     if (button.x <= window.left)
     { // taskbar on left
         dx = 1;
-        arrow.toggle_element(L"left", true);
+        directions.set(D2DArrowSVG::Left);
     }
     if (button.x >= window.right)
     { // taskbar on right
         dx = -1;
-        arrow.toggle_element(L"right", true);
+        directions.set(D2DArrowSVG::Right);
     }
     if (button.y <= window.top)
     { // taskbar on top
         dy = 1;
-        arrow.toggle_element(L"top", true);
+        directions.set(D2DArrowSVG::Top);
     }
     if (button.y >= window.bottom)
     { // taskbar on bottom
         dy = -1;
-        arrow.toggle_element(L"bottom", true);
+        directions.set(D2DArrowSVG::Bottom);
     }
+    arrow.show_directions(directions);
     double arrow_ratio = (double)arrow.height() / arrow.width();
     if (dy != 0)
     {
@@ -628,7 +779,13 @@ void D2DOverlayWindow::render(ID2D1DeviceContext5* d2d_dc)
     d2d_dc->Clear();
     int x_offset = 0, y_offset = 0, dimension = 0;
     auto current_anim_value = (float)animation.value(Animation::AnimFunctions::LINEAR);
-    SetLayeredWindowAttributes(hwnd, 0, (int)(255 * current_anim_value), LWA_ALPHA);
+    // The alpha only changes during the intro animation
+    int alpha = (int)(255 * current_anim_value);
+    if (alpha != layered_alpha)
+    {
+        SetLayeredWindowAttributes(hwnd, 0, alpha, LWA_ALPHA);
+        layered_alpha = alpha;
+    }
     double pos_anim_value = 1 - animation.value(Animation::AnimFunctions::EASE_OUT_EXPO);
     if (!tasklist_buttons.empty())
     {
@@ -775,6 +932,7 @@ void D2DOverlayWindow::render(ID2D1DeviceContext5* d2d_dc)
             {
                 animation.animation.reset(0.05, 1, 0);
                 animation.animation.value(Animation::AnimFunctions::EASE_OUT_EXPO);
+                track_animation(animation.animation);
             }
             else
             {
@@ -784,9 +942,7 @@ void D2DOverlayWindow::render(ID2D1DeviceContext5* d2d_dc)
         }
         ++id;
     }
-    // Finally: render the overlay...
-    use_overlay->render(d2d_dc);
-    // ... window arrows texts ...
+    // Window arrows texts
     std::wstring left, right, up, down;
     bool left_disabled = false;
     bool right_disabled = false;
@@ -862,16 +1018,28 @@ void D2DOverlayWindow::render(ID2D1DeviceContext5* d2d_dc)
         down = GET_RESOURCE_STRING(IDS_NO_ACTION);
         down_disabled = true;
     }
+    // Dim the arrow keys without an action, before the overlay is drawn so the frame shows them
+    const std::pair<OverlayElement, bool> key_groups[] = { { OverlayElement::KeyUpGroup, up_disabled },
+                                                           { OverlayElement::KeyDownGroup, down_disabled },
+                                                           { OverlayElement::KeyLeftGroup, left_disabled },
+                                                           { OverlayElement::KeyRightGroup, right_disabled } };
+    for (auto& [element, disabled] : key_groups)
+    {
+        if (auto group = use_overlay->get_element(element))
+        {
+            group->SetAttributeValue(L"fill-opacity", disabled ? 0.3f : 1.0f);
+        }
+    }
+    // Finally: render the overlay...
+    use_overlay->render(d2d_dc);
+    // ... the texts ...
     auto text_color = D2D1::ColorF(light_mode ? 0x222222 : 0xDDDDDD, active_window_snappable && (miniature_shown || window_state == MINIMIZED) ? 1.0f : 0.3f);
-    use_overlay->find_element(L"KeyUpGroup")->SetAttributeValue(L"fill-opacity", up_disabled ? 0.3f : 1.0f);
     text.set_alignment_center().write(d2d_dc, text_color, use_overlay->get_maximize_label(), up);
-    use_overlay->find_element(L"KeyDownGroup")->SetAttributeValue(L"fill-opacity", down_disabled ? 0.3f : 1.0f);
     text.write(d2d_dc, text_color, use_overlay->get_minimize_label(), down);
-    use_overlay->find_element(L"KeyLeftGroup")->SetAttributeValue(L"fill-opacity", left_disabled ? 0.3f : 1.0f);
     text.set_alignment_right().write(d2d_dc, text_color, use_overlay->get_snap_left(), left);
-    use_overlay->find_element(L"KeyRightGroup")->SetAttributeValue(L"fill-opacity", right_disabled ? 0.3f : 1.0f);
     text.set_alignment_left().write(d2d_dc, text_color, use_overlay->get_snap_right(), right);
     // ... and the arrows with numbers
+    auto& arrows = use_theme->arrows;
     for (auto&& button : tasklist_buttons)
     {
         if ((size_t)(button.keynum) - 1 >= arrows.size())
@@ -6,6 +6,9 @@
 #include "common/animation.h"
 #include "common/windows_colors.h"
 #include "common/tasklist_positions.h"
+#include <array>
+#include <bitset>
+#include <unordered_map>
 
 struct ScaleResult
 {
@@ -13,6 +16,16 @@ struct ScaleResult
     RECT rect;
 };
 
+// Elements of the overlay changed on every frame
+enum class OverlayElement
+{
+    KeyUpGroup,
+    KeyDownGroup,
+    KeyLeftGroup,
+    KeyRightGroup,
+    Count
+};
+
 class D2DOverlaySVG : public D2DSVG
 {
 public:
@@ -22,7 +35,10 @@ public:
     D2DOverlaySVG& find_window_group(const std::wstring& id);
     ScaleResult get_thumbnail_rect_and_scale(int x_offset, int y_offset, int window_cx, int window_cy, float fill);
     D2DOverlaySVG& toggle_window_group(bool active);
-    winrt::com_ptr<ID2D1SvgElement> find_element(const std::wstring& id);
+    ID2D1SvgElement* get_element(OverlayElement element) const;
+    // Returns the background of the key labeled with the element id, nullptr if there is none.
+    // Looked up on the first press of the key only.
+    winrt::com_ptr<ID2D1SvgElement> find_key_button(const std::wstring& id);
     D2D1_RECT_F get_maximize_label() const;
     D2D1_RECT_F get_minimize_label() const;
     D2D1_RECT_F get_snap_left() const;
@@ -33,6 +49,39 @@ private:
     D2D1_POINT_2F thumbnail_bottom_right = {};
     RECT thumbnail_scaled_rect = {};
     winrt::com_ptr<ID2D1SvgElement> window_group;
+    // Resolved when the document is loaded
+    std::array<winrt::com_ptr<ID2D1SvgElement>, (size_t)OverlayElement::Count> elements;
+    std::unordered_map<std::wstring, winrt::com_ptr<ID2D1SvgElement>> key_buttons;
+};
+
+// Arrow pointing at a taskbar button, with a pointer for each side the taskbar can be on
+class D2DArrowSVG : public D2DSVG
+{
+public:
+    enum Direction
+    {
+        Left,
+        Right,
+        Top,
+        Bottom,
+        DirectionCount
+    };
+
+    D2DArrowSVG& load(const std::wstring& filename, ID2D1DeviceContext5* d2d_dc);
+    // Shows the pointers of the given sides and hides the others
+    D2DArrowSVG& show_directions(std::bitset<DirectionCount> shown);
+
+private:
+    std::array<winrt::com_ptr<ID2D1SvgElement>, DirectionCount> directions;
+    std::bitset<DirectionCount> shown_directions;
+    bool directions_set = false;
+};
+
+// The documents of one theme, recolored once when loaded
+struct OverlayTheme
+{
+    D2DOverlaySVG landscape, portrait;
+    std::vector<D2DArrowSVG> arrows;
 };
 
 struct AnimateKeys
@@ -58,12 +107,15 @@ private:
     void animate(int vk_code, int offset);
     bool show_thumbnail(const RECT& rect, double alpha);
     void hide_thumbnail();
+    void load_theme(OverlayTheme& theme, bool dark);
     virtual void init() override;
     virtual void resize() override;
     virtual void render(ID2D1DeviceContext5* d2d_dc) override;
     virtual void on_show() override;
     virtual void on_hide() override;
     float get_overlay_opacity();
+    static void CALLBACK on_win_event(HWINEVENTHOOK hook, DWORD event, HWND window, LONG object, LONG child, DWORD thread, DWORD time);
+    static void CALLBACK on_refresh_timer(PTP_CALLBACK_INSTANCE callback_instance, PVOID context, PTP_TIMER timer);
 
     bool running = true;
     std::vector<AnimateKeys> key_animations;
@@ -74,21 +126,36 @@ private:
     D2DText text;
     WindowsColors colors;
     Animation animation;
+    // Last alpha set with SetLayeredWindowAttributes, -1 when not set since shown
+    int layered_alpha = -1;
     RECT window_rect = {};
     Tasklist tasklist;
     std::vector<TasklistButton> tasklist_buttons;
     std::thread tasklist_thread;
+    // Set by show and by the taskbar events, the thread refreshes the buttons
     bool tasklist_update = false;
+    // Whether the overlay shows the tasklist buttons, guarded by mutex
+    bool tasklist_buttons_shown = false;
     std::mutex tasklist_cv_mutex;
     std::condition_variable tasklist_cv;
 
+    // The overlay only renders when invalidated, these invalidate it for the changes it doesn't
+    // cause itself. Start opening or another window coming to the foreground hide it, and the
+    // active window being minimized or restored changes its thumbnail.
+    HWINEVENTHOOK foreground_hook = nullptr;
+    HWINEVENTHOOK minimize_hook = nullptr;
+    // Renders the overlay a few times per second while it is shown, for what no event reports,
+    // e.g. Start visibility changing without a foreground change or the active window moving
+    PTP_TIMER refresh_timer = nullptr;
+
     HTHUMBNAIL thumbnail;
     HWND active_window = nullptr;
     bool active_window_snappable = false;
-    D2DOverlaySVG landscape, portrait;
+    // Both themes are ready from init, switching the theme does not touch the documents
+    OverlayTheme light_theme, dark_theme;
+    OverlayTheme* use_theme = nullptr;
     D2DOverlaySVG* use_overlay = nullptr;
     D2DSVG no_active;
-    std::vector<D2DSVG> arrows;
     std::chrono::steady_clock::time_point shown_start_time;
     float overlay_opacity = 0.9f;
     enum
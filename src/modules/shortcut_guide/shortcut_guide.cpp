@@ -79,8 +79,14 @@ bool OverlayWindow::get_config(wchar_t* buffer, int* buffer_size)
     return settings.serialize_to_buffer(buffer, buffer_size);
 }
 
+unsigned long long OverlayWindow::get_config_generation()
+{
+    return config_generation;
+}
+
 void OverlayWindow::set_config(const wchar_t* config)
 {
+    ++config_generation;
     try
     {
         // save configuration
@@ -215,6 +221,12 @@ void OverlayWindow::on_held_press(DWORD vkCode)
     winkey_popup->animate(vkCode);
 }
 
+void OverlayWindow::on_held_release()
+{
+    // The overlay only renders when asked to, the next frame sees the released key and hides it
+    winkey_popup->invalidate();
+}
+
 void OverlayWindow::quick_hide()
 {
     winkey_popup->quick_hide();
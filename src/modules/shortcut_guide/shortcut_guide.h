@@ -17,6 +17,7 @@ public:
     virtual const wchar_t* get_name() override;
     virtual const wchar_t** get_events() override;
     virtual bool get_config(wchar_t* buffer, int* buffer_size) override;
+    virtual unsigned long long get_config_generation() override;
 
     virtual void set_config(const wchar_t* config) override;
     virtual void enable() override;
@@ -31,6 +32,7 @@ public:
 
     void on_held();
     void on_held_press(DWORD vkCode);
+    void on_held_release();
     void quick_hide();
     void was_hidden();
 
@@ -45,6 +47,8 @@ private:
     std::unique_ptr<D2DOverlayWindow> winkey_popup;
     bool _enabled = false;
     HHOOK hook_handle;
+    // Bumped by set_config(), the only change to the values get_config() reports
+    unsigned long long config_generation = 1;
 
     void init_settings();
     void disable(bool trace_event);
@@ -118,6 +118,7 @@ void TargetState::handle_shown()
     {
         state = Hidden;
         lock.unlock();
+        instance->on_held_release();
         return;
     }
     if (event.key_down)
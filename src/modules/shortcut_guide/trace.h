@@ -8,4 +8,5 @@ public:
     static void HideGuide(const __int64 duration_ms, std::vector<int>& key_pressed) noexcept;
     static void EnableShortcutGuide(const bool enabled) noexcept;
     static void SettingsChanged(const int press_delay_time, const int overlay_opacity, const std::wstring& theme) noexcept;
+    static void TasklistError(const HRESULT hr) noexcept;
 };
@@ -7,6 +7,7 @@
 #include "powertoy_module.h"
 #include <common/windows_colors.h>
 #include <common/winstore.h>
+#include <common/span_tracing.h>
 
 #include "trace.h"
 
@@ -108,7 +109,7 @@ GeneralSettings get_general_settings()
 
     for (auto& [name, powertoy] : modules())
     {
-        settings.isModulesEnabledMap[name] = powertoy->is_enabled();
+        settings.isModulesEnabledMap[name] = powertoy.is_enabled();
     }
 
     return settings;
@@ -116,6 +117,7 @@ GeneralSettings get_general_settings()
 
 void apply_general_settings(const json::JsonObject& general_configs)
 {
+    PERF_SPAN("apply_general_settings");
     run_as_elevated = general_configs.GetNamedBoolean(L"run_elevated", false);
 
     download_updates_automatically = general_configs.GetNamedBoolean(L"download_updates_automatically", true);
@@ -173,7 +175,7 @@ void apply_general_settings(const json::JsonObject& general_configs)
             {
                 continue;
             }
-            const bool module_inst_enabled = modules().at(name)->is_enabled();
+            const bool module_inst_enabled = modules().at(name).is_enabled();
             const bool target_enabled = value.GetBoolean();
             if (module_inst_enabled == target_enabled)
             {
@@ -200,8 +202,9 @@ void apply_general_settings(const json::JsonObject& general_configs)
     Trace::SettingsChanged(save_settings);
 }
 
-void start_initial_powertoys()
+std::unordered_set<std::wstring> get_disabled_powertoys()
 {
+    PERF_SPAN("get_disabled_powertoys");
     std::unordered_set<std::wstring> powertoys_to_disable;
 
     json::JsonObject general_settings;
@@ -223,7 +226,12 @@ void start_initial_powertoys()
     catch (...)
     {
     }
+    return powertoys_to_disable;
+}
 
+void start_initial_powertoys(const std::unordered_set<std::wstring>& powertoys_to_disable)
+{
+    PERF_SPAN("start_initial_powertoys");
     if (powertoys_to_disable.empty())
     {
         for (auto& [name, powertoy] : modules())
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <common/json.h>
+#include <unordered_set>
 
 struct GeneralSettings
 {
@@ -22,4 +23,6 @@ struct GeneralSettings
 json::JsonObject load_general_settings();
 GeneralSettings get_general_settings();
 void apply_general_settings(const json::JsonObject& general_configs);
-void start_initial_powertoys();
+// Names of the PowerToys disabled in the saved general settings
+std::unordered_set<std::wstring> get_disabled_powertoys();
+void start_initial_powertoys(const std::unordered_set<std::wstring>& powertoys_to_disable);
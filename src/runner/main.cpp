@@ -4,6 +4,7 @@
 #include <filesystem>
 #include "tray_icon.h"
 #include "powertoy_module.h"
+#include "module_loader.h"
 #include "trace.h"
 #include "general_settings.h"
 #include "restart_elevated.h"
@@ -11,6 +12,8 @@
 
 #include <common/common.h>
 #include <common/dpi_aware.h>
+#include <common/shell_extension_settings.h>
+#include <common/span_tracing.h>
 
 #include <common/winstore.h>
 #include <common/notifications.h>
@@ -120,6 +123,10 @@ int runner(bool isProcessElevated)
         notifications::register_background_toast_handler();
 
         chdir_current_executable();
+
+        // Shared settings snapshot read by the shell extensions, modules publish into it while loading.
+        shell_extension_settings::Publisher shell_extension_settings_publisher;
+
         // Load Powertoys DLLS
         // For now only load known DLLs
         
@@ -146,6 +153,7 @@ int runner(bool isProcessElevated)
             L"KeyboardManager/"
         };
 
+        std::vector<std::wstring> dll_paths;
         for (std::wstring subfolderName : module_folders)
         {
             for (auto& file : std::filesystem::directory_iterator(baseModuleFolder + subfolderName))
@@ -154,22 +162,19 @@ int runner(bool isProcessElevated)
                     continue;
                 if (known_dlls.find(file.path().filename()) == known_dlls.end())
                     continue;
-                try
-                {
-                    auto module = load_powertoy(file.path().wstring());
-                    modules().emplace(module->get_name(), std::move(module));
-                }
-                catch (...)
-                {
-                }
+                dll_paths.push_back(file.path().wstring());
             }
         }
+        const auto disabled_powertoys = get_disabled_powertoys();
+        load_powertoys(dll_paths, disabled_powertoys);
+
         // Start initial powertoys
-        start_initial_powertoys();
+        start_initial_powertoys(disabled_powertoys);
 
         Trace::EventLaunch(get_product_version(), isProcessElevated);
 
         result = run_message_loop();
+        PERF_SPAN_WRITE_TRACE(L"runner");
     }
     catch (std::runtime_error& err)
     {
@@ -0,0 +1,193 @@
+#include "pch.h"
+#include "module_loader.h"
+#include "powertoy_module.h"
+
+#include <common/json.h>
+#include <common/settings_helpers.h>
+#include <common/span_tracing.h>
+#include <filesystem>
+#include <future>
+
+namespace
+{
+    using clock = std::chrono::high_resolution_clock;
+
+    const wchar_t STARTUP_REPORT_FILENAME[] = L"\\startup.json";
+
+    std::wstring get_startup_report_location()
+    {
+        return PTSettingsHelper::get_root_save_folder_location() + STARTUP_REPORT_FILENAME;
+    }
+
+    double to_milliseconds(const clock::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    struct ModuleStartup
+    {
+        std::wstring path;
+        std::wstring name;
+        clock::duration load_time{};
+        clock::duration create_time{};
+        bool concurrent = false;
+        bool deferred = false;
+    };
+
+    // Names of the PowerToys by DLL file name, for the first startup without a report. They are the
+    // names the settings window uses, a localized name missing from them just loads the PowerToy.
+    const std::unordered_map<std::wstring, std::wstring> DEFAULT_POWERTOY_NAMES = {
+        { L"fancyzones.dll", L"FancyZones" },
+        { L"ImageResizerExt.dll", L"Image Resizer" },
+        { L"KeyboardManager.dll", L"Keyboard Manager" },
+        { L"Microsoft.Launcher.dll", L"PowerToys Run" },
+        { L"PowerRenameExt.dll", L"PowerRename" },
+        { L"powerpreview.dll", L"File Explorer" },
+        { L"ShortcutGuide.dll", L"Shortcut Guide" }
+    };
+
+    // Names of the PowerToys by DLL path, from the last report. The names are localized resources
+    // of the DLLs, so the runner knows them only after creating the PowerToys once.
+    std::unordered_map<std::wstring, std::wstring> read_powertoy_names()
+    {
+        std::unordered_map<std::wstring, std::wstring> names;
+        try
+        {
+            auto report = json::from_file(get_startup_report_location());
+            if (report && json::has(*report, L"modules", json::JsonValueType::Array))
+            {
+                for (const auto& element : report->GetNamedArray(L"modules"))
+                {
+                    const auto module = element.GetObjectW();
+                    names.emplace(module.GetNamedString(L"path"), module.GetNamedString(L"name"));
+                }
+            }
+        }
+        catch (...)
+        {
+        }
+        return names;
+    }
+
+    void write_startup_report(const std::vector<ModuleStartup>& startups, const clock::duration total_time)
+    {
+        json::JsonArray modules;
+        for (const auto& startup : startups)
+        {
+            if (startup.name.empty())
+            {
+                continue;
+            }
+            json::JsonObject module;
+            module.SetNamedValue(L"path", json::value(startup.path));
+            module.SetNamedValue(L"name", json::value(startup.name));
+            module.SetNamedValue(L"load_ms", json::value(to_milliseconds(startup.load_time)));
+            module.SetNamedValue(L"create_ms", json::value(to_milliseconds(startup.create_time)));
+            module.SetNamedValue(L"concurrent", json::value(startup.concurrent));
+            module.SetNamedValue(L"deferred", json::value(startup.deferred));
+            modules.Append(module);
+        }
+
+        json::JsonObject report;
+        report.SetNamedValue(L"total_ms", json::value(to_milliseconds(total_time)));
+        report.SetNamedValue(L"modules", modules);
+        try
+        {
+            json::to_file(get_startup_report_location(), report);
+        }
+        catch (...)
+        {
+        }
+    }
+
+    // A loaded DLL, with the PowerToy already created if that could be done on the worker thread
+    struct LoadedDll
+    {
+        HMODULE handle = nullptr;
+        PowertoyModuleIface* powertoy = nullptr;
+        clock::duration load_time{};
+        clock::duration create_time{};
+    };
+
+    LoadedDll load_dll(const std::wstring& path)
+    {
+        PERF_SPAN("load_dll");
+        LoadedDll dll;
+        auto start = clock::now();
+        dll.handle = load_powertoy_dll(path);
+        dll.load_time = clock::now() - start;
+        if (get_powertoy_startup_flags(dll.handle) & POWERTOY_STARTUP_CONCURRENT_CREATE)
+        {
+            PERF_SPAN("create_powertoy");
+            start = clock::now();
+            dll.powertoy = create_powertoy(dll.handle);
+            dll.create_time = clock::now() - start;
+        }
+        return dll;
+    }
+}
+
+void load_powertoys(const std::vector<std::wstring>& dll_paths, const std::unordered_set<std::wstring>& disabled_powertoys)
+{
+    PERF_SPAN("load_powertoys");
+    const auto start = clock::now();
+    const auto names = read_powertoy_names();
+
+    std::vector<ModuleStartup> startups(dll_paths.size());
+    std::vector<std::future<LoadedDll>> loading(dll_paths.size());
+    for (size_t i = 0; i < dll_paths.size(); ++i)
+    {
+        auto& startup = startups[i];
+        startup.path = dll_paths[i];
+        const std::wstring* name = nullptr;
+        if (const auto reported = names.find(startup.path); reported != names.end())
+        {
+            name = &reported->second;
+        }
+        else if (const auto known = DEFAULT_POWERTOY_NAMES.find(std::filesystem::path(startup.path).filename()); known != DEFAULT_POWERTOY_NAMES.end())
+        {
+            name = &known->second;
+        }
+        if (name && disabled_powertoys.find(*name) != disabled_powertoys.end())
+        {
+            startup.name = *name;
+            startup.deferred = true;
+        }
+        else
+        {
+            loading[i] = std::async(std::launch::async, load_dll, startup.path);
+        }
+    }
+
+    for (size_t i = 0; i < dll_paths.size(); ++i)
+    {
+        auto& startup = startups[i];
+        if (startup.deferred)
+        {
+            modules().emplace(startup.name, PowertoyModule(startup.path, startup.name));
+            continue;
+        }
+        try
+        {
+            auto dll = loading[i].get();
+            startup.load_time = dll.load_time;
+            startup.concurrent = dll.powertoy != nullptr;
+            if (!dll.powertoy)
+            {
+                PERF_SPAN("create_powertoy");
+                const auto create_start = clock::now();
+                dll.powertoy = create_powertoy(dll.handle);
+                dll.create_time = clock::now() - create_start;
+            }
+            startup.create_time = dll.create_time;
+            PowertoyModule module(dll.powertoy, dll.handle);
+            startup.name = module->get_name();
+            modules().emplace(startup.name, std::move(module));
+        }
+        catch (...)
+        {
+        }
+    }
+
+    write_startup_report(startups, clock::now() - start);
+}
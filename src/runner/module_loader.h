@@ -0,0 +1,13 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_set>
+
+// Loads the PowerToys DLLs into modules(). The DLLs are loaded concurrently and the PowerToys
+// declaring POWERTOY_STARTUP_CONCURRENT_CREATE are created on the same worker threads; the others
+// are created on the calling thread, in the order of dll_paths. PowerToys disabled in the general
+// settings, under the name they had when last loaded or their default name on the first startup,
+// aren't loaded until they are enabled or their settings are saved.
+// The time spent on every DLL is written to startup.json in the settings folder, which also
+// keeps the names of the PowerToys for the next startup.
+void load_powertoys(const std::vector<std::wstring>& dll_paths, const std::unordered_set<std::wstring>& disabled_powertoys);
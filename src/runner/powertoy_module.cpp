@@ -1,15 +1,73 @@
 #include "pch.h"
 #include "powertoy_module.h"
 
+#include <common/settings_helpers.h>
+#include <common/span_tracing.h>
+#include <filesystem>
+
+namespace
+{
+    const wchar_t CONFIG_SNAPSHOT_FILENAME[] = L"\\config_snapshot.json";
+    const wchar_t SETTINGS_FILENAME[] = L"\\settings.json";
+
+    // The configuration the PowerToy returned when it was last loaded, unless its settings were saved
+    // after that, e.g. by an older runner or by hand
+    json::JsonObject read_config_snapshot(const std::wstring& name)
+    {
+        try
+        {
+            const auto folder = PTSettingsHelper::get_module_save_folder_location(name);
+            std::error_code error;
+            const auto snapshot_time = std::filesystem::last_write_time(folder + CONFIG_SNAPSHOT_FILENAME, error);
+            if (error)
+            {
+                return nullptr;
+            }
+            const auto settings_time = std::filesystem::last_write_time(folder + SETTINGS_FILENAME, error);
+            if (!error && settings_time > snapshot_time)
+            {
+                return nullptr;
+            }
+            auto snapshot = json::from_file(folder + CONFIG_SNAPSHOT_FILENAME);
+            return snapshot ? *snapshot : nullptr;
+        }
+        catch (...)
+        {
+            return nullptr;
+        }
+    }
+
+    void write_config_snapshot(const std::wstring& name, const json::JsonObject& config)
+    {
+        try
+        {
+            json::to_file(PTSettingsHelper::get_module_save_folder_location(name) + CONFIG_SNAPSHOT_FILENAME, config);
+        }
+        catch (...)
+        {
+        }
+    }
+}
+
 std::map<std::wstring, PowertoyModule>& modules()
 {
     static std::map<std::wstring, PowertoyModule> modules;
     return modules;
 }
 
-PowertoyModule load_powertoy(const std::wstring& filename)
+HMODULE load_powertoy_dll(const std::wstring& filename)
+{
+    return winrt::check_pointer(LoadLibraryW(filename.c_str()));
+}
+
+unsigned get_powertoy_startup_flags(HMODULE handle)
+{
+    auto startup_flags = reinterpret_cast<powertoy_startup_flags_func>(GetProcAddress(handle, "powertoy_startup_flags"));
+    return startup_flags ? startup_flags() : 0;
+}
+
+PowertoyModuleIface* create_powertoy(HMODULE handle)
 {
-    auto handle = winrt::check_pointer(LoadLibraryW(filename.c_str()));
     auto create = reinterpret_cast<powertoy_create_func>(GetProcAddress(handle, "powertoy_create"));
     if (!create)
     {
@@ -22,18 +80,116 @@ PowertoyModule load_powertoy(const std::wstring& filename)
         FreeLibrary(handle);
         winrt::throw_last_error();
     }
-    module->register_system_menu_helper(&SystemMenuHelperInstance());
-    return PowertoyModule(module, handle);
+    return module;
 }
 
-json::JsonObject PowertoyModule::json_config() const
+PowertoyModule load_powertoy(const std::wstring& filename)
+{
+    auto handle = load_powertoy_dll(filename);
+    return PowertoyModule(create_powertoy(handle), handle);
+}
+
+json::JsonObject PowertoyModule::json_config()
+{
+    PERF_SPAN("get_config");
+    if (!module)
+    {
+        // The settings window shows the configuration of disabled PowerToys too, without loading them
+        if (!config_snapshot)
+        {
+            config_snapshot = read_config_snapshot(name);
+        }
+        if (config_snapshot)
+        {
+            return config_snapshot;
+        }
+    }
+
+    auto powertoy = operator->();
+    const auto generation = powertoy->get_config_generation();
+    if (generation != 0 && generation == config_generation && config_snapshot)
+    {
+        return config_snapshot;
+    }
+
+    int size = static_cast<int>(config_buffer.size());
+    if (!powertoy->get_config(size > 0 ? config_buffer.data() : nullptr, &size))
+    {
+        config_buffer.resize(size);
+        powertoy->get_config(config_buffer.data(), &size);
+    }
+    config_snapshot = json::JsonObject::Parse(config_buffer.c_str());
+    config_generation = generation;
+    if (saved_config != config_buffer.c_str())
+    {
+        write_config_snapshot(name, config_snapshot);
+        saved_config = config_buffer.c_str();
+    }
+    return config_snapshot;
+}
+
+bool PowertoyModule::set_config(const json::JsonObject& config)
+{
+    PERF_SPAN("set_config");
+    if (applied_config && json::equals(config, applied_config))
+    {
+        return false;
+    }
+
+    // The properties which changed since the configuration last applied, all of them if it wasn't
+    std::vector<std::wstring> changed;
+    std::vector<const wchar_t*> changed_names;
+    const bool diffed = applied_config && json::has(applied_config, L"properties") && json::has(config, L"properties");
+    if (diffed)
+    {
+        changed = json::changed_members(applied_config.GetNamedObject(L"properties"), config.GetNamedObject(L"properties"));
+        for (const auto& property : changed)
+        {
+            changed_names.push_back(property.c_str());
+        }
+        changed_names.push_back(nullptr);
+    }
+
+    // Forgotten until the PowerToy applied it, so the same configuration is sent again if that fails
+    applied_config = nullptr;
+    const auto config_string = config.Stringify();
+    if (operator->()->set_changed_config({ config_string.c_str(), diffed ? changed_names.data() : nullptr }))
+    {
+        applied_config = config;
+    }
+
+    // The PowerToy saves its settings now, write the snapshot again so it stays newer than them
+    config_generation = 0;
+    saved_config.clear();
+    try
+    {
+        json_config();
+    }
+    catch (...)
+    {
+    }
+    return true;
+}
+
+bool PowertoyModule::is_enabled()
+{
+    return module && module->is_enabled();
+}
+
+void PowertoyModule::load()
+{
+    PERF_SPAN("load_powertoy");
+    auto loaded = load_powertoy(filename);
+    handle = std::move(loaded.handle);
+    module = std::move(loaded.module);
+    // Read from the PowerToy from now on
+    config_snapshot = nullptr;
+    config_generation = 0;
+}
+
+PowertoyModule::PowertoyModule(std::wstring filename, std::wstring name) :
+    filename(std::move(filename)), name(std::move(name))
 {
-    int size = 0;
-    module->get_config(nullptr, &size);
-    std::wstring result;
-    result.resize(size - 1);
-    module->get_config(result.data(), &size);
-    return json::JsonObject::Parse(result);
 }
 
 PowertoyModule::PowertoyModule(PowertoyModuleIface* module, HMODULE handle) :
@@ -43,6 +199,8 @@ PowertoyModule::PowertoyModule(PowertoyModuleIface* module, HMODULE handle) :
     {
         throw std::runtime_error("Module not initialized");
     }
+    name = module->get_name();
+    module->register_system_menu_helper(&SystemMenuHelperInstance());
     auto want_signals = module->get_events();
     if (want_signals)
     {
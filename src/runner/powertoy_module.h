@@ -36,18 +36,59 @@ class PowertoyModule
 {
 public:
     PowertoyModule(PowertoyModuleIface* module, HMODULE handle);
+    // A PowerToy loaded from the DLL the first time it's used, under the name it had when last loaded
+    PowertoyModule(std::wstring filename, std::wstring name);
 
     inline PowertoyModuleIface* operator->()
     {
+        if (!module)
+        {
+            load();
+        }
         return module.get();
     }
 
-    json::JsonObject json_config() const;
+    // Doesn't load the PowerToy if the configuration it returned when last loaded is saved and its
+    // settings weren't changed since
+    json::JsonObject json_config();
+
+    // Sends the configuration to the PowerToy unless it equals the one it applied last time, so saves
+    // which change nothing don't make the PowerToy apply all its settings again. Otherwise passes the
+    // names of the properties which changed along.
+    // Returns whether it was sent.
+    bool set_config(const json::JsonObject& config);
+
+    // Doesn't load the PowerToy, the ones not loaded yet are disabled
+    bool is_enabled();
+
+    bool is_loaded() const
+    {
+        return module != nullptr;
+    }
 
 private:
+    void load();
+
+    std::wstring filename;
+    std::wstring name;
+    // Configuration from the last json_config(), reused until the PowerToy's generation changes
+    json::JsonObject config_snapshot{ nullptr };
+    unsigned long long config_generation = 0;
+    // Kept between the calls, so get_config() usually fits in it the first time
+    std::wstring config_buffer;
+    // Configuration last written to the config snapshot file
+    std::wstring saved_config;
+    // Last configuration the PowerToy applied
+    json::JsonObject applied_config{ nullptr };
     std::unique_ptr<HMODULE, PowertoyModuleDLLDeleter> handle;
     std::unique_ptr<PowertoyModuleIface, PowertoyModuleDeleter> module;
 };
 
+// Loads the DLL of a PowerToy without creating it
+HMODULE load_powertoy_dll(const std::wstring& filename);
+// Returns the flags from powertoy_startup_flags(), or 0 if the DLL doesn't export it
+unsigned get_powertoy_startup_flags(HMODULE handle);
+// Calls powertoy_create(), frees the DLL if it fails
+PowertoyModuleIface* create_powertoy(HMODULE handle);
 PowertoyModule load_powertoy(const std::wstring& filename);
 std::map<std::wstring, PowertoyModule>& modules();
@@ -4,6 +4,8 @@
 #include "win_hook_event.h"
 #include "system_menu_helper.h"
 
+#include <common/span_tracing.h>
+
 void first_subscribed(const std::wstring& event)
 {
     if (event == ll_keyboard)
@@ -91,6 +93,7 @@ void PowertoysEvents::handle_system_menu_action(const WinHookEvent& data)
 
 intptr_t PowertoysEvents::signal_event(const std::wstring& event, intptr_t data)
 {
+    PERF_SPAN("signal_event");
     intptr_t rvalue = 0;
     std::shared_lock lock(mutex);
     if (auto it = receivers.find(event); it != end(receivers))
@@ -13,6 +13,7 @@
 #include "restart_elevated.h"
 
 #include <common/json.h>
+#include <common/span_tracing.h>
 #include <common\settings_helpers.cpp>
 #include <os-detect.h>
 
@@ -24,7 +25,7 @@ std::atomic_bool g_isLaunchInProgress = false;
 json::JsonObject get_power_toys_settings()
 {
     json::JsonObject result;
-    for (const auto& [name, powertoy] : modules())
+    for (auto& [name, powertoy] : modules())
     {
         try
         {
@@ -75,25 +76,31 @@ void dispatch_json_action_to_module(const json::JsonObject& powertoys_configs)
     }
 }
 
-void send_json_config_to_module(const std::wstring& module_key, const std::wstring& settings)
-{
-    if (modules().find(module_key) != modules().end())
-    {
-        modules().at(module_key)->set_config(settings.c_str());
-    }
-}
-
 void dispatch_json_config_to_modules(const json::JsonObject& powertoys_configs)
 {
     for (const auto& powertoy_element : powertoys_configs)
     {
-        const auto element = powertoy_element.Value().Stringify();
-        send_json_config_to_module(powertoy_element.Key().c_str(), element.c_str());
+        const std::wstring name{ powertoy_element.Key().c_str() };
+        const auto value = powertoy_element.Value();
+        if (modules().find(name) == modules().end())
+        {
+            continue;
+        }
+        if (value.ValueType() == json::JsonValueType::Object)
+        {
+            // Modules whose configuration didn't change aren't called
+            modules().at(name).set_config(value.GetObjectW());
+        }
+        else
+        {
+            modules().at(name)->set_config(value.Stringify().c_str());
+        }
     }
 };
 
 void dispatch_received_json(const std::wstring& json_to_parse)
 {
+    PERF_SPAN("dispatch_received_json");
     const json::JsonObject j = json::JsonObject::Parse(json_to_parse);
     for (const auto& base_element : j)
     {
@@ -137,7 +144,14 @@ void dispatch_received_json(const std::wstring& json_to_parse)
 void dispatch_received_json_callback(PVOID data)
 {
     std::wstring* msg = (std::wstring*)data;
-    dispatch_received_json(*msg);
+    try
+    {
+        dispatch_received_json(*msg);
+    }
+    catch (...)
+    {
+        // PowerToys which weren't loaded at startup are loaded here and can fail to load
+    }
     delete msg;
 }
 
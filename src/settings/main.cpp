@@ -7,6 +7,7 @@
 #include "resource.h"
 #include <common/dpi_aware.h>
 #include <common/common.h>
+#include <common/json.h>
 #include <Sddl.h>
 
 #include "trace.h"
@@ -124,19 +125,13 @@ void send_message_to_webview(const std::wstring& msg)
     }
 }
 
-void send_message_to_powertoys_runner(const std::wstring& msg)
-{
-    if (g_message_pipe != nullptr)
-    {
-        g_message_pipe->send(msg);
-    }
-    else
-    {
-        // For Debug purposes, in case the webview is being run alone.
 #ifdef _DEBUG
-        MessageBox(g_main_wnd, msg.c_str(), L"From Webview", MB_OK);
-        //throw in some sample data
-        std::wstring debug_settings_info(LR"json({
+// For Debug purposes, in case the webview is being run alone.
+void show_message_to_powertoys_runner(const std::wstring& msg)
+{
+    MessageBox(g_main_wnd, msg.c_str(), L"From Webview", MB_OK);
+    //throw in some sample data
+    std::wstring debug_settings_info(LR"json({
             "general": {
               "startup": true,
               "enabled": {
@@ -195,7 +190,53 @@ void send_message_to_powertoys_runner(const std::wstring& msg)
               }
             }
           })json");
-        send_message_to_webview(debug_settings_info);
+    send_message_to_webview(debug_settings_info);
+}
+#endif
+
+// Messages holding all the general settings or all the settings of one PowerToy get a key, so that
+// a newer one replaces the one waiting to be sent, e.g. while a slider is dragged. Other messages,
+// like custom actions, are all sent in order.
+std::wstring get_coalescing_key(const std::wstring& msg)
+{
+    try
+    {
+        const auto message = json::JsonObject::Parse(msg);
+        if (message.Size() != 1)
+        {
+            return {};
+        }
+        if (json::has(message, L"general", json::JsonValueType::Object))
+        {
+            return L"general";
+        }
+        if (json::has(message, L"powertoys", json::JsonValueType::Object))
+        {
+            const auto powertoys = message.GetNamedObject(L"powertoys");
+            if (powertoys.Size() == 1)
+            {
+                return L"powertoys/" + std::wstring{ powertoys.First().Current().Key() };
+            }
+        }
+    }
+    catch (...)
+    {
+    }
+    return {};
+}
+
+void send_message_to_powertoys_runner(const std::wstring& msg)
+{
+    if (g_message_pipe != nullptr)
+    {
+        // Only queues the message, the output thread of the pipe sends the queued messages one
+        // connection after the other.
+        g_message_pipe->send(msg, get_coalescing_key(msg));
+    }
+    else
+    {
+#ifdef _DEBUG
+        std::thread(show_message_to_powertoys_runner, msg).detach();
 #endif
     }
 }
@@ -205,7 +246,7 @@ void receive_message_from_webview(const std::wstring& msg)
     if (msg[0] == '{')
     {
         // It's a JSON string, send the message to the PowerToys runner.
-        std::thread(send_message_to_powertoys_runner, msg).detach();
+        send_message_to_powertoys_runner(msg);
     }
     else
     {